@@ -0,0 +1,65 @@
+#version 460
+
+#extension GL_EXT_debug_printf : enable
+
+#define VIEW_RESOLUTION 64
+#define EMPTY_TEXEL 0xFFFFFFFF
+
+layout (location = 0) in vec2 i_uv;
+layout (location = 1) flat in ivec2 i_view_origin;
+layout (location = 2) in vec3 i_position;
+layout (location = 3) flat in mat3 i_normal_mat;
+
+layout (location = 0) out vec4 o_color;
+
+layout (set = 1, binding = 0, r32ui) uniform readonly uimage2D atlas;
+
+layout (push_constant, std430) uniform DirectionalLightProps {
+    vec3 u_light_color_dif;
+    vec3 u_light_color_amb;
+    vec3 u_light_color_spec;
+    vec3 u_light_dir;
+    vec3 u_cam_pos;
+    vec3 u_view_dir;
+	bool lod_color;
+};
+
+vec3 oct_decode(vec2 f) {
+	vec3 n = vec3(f.x, f.y, 1.f - abs(f.x) - abs(f.y));
+	float t = max(-n.z, 0.f);
+	n.xy += vec2(n.x >= 0.f ? -t : t, n.y >= 0.f ? -t : t);
+	return normalize(n);
+}
+
+void main() {
+
+	ivec2 texel = clamp(ivec2(i_uv * VIEW_RESOLUTION), 0, VIEW_RESOLUTION - 1);
+	uint sample_value = imageLoad(atlas, i_view_origin + texel).r;
+
+	if (sample_value == EMPTY_TEXEL) {
+		discard;
+	}
+
+	vec2 encoded_normal = vec2((sample_value >> 8) & 0xFF, sample_value & 0xFF) / 255.f;
+	vec3 normal = normalize(i_normal_mat * oct_decode(encoded_normal * 2.f - 1.f));
+
+	vec4 color = vec4(normal * 0.5 + 0.5, 1.f);
+
+    float diffuse = max(dot(normal, normalize(u_light_dir)), 0.f);
+
+    vec3 ambient = 0.01f * u_light_color_amb;
+
+    float specular = 0.f;
+
+    if (diffuse != 0.0) {
+
+        vec3 reflection_dir = reflect(-normalize(u_light_dir), normal);
+        vec3 half_vec = normalize(reflection_dir) + normalize(u_light_dir);
+
+        float spec_amount = pow(max(dot(normal, half_vec), 0.f), 3.f);
+
+        specular = spec_amount * 0.1f;
+    }
+
+    o_color = vec4(diffuse * u_light_color_amb + ambient + specular * u_light_color_spec, 1.0f) * color;
+}
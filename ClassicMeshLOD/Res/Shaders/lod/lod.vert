@@ -27,14 +27,66 @@ struct s_draw_cmd {
 	uint firstInstance;
 };
 
+struct s_instance {
+	mat4 transform;
+	uint model_id;
+};
+
+struct s_packed_instance {
+	vec3 position;
+	float scale;
+	uint rotation[2];
+	uint model_id;
+	uint padding;
+};
+
 layout (std430, set = 1, binding = 0) buffer Instances {
-	mat4 instances[];
+	s_instance instances[];
 } instance_buffer;
 
+// The same buffer as the instances, used when they are stored in the compressed format.
+layout (std430, set = 1, binding = 0) buffer PackedInstances {
+	s_packed_instance instances[];
+} packed_instances;
+
+layout (push_constant, std430) uniform InstancePC {
+	// The offset is here due to the preceding push constant used in the fragment shader.
+	layout(offset = 96) bool u_packed_instances;
+};
+
 layout (std430, set = 2, binding = 1) buffer InstanceInfos {
 	uint indices[];
 } instances_indirect;
 
+mat4 unpack_instance(s_packed_instance instance) {
+	vec4 q = normalize(vec4(unpackSnorm2x16(instance.rotation[0]), unpackSnorm2x16(instance.rotation[1])));
+
+	float xx = q.x * q.x;
+	float yy = q.y * q.y;
+	float zz = q.z * q.z;
+	float xy = q.x * q.y;
+	float xz = q.x * q.z;
+	float yz = q.y * q.z;
+	float wx = q.w * q.x;
+	float wy = q.w * q.y;
+	float wz = q.w * q.z;
+
+	mat3 rotation = mat3(
+		1.f - 2.f * (yy + zz), 2.f * (xy + wz), 2.f * (xz - wy),
+		2.f * (xy - wz), 1.f - 2.f * (xx + zz), 2.f * (yz + wx),
+		2.f * (xz + wy), 2.f * (yz - wx), 1.f - 2.f * (xx + yy)) * instance.scale;
+
+	return mat4(vec4(rotation[0], 0.f), vec4(rotation[1], 0.f), vec4(rotation[2], 0.f), vec4(instance.position, 1.f));
+}
+
+mat4 load_instance_transform(uint index) {
+	if (u_packed_instances) {
+		return unpack_instance(packed_instances.instances[index]);
+	}
+
+	return instance_buffer.instances[index].transform;
+}
+
 vec3 lod_colors[8] = {
   vec3(1,0,0), 
   vec3(0,1,0),
@@ -53,7 +105,8 @@ layout (location = 2) out vec3 o_color;
 
 void main() {
 
-	mat4 instance_mat = instance_buffer.instances[instances_indirect.indices[gl_InstanceIndex]];
+	// gl_InstanceIndex already contains the first instance of the bucket the draw belongs to.
+	mat4 instance_mat = load_instance_transform(instances_indirect.indices[gl_InstanceIndex]);
 
 	vec4 vertex = mat_buffer.proj * mat_buffer.view * vec4(a_position + instance_mat[3].xyz, 1.f);
 
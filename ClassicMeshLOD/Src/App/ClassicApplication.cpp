@@ -6,22 +6,17 @@
 #include <stddef.h>
 #include <stdexcept>
 
+#include "../../Common/Renderer/PipelineBuilder.h"
 #include "Constants.h"
 #include "GLFW/glfw3.h"
 #include "Log/Log.h"
 #include "Mesh/ClassicLODMesh.h"
 #include "Model/Camera.h"
 #include "Model/MatrixBuffer.h"
-#include "Model/Shaders/ShaderData.h"
-#include "Model/Shaders/ShaderLoader.h"
 #include "Vk/Buffers/Buffer.h"
 #include "Vk/Descriptors/DescriptorBuilder.h"
 #include "Vk/Devices/DeviceManager.h"
-#include "Vk/GraphicsPipeline/GraphicsPipelineBuilder.h"
-#include "Vk/Swapchain.h"
-#include "Vk/SwapchainRenderPass.h"
 #include "Vk/Utils.h"
-#include "Vk/Vertex/VertexAttributeBuilder.h"
 #include "backends/imgui_impl_glfw.h"
 #include "glm/ext/matrix_transform.hpp"
 #include "glm/ext/vector_float3.hpp"
@@ -32,33 +27,47 @@
 #include "vulkan/vulkan_handles.hpp"
 #include "vulkan/vulkan_structs.hpp"
 #include "glm/gtc/type_ptr.hpp"
-#include "../../Common/Query.h"
 
-void ClassicApplication::Run(const uint32_t winWidth, const uint32_t winHeight)
+void ClassicApplication::Run(const LaunchOptions& options)
 {
     Logger::SetSeverityFilter(ESeverity::Verbose);
 
-    m_Window = new VkCore::Window("Mesh Application", winWidth, winHeight);
-    m_Window->SetEventCallback(std::bind(&ClassicApplication::OnEvent, this, std::placeholders::_1));
+    // The headless mode renders offscreen, without opening a window.
+    if (!options.headless)
+    {
+        m_Window = new VkCore::Window("Mesh Application", options.width, options.height);
+        m_Window->SetEventCallback(std::bind(&ClassicApplication::OnEvent, this, std::placeholders::_1));
+    }
+
+    // The instances are read by both the LOD passes and the draws, which the exclusive VkCore buffers don't allow on
+    // queues of two families, so the LOD passes stay on the graphics queue.
+    LaunchOptions rendererOptions = options;
+    rendererOptions.dedicatedCompute = false;
 
     m_Renderer = VulkanRenderer("Mesh Application", m_Window,
                                 {VK_KHR_SWAPCHAIN_EXTENSION_NAME, VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME,
+                                 VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME, VK_EXT_MESH_SHADER_EXTENSION_NAME,
                                  VK_KHR_SHADER_NON_SEMANTIC_INFO_EXTENSION_NAME},
-                                {});
-    m_Renderer.InitImGui(m_Window, winWidth, winHeight);
+                                {}, rendererOptions);
+    m_Renderer.InitImGui(m_Window, m_Renderer.GetWidth(), m_Renderer.GetHeight());
+
+    m_vkCmdDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(
+        *VkCore::DeviceManager::GetDevice(), "vkCmdDrawIndexedIndirectCountKHR");
+    vkCmdDrawMeshTasksIndirectEXT = (PFN_vkCmdDrawMeshTasksIndirectEXT)vkGetDeviceProcAddr(
+        *VkCore::DeviceManager::GetDevice(), "vkCmdDrawMeshTasksIndirectEXT");
 
     m_Camera =
-        Camera({-1.f, 3.f, -1.f}, {1.f, 0.5f, 1.f}, (float)m_Window->GetWidth() / m_Window->GetHeight(), 45.f, 50.f);
+        Camera({-1.f, 3.f, -1.f}, {1.f, 0.5f, 1.f}, (float)m_Renderer.GetWidth() / m_Renderer.GetHeight(), 45.f, 50.f);
     m_CurrentCamera = &m_Camera;
     m_FrustumCamera =
-        Camera({-1.f, 3.f, -1.f}, {1.f, 0.5f, 1.f}, (float)m_Window->GetWidth() / m_Window->GetHeight(), 45.f, 40.f);
+        Camera({-1.f, 3.f, -1.f}, {1.f, 0.5f, 1.f}, (float)m_Renderer.GetWidth() / m_Renderer.GetHeight(), 45.f, 40.f);
 
     m_ZenithAngle = m_FrustumCamera.GetZenith();
     m_AzimuthAngle = m_FrustumCamera.GetAzimuth();
     m_Position = m_FrustumCamera.GetPosition();
 
     // Create Uniform Buffers
-    for (int i = 0; i < m_Renderer.m_Swapchain.GetImageCount(); i++)
+    for (int i = 0; i < m_Renderer.GetFramesInFlight(); i++)
     {
         VkCore::Buffer matBuffer = VkCore::Buffer(vk::BufferUsageFlagBits::eUniformBuffer);
         matBuffer.InitializeOnCpu(sizeof(MatrixBuffer));
@@ -69,104 +78,206 @@ void ClassicApplication::Run(const uint32_t winWidth, const uint32_t winHeight)
     // Camera Matrix Descriptor Sets
     m_DescriptorBuilder = VkCore::DescriptorBuilder(VkCore::DeviceManager::GetDevice());
 
-    for (uint32_t i = 0; i < m_Renderer.m_Swapchain.GetImageCount(); i++)
+    for (uint32_t i = 0; i < m_Renderer.GetFramesInFlight(); i++)
     {
         vk::DescriptorSet tempSet;
 
         m_DescriptorBuilder.BindBuffer(0, m_MatBuffers[i], vk::DescriptorType::eUniformBuffer,
-                                       vk::ShaderStageFlagBits::eVertex);
+                                       vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eMeshEXT);
         m_DescriptorBuilder.Build(tempSet, m_MatrixDescSetLayout);
         m_DescriptorBuilder.Clear();
 
         m_MatrixDescriptorSets.emplace_back(tempSet);
     }
 
+    InitializeScene();
     InitializeInstancing();
+    InitializeScratchSets();
+
+    // The scene and the instances go out in a single submission, the frames are ordered after it on the queue.
+    m_Renderer.GetUploader().Flush();
+
+    m_PipelineFactory.Initialize();
+
+    // The pipelines are built on the workers, the first frame waits for them. The axis and the frustum are only
+    // drawn by the disabled debug passes, so InitializeAxisPipeline and InitializeFrustumPipeline build them once the
+    // passes are needed.
+    m_Renderer.BeginPipelineCreation();
     InitializeModelPipeline();
 
     InitializeLODCompute();
-    InitializeAxisPipeline();
-    InitializeFrustumPipeline();
+    InitializeImpostors();
+    InitializeLODGraph();
 
     Loop();
+
+    m_Renderer.WriteHeadlessCapture();
     Shutdown();
 }
 
-void ClassicApplication::InitializeModelPipeline()
+void ClassicApplication::InitializeScene()
 {
+    for (const char* path : m_AvailableModels)
+    {
+        m_Scene.AddModel(path);
+    }
 
-    m_Model = new ClassicLODModel("ClassicMeshLOD/Res/Artwork/OBJs/kitten_lod0.obj");
-
-    const std::vector<VkCore::ShaderData> shaders =
-        VkCore::ShaderLoader::LoadClassicShaders("ClassicMeshLOD/Res/Shaders/lod", false, true);
-
-    ClassicLODMeshInfo meshInfo = m_Model->GetMesh(0).GetMeshInfo();
+    m_Scene.Build(m_Renderer.GetUploader());
 
-    m_LODMeshInfo = VkCore::Buffer(vk::BufferUsageFlagBits::eStorageBuffer);
-    m_LODMeshInfo.InitializeOnGpu(&meshInfo, sizeof(ClassicLODMeshInfo));
+    lod_pc.mesh_count = m_Scene.GetMeshCount();
 
     m_DescriptorBuilder
-        .BindBuffer(0, m_LODMeshInfo, vk::DescriptorType::eStorageBuffer,
-                    vk::ShaderStageFlagBits::eCompute | vk::ShaderStageFlagBits::eVertex)
+        .BindBuffer(0, m_Scene.GetMeshInfoBuffer(), vk::DescriptorType::eStorageBuffer,
+                    vk::ShaderStageFlagBits::eCompute)
+        .BindBuffer(1, m_Scene.GetMeshDrawBuffer(), vk::DescriptorType::eStorageBuffer,
+                    vk::ShaderStageFlagBits::eCompute)
+        .BindBuffer(2, m_Scene.GetModelInfoBuffer(), vk::DescriptorType::eStorageBuffer,
+                    vk::ShaderStageFlagBits::eCompute)
         .Build(m_LODMeshInfoSet, m_LODMeshInfoSetLayout);
 
     m_DescriptorBuilder.Clear();
+}
 
-    VkCore::VertexAttributeBuilder attributeBuilder = Vertex::CreateAttributeBuilder();
-
-    VkCore::GraphicsPipelineBuilder pipelineBuilder(VkCore::DeviceManager::GetDevice(), false);
-
-    m_ModelPipeline = pipelineBuilder.BindShaderModules(shaders)
-                          .BindRenderPass(m_Renderer.m_RenderPass.GetVkRenderPass())
-                          .EnableDepthTest()
-                          .AddViewport(glm::uvec4(0, 0, m_Window->GetWidth(), m_Window->GetHeight()))
-                          .FrontFaceDirection(vk::FrontFace::eClockwise)
-                          .SetCullMode(vk::CullModeFlagBits::eBack)
-                          .AddDisabledBlendAttachment()
-                          .BindVertexAttributes(attributeBuilder)
-                          .AddDescriptorLayout(m_MatrixDescSetLayout)
-                          .AddDescriptorLayout(m_InstancesDescSetLayout)
-                          .AddDescriptorLayout(m_ScratchSetLayout)
-                          .AddPushConstantRange<FragmentPC>(vk::ShaderStageFlagBits::eFragment)
-                          .SetPrimitiveAssembly(vk::PrimitiveTopology::eTriangleList)
-                          .AddDynamicState(vk::DynamicState::eScissor)
-                          .AddDynamicState(vk::DynamicState::eViewport)
-                          .Build(m_ModelPipelineLayout);
+void ClassicApplication::InitializeModelPipeline()
+{
+    m_ModelPipelineBuild = m_PipelineFactory.Submit([this, &pipelineCache = m_Renderer.GetPipelineCache()]() {
+        const std::vector<ShaderBinary> shaders = LoadClassicShaders("ClassicMeshLOD/Res/Shaders/lod");
+
+        // Position, normal, tangent, bitangent and texture coordinates, as read by lod.vert.
+        static_assert(sizeof(Vertex) == 14 * sizeof(float), "The vertex layout doesn't match the Vertex!");
+
+        VertexLayout vertexLayout;
+        vertexLayout.PushAttribute<float>(3).PushAttribute<float>(3).PushAttribute<float>(3).PushAttribute<float>(3);
+        vertexLayout.PushAttribute<float>(2);
+
+        GraphicsPipelineBuilder pipelineBuilder(pipelineCache);
+
+        m_ModelPipeline = pipelineBuilder.BindShaderModules(shaders)
+                              .BindRenderPass(m_Renderer.GetVkRenderPass())
+                              .EnableDepthTest()
+                              .AddViewport(glm::uvec4(0, 0, m_Renderer.GetWidth(), m_Renderer.GetHeight()))
+                              .FrontFaceDirection(vk::FrontFace::eClockwise)
+                              .SetCullMode(vk::CullModeFlagBits::eBack)
+                              .AddDisabledBlendAttachment()
+                              .BindVertexAttributes(vertexLayout)
+                              .AddDescriptorLayout(m_MatrixDescSetLayout)
+                              .AddDescriptorLayout(m_InstancesDescSetLayout)
+                              .AddDescriptorLayout(m_ScratchSetLayout)
+                              .AddPushConstantRange<FragmentPC>(vk::ShaderStageFlagBits::eFragment)
+                              .AddPushConstantRange<InstancePC>(vk::ShaderStageFlagBits::eVertex, sizeof(FragmentPC))
+                              .SetPrimitiveAssembly(vk::PrimitiveTopology::eTriangleList)
+                              .AddDynamicState(vk::DynamicState::eScissor)
+                              .AddDynamicState(vk::DynamicState::eViewport)
+                              .Build(m_ModelPipelineLayout);
+    });
 }
 
 void ClassicApplication::InitializeLODCompute()
 {
 
-    VkCore::ShaderData computeShader =
-        VkCore::ShaderLoader::LoadComputeShader("ClassicMeshLOD/Res/Shaders/lod_compute.comp", true, true);
+    // Each pass is built on its own worker.
+    m_LODCalculatePipelineBuild = m_PipelineFactory.Submit([this, &pipelineCache = m_Renderer.GetPipelineCache()]() {
+        const ShaderBinary computeShader = LoadShader("ClassicMeshLOD/Res/Shaders/lod_compute.comp");
+
+        ComputePipelineBuilder pipelineBuilder(pipelineCache);
+
+        m_LODCalculatePipeline = pipelineBuilder.BindShaderModule(computeShader)
+                                     .AddPushConstantRange<LodPC>(vk::ShaderStageFlagBits::eCompute)
+                                     .AddDescriptorLayout(m_LODMeshInfoSetLayout)
+                                     .AddDescriptorLayout(m_InstancesDescSetLayout)
+                                     .AddDescriptorLayout(m_ScratchSetLayout)
+                                     .AddDescriptorLayout(m_DrawIndirectCmdsLayout)
+                                     .Build(m_LODCalculatePipelineLayout);
+    });
+
+    m_LODPreparePipelineBuild = m_PipelineFactory.Submit([this, &pipelineCache = m_Renderer.GetPipelineCache()]() {
+        const ShaderBinary computeShader = LoadShader("ClassicMeshLOD/Res/Shaders/lod_sort.comp");
+
+        ComputePipelineBuilder pipelineBuilder(pipelineCache);
+
+        m_LODPreparePipeline = pipelineBuilder.BindShaderModule(computeShader)
+                                   .AddPushConstantRange<LodPC>(vk::ShaderStageFlagBits::eCompute)
+                                   .AddDescriptorLayout(m_LODMeshInfoSetLayout)
+                                   .AddDescriptorLayout(m_InstancesDescSetLayout)
+                                   .AddDescriptorLayout(m_ScratchSetLayout)
+                                   .AddDescriptorLayout(m_DrawIndirectCmdsLayout)
+                                   .Build(m_LODPreparePipelineLayout);
+    });
+
+    m_LODScatterPipelineBuild = m_PipelineFactory.Submit([this, &pipelineCache = m_Renderer.GetPipelineCache()]() {
+        const ShaderBinary computeShader = LoadShader("ClassicMeshLOD/Res/Shaders/lod_scatter.comp");
+
+        ComputePipelineBuilder pipelineBuilder(pipelineCache);
+
+        m_LODScatterPipeline = pipelineBuilder.BindShaderModule(computeShader)
+                                   .AddPushConstantRange<LodPC>(vk::ShaderStageFlagBits::eCompute)
+                                   .AddDescriptorLayout(m_LODMeshInfoSetLayout)
+                                   .AddDescriptorLayout(m_InstancesDescSetLayout)
+                                   .AddDescriptorLayout(m_ScratchSetLayout)
+                                   .AddDescriptorLayout(m_DrawIndirectCmdsLayout)
+                                   .Build(m_LODScatterPipelineLayout);
+    });
 
-    VkCore::ComputePipelineBuilder pipelineBuilder{};
+    m_DescriptorBuilder.Clear();
+}
 
-    m_LODCalculatePipeline = pipelineBuilder.BindShaderModule(computeShader)
-                                 .AddPushConstantRange<LodPC>(vk::ShaderStageFlagBits::eCompute)
-                                 .AddDescriptorLayout(m_LODMeshInfoSetLayout)
-                                 .AddDescriptorLayout(m_InstancesDescSetLayout)
-                                 .AddDescriptorLayout(m_ScratchSetLayout)
-                                 .AddDescriptorLayout(m_DrawIndirectCmdsLayout)
-                                 .Build(m_LODCalculatePipelineLayout);
+void ClassicApplication::InitializeImpostors()
+{
+    m_ImpostorAtlas.Bake(m_Scene.GetModels(), m_Renderer.GetPipelineCache());
+
+    vk::DescriptorImageInfo atlasInfo = m_ImpostorAtlas.GetAtlas().CreateDescriptorImageInfo(vk::ImageLayout::eGeneral);
 
-    computeShader = VkCore::ShaderLoader::LoadComputeShader("ClassicMeshLOD/Res/Shaders/lod_sort.comp", true, true);
+    for (uint32_t i = 0; i < m_Renderer.GetFramesInFlight(); i++)
+    {
+        vk::DescriptorSet set;
 
-    pipelineBuilder.Reset();
+        m_DescriptorBuilder
+            .BindImage(0, atlasInfo, vk::DescriptorType::eStorageImage, vk::ShaderStageFlagBits::eFragment)
+            .BindBuffer(1, m_ImpostorAtlas.GetBoundsBuffer(), vk::DescriptorType::eStorageBuffer,
+                        vk::ShaderStageFlagBits::eMeshEXT)
+            .BindBuffer(2, m_ImpostorInstanceBuffers[i], vk::DescriptorType::eStorageBuffer,
+                        vk::ShaderStageFlagBits::eMeshEXT)
+            .Build(set, m_ImpostorSetLayout);
 
-    m_LODPreparePipeline = pipelineBuilder.BindShaderModule(computeShader)
-                               .AddPushConstantRange<LodPC>(vk::ShaderStageFlagBits::eCompute)
-                               .AddDescriptorLayout(m_LODMeshInfoSetLayout)
-                               .AddDescriptorLayout(m_InstancesDescSetLayout)
-                               .AddDescriptorLayout(m_ScratchSetLayout)
-                               .AddDescriptorLayout(m_DrawIndirectCmdsLayout)
-                               .Build(m_LODPreparePipelineLayout);
+        m_ImpostorSets.emplace_back(set);
 
-    m_DescriptorBuilder.Clear();
+        m_DescriptorBuilder.Clear();
+    }
+
+    m_ImpostorPipelineBuild = m_PipelineFactory.Submit([this, &pipelineCache = m_Renderer.GetPipelineCache()]() {
+        const std::vector<ShaderBinary> shaders = LoadMeshShaders("ClassicMeshLOD/Res/Shaders/impostor");
+
+        GraphicsPipelineBuilder pipelineBuilder(pipelineCache);
+
+        // The quads can face away from the camera, when the closest baked view doesn't match the camera direction
+        // exactly, therefore nothing is culled.
+        m_ImpostorPipeline = pipelineBuilder.BindShaderModules(shaders)
+                                 .BindRenderPass(m_Renderer.GetVkRenderPass())
+                                 .EnableDepthTest()
+                                 .AddViewport(glm::uvec4(0, 0, m_Renderer.GetWidth(), m_Renderer.GetHeight()))
+                                 .FrontFaceDirection(vk::FrontFace::eClockwise)
+                                 .SetCullMode(vk::CullModeFlagBits::eNone)
+                                 .AddDisabledBlendAttachment()
+                                 .AddDescriptorLayout(m_MatrixDescSetLayout)
+                                 .AddDescriptorLayout(m_ImpostorSetLayout)
+                                 .AddDescriptorLayout(m_InstancesDescSetLayout)
+                                 .AddPushConstantRange<FragmentPC>(vk::ShaderStageFlagBits::eFragment)
+                                 .AddPushConstantRange<InstancePC>(vk::ShaderStageFlagBits::eMeshEXT,
+                                                                   sizeof(FragmentPC))
+                                 .SetPrimitiveAssembly(vk::PrimitiveTopology::eTriangleList)
+                                 .AddDynamicState(vk::DynamicState::eScissor)
+                                 .AddDynamicState(vk::DynamicState::eViewport)
+                                 .Build(m_ImpostorPipelineLayout);
+    });
 }
 
 void ClassicApplication::InitializeAxisPipeline()
 {
+    // Built on the first use only, it's a debug view.
+    if (m_AxisPipelineBuild.valid())
+    {
+        return;
+    }
 
     const float m_AxisVertexData[12] = {
         0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0,
@@ -182,86 +293,65 @@ void ClassicApplication::InitializeAxisPipeline()
     m_AxisIndexBuffer = VkCore::Buffer(vk::BufferUsageFlagBits::eIndexBuffer);
     m_AxisIndexBuffer.InitializeOnGpu(&m_AxisIndexData, sizeof(uint32_t) * 6);
 
-    VkCore::VertexAttributeBuilder attributeBuilder{};
-
-    attributeBuilder.PushAttribute<float>(3);
-    attributeBuilder.SetBinding(0);
-
-    std::vector<VkCore::ShaderData> shaderData =
-        VkCore::ShaderLoader::LoadClassicShaders("ClassicMeshLOD/Res/Shaders/axis");
-    VkCore::GraphicsPipelineBuilder pipelineBuilder(VkCore::DeviceManager::GetDevice());
-
-    m_AxisPipeline = pipelineBuilder.BindShaderModules(shaderData)
-                         .BindRenderPass(m_Renderer.m_RenderPass.GetVkRenderPass())
-                         .AddViewport(glm::uvec4(0, 0, m_Window->GetWidth(), m_Window->GetHeight()))
-                         .FrontFaceDirection(vk::FrontFace::eCounterClockwise)
-                         .SetCullMode(vk::CullModeFlagBits::eBack)
-                         .BindVertexAttributes(attributeBuilder)
-                         .AddDisabledBlendAttachment()
-                         .AddDescriptorLayout(m_MatrixDescSetLayout)
-                         .SetPrimitiveAssembly(vk::PrimitiveTopology::eLineList)
-                         .AddDynamicState(vk::DynamicState::eScissor)
-                         .AddDynamicState(vk::DynamicState::eViewport)
-                         .Build(m_AxisPipelineLayout);
-}
-
-void ClassicApplication::InitializeBoundsPipeline()
-{
-
-    m_Sphere = SphereModel(Vec3f(0.f, 0.f, 0.f));
-
-    VkCore::VertexAttributeBuilder attributeBuilder;
-
-    attributeBuilder.PushAttribute<float>(3).PushAttribute<float>(3).PushAttribute<float>(3);
-
-    VkCore::GraphicsPipelineBuilder pipelineBuilder(VkCore::DeviceManager::GetDevice());
-
-    std::vector<VkCore::ShaderData> shaderData =
-        VkCore::ShaderLoader::LoadClassicShaders("ClassicMeshLOD/Res/Shaders/bounds");
-
-    m_BoundsPipeline = pipelineBuilder.BindShaderModules(shaderData)
-                           .BindRenderPass(m_Renderer.m_RenderPass.GetVkRenderPass())
-                           .EnableDepthTest()
-                           .AddViewport(glm::uvec4(0, 0, m_Window->GetWidth(), m_Window->GetHeight()))
-                           .FrontFaceDirection(vk::FrontFace::eClockwise)
-                           .SetCullMode(vk::CullModeFlagBits::eNone)
-                           .BindVertexAttributes(attributeBuilder)
-                           .AddDisabledBlendAttachment()
-                           .AddDescriptorLayout(m_MatrixDescSetLayout)
-                           .SetPrimitiveAssembly(vk::PrimitiveTopology::eLineList)
-                           .AddDynamicState(vk::DynamicState::eScissor)
-                           .AddDynamicState(vk::DynamicState::eViewport)
-                           .Build(m_BoundsPipelineLayout);
+    m_AxisPipelineBuild = m_PipelineFactory.Submit([this, &pipelineCache = m_Renderer.GetPipelineCache()]() {
+        VertexLayout vertexLayout;
+
+        vertexLayout.PushAttribute<float>(3);
+        vertexLayout.SetBinding(0);
+
+        const std::vector<ShaderBinary> shaderData = LoadClassicShaders("ClassicMeshLOD/Res/Shaders/axis");
+        GraphicsPipelineBuilder pipelineBuilder(pipelineCache);
+
+        m_AxisPipeline = pipelineBuilder.BindShaderModules(shaderData)
+                             .BindRenderPass(m_Renderer.GetVkRenderPass())
+                             .AddViewport(glm::uvec4(0, 0, m_Renderer.GetWidth(), m_Renderer.GetHeight()))
+                             .FrontFaceDirection(vk::FrontFace::eCounterClockwise)
+                             .SetCullMode(vk::CullModeFlagBits::eBack)
+                             .BindVertexAttributes(vertexLayout)
+                             .AddDisabledBlendAttachment()
+                             .AddDescriptorLayout(m_MatrixDescSetLayout)
+                             .SetPrimitiveAssembly(vk::PrimitiveTopology::eLineList)
+                             .AddDynamicState(vk::DynamicState::eScissor)
+                             .AddDynamicState(vk::DynamicState::eViewport)
+                             .Build(m_AxisPipelineLayout);
+    });
 }
 
 void ClassicApplication::InitializeFrustumPipeline()
 {
+    // Built on the first use only, it's a debug view.
+    if (m_FrustumPipelineBuild.valid())
+    {
+        return;
+    }
+
     std::tie(m_FrustumBuffer, m_FrustumIndexBuffer) = m_FrustumCamera.ConstructFrustumModel();
 
-    VkCore::VertexAttributeBuilder attributeBuilder{};
-
-    attributeBuilder.PushAttribute<float>(3).PushAttribute<float>(3).PushAttribute<float>(3);
-    attributeBuilder.SetBinding(0);
-
-    std::vector<VkCore::ShaderData> shaderData =
-        VkCore::ShaderLoader::LoadClassicShaders("ClassicMeshLOD/Res/Shaders/frustum");
-
-    VkCore::GraphicsPipelineBuilder pipelineBuilder(VkCore::DeviceManager::GetDevice());
-
-    m_FrustumPipeline = pipelineBuilder.BindShaderModules(shaderData)
-                            .BindRenderPass(m_Renderer.m_RenderPass.GetVkRenderPass())
-                            .AddViewport(glm::uvec4(0, 0, m_Window->GetWidth(), m_Window->GetHeight()))
-                            .FrontFaceDirection(vk::FrontFace::eCounterClockwise)
-                            .SetCullMode(vk::CullModeFlagBits::eNone)
-                            .BindVertexAttributes(attributeBuilder)
-                            .AddDisabledBlendAttachment()
-                            .SetLineWidth(2.f)
-                            .AddPushConstantRange<Frustum>(vk::ShaderStageFlagBits::eVertex)
-                            .AddDescriptorLayout(m_MatrixDescSetLayout)
-                            .SetPrimitiveAssembly(vk::PrimitiveTopology::eLineList)
-                            .AddDynamicState(vk::DynamicState::eScissor)
-                            .AddDynamicState(vk::DynamicState::eViewport)
-                            .Build(m_FrustumPipelineLayout);
+    m_FrustumPipelineBuild = m_PipelineFactory.Submit([this, &pipelineCache = m_Renderer.GetPipelineCache()]() {
+        VertexLayout vertexLayout;
+
+        vertexLayout.PushAttribute<float>(3).PushAttribute<float>(3).PushAttribute<float>(3);
+        vertexLayout.SetBinding(0);
+
+        const std::vector<ShaderBinary> shaderData = LoadClassicShaders("ClassicMeshLOD/Res/Shaders/frustum");
+
+        GraphicsPipelineBuilder pipelineBuilder(pipelineCache);
+
+        m_FrustumPipeline = pipelineBuilder.BindShaderModules(shaderData)
+                                .BindRenderPass(m_Renderer.GetVkRenderPass())
+                                .AddViewport(glm::uvec4(0, 0, m_Renderer.GetWidth(), m_Renderer.GetHeight()))
+                                .FrontFaceDirection(vk::FrontFace::eCounterClockwise)
+                                .SetCullMode(vk::CullModeFlagBits::eNone)
+                                .BindVertexAttributes(vertexLayout)
+                                .AddDisabledBlendAttachment()
+                                .SetLineWidth(2.f)
+                                .AddPushConstantRange<Frustum>(vk::ShaderStageFlagBits::eVertex)
+                                .AddDescriptorLayout(m_MatrixDescSetLayout)
+                                .SetPrimitiveAssembly(vk::PrimitiveTopology::eLineList)
+                                .AddDynamicState(vk::DynamicState::eScissor)
+                                .AddDynamicState(vk::DynamicState::eViewport)
+                                .Build(m_FrustumPipelineLayout);
+    });
 }
 
 void ClassicApplication::InitializeInstancing()
@@ -269,7 +359,7 @@ void ClassicApplication::InitializeInstancing()
 
     const glm::vec3 span = glm::vec3(1.f);
 
-    std::vector<glm::mat4> instances;
+    std::vector<InstanceData> instances;
     instances.resize(m_InstanceCountMax);
 
     for (uint32_t y = 0; y < m_InstanceSize.y; y++)
@@ -280,30 +370,97 @@ void ClassicApplication::InitializeInstancing()
 
             const uint32_t index = x + m_InstanceSize.y * y;
 
-            instances[index] = (glm::translate(glm::identity<glm::mat4>(), instancePos));
+            instances[index].transform = glm::translate(glm::identity<glm::mat4>(), instancePos);
+            instances[index].modelId = index % m_Scene.GetModelCount();
+        }
+    }
+
+    StagingUploader& uploader = m_Renderer.GetUploader();
+
+    m_InstancesBuffer =
+        VkCore::Buffer(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst);
+
+    if (m_InstanceFormat == EInstanceFormat::Packed)
+    {
+        std::vector<PackedInstance> packedInstances;
+        packedInstances.reserve(instances.size());
+
+        for (const InstanceData& instance : instances)
+        {
+            packedInstances.push_back(PackInstance(instance.transform, instance.modelId));
         }
+
+        const vk::DeviceSize size = packedInstances.size() * sizeof(PackedInstance);
+
+        m_InstancesBuffer.InitializeOnGpu(size);
+        uploader.Upload(m_InstancesBuffer.GetVkBuffer(), packedInstances.data(), size);
     }
+    else
+    {
+        const vk::DeviceSize size = instances.size() * sizeof(InstanceData);
 
-    m_InstancesBuffer = VkCore::Buffer(vk::BufferUsageFlagBits::eStorageBuffer);
-    m_InstancesBuffer.InitializeOnGpu(instances.data(), instances.size() * sizeof(glm::mat4));
+        m_InstancesBuffer.InitializeOnGpu(size);
+        uploader.Upload(m_InstancesBuffer.GetVkBuffer(), instances.data(), size);
+    }
+
+    LOGF(Application, Info, "Instance buffer: %u instances, %.2f MB", m_InstanceCountMax,
+         m_InstancesBuffer.GetSize() / (1024.f * 1024.f))
+
+    lod_pc.packed_instances = m_InstanceFormat == EInstanceFormat::Packed;
+    instance_pc.packed_instances = m_InstanceFormat == EInstanceFormat::Packed;
+
+    const std::vector<uint32_t> lodStates(m_InstanceCountMax, LOD_STATE_NONE);
+
+    m_LODStateBuffer = VkCore::Buffer(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst);
+    m_LODStateBuffer.InitializeOnGpu(lodStates.size() * sizeof(uint32_t));
+    uploader.Upload(m_LODStateBuffer.GetVkBuffer(), lodStates.data(), lodStates.size() * sizeof(uint32_t));
 
     m_DescriptorBuilder
         .BindBuffer(0, m_InstancesBuffer, vk::DescriptorType::eStorageBuffer,
-                    vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eCompute)
+                    vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eCompute |
+                        vk::ShaderStageFlagBits::eMeshEXT)
+        .BindBuffer(1, m_LODStateBuffer, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
         .Build(m_InstancesDescSet, m_InstancesDescSetLayout);
 
     m_DescriptorBuilder.Clear();
 
-    for (int i = 0; i < m_Renderer.m_Swapchain.GetImageCount(); i++)
+    // The indirect buffer starts with the draw count (padded to 16 bytes) followed by the compacted draw commands.
+    const vk::DeviceSize drawCmdsSize =
+        DRAW_CMDS_OFFSET + m_Scene.GetBucketCount() * sizeof(vk::DrawIndexedIndirectCommand);
+
+    for (int i = 0; i < m_Renderer.GetFramesInFlight(); i++)
     {
         m_DrawIndirectCmds.emplace_back(vk::BufferUsageFlagBits::eStorageBuffer |
                                         vk::BufferUsageFlagBits::eIndirectBuffer |
                                         vk::BufferUsageFlagBits::eTransferDst);
 
-        m_DrawIndirectCmds[i].InitializeOnGpu(Constants::MAX_LOD_LEVELS * sizeof(vk::DrawIndexedIndirectCommand));
+        m_DrawIndirectCmds[i].InitializeOnGpu(drawCmdsSize);
+
+        m_ImpostorInstanceBuffers.emplace_back(vk::BufferUsageFlagBits::eStorageBuffer |
+                                               vk::BufferUsageFlagBits::eIndirectBuffer |
+                                               vk::BufferUsageFlagBits::eTransferDst);
+
+        m_ImpostorInstanceBuffers[i].InitializeOnGpu(sizeof(ImpostorListHeader) + m_InstanceCountMax * sizeof(uint32_t));
+
+        m_LODStatsBuffers.emplace_back(vk::BufferUsageFlagBits::eStorageBuffer |
+                                       vk::BufferUsageFlagBits::eTransferSrc |
+                                       vk::BufferUsageFlagBits::eTransferDst);
+        m_LODStatsBuffers[i].InitializeOnGpu(sizeof(LODStats));
+
+        m_LODStatsReadbacks.emplace_back();
+        m_LODStatsReadbacks[i].Initialize(sizeof(LODStats), vk::BufferUsageFlagBits::eTransferDst);
+
+        m_DurationQueries.emplace_back(std::make_unique<DurationQuery>());
+        m_StatisticsQueries.emplace_back(std::make_unique<PipelineStatisticsQuery>(
+            vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations));
+        m_HasFrameResults.emplace_back(false);
 
         m_DescriptorBuilder.BindBuffer(0, m_DrawIndirectCmds[i], vk::DescriptorType::eStorageBuffer,
                                        vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eCompute);
+        m_DescriptorBuilder.BindBuffer(1, m_ImpostorInstanceBuffers[i], vk::DescriptorType::eStorageBuffer,
+                                       vk::ShaderStageFlagBits::eCompute);
+        m_DescriptorBuilder.BindBuffer(2, m_LODStatsBuffers[i], vk::DescriptorType::eStorageBuffer,
+                                       vk::ShaderStageFlagBits::eCompute);
 
         vk::DescriptorSet set;
 
@@ -313,26 +470,227 @@ void ClassicApplication::InitializeInstancing()
         m_DescriptorBuilder.Clear();
     }
 
-    for (int i = 0; i < m_Renderer.m_Swapchain.GetImageCount(); i++)
-    {
-        m_ScratchBuffers.emplace_back(vk::BufferUsageFlagBits::eStorageBuffer);
-        m_ScratchBuffers[i].InitializeOnGpu(sizeof(uint32_t) * m_InstanceCountMax);
+    // Every visible instance is drawn once per mesh of its model.
+    const uint32_t maxDrawnInstances = m_InstanceCountMax * m_Scene.GetMaxMeshesPerModel();
 
+    for (int i = 0; i < m_Renderer.GetFramesInFlight(); i++)
+    {
         m_InstanceIndexBuffers.emplace_back(vk::BufferUsageFlagBits::eStorageBuffer);
-        m_InstanceIndexBuffers[i].InitializeOnGpu(m_InstanceCountMax * sizeof(uint32_t));
+        m_InstanceIndexBuffers[i].InitializeOnGpu(maxDrawnInstances * sizeof(uint32_t));
 
-        vk::DescriptorSet set;
+        m_SortKeyBuffers.emplace_back(vk::BufferUsageFlagBits::eStorageBuffer);
+        m_SortKeyBuffers[i].InitializeOnGpu(maxDrawnInstances * sizeof(uint32_t));
+    }
 
-        m_DescriptorBuilder
-            .BindBuffer(0, m_ScratchBuffers[i], vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
-            .BindBuffer(1, m_InstanceIndexBuffers[i], vk::DescriptorType::eStorageBuffer,
-                        vk::ShaderStageFlagBits::eCompute | vk::ShaderStageFlagBits::eVertex)
-            .Build(set, m_ScratchSetLayout);
+    // The bucket takes the bits of the sort keys above the depth, so the sort never moves an instance index out of
+    // its bucket. All the instance indices form a single segment, counted by the LOD prepare pass.
+    ASSERT(m_Scene.GetBucketCount() <= (1u << (32 - SORT_DEPTH_BITS)), "Too many buckets for the depth sort keys!")
 
-        m_ScratchSets.emplace_back(set);
+    m_DepthSort.Initialize(1, maxDrawnInstances, m_Renderer.GetPipelineCache(), DRAW_CMDS_INSTANCE_COUNT_INDEX);
 
-        m_DescriptorBuilder.Clear();
+    for (int i = 0; i < m_Renderer.GetFramesInFlight(); i++)
+    {
+        m_DepthSort.AddFrame(m_SortKeyBuffers[i], m_InstanceIndexBuffers[i], m_DrawIndirectCmds[i]);
+    }
+}
+
+void ClassicApplication::InitializeScratchSets()
+{
+    const uint32_t framesInFlight = m_Renderer.GetFramesInFlight();
+    const vk::Device device = *VkCore::DeviceManager::GetDevice();
+
+    const std::vector<vk::DescriptorSetLayoutBinding> bindings = {
+        {0, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute},
+        {1, vk::DescriptorType::eStorageBuffer, 1,
+         vk::ShaderStageFlagBits::eCompute | vk::ShaderStageFlagBits::eVertex},
+        {2, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute},
+        {3, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute},
+    };
+
+    const vk::DescriptorPoolSize poolSize{vk::DescriptorType::eStorageBuffer,
+                                          (uint32_t)bindings.size() * framesInFlight};
+
+    TRY_CATCH_BEGIN()
+
+    m_ScratchSetLayout = device.createDescriptorSetLayout(vk::DescriptorSetLayoutCreateInfo({}, bindings));
+    m_ScratchSetPool = device.createDescriptorPool(vk::DescriptorPoolCreateInfo({}, framesInFlight, poolSize));
+
+    const std::vector<vk::DescriptorSetLayout> layouts(framesInFlight, m_ScratchSetLayout);
+    m_ScratchSets = device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo(m_ScratchSetPool, layouts));
+
+    TRY_CATCH_END()
+}
+
+void ClassicApplication::InitializeLODGraph()
+{
+    const uint32_t framesInFlight = m_Renderer.GetFramesInFlight();
+
+    // The passes only bind the pipelines, so the recording never waits for the workers.
+    m_LODCalculatePipelineBuild.get();
+    m_LODPreparePipelineBuild.get();
+    m_LODScatterPipelineBuild.get();
+
+    std::vector<vk::Buffer> drawCmds, impostorInstances, lodStats, lodStatsReadbacks, instanceIndices, sortKeys;
+
+    for (uint32_t i = 0; i < framesInFlight; i++)
+    {
+        drawCmds.push_back(m_DrawIndirectCmds[i].GetVkBuffer());
+        impostorInstances.push_back(m_ImpostorInstanceBuffers[i].GetVkBuffer());
+        lodStats.push_back(m_LODStatsBuffers[i].GetVkBuffer());
+        lodStatsReadbacks.push_back(m_LODStatsReadbacks[i].GetVkBuffer());
+        instanceIndices.push_back(m_InstanceIndexBuffers[i].GetVkBuffer());
+        sortKeys.push_back(m_SortKeyBuffers[i].GetVkBuffer());
+    }
+
+    const RenderGraphResource drawCmdsResource = m_LODGraph.ImportBuffers("Draw commands", drawCmds);
+    const RenderGraphResource impostorResource = m_LODGraph.ImportBuffers("Impostor instances", impostorInstances);
+    const RenderGraphResource statsResource = m_LODGraph.ImportBuffers("LOD stats", lodStats);
+    const RenderGraphResource readbackResource = m_LODGraph.ImportBuffers("LOD stats readback", lodStatsReadbacks);
+    const RenderGraphResource indicesResource = m_LODGraph.ImportBuffers("Instance indices", instanceIndices);
+    const RenderGraphResource sortKeysResource = m_LODGraph.ImportBuffers("Sort keys", sortKeys);
+    // Carried over from the previous frames, so a single one is shared by all of them.
+    const RenderGraphResource lodStatesResource =
+        m_LODGraph.ImportBuffers("LOD states", {m_LODStateBuffer.GetVkBuffer()});
+
+    // Both are only alive in between the LOD passes, so the graph owns them.
+    m_ScratchBuffer = m_LODGraph.CreateBuffer("LOD scratch", sizeof(uint32_t) * m_InstanceCountMax,
+                                              vk::BufferUsageFlagBits::eStorageBuffer);
+    m_BucketBuffer =
+        m_LODGraph.CreateBuffer("LOD buckets", m_Scene.GetBucketCount() * sizeof(LodBucket),
+                                vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst);
+
+    m_LODGraph
+        .AddPass("LOD clear",
+                 [this](const vk::CommandBuffer& cmdBuffer, const uint32_t frameIndex) {
+                     cmdBuffer.fillBuffer(m_DrawIndirectCmds[frameIndex].GetVkBuffer(), 0, VK_WHOLE_SIZE, 0);
+                     cmdBuffer.fillBuffer(m_LODGraph.GetBuffer(m_BucketBuffer, frameIndex), 0, VK_WHOLE_SIZE, 0);
+                     cmdBuffer.fillBuffer(m_ImpostorInstanceBuffers[frameIndex].GetVkBuffer(), 0,
+                                          sizeof(ImpostorListHeader), 0);
+                     cmdBuffer.fillBuffer(m_LODStatsBuffers[frameIndex].GetVkBuffer(), 0, VK_WHOLE_SIZE, 0);
+                 })
+        .Write(drawCmdsResource, EGraphStage::Transfer)
+        .Write(m_BucketBuffer, EGraphStage::Transfer)
+        .Write(impostorResource, EGraphStage::Transfer)
+        .Write(statsResource, EGraphStage::Transfer);
+
+    // Compute the LODs
+    m_LODGraph
+        .AddPass("LOD calculate",
+                 [this](const vk::CommandBuffer& cmdBuffer, const uint32_t frameIndex) {
+                     cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_LODCalculatePipeline);
+                     cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_LODCalculatePipelineLayout, 0,
+                                                  {m_LODMeshInfoSet, m_InstancesDescSet, m_ScratchSets[frameIndex],
+                                                   m_DrawIndirectCmdSets[frameIndex]},
+                                                  {});
+
+                     cmdBuffer.pushConstants(m_LODCalculatePipelineLayout, vk::ShaderStageFlagBits::eCompute, 0,
+                                             sizeof(LodPC), &lod_pc);
+
+                     cmdBuffer.dispatch(((uint32_t)m_InstanceCount / 32) + 1, 1, 1);
+                 })
+        .Read(lodStatesResource, EGraphStage::Compute)
+        .Write(lodStatesResource, EGraphStage::Compute)
+        .Write(m_ScratchBuffer, EGraphStage::Compute)
+        .Write(m_BucketBuffer, EGraphStage::Compute)
+        .Write(impostorResource, EGraphStage::Compute)
+        .Write(statsResource, EGraphStage::Compute);
+
+    // Compact the non-empty buckets into draw commands and compute their instance offsets
+    m_LODGraph
+        .AddPass("LOD prepare",
+                 [this](const vk::CommandBuffer& cmdBuffer, const uint32_t frameIndex) {
+                     cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_LODPreparePipeline);
+                     cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_LODPreparePipelineLayout, 0,
+                                                  {m_LODMeshInfoSet, m_InstancesDescSet, m_ScratchSets[frameIndex],
+                                                   m_DrawIndirectCmdSets[frameIndex]},
+                                                  {});
+
+                     cmdBuffer.pushConstants(m_LODPreparePipelineLayout, vk::ShaderStageFlagBits::eCompute, 0,
+                                             sizeof(LodPC), &lod_pc);
+
+                     cmdBuffer.dispatch(1, 1, 1);
+                 })
+        .Write(m_BucketBuffer, EGraphStage::Compute)
+        .Write(drawCmdsResource, EGraphStage::Compute)
+        .Write(impostorResource, EGraphStage::Compute);
+
+    // Scatter the visible instances into their buckets
+    m_LODGraph
+        .AddPass("LOD scatter",
+                 [this](const vk::CommandBuffer& cmdBuffer, const uint32_t frameIndex) {
+                     cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_LODScatterPipeline);
+                     cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_LODScatterPipelineLayout, 0,
+                                                  {m_LODMeshInfoSet, m_InstancesDescSet, m_ScratchSets[frameIndex],
+                                                   m_DrawIndirectCmdSets[frameIndex]},
+                                                  {});
+
+                     cmdBuffer.pushConstants(m_LODScatterPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0,
+                                             sizeof(LodPC), &lod_pc);
+
+                     cmdBuffer.dispatch(((uint32_t)m_InstanceCount / 32) + 1, 1, 1);
+                 })
+        .Read(m_ScratchBuffer, EGraphStage::Compute)
+        .Write(m_BucketBuffer, EGraphStage::Compute)
+        .Write(indicesResource, EGraphStage::Compute)
+        .Write(sortKeysResource, EGraphStage::Compute);
+
+    // Order the instances of every bucket front-to-back, so that the early depth test rejects more fragments. The
+    // instance count of the sort comes from the draw commands.
+    m_LODGraph
+        .AddPass("Depth sort",
+                 [this](const vk::CommandBuffer& cmdBuffer, const uint32_t frameIndex) {
+                     if (m_SortByDepth)
+                     {
+                         m_DepthSort.Record(cmdBuffer, frameIndex);
+                     }
+                 })
+        .Read(drawCmdsResource, EGraphStage::Compute)
+        .Read(drawCmdsResource, EGraphStage::Indirect)
+        .Write(sortKeysResource, EGraphStage::Compute)
+        .Write(indicesResource, EGraphStage::Compute);
+
+    // Copy the LOD statistics of this frame to the host, they are read once the frame is done. Independent of the
+    // passes after the calculation, so it runs along with them.
+    m_LODGraph
+        .AddPass("LOD stats readback",
+                 [this](const vk::CommandBuffer& cmdBuffer, const uint32_t frameIndex) {
+                     cmdBuffer.copyBuffer(m_LODStatsBuffers[frameIndex].GetVkBuffer(),
+                                          m_LODStatsReadbacks[frameIndex].GetVkBuffer(),
+                                          vk::BufferCopy(0, 0, sizeof(LODStats)));
+                 })
+        .Read(statsResource, EGraphStage::Transfer)
+        .Write(readbackResource, EGraphStage::Transfer);
+
+    // The draws wait for the submission of the graph, only the readback is handed to the host by it.
+    m_LODGraph.Export(readbackResource, EGraphStage::Host);
+
+    m_LODGraph.Compile(framesInFlight, m_Renderer.GetAsyncCompute().GetComputeFamily());
+
+    // The scratch and the bucket buffers only exist once the graph is compiled, and aren't VkCore buffers, so the sets
+    // allocated by InitializeScratchSets are written directly instead of by the descriptor builder.
+    const vk::Device device = *VkCore::DeviceManager::GetDevice();
+
+    std::vector<vk::DescriptorBufferInfo> bufferInfos;
+    std::vector<vk::WriteDescriptorSet> writes;
+
+    for (uint32_t i = 0; i < framesInFlight; i++)
+    {
+        bufferInfos.emplace_back(m_LODGraph.GetBuffer(m_ScratchBuffer, i), 0, VK_WHOLE_SIZE);
+        bufferInfos.emplace_back(m_InstanceIndexBuffers[i].GetVkBuffer(), 0, VK_WHOLE_SIZE);
+        bufferInfos.emplace_back(m_LODGraph.GetBuffer(m_BucketBuffer, i), 0, VK_WHOLE_SIZE);
+        bufferInfos.emplace_back(m_SortKeyBuffers[i].GetVkBuffer(), 0, VK_WHOLE_SIZE);
     }
+
+    // Every set binds the buffers of its frame in the order of the bindings.
+    const uint32_t bindingCount = (uint32_t)bufferInfos.size() / framesInFlight;
+
+    for (uint32_t i = 0; i < bufferInfos.size(); i++)
+    {
+        writes.emplace_back(m_ScratchSets[i / bindingCount], i % bindingCount, 0, 1,
+                            vk::DescriptorType::eStorageBuffer, nullptr, &bufferInfos[i]);
+    }
+
+    device.updateDescriptorSets(writes, {});
 }
 
 void ClassicApplication::DrawFrame()
@@ -347,7 +705,14 @@ void ClassicApplication::DrawFrame()
         return;
     }
 
-    const double time = glfwGetTime();
+    // The frame last recorded into this slot is finished by now, so its results are read without stalling on the
+    // frames still in flight.
+    if (m_HasFrameResults[imageIndex])
+    {
+        ReadFrameResults(imageIndex);
+    }
+
+    const double time = m_Renderer.GetTime();
 
     m_CurrentCamera->Update();
 
@@ -368,79 +733,60 @@ void ClassicApplication::DrawFrame()
     Frustum frustum = m_FrustumCamera.CalculateFrustum();
     lod_pc.frustum = frustum;
 
+    const glm::vec3 viewDirection = m_CurrentCamera->GetViewDirection();
+    lod_pc.view_plane = glm::vec4(viewDirection, -glm::dot(viewDirection, m_CurrentCamera->GetPosition()));
+
     fragment_pc.cam_pos = m_CurrentCamera->GetPosition();
     fragment_pc.cam_view_dir = m_CurrentCamera->GetViewDirection();
 
     m_MatBuffers[imageIndex].UpdateData(&ubo);
 
-    m_Renderer.BeginCmdBuffer();
-    vk::CommandBuffer cmdBuffer = m_Renderer.GetCurrentCmdBuffer();
-
-    DurationQuery durationQuery;
-
-    durationQuery.Reset(cmdBuffer);
-
-    {
-        // Compute the LODs
-        cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_LODCalculatePipeline);
-        cmdBuffer.bindDescriptorSets(
-            vk::PipelineBindPoint::eCompute, m_LODCalculatePipelineLayout, 0,
-            {m_LODMeshInfoSet, m_InstancesDescSet, m_ScratchSets[imageIndex], m_DrawIndirectCmdSets[imageIndex]}, {});
-
-        cmdBuffer.pushConstants(m_LODCalculatePipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(LodPC),
-                                &lod_pc);
-
-        cmdBuffer.fillBuffer(m_DrawIndirectCmds[imageIndex].GetVkBuffer(), 0, m_DrawIndirectCmds[imageIndex].GetSize(),
-                             0);
-
-        vk::BufferMemoryBarrier drawIndirectBarrier = m_DrawIndirectCmds[imageIndex].CreateBufferMemoryBarrier(
-            vk::AccessFlagBits::eMemoryWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+    // The LOD passes are submitted ahead of the frame, so they run alongside the rasterization of the previous one.
+    AsyncCompute& asyncCompute = m_Renderer.GetAsyncCompute();
+    vk::CommandBuffer cmdBuffer = asyncCompute.Begin();
 
-        cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
-                                  {}, {}, drawIndirectBarrier, {});
+    m_LODGraph.Execute(cmdBuffer, imageIndex);
 
-        durationQuery.StartTimestamp(cmdBuffer, vk::PipelineStageFlagBits::eComputeShader);
+    // The buffers the draws read from, handed over to the graphics queue when the compute queue is of another family.
+    const vk::AccessFlags drawReadAccess = vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead;
 
-        cmdBuffer.dispatch(((uint32_t)m_InstanceCount / 32) + 1, 1, 1);
-
-        vk::MemoryBarrier memoryBarrier;
-        memoryBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
-        memoryBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
-
-        cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
-                                  {}, memoryBarrier, {}, {});
-    }
-    {
-        // Sort and Prepare the LOD Instances data for drawing
-        cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_LODPreparePipeline);
+    const std::vector<vk::BufferMemoryBarrier> drawBufferBarriers = {
+        m_DrawIndirectCmds[imageIndex].CreateBufferMemoryBarrier(vk::AccessFlagBits::eShaderWrite, drawReadAccess),
+        m_InstanceIndexBuffers[imageIndex].CreateBufferMemoryBarrier(vk::AccessFlagBits::eShaderWrite,
+                                                                     vk::AccessFlagBits::eShaderRead),
+        m_ImpostorInstanceBuffers[imageIndex].CreateBufferMemoryBarrier(vk::AccessFlagBits::eShaderWrite,
+                                                                        drawReadAccess),
+    };
 
-        cmdBuffer.bindDescriptorSets(
-            vk::PipelineBindPoint::eCompute, m_LODPreparePipelineLayout, 0,
-            {m_LODMeshInfoSet, m_InstancesDescSet, m_ScratchSets[imageIndex], m_DrawIndirectCmdSets[imageIndex]}, {});
+    asyncCompute.ReleaseBuffers(cmdBuffer, drawBufferBarriers);
+    asyncCompute.Submit(vk::PipelineStageFlagBits::eDrawIndirect);
 
-        cmdBuffer.pushConstants(m_LODPreparePipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(LodPC),
-                                &lod_pc);
+    m_Renderer.BeginCmdBuffer();
+    cmdBuffer = m_Renderer.GetCurrentCmdBuffer();
 
-        cmdBuffer.dispatch(1, 1, 1);
+    DurationQuery& durationQuery = *m_DurationQueries[imageIndex];
+    PipelineStatisticsQuery& statisticsQuery = *m_StatisticsQueries[imageIndex];
 
-        vk::MemoryBarrier memoryBarrier;
-        memoryBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
-        memoryBarrier.dstAccessMask = vk::AccessFlagBits::eIndirectCommandRead;
+    durationQuery.Reset(cmdBuffer);
+    statisticsQuery.Reset(cmdBuffer);
 
-        cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eDrawIndirect,
-                                  {}, memoryBarrier, {}, {});
-    }
+    asyncCompute.AcquireBuffers(cmdBuffer, drawBufferBarriers,
+                                vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexShader |
+                                    vk::PipelineStageFlagBits::eMeshShaderEXT);
 
-    m_Renderer.BeginRenderPass({0.3f, 0.f, 0.2f, 1.f}, m_Window->GetWidth(), m_Window->GetHeight());
+    m_Renderer.BeginRenderPass({0.3f, 0.f, 0.2f, 1.f}, m_Renderer.GetWidth(), m_Renderer.GetHeight());
 
-    vk::Rect2D scissor = vk::Rect2D({0, 0}, {m_Window->GetWidth(), m_Window->GetHeight()});
+    vk::Rect2D scissor = vk::Rect2D({0, 0}, {m_Renderer.GetWidth(), m_Renderer.GetHeight()});
     cmdBuffer.setScissor(0, 1, &scissor);
 
-    vk::Viewport viewport = vk::Viewport(0, 0, m_Window->GetWidth(), m_Window->GetHeight(), 0, 1);
+    vk::Viewport viewport = vk::Viewport(0, 0, m_Renderer.GetWidth(), m_Renderer.GetHeight(), 0, 1);
     cmdBuffer.setViewport(0, 1, &viewport);
 
     {
+        durationQuery.StartTimestamp(cmdBuffer, vk::PipelineStageFlagBits::eDrawIndirect);
+        statisticsQuery.Begin(cmdBuffer);
 
+        m_ModelPipelineBuild.get();
         cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_ModelPipeline);
 
         cmdBuffer.bindDescriptorSets(
@@ -449,21 +795,45 @@ void ClassicApplication::DrawFrame()
 
         cmdBuffer.pushConstants(m_ModelPipelineLayout, vk::ShaderStageFlagBits::eFragment, 0, sizeof(FragmentPC),
                                 &fragment_pc);
+        cmdBuffer.pushConstants(m_ModelPipelineLayout, vk::ShaderStageFlagBits::eVertex, sizeof(FragmentPC),
+                                sizeof(InstancePC), &instance_pc);
+
+        cmdBuffer.bindVertexBuffers(0, m_Scene.GetVertexBuffer().GetVkBuffer(), {0});
+        cmdBuffer.bindIndexBuffer(m_Scene.GetIndexBuffer().GetVkBuffer(), 0, vk::IndexType::eUint32);
+
+        // The whole scene goes out in a single call. The draw count is written by the LOD prepare pass.
+        const VkBuffer drawCmdsBuffer = m_DrawIndirectCmds[imageIndex].GetVkBuffer();
+
+        m_vkCmdDrawIndexedIndirectCount(&*cmdBuffer, drawCmdsBuffer, DRAW_CMDS_OFFSET, drawCmdsBuffer, 0,
+                                        m_Scene.GetBucketCount(), sizeof(vk::DrawIndexedIndirectCommand));
 
-        ClassicLODMesh& mesh = m_Model->GetMesh(0);
+        // Impostors of the instances beyond the impostor distance, the dispatch size is written by the LOD prepare
+        // pass
+        m_ImpostorPipelineBuild.get();
+        cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_ImpostorPipeline);
 
-        cmdBuffer.bindVertexBuffers(0, mesh.GetVertexBuffer().GetVkBuffer(), {0});
-        cmdBuffer.bindIndexBuffer(mesh.GetIndexBuffer().GetVkBuffer(), 0, vk::IndexType::eUint32);
+        cmdBuffer.bindDescriptorSets(
+            vk::PipelineBindPoint::eGraphics, m_ImpostorPipelineLayout, 0,
+            {m_MatrixDescriptorSets[imageIndex], m_ImpostorSets[imageIndex], m_InstancesDescSet}, {});
+
+        cmdBuffer.pushConstants(m_ImpostorPipelineLayout, vk::ShaderStageFlagBits::eFragment, 0, sizeof(FragmentPC),
+                                &fragment_pc);
+        cmdBuffer.pushConstants(m_ImpostorPipelineLayout, vk::ShaderStageFlagBits::eMeshEXT, sizeof(FragmentPC),
+                                sizeof(InstancePC), &instance_pc);
 
-        cmdBuffer.drawIndexedIndirect(m_DrawIndirectCmds[imageIndex].GetVkBuffer(), 0, mesh.GetMeshInfo().LodCount,
-                                      sizeof(vk::DrawIndexedIndirectCommand));
+        vkCmdDrawMeshTasksIndirectEXT(&*cmdBuffer, m_ImpostorInstanceBuffers[imageIndex].GetVkBuffer(), 0, 1,
+                                      sizeof(VkDrawMeshTasksIndirectCommandEXT));
 
+        statisticsQuery.End(cmdBuffer);
         durationQuery.EndTimestamp(cmdBuffer, vk::PipelineStageFlagBits::eFragmentShader);
     }
 
     //
     // {
     //
+    //     InitializeFrustumPipeline();
+    //     m_FrustumPipelineBuild.get();
+    //
     //     cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_FrustumPipeline);
     //     cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_FrustumPipelineLayout, 0, 1,
     //                                  &m_MatrixDescriptorSets[imageIndex], 0, nullptr);
@@ -478,7 +848,7 @@ void ClassicApplication::DrawFrame()
     // }
     //
     {
-        m_Renderer.ImGuiNewFrame(m_Window->GetWidth(), m_Window->GetHeight());
+        m_Renderer.ImGuiNewFrame(m_Renderer.GetWidth(), m_Renderer.GetHeight());
 
         static bool open = true;
 
@@ -490,7 +860,18 @@ void ClassicApplication::DrawFrame()
         if (ImGui::Begin("Instancing", &open))
         {
             ImGui::Text("Drawing execution in ms: %.4f", m_Duration / 1000000.f);
+            ImGui::Text("LOD compute %.3f ms, graphics %.3f ms, overlapped %.3f ms", asyncCompute.GetComputeMs(),
+                        asyncCompute.GetGraphicsMs(), asyncCompute.GetOverlapMs());
+
+            for (const RenderGraph::PassTiming& timing : m_LODGraph.GetTimings())
+            {
+                ImGui::Text("  %-18s at %.3f ms, %.3f ms", timing.name.c_str(), timing.beginMs, timing.durationMs);
+            }
+
             ImGui::Text("Avg. Drawing execution in ms: %.4f", m_AvgDuration / 1000000.f);
+            ImGui::Text("Instance buffer (%s) in MB: %.2f",
+                        m_InstanceFormat == EInstanceFormat::Packed ? "packed" : "mat4",
+                        m_InstancesBuffer.GetSize() / (1024.f * 1024.f));
             ImGui::Text("Instance Count");
             if (ImGui::SliderInt("##Instance Count", &m_InstanceCount, 0, (int)m_InstanceCountMax, "%d",
                                  ImGuiSliderFlags_AlwaysClamp))
@@ -501,6 +882,42 @@ void ClassicApplication::DrawFrame()
             ImGui::Text("LOD Exponent");
             ImGui::SliderFloat("##LOD Exponent", &lod_pc.lod_pow, 0, 1.f, "%.3f", ImGuiSliderFlags_AlwaysClamp);
 
+            ImGui::Text("Auto LOD");
+            ImGui::SameLine();
+
+            if (ImGui::Checkbox("##Auto LOD", &m_AutoLOD))
+            {
+                m_LODGovernor.Reset();
+            }
+
+            if (m_AutoLOD)
+            {
+                ImGui::Text("Target GPU time in ms");
+                ImGui::SliderFloat("##Target GPU time", &m_LODGovernor.GetSettings().targetMs, 0.1f, 20.f, "%.2f",
+                                   ImGuiSliderFlags_AlwaysClamp);
+                ImGui::Text("Governor: %s (avg. %.3f ms)", m_LODGovernor.GetStateName(),
+                            m_LODGovernor.GetSmoothedMs());
+            }
+
+            ImGui::Text("Impostor distance (0 - disabled)");
+            ImGui::SliderFloat("##Impostor distance", &lod_pc.impostor_distance, 0, 300.f, "%.1f",
+                               ImGuiSliderFlags_AlwaysClamp);
+
+            ImGui::Text("LOD hysteresis");
+            ImGui::SliderFloat("##LOD hysteresis", &lod_pc.lod_hysteresis, 0, 1.f, "%.2f",
+                               ImGuiSliderFlags_AlwaysClamp);
+            ImGui::Text("Impostor hysteresis");
+            ImGui::SliderFloat("##Impostor hysteresis", &lod_pc.impostor_hysteresis, 0, 20.f, "%.1f",
+                               ImGuiSliderFlags_AlwaysClamp);
+            ImGui::Text("LOD transitions per frame: %u", m_LODTransitions);
+
+            ImGui::Text("Sort by depth");
+            ImGui::SameLine();
+            ImGui::Checkbox("##Sort by depth", &m_SortByDepth);
+            ImGui::Text("Fragment invocations: %llu", (unsigned long long)m_FragmentInvocations);
+            ImGui::Text("Unsorted: %llu, sorted: %llu", (unsigned long long)m_SortFragmentInvocations[0],
+                        (unsigned long long)m_SortFragmentInvocations[1]);
+
             ImGui::Text("Show LODs with color");
             ImGui::SameLine();
             ImGui::Checkbox("##Show LODs with color", (bool*)&fragment_pc.lod_color);
@@ -572,17 +989,16 @@ void ClassicApplication::DrawFrame()
     }
 
     uint32_t endDrawResult = m_Renderer.EndDraw();
-    m_AccDuration += m_Duration = durationQuery.GetResults();
-
-    m_Counter++;
-    m_Counter %= 180;
 
-    if (m_Counter >= 179)
+    // The startup lasts until the first frame, which had to wait for its pipelines.
+    if (!m_IsStartupLogged)
     {
-        m_AvgDuration = m_AccDuration / 179;
-        m_AccDuration = 0;
+        m_Renderer.EndPipelineCreation();
+        m_IsStartupLogged = true;
     }
 
+    m_HasFrameResults[imageIndex] = true;
+
     if (endDrawResult == -1)
     {
         m_FramebufferResized = true;
@@ -591,16 +1007,45 @@ void ClassicApplication::DrawFrame()
     }
 }
 
+void ClassicApplication::ReadFrameResults(const uint32_t frameIndex)
+{
+    // The LOD passes run on the compute queue now, so their time is added to the one of the draws.
+    const uint64_t computeDuration = (uint64_t)(m_Renderer.GetAsyncCompute().GetComputeMs() * 1000000.f);
+
+    m_AccDuration += m_Duration = m_DurationQueries[frameIndex]->GetResults() + computeDuration;
+
+    m_FragmentInvocations = m_StatisticsQueries[frameIndex]->GetResults()[0];
+    m_SortFragmentInvocations[m_SortByDepth ? 1 : 0] = m_FragmentInvocations;
+
+    m_LODTransitions = static_cast<const LODStats*>(m_LODStatsReadbacks[frameIndex].GetData())->transitionCount;
+
+    m_LODGraph.ReadTimings(frameIndex);
+
+    if (m_AutoLOD)
+    {
+        lod_pc.lod_pow = m_LODGovernor.Update(m_Duration, lod_pc.lod_pow);
+    }
+
+    m_Counter++;
+    m_Counter %= 180;
+
+    if (m_Counter >= 179)
+    {
+        m_AvgDuration = m_AccDuration / 179;
+        m_AccDuration = 0;
+    }
+}
+
 void ClassicApplication::Loop()
 {
-    if (m_Window == nullptr)
+    if (m_Window == nullptr && !m_Renderer.IsHeadless())
     {
         throw std::runtime_error("Failed to run the App! The window is NULL!");
     }
 
-    while (!m_Window->ShouldClose())
+    while (!m_Renderer.ShouldClose())
     {
-        glfwPollEvents();
+        m_Renderer.PollEvents();
         DrawFrame();
     }
 }
@@ -612,7 +1057,8 @@ void ClassicApplication::Shutdown()
 
     device.WaitIdle();
 
-    m_Renderer.m_Swapchain.Destroy();
+    // None of the pipelines may still be in the making when they are destroyed.
+    m_PipelineFactory.Destroy();
 
     device.DestroyPipeline(m_AxisPipeline);
     device.DestroyPipelineLayout(m_AxisPipelineLayout);
@@ -620,40 +1066,77 @@ void ClassicApplication::Shutdown()
     device.DestroyPipeline(m_ModelPipeline);
     device.DestroyPipelineLayout(m_ModelPipelineLayout);
 
-    device.DestroyPipeline(m_BoundsPipeline);
-    device.DestroyPipelineLayout(m_BoundsPipelineLayout);
-
     device.DestroyPipeline(m_FrustumPipeline);
     device.DestroyPipelineLayout(m_FrustumPipelineLayout);
 
     device.DestroyPipeline(m_LODCalculatePipeline);
     device.DestroyPipelineLayout(m_LODCalculatePipelineLayout);
 
-    m_Model->Destroy();
+    device.DestroyPipeline(m_LODPreparePipeline);
+    device.DestroyPipelineLayout(m_LODPreparePipelineLayout);
+
+    device.DestroyPipeline(m_LODScatterPipeline);
+    device.DestroyPipelineLayout(m_LODScatterPipelineLayout);
+
+    device.DestroyPipeline(m_ImpostorPipeline);
+    device.DestroyPipelineLayout(m_ImpostorPipelineLayout);
+
+    m_ImpostorAtlas.Destroy();
+    m_Scene.Destroy();
 
-    m_AxisBuffer.Destroy();
-    m_AxisIndexBuffer.Destroy();
+    // The buffers of the debug views exist only once their pipelines were requested.
+    if (m_AxisPipelineBuild.valid())
+    {
+        m_AxisBuffer.Destroy();
+        m_AxisIndexBuffer.Destroy();
+    }
 
-    m_FrustumBuffer.Destroy();
-    m_FrustumIndexBuffer.Destroy();
+    if (m_FrustumPipelineBuild.valid())
+    {
+        m_FrustumBuffer.Destroy();
+        m_FrustumIndexBuffer.Destroy();
+    }
 
     for (VkCore::Buffer& buffer : m_DrawIndirectCmds)
     {
         buffer.Destroy();
     }
 
+    for (VkCore::Buffer& buffer : m_ImpostorInstanceBuffers)
+    {
+        buffer.Destroy();
+    }
+
+    for (VkCore::Buffer& buffer : m_LODStatsBuffers)
+    {
+        buffer.Destroy();
+    }
+
+    for (HostBuffer& buffer : m_LODStatsReadbacks)
+    {
+        buffer.Destroy();
+    }
+
+    m_DurationQueries.clear();
+    m_StatisticsQueries.clear();
+
     m_InstancesBuffer.Destroy();
+    m_LODStateBuffer.Destroy();
 
     for (VkCore::Buffer& buffer : m_InstanceIndexBuffers)
     {
         buffer.Destroy();
     }
 
-    for (VkCore::Buffer& buffer : m_ScratchBuffers)
+    m_LODGraph.Destroy();
+
+    for (VkCore::Buffer& buffer : m_SortKeyBuffers)
     {
         buffer.Destroy();
     }
 
+    m_DepthSort.Destroy();
+
     for (VkCore::Buffer& buffer : m_MatBuffers)
     {
         buffer.Destroy();
@@ -661,7 +1144,11 @@ void ClassicApplication::Shutdown()
 
     device.DestroyDescriptorSetLayout(m_MatrixDescSetLayout);
     device.DestroyDescriptorSetLayout(m_ScratchSetLayout);
+    (*device).destroyDescriptorPool(m_ScratchSetPool);
     device.DestroyDescriptorSetLayout(m_InstancesDescSetLayout);
+    device.DestroyDescriptorSetLayout(m_LODMeshInfoSetLayout);
+    device.DestroyDescriptorSetLayout(m_ImpostorSetLayout);
+    device.DestroyDescriptorSetLayout(m_DrawIndirectCmdsLayout);
 
     m_DescriptorBuilder.Clear();
     m_DescriptorBuilder.Cleanup();
@@ -834,20 +1321,10 @@ bool ClassicApplication::OnKeyPressed(KeyPressedEvent& event)
 
 void ClassicApplication::RecreateSwapchain()
 {
+    // The pipelines are kept, the frames still in flight finish with the old swapchain.
+    m_Renderer.RecreateSwapchain();
 
-    VkCore::Device& device = VkCore::DeviceManager::GetDevice();
-
-    device.WaitIdle();
-    m_Window->WaitEvents();
-
-    m_Renderer.DestroySwapchain();
-    m_Renderer.DestroyFrameBuffers();
-
-    m_Window->RefreshResolution();
-    m_Renderer.CreateSwapchain(m_Window->GetWidth(), m_Window->GetHeight());
-    m_Renderer.CreateFramebuffers(m_Window->GetWidth(), m_Window->GetHeight());
-
-    m_Camera.RecreateProjection(m_Window->GetWidth(), m_Window->GetHeight());
+    m_Camera.RecreateProjection(m_Renderer.GetWidth(), m_Renderer.GetHeight());
 
     m_FramebufferResized = false;
 }
@@ -1,7 +1,19 @@
 #include <cstdint>
+#include <future>
+#include <memory>
 #include <vector>
 
 #include "../Model/PushConstants.h"
+#include "../Model/ClassicScene.h"
+#include "../../Common/HostBuffer.h"
+#include "../../Common/Impostor/ImpostorAtlas.h"
+#include "../../Common/InstanceTransform.h"
+#include "../../Common/LODGovernor.h"
+#include "../../Common/LODStats.h"
+#include "../../Common/Query.h"
+#include "../../Common/RadixSort.h"
+#include "../../Common/Renderer/PipelineFactory.h"
+#include "../../Common/Renderer/RenderGraph.h"
 #include "../../Common/Renderer/VulkanRenderer.h"
 #include "Event/KeyEvent.h"
 #include "Event/MouseEvent.h"
@@ -10,7 +22,6 @@
 #include "Mesh/Model.h"
 #include "Model/Camera.h"
 #include "Model/MouseState.h"
-#include "Model/Structures/Sphere.h"
 #include "Vk/Descriptors/DescriptorBuilder.h"
 #include "vulkan/vulkan_core.h"
 #include "vulkan/vulkan_handles.hpp"
@@ -21,18 +32,22 @@ class ClassicApplication
   public:
     ClassicApplication() {};
 
-    void Run(const uint32_t winWidth, const uint32_t winHeight);
+    void Run(const LaunchOptions& options);
 
     void DrawFrame();
+    void ReadFrameResults(const uint32_t frameIndex);
     void Loop();
     void Shutdown();
 
+    void InitializeScene();
     void InitializeModelPipeline();
     void InitializeAxisPipeline();
-    void InitializeBoundsPipeline();
     void InitializeFrustumPipeline();
     void InitializeInstancing();
+    void InitializeScratchSets();
+    void InitializeLODGraph();
     void InitializeLODCompute();
+    void InitializeImpostors();
 
     void RecreateSwapchain();
 
@@ -57,9 +72,6 @@ class ClassicApplication
     vk::Pipeline m_ModelPipeline;
     vk::PipelineLayout m_ModelPipelineLayout;
 
-    vk::Pipeline m_BoundsPipeline;
-    vk::PipelineLayout m_BoundsPipelineLayout;
-
     vk::Pipeline m_FrustumPipeline;
     vk::PipelineLayout m_FrustumPipelineLayout;
 
@@ -69,6 +81,23 @@ class ClassicApplication
     vk::Pipeline m_LODPreparePipeline;
     vk::PipelineLayout m_LODPreparePipelineLayout;
 
+    vk::Pipeline m_LODScatterPipeline;
+    vk::PipelineLayout m_LODScatterPipelineLayout;
+
+    vk::Pipeline m_ImpostorPipeline;
+    vk::PipelineLayout m_ImpostorPipelineLayout;
+
+    // Ready once the factory has built the pipelines above.
+    PipelineFactory m_PipelineFactory;
+    std::shared_future<void> m_AxisPipelineBuild;
+    std::shared_future<void> m_ModelPipelineBuild;
+    std::shared_future<void> m_FrustumPipelineBuild;
+    std::shared_future<void> m_LODCalculatePipelineBuild;
+    std::shared_future<void> m_LODPreparePipelineBuild;
+    std::shared_future<void> m_LODScatterPipelineBuild;
+    std::shared_future<void> m_ImpostorPipelineBuild;
+    bool m_IsStartupLogged = false;
+
     std::vector<VkCore::Buffer> m_MatBuffers;
     std::vector<vk::DescriptorSet> m_MatrixDescriptorSets;
     vk::DescriptorSetLayout m_MatrixDescSetLayout;
@@ -79,15 +108,41 @@ class ClassicApplication
     VkCore::Buffer m_FrustumBuffer;
     VkCore::Buffer m_FrustumIndexBuffer;
 
+    // Compressed transforms shrink an instance from 80 to 32 bytes, Mat4 keeps the full matrices.
+    EInstanceFormat m_InstanceFormat = EInstanceFormat::Packed;
     VkCore::Buffer m_InstancesBuffer;
 
+	// LOD every instance was last drawn with, bound next to the instances. Kept across the frames for the hysteresis.
+	VkCore::Buffer m_LODStateBuffer;
+
 	// Instance Index Buffer
 	std::vector<VkCore::Buffer> m_InstanceIndexBuffers;
 
-	// Instance Index Buffer for intermediate calculations.
-	std::vector<VkCore::Buffer> m_ScratchBuffers;
+	// Clear, calculate, prepare, scatter and sort passes of the LODs, recorded into the async compute buffer.
+	RenderGraph m_LODGraph;
+
+	// Instance Index Buffer for intermediate calculations, a transient of the LOD graph.
+	RenderGraphResource m_ScratchBuffer = 0;
+
+	// Instance counts and offsets of every (mesh, LOD) bucket, a transient of the LOD graph.
+	RenderGraphResource m_BucketBuffer = 0;
 
-	VkCore::Buffer m_LODMeshInfo;
+	// Bucket and depth of every instance index. Sorting by them orders the instances of every bucket front-to-back.
+	std::vector<VkCore::Buffer> m_SortKeyBuffers;
+	RadixSort m_DepthSort;
+	bool m_SortByDepth = true;
+
+	// Indirect mesh tasks command and instance indices of the impostors.
+	std::vector<VkCore::Buffer> m_ImpostorInstanceBuffers;
+
+	// Per frame LOD statistics of the LOD compute pass and their host visible copies.
+	std::vector<VkCore::Buffer> m_LODStatsBuffers;
+	std::vector<HostBuffer> m_LODStatsReadbacks;
+
+	// Per frame GPU time of the draws and their fragment invocations, read once the slot comes around again.
+	std::vector<std::unique_ptr<DurationQuery>> m_DurationQueries;
+	std::vector<std::unique_ptr<PipelineStatisticsQuery>> m_StatisticsQueries;
+	std::vector<bool> m_HasFrameResults;
 
 	std::vector<VkCore::Buffer> m_DrawIndirectCmds;
 	std::vector<vk::DescriptorSet> m_DrawIndirectCmdSets;
@@ -102,6 +157,10 @@ class ClassicApplication
 	
 	std::vector<vk::DescriptorSet> m_ScratchSets;
     vk::DescriptorSetLayout m_ScratchSetLayout;
+    vk::DescriptorPool m_ScratchSetPool;
+
+	std::vector<vk::DescriptorSet> m_ImpostorSets;
+    vk::DescriptorSetLayout m_ImpostorSetLayout;
 
     glm::vec2 angles = {0.f, 0.f};
 
@@ -124,7 +183,8 @@ class ClassicApplication
                     .max_instances_count = m_InstanceCountMax,
                     .instances_count = (uint32_t) m_InstanceCount,
                     .lod_pow = 0.7f,
-                    .enable_culling = m_EnableCulling};
+                    .enable_culling = m_EnableCulling,
+                    .mesh_count = 0};
 
     FragmentPC fragment_pc = {
         .diffusion_color = glm::vec3(1.f),
@@ -135,8 +195,17 @@ class ClassicApplication
         .cam_view_dir = glm::vec3(0.f),
     };
 
-    SphereModel m_Sphere;
+    InstancePC instance_pc;
 
+    // Tunes the LOD exponent from the measured GPU time when enabled.
+    LODGovernor m_LODGovernor;
+    bool m_AutoLOD = false;
+
+    uint32_t m_LODTransitions = 0;
+
+    // Fragment shader invocations of the last frame, and of the last frames drawn unsorted and sorted by depth.
+    uint64_t m_FragmentInvocations = 0;
+    uint64_t m_SortFragmentInvocations[2] = {};
 
     uint64_t m_Duration = 0;
     uint64_t m_AvgDuration = 0;
@@ -150,9 +219,15 @@ class ClassicApplication
     VulkanRenderer m_Renderer;
     VkCore::Window* m_Window = nullptr;
 
-    ClassicLODModel* m_Model = nullptr;
+    ClassicScene m_Scene;
+    ImpostorAtlas m_ImpostorAtlas;
+
+    std::array<const char*, 3> m_AvailableModels = {"ClassicMeshLOD/Res/Artwork/OBJs/kitten_lod0.obj",
+                                                    "ClassicMeshLOD/Res/Artwork/OBJs/lucy_lod1.obj",
+                                                    "ClassicMeshLOD/Res/Artwork/OBJs/happysmoothed_lod1.obj"};
 
-    std::array<Model*, 3> m_AvailableModels = {nullptr, nullptr, nullptr};
+    PFN_vkCmdDrawIndexedIndirectCountKHR m_vkCmdDrawIndexedIndirectCount = nullptr;
+    PFN_vkCmdDrawMeshTasksIndirectEXT vkCmdDrawMeshTasksIndirectEXT;
 
     Camera m_Camera;
     Camera m_FrustumCamera;
@@ -0,0 +1,135 @@
+#include "ClassicScene.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Log/Log.h"
+#include "Mesh/ClassicLODMesh.h"
+#include "Vk/Devices/DeviceManager.h"
+#include "Vk/Utils.h"
+#include "vulkan/vulkan_enums.hpp"
+#include "vulkan/vulkan_handles.hpp"
+#include "vulkan/vulkan_structs.hpp"
+
+static_assert(sizeof(ClassicLODMeshInfo) <= LOD_MESH_INFO_STRIDE,
+              "ClassicLODMeshInfo doesn't fit into the stride of the mesh info array!");
+
+uint32_t ClassicScene::AddModel(const std::string& path)
+{
+    ClassicLODModel* model = new ClassicLODModel(path);
+
+    ModelInfo modelInfo{};
+    modelInfo.firstMesh = m_MeshDraws.size();
+    modelInfo.meshCount = model->GetMeshCount();
+
+    for (uint32_t i = 0; i < model->GetMeshCount(); i++)
+    {
+        MeshDrawInfo meshDraw{};
+        meshDraw.modelId = m_Models.size();
+
+        m_MeshDraws.emplace_back(meshDraw);
+    }
+
+    m_MaxMeshesPerModel = std::max(m_MaxMeshesPerModel, modelInfo.meshCount);
+
+    m_Models.emplace_back(model);
+    m_ModelInfos.emplace_back(modelInfo);
+
+    return m_ModelInfos.size() - 1;
+}
+
+void ClassicScene::Build(StagingUploader& uploader)
+{
+    ASSERT(!m_Models.empty(), "The scene has to contain at least one model before building it!")
+
+    std::vector<vk::BufferCopy> vertexCopies;
+    std::vector<vk::BufferCopy> indexCopies;
+    std::vector<uint8_t> meshInfos(m_MeshDraws.size() * LOD_MESH_INFO_STRIDE, 0);
+
+    vk::DeviceSize vertexBytes = 0;
+    vk::DeviceSize indexBytes = 0;
+
+    uint32_t meshIndex = 0;
+
+    for (ClassicLODModel* model : m_Models)
+    {
+        for (uint32_t i = 0; i < model->GetMeshCount(); i++, meshIndex++)
+        {
+            ClassicLODMesh& mesh = model->GetMesh(i);
+
+            const vk::DeviceSize vertexSize = mesh.GetVertexBuffer().GetSize();
+            const vk::DeviceSize indexSize = mesh.GetIndexBuffer().GetSize();
+
+            // The LOD index offsets of a mesh are relative to the start of its index buffer and the indices
+            // themselves to the start of its vertex buffer. Therefore only the base offsets have to be stored.
+            m_MeshDraws[meshIndex].firstIndex = indexBytes / sizeof(uint32_t);
+            m_MeshDraws[meshIndex].vertexOffset = vertexBytes / sizeof(Vertex);
+
+            vertexCopies.emplace_back(0, vertexBytes, vertexSize);
+            indexCopies.emplace_back(0, indexBytes, indexSize);
+
+            vertexBytes += vertexSize;
+            indexBytes += indexSize;
+
+            const ClassicLODMeshInfo meshInfo = mesh.GetMeshInfo();
+            std::memcpy(meshInfos.data() + meshIndex * LOD_MESH_INFO_STRIDE, &meshInfo, sizeof(ClassicLODMeshInfo));
+        }
+    }
+
+    m_VertexBuffer = VkCore::Buffer(vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst);
+    m_VertexBuffer.InitializeOnGpu(vertexBytes);
+
+    m_IndexBuffer = VkCore::Buffer(vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst);
+    m_IndexBuffer.InitializeOnGpu(indexBytes);
+
+    // Merge the geometry on the GPU. The source buffers live in device local memory already, so there is no need to
+    // stage them again through the host. The copies go out together with the tables below.
+    meshIndex = 0;
+
+    for (ClassicLODModel* model : m_Models)
+    {
+        for (uint32_t i = 0; i < model->GetMeshCount(); i++, meshIndex++)
+        {
+            ClassicLODMesh& mesh = model->GetMesh(i);
+
+            uploader.Copy(mesh.GetVertexBuffer().GetVkBuffer(), m_VertexBuffer.GetVkBuffer(), vertexCopies[meshIndex]);
+            uploader.Copy(mesh.GetIndexBuffer().GetVkBuffer(), m_IndexBuffer.GetVkBuffer(), indexCopies[meshIndex]);
+        }
+    }
+
+    const vk::BufferUsageFlags tableUsage =
+        vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst;
+
+    m_MeshInfoBuffer = VkCore::Buffer(tableUsage);
+    m_MeshInfoBuffer.InitializeOnGpu(meshInfos.size());
+    uploader.Upload(m_MeshInfoBuffer.GetVkBuffer(), meshInfos.data(), meshInfos.size());
+
+    m_MeshDrawBuffer = VkCore::Buffer(tableUsage);
+    m_MeshDrawBuffer.InitializeOnGpu(m_MeshDraws.size() * sizeof(MeshDrawInfo));
+    uploader.Upload(m_MeshDrawBuffer.GetVkBuffer(), m_MeshDraws.data(), m_MeshDraws.size() * sizeof(MeshDrawInfo));
+
+    m_ModelInfoBuffer = VkCore::Buffer(tableUsage);
+    m_ModelInfoBuffer.InitializeOnGpu(m_ModelInfos.size() * sizeof(ModelInfo));
+    uploader.Upload(m_ModelInfoBuffer.GetVkBuffer(), m_ModelInfos.data(), m_ModelInfos.size() * sizeof(ModelInfo));
+
+    LOGF(Application, Info, "Built the scene with %d models, %d meshes and %d draw buckets", GetModelCount(),
+         GetMeshCount(), GetBucketCount())
+}
+
+void ClassicScene::Destroy()
+{
+    for (ClassicLODModel* model : m_Models)
+    {
+        model->Destroy();
+        delete model;
+    }
+
+    m_Models.clear();
+
+    m_VertexBuffer.Destroy();
+    m_IndexBuffer.Destroy();
+
+    m_MeshInfoBuffer.Destroy();
+    m_MeshDrawBuffer.Destroy();
+    m_ModelInfoBuffer.Destroy();
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Constants.h"
+#include "../../Common/Renderer/StagingUploader.h"
+#include "glm/mat4x4.hpp"
+#include "Mesh/ClassicLODModel.h"
+#include "Vk/Buffers/Buffer.h"
+
+// Stride of a single `s_lod_mesh_info` element in the std430 mesh info array. The struct contains a vec3, so its
+// size is rounded up to a multiple of 16 bytes.
+constexpr size_t LOD_MESH_INFO_STRIDE = 128;
+
+// Per-mesh offsets into the merged vertex and index buffers. Mirrors `s_mesh_draw` in the LOD compute shaders.
+struct MeshDrawInfo
+{
+    uint32_t firstIndex = 0;
+    int32_t vertexOffset = 0;
+    uint32_t modelId = 0;
+    uint32_t padding = 0;
+};
+
+// Range of meshes belonging to a single model. Mirrors `s_model_info` in the LOD compute shaders.
+struct ModelInfo
+{
+    uint32_t firstMesh = 0;
+    uint32_t meshCount = 0;
+};
+
+// Instance counts and offsets of a single (mesh, LOD) draw bucket. Mirrors `s_bucket`.
+struct LodBucket
+{
+    uint32_t instanceCount = 0;
+    uint32_t firstInstance = 0;
+    uint32_t cursor = 0;
+    uint32_t padding = 0;
+};
+
+// Byte offset of the first draw command in the indirect buffer. The draw count and the total instance count of the
+// buckets are stored in front of the commands.
+constexpr uint32_t DRAW_CMDS_OFFSET = 16;
+constexpr uint32_t DRAW_CMDS_INSTANCE_COUNT_INDEX = 1;
+
+// Bits of the depth in the sort keys of the instance indices, the bucket takes the bits above them.
+constexpr uint32_t SORT_DEPTH_BITS = 20;
+
+// Instance data as seen by the shaders. Mirrors `s_instance`.
+struct InstanceData
+{
+    glm::mat4 transform;
+    uint32_t modelId = 0;
+    uint32_t padding[3] = {};
+};
+
+/**
+ * Collection of classic LOD models which share one merged vertex and index buffer, so that the whole scene can be
+ * drawn with a single indirect draw call. Every (mesh, LOD) pair forms a draw bucket.
+ */
+class ClassicScene
+{
+  public:
+    ClassicScene() {};
+
+    /**
+     * Loads a model into the scene.
+     * @return ID of the model, which should be assigned to the instances of this model.
+     */
+    uint32_t AddModel(const std::string& path);
+
+    /**
+     * Merges the geometry of all added models into the shared buffers and uploads the mesh and model tables.
+     * Has to be called after all models were added. The copies are queued to the uploader, the caller flushes them.
+     */
+    void Build(StagingUploader& uploader);
+
+    void Destroy();
+
+    const std::vector<ClassicLODModel*>& GetModels() const
+    {
+        return m_Models;
+    }
+
+    uint32_t GetModelCount() const
+    {
+        return m_ModelInfos.size();
+    }
+
+    uint32_t GetMeshCount() const
+    {
+        return m_MeshDraws.size();
+    }
+
+    uint32_t GetBucketCount() const
+    {
+        return m_MeshDraws.size() * Constants::MAX_LOD_LEVELS;
+    }
+
+    uint32_t GetMaxMeshesPerModel() const
+    {
+        return m_MaxMeshesPerModel;
+    }
+
+    VkCore::Buffer& GetVertexBuffer()
+    {
+        return m_VertexBuffer;
+    }
+
+    VkCore::Buffer& GetIndexBuffer()
+    {
+        return m_IndexBuffer;
+    }
+
+    VkCore::Buffer& GetMeshInfoBuffer()
+    {
+        return m_MeshInfoBuffer;
+    }
+
+    VkCore::Buffer& GetMeshDrawBuffer()
+    {
+        return m_MeshDrawBuffer;
+    }
+
+    VkCore::Buffer& GetModelInfoBuffer()
+    {
+        return m_ModelInfoBuffer;
+    }
+
+  private:
+    std::vector<ClassicLODModel*> m_Models;
+    std::vector<ModelInfo> m_ModelInfos;
+    std::vector<MeshDrawInfo> m_MeshDraws;
+
+    uint32_t m_MaxMeshesPerModel = 0;
+
+    VkCore::Buffer m_VertexBuffer;
+    VkCore::Buffer m_IndexBuffer;
+
+    VkCore::Buffer m_MeshInfoBuffer;
+    VkCore::Buffer m_MeshDrawBuffer;
+    VkCore::Buffer m_ModelInfoBuffer;
+};
@@ -4,6 +4,7 @@
 #include "glm/mat4x4.hpp"
 #include "Model/Camera.h"
 #include "glm/vec3.hpp"
+#include "glm/vec4.hpp"
 
 struct FragmentPC {
     glm::vec3 diffusion_color;
@@ -22,4 +23,21 @@ struct LodPC {
 	uint32_t instances_count = 0;
 	float lod_pow = 0.7f;
 	uint32_t enable_culling = false;
+	uint32_t mesh_count = 0;
+	// Distance from which the instances are drawn as impostors. Zero disables the impostor LOD.
+	float impostor_distance = 30.f;
+	// Margin in LOD levels by which the continuous LOD has to leave the range of the current LOD of an instance
+	// before the instance switches to another one.
+	float lod_hysteresis = 0.25f;
+	// Distance by which an impostor has to come closer than the impostor distance before it gets its mesh back.
+	float impostor_hysteresis = 2.f;
+	uint32_t packed_instances = false;
+	// View direction (xyz) and its offset (w) of the drawing camera, the depth of the instances is their distance
+	// to this plane.
+	alignas(16) glm::vec4 view_plane = glm::vec4(0.f);
+};
+
+// Instance format of the graphics pipelines reading the instances, pushed after the FragmentPC.
+struct InstancePC {
+	uint32_t packed_instances = false;
 };
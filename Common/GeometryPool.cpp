@@ -0,0 +1,167 @@
+#include "GeometryPool.h"
+
+#include <algorithm>
+
+#include "Log/Log.h"
+#include "Mesh/Mesh.h"
+#include "Vk/Devices/DeviceManager.h"
+#include "Vk/Utils.h"
+
+void GeometryPool::Initialize(const vk::DeviceSize blockSize)
+{
+    m_BlockSize = blockSize;
+}
+
+void GeometryPool::Destroy()
+{
+    vk::Device device = *VkCore::DeviceManager::GetDevice();
+
+    for (Block& block : m_Blocks)
+    {
+        device.destroyBuffer(block.buffer);
+        device.freeMemory(block.memory);
+    }
+
+    m_Blocks.clear();
+    m_PendingCopies.clear();
+    m_UsedBytes = 0;
+}
+
+void GeometryPool::AddBlock(const vk::DeviceSize size)
+{
+    vk::Device device = *VkCore::DeviceManager::GetDevice();
+    vk::PhysicalDevice physicalDevice = *VkCore::DeviceManager::GetPhysicalDevice();
+
+    Block block{};
+    block.size = size;
+
+    vk::BufferCreateInfo createInfo{};
+    createInfo.setSize(size)
+        .setUsage(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress |
+                  vk::BufferUsageFlagBits::eTransferDst)
+        .setSharingMode(vk::SharingMode::eExclusive);
+
+    block.buffer = device.createBuffer(createInfo);
+
+    const vk::MemoryRequirements requirements = device.getBufferMemoryRequirements(block.buffer);
+    const vk::PhysicalDeviceMemoryProperties memoryProperties = physicalDevice.getMemoryProperties();
+
+    uint32_t memoryType = UINT32_MAX;
+
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount && memoryType == UINT32_MAX; i++)
+    {
+        if ((requirements.memoryTypeBits & (1 << i)) &&
+            (memoryProperties.memoryTypes[i].propertyFlags & vk::MemoryPropertyFlagBits::eDeviceLocal))
+        {
+            memoryType = i;
+        }
+    }
+
+    ASSERT(memoryType != UINT32_MAX, "No device local memory type found for the geometry pool!")
+
+    vk::MemoryAllocateFlagsInfo flagsInfo{};
+    flagsInfo.setFlags(vk::MemoryAllocateFlagBits::eDeviceAddress);
+
+    vk::MemoryAllocateInfo allocateInfo{};
+    allocateInfo.setAllocationSize(requirements.size).setMemoryTypeIndex(memoryType).setPNext(&flagsInfo);
+
+    block.memory = device.allocateMemory(allocateInfo);
+    device.bindBufferMemory(block.buffer, block.memory, 0);
+
+    block.address = device.getBufferAddress(vk::BufferDeviceAddressInfo{block.buffer});
+
+    m_Blocks.emplace_back(block);
+
+    LOGF(Application, Info, "Geometry pool: allocated block %d of %.2f MB", (int)m_Blocks.size() - 1,
+         size / (1024.f * 1024.f))
+}
+
+vk::DeviceAddress GeometryPool::Allocate(const vk::DeviceSize size, const vk::DeviceSize alignment)
+{
+    ASSERT(m_BlockSize > 0, "The geometry pool has to be initialized before allocating from it!")
+
+    // Only the last block is allocated from, the ranges are never freed.
+    if (!m_Blocks.empty())
+    {
+        Block& block = m_Blocks.back();
+        const vk::DeviceSize offset = (block.offset + alignment - 1) / alignment * alignment;
+
+        if (offset + size <= block.size)
+        {
+            block.offset = offset + size;
+            m_UsedBytes += size;
+
+            return block.address + offset;
+        }
+    }
+
+    AddBlock(std::max(m_BlockSize, size));
+
+    Block& block = m_Blocks.back();
+    block.offset = size;
+    m_UsedBytes += size;
+
+    return block.address;
+}
+
+void GeometryPool::QueueCopy(const vk::Buffer srcBuffer, const vk::DeviceSize size, const vk::DeviceAddress dstAddress)
+{
+    for (uint32_t i = 0; i < m_Blocks.size(); i++)
+    {
+        const Block& block = m_Blocks[i];
+
+        if (dstAddress >= block.address && dstAddress + size <= block.address + block.size)
+        {
+            m_PendingCopies.push_back({srcBuffer, i, vk::BufferCopy(0, dstAddress - block.address, size)});
+            return;
+        }
+    }
+
+    ASSERT(false, "The address of the copy doesn't belong to the geometry pool!")
+}
+
+MeshGeometry GeometryPool::AddMesh(Mesh& mesh)
+{
+    MeshGeometry geometry{};
+    geometry.meshletCount = mesh.GetMeshletCount();
+
+    const std::pair<VkCore::Buffer*, vk::DeviceAddress*> streams[] = {
+        {&mesh.GetVertexBuffer(), &geometry.vertices},
+        {&mesh.GetMeshletBuffer(), &geometry.meshlets},
+        {&mesh.GetMeshletVerticesBuffer(), &geometry.meshletVertices},
+        {&mesh.GetMeshletTrianglesBuffer(), &geometry.meshletTriangles},
+        {&mesh.GetMeshletBoundsBuffer(), &geometry.meshletBounds},
+    };
+
+    for (const auto& [buffer, address] : streams)
+    {
+        *address = Allocate(buffer->GetSize());
+        QueueCopy(buffer->GetVkBuffer(), buffer->GetSize(), *address);
+    }
+
+    return geometry;
+}
+
+void GeometryPool::Flush(StagingUploader& uploader)
+{
+    // The source buffers live in device local memory already, so there is no need to stage them again through the
+    // host.
+    for (const PendingCopy& copy : m_PendingCopies)
+    {
+        uploader.Copy(copy.srcBuffer, m_Blocks[copy.block].buffer, copy.region);
+    }
+
+    m_PendingCopies.clear();
+}
+
+vk::DeviceSize GeometryPool::GetCapacity() const
+{
+    vk::DeviceSize capacity = 0;
+
+    for (const Block& block : m_Blocks)
+    {
+        capacity += block.size;
+    }
+
+    return capacity;
+}
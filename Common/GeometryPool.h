@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "Renderer/StagingUploader.h"
+
+class Mesh;
+
+// Device addresses of the geometry of a single mesh in the pool. Mirrors `s_mesh_geometry` in the shaders, where the
+// addresses are buffer references.
+struct MeshGeometry
+{
+    vk::DeviceAddress vertices = 0;
+    vk::DeviceAddress meshlets = 0;
+    vk::DeviceAddress meshletVertices = 0;
+    vk::DeviceAddress meshletTriangles = 0;
+    vk::DeviceAddress meshletBounds = 0;
+    uint32_t meshletCount = 0;
+    uint32_t padding = 0;
+};
+
+/**
+ * Device local storage for the geometry of all the meshes of an application. The meshes are sub-allocated from a few
+ * large blocks and reached by the shaders through the device addresses of their ranges, so drawing another mesh
+ * needs neither a descriptor set nor a change of the pipeline layout.
+ *
+ * The blocks are allocated directly with the device address flag, since the addresses have to be queried from the
+ * memory they are bound to.
+ */
+class GeometryPool
+{
+  public:
+    GeometryPool() {};
+
+    /**
+     * @param blockSize Size of a single block. Allocations larger than that get a block of their own.
+     */
+    void Initialize(const vk::DeviceSize blockSize = 64 * 1024 * 1024);
+
+    void Destroy();
+
+    /**
+     * Reserves the ranges of all the geometry streams of the mesh and queues the copies of its buffers into them.
+     * The copies are handed to the uploader by the next Flush call.
+     */
+    MeshGeometry AddMesh(Mesh& mesh);
+
+    /**
+     * Reserves a range of the pool.
+     * @return Device address of the range.
+     */
+    vk::DeviceAddress Allocate(const vk::DeviceSize size, const vk::DeviceSize alignment = 16);
+
+    // Queues a copy of the whole source buffer to the given address of the pool.
+    void QueueCopy(const vk::Buffer srcBuffer, const vk::DeviceSize size, const vk::DeviceAddress dstAddress);
+
+    // Hands the queued copies to the uploader, which submits them along with the rest of its copies.
+    void Flush(StagingUploader& uploader);
+
+    uint32_t GetBlockCount() const
+    {
+        return m_Blocks.size();
+    }
+
+    vk::DeviceSize GetUsedBytes() const
+    {
+        return m_UsedBytes;
+    }
+
+    vk::DeviceSize GetCapacity() const;
+
+  private:
+    struct Block
+    {
+        vk::Buffer buffer = nullptr;
+        vk::DeviceMemory memory = nullptr;
+        vk::DeviceAddress address = 0;
+        vk::DeviceSize size = 0;
+        vk::DeviceSize offset = 0;
+    };
+
+    struct PendingCopy
+    {
+        vk::Buffer srcBuffer;
+        uint32_t block = 0;
+        vk::BufferCopy region;
+    };
+
+    void AddBlock(const vk::DeviceSize size);
+
+  private:
+    vk::DeviceSize m_BlockSize = 0;
+    vk::DeviceSize m_UsedBytes = 0;
+
+    std::vector<Block> m_Blocks;
+    std::vector<PendingCopy> m_PendingCopies;
+};
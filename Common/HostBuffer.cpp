@@ -0,0 +1,66 @@
+#include "HostBuffer.h"
+
+#include "Log/Log.h"
+#include "Vk/Devices/DeviceManager.h"
+
+void HostBuffer::Initialize(const vk::DeviceSize size, const vk::BufferUsageFlags usage)
+{
+    vk::Device device = *VkCore::DeviceManager::GetDevice();
+    vk::PhysicalDevice physicalDevice = *VkCore::DeviceManager::GetPhysicalDevice();
+
+    m_Size = size;
+
+    vk::BufferCreateInfo createInfo{};
+    createInfo.setSize(size).setUsage(usage).setSharingMode(vk::SharingMode::eExclusive);
+
+    m_Buffer = device.createBuffer(createInfo);
+
+    const vk::MemoryRequirements requirements = device.getBufferMemoryRequirements(m_Buffer);
+    const vk::PhysicalDeviceMemoryProperties memoryProperties = physicalDevice.getMemoryProperties();
+
+    const vk::MemoryPropertyFlags required =
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+
+    // Cached memory makes the reads on the CPU cheap, but it is not available everywhere.
+    uint32_t memoryType = UINT32_MAX;
+
+    for (const vk::MemoryPropertyFlags flags : {required | vk::MemoryPropertyFlagBits::eHostCached, required})
+    {
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount && memoryType == UINT32_MAX; i++)
+        {
+            if ((requirements.memoryTypeBits & (1 << i)) &&
+                (memoryProperties.memoryTypes[i].propertyFlags & flags) == flags)
+            {
+                memoryType = i;
+            }
+        }
+    }
+
+    ASSERT(memoryType != UINT32_MAX, "No host visible and coherent memory type found for the host buffer!")
+
+    vk::MemoryAllocateInfo allocateInfo{};
+    allocateInfo.setAllocationSize(requirements.size).setMemoryTypeIndex(memoryType);
+
+    m_Memory = device.allocateMemory(allocateInfo);
+    device.bindBufferMemory(m_Buffer, m_Memory, 0);
+
+    m_Data = device.mapMemory(m_Memory, 0, size);
+}
+
+void HostBuffer::Destroy()
+{
+    vk::Device device = *VkCore::DeviceManager::GetDevice();
+
+    if (m_Data)
+    {
+        device.unmapMemory(m_Memory);
+        m_Data = nullptr;
+    }
+
+    device.destroyBuffer(m_Buffer);
+    device.freeMemory(m_Memory);
+
+    m_Buffer = nullptr;
+    m_Memory = nullptr;
+    m_Size = 0;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+
+#include <vulkan/vulkan.hpp>
+
+/**
+ * Persistently mapped buffer in host visible memory. Used for small amounts of data the GPU writes back to the CPU,
+ * like the statistics of the compute passes. The memory is coherent, so the data can be read once the work writing
+ * it has finished, without flushing or invalidating.
+ */
+class HostBuffer
+{
+  public:
+    HostBuffer() {};
+
+    void Initialize(const vk::DeviceSize size, const vk::BufferUsageFlags usage);
+
+    void Destroy();
+
+    vk::Buffer GetVkBuffer() const
+    {
+        return m_Buffer;
+    }
+
+    vk::DeviceSize GetSize() const
+    {
+        return m_Size;
+    }
+
+    void* GetData() const
+    {
+        return m_Data;
+    }
+
+  private:
+    vk::Buffer m_Buffer = nullptr;
+    vk::DeviceMemory m_Memory = nullptr;
+    vk::DeviceSize m_Size = 0;
+    void* m_Data = nullptr;
+};
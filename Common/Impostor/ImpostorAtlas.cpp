@@ -0,0 +1,253 @@
+#include "ImpostorAtlas.h"
+
+#include "../Renderer/PipelineBuilder.h"
+#include "Log/Log.h"
+#include "Mesh/ClassicLODMesh.h"
+#include "Vk/Devices/DeviceManager.h"
+#include "Vk/Utils.h"
+#include "vulkan/vulkan_enums.hpp"
+#include "vulkan/vulkan_structs.hpp"
+
+// Passes of the bake shader. Mirrors the defines in impostor_bake.comp.
+enum class EImpostorBakePass : uint32_t
+{
+    Clear = 0,
+    Bounds = 1,
+    Sphere = 2,
+    Rasterize = 3,
+};
+
+struct ImpostorBakeDraw
+{
+    uint32_t slot = 0;
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    int32_t vertexOffset = 0;
+};
+
+static void InsertComputeBarrier(const vk::CommandBuffer& cmdBuffer)
+{
+    vk::MemoryBarrier memoryBarrier;
+    memoryBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+    memoryBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {},
+                              memoryBarrier, {}, {});
+}
+
+void ImpostorAtlas::Bake(const std::vector<ClassicLODModel*>& models, const PipelineCache& pipelineCache)
+{
+    ASSERT(!models.empty(), "There has to be at least one model to bake the impostor atlas from!")
+
+    m_SlotCount = models.size();
+
+    m_Atlas.InitializeOnTheGpu(IMPOSTOR_ATLAS_SIZE, IMPOSTOR_ATLAS_SIZE * m_SlotCount, vk::Format::eR32Uint);
+
+    m_BoundsBuffer = VkCore::Buffer(vk::BufferUsageFlagBits::eStorageBuffer);
+    m_BoundsBuffer.InitializeOnGpu(m_SlotCount * sizeof(ImpostorBounds));
+
+    // The geometry of all the models is gathered into one pair of storage buffers, so that a single descriptor set
+    // covers every mesh. All LODs of a mesh are rasterized, they approximate the same surface and the closest sample
+    // wins anyway.
+    std::vector<ImpostorBakeDraw> draws;
+    std::vector<vk::BufferCopy> vertexCopies;
+    std::vector<vk::BufferCopy> indexCopies;
+
+    vk::DeviceSize vertexBytes = 0;
+    vk::DeviceSize indexBytes = 0;
+
+    for (uint32_t slot = 0; slot < m_SlotCount; slot++)
+    {
+        for (uint32_t i = 0; i < models[slot]->GetMeshCount(); i++)
+        {
+            ClassicLODMesh& mesh = models[slot]->GetMesh(i);
+
+            const vk::DeviceSize vertexSize = mesh.GetVertexBuffer().GetSize();
+            const vk::DeviceSize indexSize = mesh.GetIndexBuffer().GetSize();
+
+            ImpostorBakeDraw draw{};
+            draw.slot = slot;
+            draw.firstIndex = indexBytes / sizeof(uint32_t);
+            draw.indexCount = indexSize / sizeof(uint32_t);
+            draw.vertexOffset = vertexBytes / sizeof(Vertex);
+
+            draws.emplace_back(draw);
+
+            vertexCopies.emplace_back(0, vertexBytes, vertexSize);
+            indexCopies.emplace_back(0, indexBytes, indexSize);
+
+            vertexBytes += vertexSize;
+            indexBytes += indexSize;
+        }
+    }
+
+    VkCore::Buffer vertexBuffer(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst);
+    vertexBuffer.InitializeOnGpu(vertexBytes);
+
+    VkCore::Buffer indexBuffer(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst);
+    indexBuffer.InitializeOnGpu(indexBytes);
+
+    VkCore::Device& device = VkCore::DeviceManager::GetDevice();
+
+    m_DescriptorBuilder = VkCore::DescriptorBuilder(device);
+
+    vk::DescriptorImageInfo atlasInfo = m_Atlas.CreateDescriptorImageInfo(vk::ImageLayout::eGeneral);
+
+    vk::DescriptorSet bakeSet;
+    vk::DescriptorSetLayout bakeSetLayout;
+
+    m_DescriptorBuilder
+        .BindImage(0, atlasInfo, vk::DescriptorType::eStorageImage, vk::ShaderStageFlagBits::eCompute)
+        .BindBuffer(1, vertexBuffer, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+        .BindBuffer(2, indexBuffer, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+        .BindBuffer(3, m_BoundsBuffer, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+        .Build(bakeSet, bakeSetLayout);
+
+    m_DescriptorBuilder.Clear();
+
+    const ShaderBinary shader = LoadShader("Common/Res/Shaders/impostor/impostor_bake.comp");
+
+    ComputePipelineBuilder pipelineBuilder(pipelineCache);
+
+    vk::PipelineLayout bakePipelineLayout;
+    vk::Pipeline bakePipeline = pipelineBuilder.BindShaderModule(shader)
+                                    .AddPushConstantRange<ImpostorBakePC>(vk::ShaderStageFlagBits::eCompute)
+                                    .AddDescriptorLayout(bakeSetLayout)
+                                    .Build(bakePipelineLayout);
+
+    vk::CommandPoolCreateInfo poolCreateInfo{
+        vk::CommandPoolCreateFlagBits::eTransient,
+        VkCore::DeviceManager::GetPhysicalDevice().GetQueueFamilyIndices().m_GraphicsFamily.value()};
+
+    vk::CommandPool commandPool = device.CreateCommandPool(poolCreateInfo);
+
+    vk::CommandBufferAllocateInfo allocateInfo{};
+    allocateInfo.setLevel(vk::CommandBufferLevel::ePrimary).setCommandPool(commandPool).setCommandBufferCount(1);
+
+    vk::CommandBuffer cmdBuffer = device.AllocateCommandBuffers(allocateInfo)[0];
+
+    cmdBuffer.begin(vk::CommandBufferBeginInfo{vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+
+    uint32_t meshIndex = 0;
+
+    for (uint32_t slot = 0; slot < m_SlotCount; slot++)
+    {
+        for (uint32_t i = 0; i < models[slot]->GetMeshCount(); i++, meshIndex++)
+        {
+            ClassicLODMesh& mesh = models[slot]->GetMesh(i);
+
+            cmdBuffer.copyBuffer(mesh.GetVertexBuffer().GetVkBuffer(), vertexBuffer.GetVkBuffer(),
+                                 vertexCopies[meshIndex]);
+            cmdBuffer.copyBuffer(mesh.GetIndexBuffer().GetVkBuffer(), indexBuffer.GetVkBuffer(),
+                                 indexCopies[meshIndex]);
+        }
+    }
+
+    vk::MemoryBarrier copyBarrier;
+    copyBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    copyBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, {},
+                              copyBarrier, {}, {});
+
+    cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, bakePipeline);
+    cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, bakePipelineLayout, 0, bakeSet, {});
+
+    ImpostorBakePC bakePC{};
+    bakePC.slot_count = m_SlotCount;
+    bakePC.vertex_stride = sizeof(Vertex) / sizeof(float);
+
+    {
+        // Clear the atlas and reset the bounds of every slot
+        bakePC.pass = (uint32_t)EImpostorBakePass::Clear;
+
+        cmdBuffer.pushConstants(bakePipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(ImpostorBakePC),
+                                &bakePC);
+        cmdBuffer.dispatch((IMPOSTOR_ATLAS_SIZE * IMPOSTOR_ATLAS_SIZE * m_SlotCount) / 32, 1, 1);
+
+        InsertComputeBarrier(cmdBuffer);
+    }
+    {
+        // Accumulate the AABB of every slot
+        bakePC.pass = (uint32_t)EImpostorBakePass::Bounds;
+
+        for (const ImpostorBakeDraw& draw : draws)
+        {
+            bakePC.slot = draw.slot;
+            bakePC.first_index = draw.firstIndex;
+            bakePC.index_count = draw.indexCount;
+            bakePC.vertex_offset = draw.vertexOffset;
+
+            cmdBuffer.pushConstants(bakePipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(ImpostorBakePC),
+                                    &bakePC);
+            cmdBuffer.dispatch((draw.indexCount / 32) + 1, 1, 1);
+        }
+
+        InsertComputeBarrier(cmdBuffer);
+    }
+    {
+        // Turn the AABBs into the bounding spheres the views are fitted to
+        bakePC.pass = (uint32_t)EImpostorBakePass::Sphere;
+
+        cmdBuffer.pushConstants(bakePipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(ImpostorBakePC),
+                                &bakePC);
+        cmdBuffer.dispatch((m_SlotCount / 32) + 1, 1, 1);
+
+        InsertComputeBarrier(cmdBuffer);
+    }
+    {
+        // Rasterize every triangle into every view of its slot
+        bakePC.pass = (uint32_t)EImpostorBakePass::Rasterize;
+
+        for (const ImpostorBakeDraw& draw : draws)
+        {
+            bakePC.slot = draw.slot;
+            bakePC.first_index = draw.firstIndex;
+            bakePC.index_count = draw.indexCount;
+            bakePC.vertex_offset = draw.vertexOffset;
+
+            cmdBuffer.pushConstants(bakePipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(ImpostorBakePC),
+                                    &bakePC);
+            cmdBuffer.dispatch((draw.indexCount / 3 / 32) + 1, IMPOSTOR_VIEWS_PER_SIDE * IMPOSTOR_VIEWS_PER_SIDE, 1);
+        }
+
+        vk::MemoryBarrier memoryBarrier;
+        memoryBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+        memoryBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+
+        cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                  vk::PipelineStageFlagBits::eMeshShaderEXT | vk::PipelineStageFlagBits::eFragmentShader,
+                                  {}, memoryBarrier, {}, {});
+    }
+
+    cmdBuffer.end();
+
+    vk::SubmitInfo submitInfo{};
+    submitInfo.setCommandBuffers(cmdBuffer);
+
+    TRY_CATCH_BEGIN()
+
+    device.GetGraphicsQueue().submit(submitInfo);
+    device.GetGraphicsQueue().waitIdle();
+
+    TRY_CATCH_END()
+
+    device.DestroyCommandPool(commandPool);
+
+    device.DestroyPipeline(bakePipeline);
+    device.DestroyPipelineLayout(bakePipelineLayout);
+
+    vertexBuffer.Destroy();
+    indexBuffer.Destroy();
+
+    LOGF(Application, Info, "Baked the impostor atlas of %d models (%dx%d texels)", m_SlotCount, IMPOSTOR_ATLAS_SIZE,
+         IMPOSTOR_ATLAS_SIZE * m_SlotCount)
+}
+
+void ImpostorAtlas::Destroy()
+{
+    m_Atlas.Destroy();
+    m_BoundsBuffer.Destroy();
+
+    m_DescriptorBuilder.Cleanup();
+}
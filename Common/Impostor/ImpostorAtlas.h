@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../Renderer/PipelineCache.h"
+#include "glm/vec4.hpp"
+#include "Mesh/ClassicLODModel.h"
+#include "Vk/Buffers/Buffer.h"
+#include "Vk/Descriptors/DescriptorBuilder.h"
+#include "Vk/Texture/Image2D.h"
+#include "vulkan/vulkan_handles.hpp"
+
+// Number of octahedral views along one side of the atlas of a single model.
+constexpr uint32_t IMPOSTOR_VIEWS_PER_SIDE = 8;
+
+// Resolution of a single view in texels.
+constexpr uint32_t IMPOSTOR_VIEW_RESOLUTION = 64;
+
+constexpr uint32_t IMPOSTOR_ATLAS_SIZE = IMPOSTOR_VIEWS_PER_SIDE * IMPOSTOR_VIEW_RESOLUTION;
+
+// Bounds of a baked model. Mirrors `s_impostor_bounds` in the impostor shaders. The AABB is only needed while baking,
+// the shaders drawing the impostors use just the bounding sphere.
+struct ImpostorBounds
+{
+    uint32_t aabbMin[3] = {};
+    uint32_t aabbMax[3] = {};
+    uint32_t padding[2] = {};
+    glm::vec4 sphere = glm::vec4(0.f);
+};
+
+struct ImpostorBakePC
+{
+    uint32_t pass = 0;
+    uint32_t slot = 0;
+    uint32_t slot_count = 0;
+    uint32_t first_index = 0;
+    uint32_t index_count = 0;
+    int32_t vertex_offset = 0;
+    uint32_t vertex_stride = 0;
+    uint32_t padding = 0;
+};
+
+// Header of the per-frame impostor instance list. It starts with the indirect mesh tasks command, so the buffer can be
+// passed to the indirect draw directly. The visible instance indices follow it.
+struct ImpostorListHeader
+{
+    uint32_t groupCountX = 0;
+    uint32_t groupCountY = 0;
+    uint32_t groupCountZ = 0;
+    uint32_t instanceCount = 0;
+};
+
+/**
+ * Octahedral impostor atlas of a set of models, used as the last LOD level of the far away instances.
+ *
+ * Every model gets its own slot of IMPOSTOR_VIEWS_PER_SIDE x IMPOSTOR_VIEWS_PER_SIDE orthographic views of its finest
+ * geometry, taken from the directions of an octahedral mapping of the sphere. A texel stores the depth of the closest
+ * surface in the upper 16 bits and its octahedrally encoded normal in the lower 16 bits, both shading models of the
+ * LOD applications derive the color from the normal. The slots are stacked vertically in a single R32Uint image.
+ */
+class ImpostorAtlas
+{
+  public:
+    ImpostorAtlas() {};
+
+    /**
+     * Rasterizes the given models into the atlas on the GPU. The model at index i is stored in slot i. Blocks until
+     * the baking is done, so it should be called during the initialization only. The bake pipeline is created with
+     * the given cache.
+     */
+    void Bake(const std::vector<ClassicLODModel*>& models, const PipelineCache& pipelineCache);
+
+    void Destroy();
+
+    uint32_t GetSlotCount() const
+    {
+        return m_SlotCount;
+    }
+
+    VkCore::Image2D& GetAtlas()
+    {
+        return m_Atlas;
+    }
+
+    VkCore::Buffer& GetBoundsBuffer()
+    {
+        return m_BoundsBuffer;
+    }
+
+  private:
+    uint32_t m_SlotCount = 0;
+
+    VkCore::Image2D m_Atlas;
+    VkCore::Buffer m_BoundsBuffer;
+
+    VkCore::DescriptorBuilder m_DescriptorBuilder;
+};
@@ -0,0 +1,277 @@
+#include "InstanceManager.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "glm/geometric.hpp"
+#include "Log/Log.h"
+#include "vulkan/vulkan_enums.hpp"
+#include "vulkan/vulkan_structs.hpp"
+
+void InstanceManager::Initialize(const uint32_t capacity, const uint32_t framesInFlight, const EInstanceFormat format,
+                                 const glm::vec4& localBounds, const vk::PipelineStageFlags consumerStages)
+{
+    m_Capacity = capacity;
+    m_Format = format;
+    m_LocalBounds = localBounds;
+    m_ConsumerStages = consumerStages;
+    m_InstanceStride = format == EInstanceFormat::Packed ? sizeof(PackedInstance) : sizeof(glm::mat4);
+
+    m_InstanceBuffer =
+        VkCore::Buffer(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst);
+    m_InstanceBuffer.InitializeOnGpu(capacity * m_InstanceStride);
+
+    m_BoundsBuffer = VkCore::Buffer(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst);
+    m_BoundsBuffer.InitializeOnGpu(capacity * sizeof(glm::vec4));
+
+    // Every segment can hold all the instances, so that even a frame touching every instance never has to wait for
+    // the ring.
+    m_RingSegmentSize = capacity * (m_InstanceStride + sizeof(glm::vec4));
+    m_UploadRing.Initialize(m_RingSegmentSize * framesInFlight, vk::BufferUsageFlagBits::eTransferSrc);
+
+    m_Transforms.reserve(capacity);
+    m_SlotToHandle.reserve(capacity);
+    m_HandleToSlot.reserve(capacity);
+    m_DirtySlots.reserve(capacity);
+    m_IsDirty.assign(capacity, 0);
+    m_ResetSlots.reserve(capacity);
+    m_IsReset.assign(capacity, 0);
+}
+
+void InstanceManager::Destroy()
+{
+    m_InstanceBuffer.Destroy();
+    m_BoundsBuffer.Destroy();
+    m_UploadRing.Destroy();
+}
+
+InstanceHandle InstanceManager::Add(const glm::mat4& transform)
+{
+    ASSERT(m_Transforms.size() < m_Capacity, "The instance manager is full!")
+
+    InstanceHandle handle;
+
+    if (!m_FreeHandles.empty())
+    {
+        handle = m_FreeHandles.back();
+        m_FreeHandles.pop_back();
+    }
+    else
+    {
+        handle = m_HandleToSlot.size();
+        m_HandleToSlot.push_back(INVALID_INSTANCE_HANDLE);
+    }
+
+    const uint32_t slot = m_Transforms.size();
+
+    m_Transforms.push_back(transform);
+    m_SlotToHandle.push_back(handle);
+    m_HandleToSlot[handle] = slot;
+
+    MarkDirty(slot);
+    MarkReset(slot);
+
+    return handle;
+}
+
+void InstanceManager::Remove(const InstanceHandle handle)
+{
+    const uint32_t slot = m_HandleToSlot[handle];
+    const uint32_t lastSlot = m_Transforms.size() - 1;
+
+    ASSERT(slot != INVALID_INSTANCE_HANDLE, "The instance has already been removed!")
+
+    // The last instance fills the hole, so the live instances stay in one range.
+    if (slot != lastSlot)
+    {
+        const InstanceHandle movedHandle = m_SlotToHandle[lastSlot];
+
+        m_Transforms[slot] = m_Transforms[lastSlot];
+        m_SlotToHandle[slot] = movedHandle;
+        m_HandleToSlot[movedHandle] = slot;
+
+        // The state of the removed instance must not carry over to the moved one.
+        MarkDirty(slot);
+        MarkReset(slot);
+    }
+
+    m_Transforms.pop_back();
+    m_SlotToHandle.pop_back();
+
+    m_HandleToSlot[handle] = INVALID_INSTANCE_HANDLE;
+    m_FreeHandles.push_back(handle);
+}
+
+void InstanceManager::UpdateTransform(const InstanceHandle handle, const glm::mat4& transform)
+{
+    const uint32_t slot = m_HandleToSlot[handle];
+
+    m_Transforms[slot] = transform;
+
+    MarkDirty(slot);
+}
+
+void InstanceManager::AddSlotState(VkCore::Buffer& buffer, const uint32_t resetValue)
+{
+    ASSERT(buffer.GetSize() >= m_Capacity * sizeof(uint32_t), "The slot state buffer is smaller than the capacity!")
+
+    m_SlotStates.push_back({buffer.GetVkBuffer(), resetValue});
+}
+
+void InstanceManager::MarkReset(const uint32_t slot)
+{
+    if (!m_IsReset[slot])
+    {
+        m_IsReset[slot] = 1;
+        m_ResetSlots.push_back(slot);
+    }
+}
+
+void InstanceManager::MarkDirty(const uint32_t slot)
+{
+    if (!m_IsDirty[slot])
+    {
+        m_IsDirty[slot] = 1;
+        m_DirtySlots.push_back(slot);
+    }
+}
+
+void InstanceManager::WriteInstance(uint8_t* dst, const uint32_t slot) const
+{
+    if (m_Format == EInstanceFormat::Packed)
+    {
+        const PackedInstance instance = PackInstance(m_Transforms[slot]);
+        std::memcpy(dst, &instance, sizeof(PackedInstance));
+    }
+    else
+    {
+        std::memcpy(dst, &m_Transforms[slot], sizeof(glm::mat4));
+    }
+}
+
+void InstanceManager::RecordUploads(const vk::CommandBuffer& cmdBuffer, const uint32_t frameIndex)
+{
+    m_UploadStats = {};
+
+    // The reset slots are dirty as well.
+    if (m_DirtySlots.empty())
+    {
+        return;
+    }
+
+    std::sort(m_DirtySlots.begin(), m_DirtySlots.end());
+
+    const vk::DeviceSize segmentOffset = frameIndex * m_RingSegmentSize;
+    const vk::DeviceSize boundsOffset = segmentOffset + m_Capacity * m_InstanceStride;
+
+    uint8_t* ring = static_cast<uint8_t*>(m_UploadRing.GetData());
+
+    vk::DeviceSize instanceCursor = segmentOffset;
+    vk::DeviceSize boundsCursor = boundsOffset;
+
+    m_InstanceRegions.clear();
+    m_BoundsRegions.clear();
+
+    uint32_t previousSlot = UINT32_MAX;
+
+    for (const uint32_t slot : m_DirtySlots)
+    {
+        m_IsDirty[slot] = 0;
+
+        // The slot was freed after it had been changed.
+        if (slot >= m_Transforms.size())
+        {
+            continue;
+        }
+
+        const glm::mat4& transform = m_Transforms[slot];
+
+        const float scale = std::max({glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])),
+                                      glm::length(glm::vec3(transform[2]))});
+        const glm::vec4 bounds = glm::vec4(glm::vec3(transform * glm::vec4(glm::vec3(m_LocalBounds), 1.f)),
+                                           m_LocalBounds.w * scale);
+
+        WriteInstance(ring + instanceCursor, slot);
+        std::memcpy(ring + boundsCursor, &bounds, sizeof(glm::vec4));
+
+        if (previousSlot != UINT32_MAX && slot == previousSlot + 1)
+        {
+            m_InstanceRegions.back().size += m_InstanceStride;
+            m_BoundsRegions.back().size += sizeof(glm::vec4);
+        }
+        else
+        {
+            m_InstanceRegions.emplace_back(instanceCursor, slot * m_InstanceStride, m_InstanceStride);
+            m_BoundsRegions.emplace_back(boundsCursor, slot * sizeof(glm::vec4), sizeof(glm::vec4));
+        }
+
+        instanceCursor += m_InstanceStride;
+        boundsCursor += sizeof(glm::vec4);
+        previousSlot = slot;
+
+        m_UploadStats.dirtyInstances++;
+    }
+
+    m_DirtySlots.clear();
+
+    std::sort(m_ResetSlots.begin(), m_ResetSlots.end());
+
+    m_ResetRegions.clear();
+    previousSlot = UINT32_MAX;
+
+    for (const uint32_t slot : m_ResetSlots)
+    {
+        m_IsReset[slot] = 0;
+
+        if (slot >= m_Transforms.size() || m_SlotStates.empty())
+        {
+            continue;
+        }
+
+        if (previousSlot != UINT32_MAX && slot == previousSlot + 1)
+        {
+            m_ResetRegions.back().second += sizeof(uint32_t);
+        }
+        else
+        {
+            m_ResetRegions.emplace_back(slot * sizeof(uint32_t), sizeof(uint32_t));
+        }
+
+        previousSlot = slot;
+    }
+
+    m_ResetSlots.clear();
+
+    if (m_InstanceRegions.empty())
+    {
+        return;
+    }
+
+    m_UploadStats.copyRegions = m_InstanceRegions.size() + m_BoundsRegions.size();
+    m_UploadStats.uploadedBytes = m_UploadStats.dirtyInstances * (m_InstanceStride + sizeof(glm::vec4));
+
+    // The previous frames may still read the instances which are about to be overwritten, and write the slot state
+    // which is about to be reset.
+    vk::MemoryBarrier stateBarrier;
+    stateBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+    stateBarrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+
+    cmdBuffer.pipelineBarrier(m_ConsumerStages, vk::PipelineStageFlagBits::eTransfer, {}, stateBarrier, {}, {});
+
+    cmdBuffer.copyBuffer(m_UploadRing.GetVkBuffer(), m_InstanceBuffer.GetVkBuffer(), m_InstanceRegions);
+    cmdBuffer.copyBuffer(m_UploadRing.GetVkBuffer(), m_BoundsBuffer.GetVkBuffer(), m_BoundsRegions);
+
+    for (const SlotState& state : m_SlotStates)
+    {
+        for (const std::pair<vk::DeviceSize, vk::DeviceSize>& region : m_ResetRegions)
+        {
+            cmdBuffer.fillBuffer(state.buffer, region.first, region.second, state.resetValue);
+        }
+    }
+
+    vk::MemoryBarrier memoryBarrier;
+    memoryBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    memoryBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, m_ConsumerStages, {}, memoryBarrier, {}, {});
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "glm/mat4x4.hpp"
+#include "glm/vec4.hpp"
+#include "HostBuffer.h"
+#include "InstanceTransform.h"
+#include "Vk/Buffers/Buffer.h"
+#include "vulkan/vulkan_handles.hpp"
+
+using InstanceHandle = uint32_t;
+
+constexpr InstanceHandle INVALID_INSTANCE_HANDLE = UINT32_MAX;
+
+// Cost of the uploads recorded by the last InstanceManager::RecordUploads call.
+struct InstanceUploadStats
+{
+    uint32_t dirtyInstances = 0;
+    uint32_t copyRegions = 0;
+    uint64_t uploadedBytes = 0;
+};
+
+/**
+ * Owns the instances of a scene and keeps their device local buffers up to date.
+ *
+ * The instances are stored densely, the first GetCount() slots of the buffers are the live ones, so the shaders can
+ * keep iterating over a plain range. Removing an instance moves the last one into its slot, the handles stay valid.
+ *
+ * Every change marks the slot as dirty. RecordUploads writes the dirty slots into the part of a persistently mapped
+ * upload ring owned by the given frame and copies them into the device local buffers. Neighbouring slots are merged
+ * into a single region, so that a frame costs one vkCmdCopyBuffer per buffer no matter how many instances moved.
+ *
+ * Next to the transforms, the world space bounding sphere of every instance is kept for the culling.
+ *
+ * The shaders may keep their own state per slot between the frames, e.g. the LOD state of the hysteresis. Such state
+ * belongs to the instance in the slot, so it's reset once another instance takes the slot. The data derived from the
+ * transforms anew every frame, like the cached clip and normal matrices, follows the moved instance by itself.
+ */
+class InstanceManager
+{
+  public:
+    InstanceManager() {};
+
+    /**
+     * @param localBounds Bounding sphere (xyz - center, w - radius) of the model in instance space.
+     * @param consumerStages Pipeline stages reading the instance and bounds buffers.
+     */
+    void Initialize(const uint32_t capacity, const uint32_t framesInFlight, const EInstanceFormat format,
+                    const glm::vec4& localBounds, const vk::PipelineStageFlags consumerStages);
+
+    void Destroy();
+
+    InstanceHandle Add(const glm::mat4& transform);
+    void Remove(const InstanceHandle handle);
+    void UpdateTransform(const InstanceHandle handle, const glm::mat4& transform);
+
+    /**
+     * Registers a device local buffer of one uint per slot, kept by the shaders between the frames. A slot is reset
+     * to the given value by RecordUploads whenever an instance is added into it or moved into it by Remove.
+     * @param buffer Has to be created with the transfer dst usage.
+     */
+    void AddSlotState(VkCore::Buffer& buffer, const uint32_t resetValue);
+
+    const glm::mat4& GetTransform(const InstanceHandle handle) const
+    {
+        return m_Transforms[m_HandleToSlot[handle]];
+    }
+
+    /**
+     * Copies the instances changed since the last call to the device local buffers and makes them visible to the
+     * shader stages. Has to be recorded outside of a render pass, before the first pass reading the instances.
+     */
+    void RecordUploads(const vk::CommandBuffer& cmdBuffer, const uint32_t frameIndex);
+
+    uint32_t GetCount() const
+    {
+        return m_Transforms.size();
+    }
+
+    uint32_t GetCapacity() const
+    {
+        return m_Capacity;
+    }
+
+    VkCore::Buffer& GetInstanceBuffer()
+    {
+        return m_InstanceBuffer;
+    }
+
+    VkCore::Buffer& GetBoundsBuffer()
+    {
+        return m_BoundsBuffer;
+    }
+
+    const InstanceUploadStats& GetUploadStats() const
+    {
+        return m_UploadStats;
+    }
+
+  private:
+    void MarkDirty(const uint32_t slot);
+    void MarkReset(const uint32_t slot);
+    void WriteInstance(uint8_t* dst, const uint32_t slot) const;
+
+  private:
+    uint32_t m_Capacity = 0;
+    uint32_t m_InstanceStride = 0;
+    EInstanceFormat m_Format = EInstanceFormat::Packed;
+    glm::vec4 m_LocalBounds = glm::vec4(0.f, 0.f, 0.f, 1.f);
+    vk::PipelineStageFlags m_ConsumerStages;
+
+    // CPU copy of the live instances, indexed by slot.
+    std::vector<glm::mat4> m_Transforms;
+    std::vector<InstanceHandle> m_SlotToHandle;
+
+    std::vector<uint32_t> m_HandleToSlot;
+    std::vector<InstanceHandle> m_FreeHandles;
+
+    std::vector<uint32_t> m_DirtySlots;
+    std::vector<uint8_t> m_IsDirty;
+
+    struct SlotState
+    {
+        vk::Buffer buffer;
+        uint32_t resetValue;
+    };
+
+    std::vector<SlotState> m_SlotStates;
+
+    // Slots taken by another instance since the last upload. Always dirty as well.
+    std::vector<uint32_t> m_ResetSlots;
+    std::vector<uint8_t> m_IsReset;
+
+    VkCore::Buffer m_InstanceBuffer;
+    VkCore::Buffer m_BoundsBuffer;
+
+    // One segment of the size of all the instances and their bounds per frame in flight.
+    HostBuffer m_UploadRing;
+    vk::DeviceSize m_RingSegmentSize = 0;
+
+    std::vector<vk::BufferCopy> m_InstanceRegions;
+    std::vector<vk::BufferCopy> m_BoundsRegions;
+
+    // Offset and size of the reset slot ranges in the slot state buffers.
+    std::vector<std::pair<vk::DeviceSize, vk::DeviceSize>> m_ResetRegions;
+
+    InstanceUploadStats m_UploadStats;
+};
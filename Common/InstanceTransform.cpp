@@ -0,0 +1,41 @@
+#include "InstanceTransform.h"
+
+#include "glm/geometric.hpp"
+#include "glm/gtc/packing.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+PackedInstance PackInstance(const glm::mat4& transform, const uint32_t modelId)
+{
+    PackedInstance instance;
+
+    instance.position = glm::vec3(transform[3]);
+    instance.scale = glm::length(glm::vec3(transform[0]));
+    instance.modelId = modelId;
+
+    const glm::mat3 rotation = glm::mat3(transform) / instance.scale;
+    glm::quat quat = glm::normalize(glm::quat_cast(rotation));
+
+    // q and -q are the same rotation, keeping w positive makes the quantization deterministic.
+    if (quat.w < 0.f)
+    {
+        quat = -quat;
+    }
+
+    instance.rotation[0] = glm::packSnorm2x16(glm::vec2(quat.x, quat.y));
+    instance.rotation[1] = glm::packSnorm2x16(glm::vec2(quat.z, quat.w));
+
+    return instance;
+}
+
+glm::mat4 UnpackInstance(const PackedInstance& instance)
+{
+    const glm::vec2 xy = glm::unpackSnorm2x16(instance.rotation[0]);
+    const glm::vec2 zw = glm::unpackSnorm2x16(instance.rotation[1]);
+
+    const glm::quat quat = glm::normalize(glm::quat(zw.y, xy.x, xy.y, zw.x));
+
+    glm::mat4 transform = glm::mat4(glm::mat3_cast(quat) * instance.scale);
+    transform[3] = glm::vec4(instance.position, 1.f);
+
+    return transform;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+#include "glm/mat4x4.hpp"
+#include "glm/vec3.hpp"
+
+// Format of the instance buffers. Pushed to the shaders, which decode the transforms accordingly.
+enum class EInstanceFormat : uint32_t
+{
+    // Full glm::mat4 (or `s_instance`) per instance.
+    Mat4 = 0,
+    // PackedInstance per instance.
+    Packed = 1,
+};
+
+/**
+ * Compressed instance transform of 32 bytes. Mirrors `s_packed_instance` in the shaders.
+ *
+ * The rotation is a unit quaternion quantized to 4 x snorm16, the scale is uniform. Transforms with a non-uniform
+ * scale or a shear can't be represented, the instances of the applications are only ever translated.
+ */
+struct PackedInstance
+{
+    glm::vec3 position = glm::vec3(0.f);
+    float scale = 1.f;
+    // Quaternion (x, y, z, w) as two packed snorm16 pairs.
+    uint32_t rotation[2] = {};
+    // Model of the instance, only used by the applications drawing several models.
+    uint32_t modelId = 0;
+    uint32_t padding = 0;
+};
+
+PackedInstance PackInstance(const glm::mat4& transform, const uint32_t modelId = 0);
+
+// Inverse of PackInstance, up to the quantization of the rotation. Mirrors `unpack_instance` in the shaders.
+glm::mat4 UnpackInstance(const PackedInstance& instance);
+
+/**
+ * Transforms of an instance for a single frame, computed once per visible instance by a compute pass so that the mesh
+ * shaders don't rebuild them for every vertex. Mirrors `s_instance_transform` in the shaders.
+ */
+struct CachedInstanceTransform
+{
+    // Projection * view * model.
+    glm::mat4 clip = glm::mat4(1.f);
+    // Inverse transpose of the upper 3x3 of the model matrix. The columns are padded to vec4 as a mat3 in std430.
+    glm::vec4 normal[3] = {};
+};
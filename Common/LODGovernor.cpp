@@ -0,0 +1,93 @@
+#include "LODGovernor.h"
+
+#include <algorithm>
+
+#include "Log/Log.h"
+
+static const char* StateToString(const EGovernorState state)
+{
+    switch (state)
+    {
+    case EGovernorState::Stable:
+        return "Stable";
+    case EGovernorState::Degrading:
+        return "Degrading";
+    case EGovernorState::Recovering:
+        return "Recovering";
+    }
+
+    return "Unknown";
+}
+
+float LODGovernor::Update(const uint64_t gpuTimeNs, const float currentBias)
+{
+    const float sampleMs = gpuTimeNs / 1000000.f;
+
+    if (m_SmoothedMs < 0.f)
+    {
+        m_SmoothedMs = sampleMs;
+    }
+    else
+    {
+        m_SmoothedMs += (sampleMs - m_SmoothedMs) * m_Settings.smoothing;
+    }
+
+    if (m_Cooldown > 0)
+    {
+        m_Cooldown--;
+        return currentBias;
+    }
+
+    const float errorMs = m_SmoothedMs - m_Settings.targetMs;
+    const float bandMs = m_Settings.targetMs * m_Settings.hysteresis;
+
+    EGovernorState state = EGovernorState::Stable;
+
+    if (errorMs > bandMs)
+    {
+        state = EGovernorState::Degrading;
+    }
+    else if (errorMs < -bandMs && currentBias > m_Settings.minBias)
+    {
+        state = EGovernorState::Recovering;
+    }
+
+    float bias = currentBias;
+
+    if (state != EGovernorState::Stable)
+    {
+        // Only the part of the error outside of the band is corrected, so the bias settles at the band's edge
+        // instead of oscillating around the target.
+        const float outsideMs = errorMs > 0.f ? errorMs - bandMs : errorMs + bandMs;
+        const float step = std::clamp(outsideMs * m_Settings.gain, -m_Settings.maxStep, m_Settings.maxStep);
+
+        bias = std::clamp(currentBias + step, m_Settings.minBias, m_Settings.maxBias);
+
+        if (bias != currentBias)
+        {
+            m_Cooldown = m_Settings.cooldownFrames;
+        }
+    }
+
+    if (state != m_State)
+    {
+        LOGF(Application, Info, "LOD governor: %s -> %s (avg. %.3f ms, target %.3f ms, bias %.3f)",
+             StateToString(m_State), StateToString(state), m_SmoothedMs, m_Settings.targetMs, bias)
+
+        m_State = state;
+    }
+
+    return bias;
+}
+
+void LODGovernor::Reset()
+{
+    m_State = EGovernorState::Stable;
+    m_SmoothedMs = -1.f;
+    m_Cooldown = 0;
+}
+
+const char* LODGovernor::GetStateName() const
+{
+    return StateToString(m_State);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+
+enum class EGovernorState : uint8_t
+{
+    Stable = 0,
+    Degrading,
+    Recovering,
+};
+
+struct LODGovernorSettings
+{
+    // GPU time of the measured passes the governor tries to hold.
+    float targetMs = 2.f;
+    // Relative band around the target in which the bias is left untouched.
+    float hysteresis = 0.1f;
+    // Change of the bias per millisecond of error.
+    float gain = 0.02f;
+    // Largest change of the bias in a single adjustment.
+    float maxStep = 0.01f;
+    float minBias = 0.f;
+    float maxBias = 1.f;
+    // Weight of the newest sample in the exponential moving average of the GPU time.
+    float smoothing = 0.1f;
+    // Frames to wait after an adjustment, so that its effect shows up in the average before the next one.
+    uint32_t cooldownFrames = 10;
+};
+
+/**
+ * Closed loop controller which tunes the LOD bias (the exponent of the distance based LOD selection) to hold a target
+ * GPU time. A higher bias selects coarser LODs sooner, so the bias rises while the frames are over the budget and
+ * decays back when there is headroom.
+ */
+class LODGovernor
+{
+  public:
+    LODGovernor() {};
+    LODGovernor(const LODGovernorSettings& settings) : m_Settings(settings) {};
+
+    /**
+     * Feeds the GPU time of the last frame to the controller.
+     * @return The LOD bias to use for the next frame.
+     */
+    float Update(const uint64_t gpuTimeNs, const float currentBias);
+
+    void Reset();
+
+    LODGovernorSettings& GetSettings()
+    {
+        return m_Settings;
+    }
+
+    float GetSmoothedMs() const
+    {
+        return m_SmoothedMs;
+    }
+
+    EGovernorState GetState() const
+    {
+        return m_State;
+    }
+
+    const char* GetStateName() const;
+
+  private:
+    LODGovernorSettings m_Settings;
+
+    EGovernorState m_State = EGovernorState::Stable;
+    float m_SmoothedMs = -1.f;
+    uint32_t m_Cooldown = 0;
+};
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+// Persistent LOD state of an instance which hasn't been visible yet. Its first LOD isn't counted as a transition.
+constexpr uint32_t LOD_STATE_NONE = 0xFFFFFFFF;
+
+// Statistics of the LOD selection, written by the GPU every frame. Mirrors `LODStats` in the LOD shaders.
+struct LODStats
+{
+    uint32_t transitionCount = 0;
+    uint32_t padding[3] = {};
+};
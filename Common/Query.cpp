@@ -22,6 +22,7 @@ DurationQuery::DurationQuery(const uint32_t timestampCounts) : m_QueryCounts(tim
 void DurationQuery::Reset(const vk::CommandBuffer& cmdBuffer)
 {
 	cmdBuffer.resetQueryPool(m_QueryPool, 0, m_QueryCounts);
+	m_ParityCount = 0;
 }
 
 DurationQuery::~DurationQuery()
@@ -70,3 +71,55 @@ uint64_t DurationQuery::GetResults()
 
     return (rv.value[1] - rv.value[0]) * m_TimestampPeriod;
 }
+
+PipelineStatisticsQuery::PipelineStatisticsQuery(const vk::QueryPipelineStatisticFlags statistics)
+{
+    for (uint32_t bit = 0; bit < 32; bit++)
+    {
+        m_StatisticCount += (static_cast<VkQueryPipelineStatisticFlags>(statistics) >> bit) & 1;
+    }
+
+    vk::QueryPoolCreateInfo createInfo;
+
+    createInfo.queryType = vk::QueryType::ePipelineStatistics;
+    createInfo.queryCount = 1;
+    createInfo.pipelineStatistics = statistics;
+
+    m_QueryPool = VkCore::DeviceManager::GetDevice().CreateQueryPool(createInfo);
+}
+
+PipelineStatisticsQuery::~PipelineStatisticsQuery()
+{
+    VkCore::DeviceManager::GetDevice().DestroyQueryPool(m_QueryPool);
+}
+
+void PipelineStatisticsQuery::Reset(const vk::CommandBuffer& cmdBuffer)
+{
+    cmdBuffer.resetQueryPool(m_QueryPool, 0, 1);
+}
+
+void PipelineStatisticsQuery::Begin(const vk::CommandBuffer& cmdBuffer)
+{
+    cmdBuffer.beginQuery(m_QueryPool, 0, {});
+}
+
+void PipelineStatisticsQuery::End(const vk::CommandBuffer& cmdBuffer)
+{
+    cmdBuffer.endQuery(m_QueryPool, 0);
+}
+
+std::vector<uint64_t> PipelineStatisticsQuery::GetResults()
+{
+    vk::ResultValue<std::vector<uint64_t>> rv =
+        (*VkCore::DeviceManager::GetDevice())
+            .getQueryPoolResults<uint64_t>(m_QueryPool, 0, 1, m_StatisticCount * sizeof(uint64_t),
+                                           m_StatisticCount * sizeof(uint64_t),
+                                           vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+
+    if (rv.result != vk::Result::eSuccess)
+    {
+        LOGF(Vulkan, Error, "Failed to get result from the query!: %d", rv.result)
+    }
+
+    return rv.value;
+}
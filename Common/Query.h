@@ -23,3 +23,23 @@ class DurationQuery
     vk::QueryPool m_QueryPool;
 	uint32_t m_TimestampPeriod = 0;
 };
+
+// Counts the pipeline statistics of the commands recorded between Begin and End, e.g. the fragment shader invocations.
+class PipelineStatisticsQuery
+{
+  public:
+	PipelineStatisticsQuery(PipelineStatisticsQuery&& other) = delete;
+	PipelineStatisticsQuery(const PipelineStatisticsQuery& other) = delete;
+	PipelineStatisticsQuery(const vk::QueryPipelineStatisticFlags statistics);
+	~PipelineStatisticsQuery();
+
+	void Reset(const vk::CommandBuffer& cmdBuffer);
+	void Begin(const vk::CommandBuffer& cmdBuffer);
+	void End(const vk::CommandBuffer& cmdBuffer);
+	// One counter per requested statistic, in the order of their flag bits.
+	std::vector<uint64_t> GetResults();
+
+  private:
+	uint32_t m_StatisticCount = 0;
+	vk::QueryPool m_QueryPool;
+};
@@ -0,0 +1,203 @@
+#include "RadixSort.h"
+
+#include "Log/Log.h"
+#include "Renderer/PipelineBuilder.h"
+#include "Vk/Devices/DeviceManager.h"
+#include "vulkan/vulkan_enums.hpp"
+#include "vulkan/vulkan_structs.hpp"
+
+// Passes of the sort shader. Mirrors the defines in radix_sort.comp.
+enum class ERadixSortPass : uint32_t
+{
+    Setup = 0,
+    Histogram = 1,
+    Scan = 2,
+    Scatter = 3,
+};
+
+// Indirect dispatch of the tiles at the start of the state buffer, padded to 16 bytes.
+static constexpr uint32_t SORT_STATE_HEADER_SIZE = 16;
+
+static void InsertComputeBarrier(const vk::CommandBuffer& cmdBuffer)
+{
+    vk::MemoryBarrier memoryBarrier;
+    memoryBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+    memoryBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {},
+                              memoryBarrier, {}, {});
+}
+
+void RadixSort::Initialize(const uint32_t segmentCount, const uint32_t segmentSize,
+                           const PipelineCache& pipelineCache, const uint32_t countOffset)
+{
+    ASSERT(segmentCount > 0 && segmentCount <= 65535, "The segment count has to fit a single dispatch dimension!")
+
+    m_TileStride = (segmentSize + RADIX_SORT_TILE_SIZE - 1) / RADIX_SORT_TILE_SIZE;
+
+    ASSERT(m_TileStride <= 65535, "The segments are too large to be sorted by a single dispatch!")
+
+    m_PushConstants.segment_count = segmentCount;
+    m_PushConstants.segment_size = segmentSize;
+    m_PushConstants.count_offset = countOffset;
+    m_PushConstants.tile_stride = m_TileStride;
+
+    m_PipelineCache = &pipelineCache;
+    m_DescriptorBuilder = VkCore::DescriptorBuilder(VkCore::DeviceManager::GetDevice());
+}
+
+void RadixSort::InitializePipeline()
+{
+    const ShaderBinary shader = LoadShader("Common/Res/Shaders/radix_sort/radix_sort.comp");
+
+    ComputePipelineBuilder pipelineBuilder(*m_PipelineCache);
+
+    m_Pipeline = pipelineBuilder.BindShaderModule(shader)
+                     .AddPushConstantRange<RadixSortPC>(vk::ShaderStageFlagBits::eCompute)
+                     .AddDescriptorLayout(m_SetLayout)
+                     .Build(m_PipelineLayout);
+}
+
+void RadixSort::AddFrame(VkCore::Buffer& keys, VkCore::Buffer& values, VkCore::Buffer& counts)
+{
+    const uint64_t elementCount = (uint64_t)m_PushConstants.segment_count * m_PushConstants.segment_size;
+
+    ASSERT(keys.GetSize() >= elementCount * sizeof(uint32_t) && values.GetSize() >= elementCount * sizeof(uint32_t),
+           "The sorted buffers are smaller than the segments!")
+
+    m_AltKeyBuffers.emplace_back(vk::BufferUsageFlagBits::eStorageBuffer);
+    m_AltKeyBuffers.back().InitializeOnGpu(elementCount * sizeof(uint32_t));
+
+    m_AltValueBuffers.emplace_back(vk::BufferUsageFlagBits::eStorageBuffer);
+    m_AltValueBuffers.back().InitializeOnGpu(elementCount * sizeof(uint32_t));
+
+    const uint32_t digitTotalCount = RADIX_SORT_DIGIT_PASSES * m_PushConstants.segment_count * RADIX_SORT_BINS;
+
+    m_StateBuffers.emplace_back(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer);
+    m_StateBuffers.back().InitializeOnGpu(SORT_STATE_HEADER_SIZE + digitTotalCount * sizeof(uint32_t));
+
+    m_HistogramBuffers.emplace_back(vk::BufferUsageFlagBits::eStorageBuffer);
+    m_HistogramBuffers.back().InitializeOnGpu((uint64_t)m_PushConstants.segment_count * RADIX_SORT_BINS *
+                                              m_TileStride * sizeof(uint32_t));
+
+    vk::DescriptorSet set;
+
+    m_DescriptorBuilder
+        .BindBuffer(0, keys, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+        .BindBuffer(1, values, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+        .BindBuffer(2, m_AltKeyBuffers.back(), vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+        .BindBuffer(3, m_AltValueBuffers.back(), vk::DescriptorType::eStorageBuffer,
+                    vk::ShaderStageFlagBits::eCompute)
+        .BindBuffer(4, counts, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+        .BindBuffer(5, m_StateBuffers.back(), vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+        .BindBuffer(6, m_HistogramBuffers.back(), vk::DescriptorType::eStorageBuffer,
+                    vk::ShaderStageFlagBits::eCompute)
+        .Build(set, m_SetLayout);
+
+    m_DescriptorBuilder.Clear();
+
+    m_Sets.emplace_back(set);
+
+    // The set layout only exists once the first set is built.
+    if (m_Sets.size() == 1)
+    {
+        InitializePipeline();
+    }
+}
+
+void RadixSort::Record(const vk::CommandBuffer& cmdBuffer, const uint32_t frame)
+{
+    ASSERT(frame < m_Sets.size(), "The sorted frame wasn't added!")
+
+    cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_Pipeline);
+    cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_PipelineLayout, 0, m_Sets[frame], {});
+
+    RadixSortPC pc = m_PushConstants;
+
+    {
+        // Size the tile dispatches by the counts of this frame
+        pc.pass = (uint32_t)ERadixSortPass::Setup;
+
+        cmdBuffer.pushConstants(m_PipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(RadixSortPC), &pc);
+        cmdBuffer.dispatch(1, 1, 1);
+
+        vk::MemoryBarrier memoryBarrier;
+        memoryBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+        memoryBarrier.dstAccessMask = vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead |
+                                      vk::AccessFlagBits::eShaderWrite;
+
+        cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                  vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader,
+                                  {}, memoryBarrier, {}, {});
+    }
+
+    const vk::Buffer stateBuffer = m_StateBuffers[frame].GetVkBuffer();
+
+    for (uint32_t digitPass = 0; digitPass < RADIX_SORT_DIGIT_PASSES; digitPass++)
+    {
+        pc.shift = digitPass * 8;
+
+        pc.pass = (uint32_t)ERadixSortPass::Histogram;
+        cmdBuffer.pushConstants(m_PipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(RadixSortPC), &pc);
+        cmdBuffer.dispatchIndirect(stateBuffer, 0);
+
+        InsertComputeBarrier(cmdBuffer);
+
+        pc.pass = (uint32_t)ERadixSortPass::Scan;
+        cmdBuffer.pushConstants(m_PipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(RadixSortPC), &pc);
+        cmdBuffer.dispatch(RADIX_SORT_BINS, m_PushConstants.segment_count, 1);
+
+        InsertComputeBarrier(cmdBuffer);
+
+        pc.pass = (uint32_t)ERadixSortPass::Scatter;
+        cmdBuffer.pushConstants(m_PipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(RadixSortPC), &pc);
+        cmdBuffer.dispatchIndirect(stateBuffer, 0);
+
+        InsertComputeBarrier(cmdBuffer);
+    }
+
+    vk::MemoryBarrier memoryBarrier;
+    memoryBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+    memoryBarrier.dstAccessMask = vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead;
+
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eAllCommands, {},
+                              memoryBarrier, {}, {});
+}
+
+void RadixSort::Destroy()
+{
+    VkCore::Device& device = VkCore::DeviceManager::GetDevice();
+
+    device.DestroyPipeline(m_Pipeline);
+    device.DestroyPipelineLayout(m_PipelineLayout);
+    device.DestroyDescriptorSetLayout(m_SetLayout);
+
+    for (uint32_t i = 0; i < m_Sets.size(); i++)
+    {
+        m_AltKeyBuffers[i].Destroy();
+        m_AltValueBuffers[i].Destroy();
+        m_StateBuffers[i].Destroy();
+        m_HistogramBuffers[i].Destroy();
+    }
+
+    m_AltKeyBuffers.clear();
+    m_AltValueBuffers.clear();
+    m_StateBuffers.clear();
+    m_HistogramBuffers.clear();
+    m_Sets.clear();
+
+    m_DescriptorBuilder.Cleanup();
+}
+
+uint64_t RadixSort::GetMemoryUsage()
+{
+    uint64_t bytes = 0;
+
+    for (uint32_t i = 0; i < m_Sets.size(); i++)
+    {
+        bytes += m_AltKeyBuffers[i].GetSize() + m_AltValueBuffers[i].GetSize() + m_StateBuffers[i].GetSize() +
+                 m_HistogramBuffers[i].GetSize();
+    }
+
+    return bytes;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Renderer/PipelineCache.h"
+#include "Vk/Buffers/Buffer.h"
+#include "Vk/Descriptors/DescriptorBuilder.h"
+#include "vulkan/vulkan_handles.hpp"
+
+// Elements sorted by a single workgroup. Mirrors TILE_SIZE in radix_sort.comp.
+constexpr uint32_t RADIX_SORT_TILE_SIZE = 512;
+
+// Digits of the 8 bit passes over the 32 bit keys.
+constexpr uint32_t RADIX_SORT_BINS = 256;
+constexpr uint32_t RADIX_SORT_DIGIT_PASSES = 4;
+
+struct RadixSortPC
+{
+    uint32_t pass = 0;
+    uint32_t shift = 0;
+    uint32_t segment_count = 0;
+    uint32_t segment_size = 0;
+    uint32_t count_offset = 0;
+    uint32_t tile_stride = 0;
+};
+
+/**
+ * Stable GPU sort of 32 bit keys with 32 bit values, sorted in place in ascending order of the keys.
+ *
+ * The elements are split into segments of equal capacity, sorted independently of each other, e.g. the per LOD
+ * instance lists. The element count of every segment is read from a buffer written earlier in the frame, so the
+ * host never waits for it. Every of the four 8 bit digit passes counts the digits of the tiles of RADIX_SORT_TILE_SIZE
+ * elements, scans the counts into offsets and scatters the tiles, ranking the lanes of a digit in the shared memory.
+ * Nothing depends on the subgroup size, so any device with compute shaders sorts the same.
+ *
+ * Every frame in flight gets its own scratch memory, added by AddFrame in the order of the swapchain images.
+ */
+class RadixSort
+{
+  public:
+    RadixSort() {};
+
+    /**
+     * @param segmentCount Number of the independently sorted segments.
+     * @param segmentSize Capacity of a single segment. The segment i starts at the element i * segmentSize.
+     * @param pipelineCache Cache the sort pipeline is created with.
+     * @param countOffset Index of the element count of the first segment in the count buffers, in uints.
+     */
+    void Initialize(const uint32_t segmentCount, const uint32_t segmentSize, const PipelineCache& pipelineCache,
+                    const uint32_t countOffset = 0);
+
+    // Buffers sorted by the frame, the counts of the segments are read from the count buffer.
+    void AddFrame(VkCore::Buffer& keys, VkCore::Buffer& values, VkCore::Buffer& counts);
+
+    /**
+     * Records the sort of the given frame. Expects the keys, the values and the counts to be written by the compute
+     * shader stage, the results are visible to any shader stage and the indirect commands afterwards.
+     */
+    void Record(const vk::CommandBuffer& cmdBuffer, const uint32_t frame);
+
+    void Destroy();
+
+    uint64_t GetMemoryUsage();
+
+  private:
+    void InitializePipeline();
+
+  private:
+    RadixSortPC m_PushConstants;
+    uint32_t m_TileStride = 0;
+
+    const PipelineCache* m_PipelineCache = nullptr;
+    vk::Pipeline m_Pipeline;
+    vk::PipelineLayout m_PipelineLayout;
+    vk::DescriptorSetLayout m_SetLayout;
+
+    // Scratch memory of every frame.
+    std::vector<VkCore::Buffer> m_AltKeyBuffers;
+    std::vector<VkCore::Buffer> m_AltValueBuffers;
+    std::vector<VkCore::Buffer> m_StateBuffers;
+    std::vector<VkCore::Buffer> m_HistogramBuffers;
+    std::vector<vk::DescriptorSet> m_Sets;
+
+    VkCore::DescriptorBuilder m_DescriptorBuilder;
+};
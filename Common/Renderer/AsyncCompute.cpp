@@ -0,0 +1,301 @@
+#include "AsyncCompute.h"
+
+#include <algorithm>
+
+#include "Log/Log.h"
+#include "Vk/Devices/DeviceManager.h"
+#include "vulkan/vulkan_enums.hpp"
+
+void AsyncCompute::Initialize(FrameScheduler& scheduler, const uint32_t graphicsFamily, const uint32_t computeFamily,
+                              const vk::Queue& computeQueue)
+{
+    m_Scheduler = &scheduler;
+    m_GraphicsFamily = graphicsFamily;
+    m_ComputeFamily = computeFamily;
+    m_ComputeQueue = computeQueue;
+
+    const uint32_t framesInFlight = scheduler.GetFramesInFlight();
+
+    const vk::PhysicalDevice physicalDevice = *VkCore::DeviceManager::GetPhysicalDevice();
+    const std::vector<vk::QueueFamilyProperties> families = physicalDevice.getQueueFamilyProperties();
+
+    m_HasComputeTimer = families[computeFamily].timestampValidBits > 0;
+    m_TimestampPeriod = VkCore::DeviceManager::GetPhysicalDevice().GetDeviceLimits().timestampPeriod;
+
+    VkCore::Device& device = VkCore::DeviceManager::GetDevice();
+
+    TRY_CATCH_BEGIN()
+
+    vk::SemaphoreTypeCreateInfo timelineTypeInfo{vk::SemaphoreType::eTimeline, 0};
+    vk::SemaphoreCreateInfo timelineCreateInfo{};
+    timelineCreateInfo.setPNext(&timelineTypeInfo);
+
+    m_Timeline = device.CreateSemaphore(timelineCreateInfo);
+
+    vk::CommandPoolCreateInfo createInfo{vk::CommandPoolCreateFlagBits::eResetCommandBuffer, computeFamily};
+
+    m_CommandPool = device.CreateCommandPool(createInfo);
+
+    vk::CommandBufferAllocateInfo allocateInfo{};
+    allocateInfo.setLevel(vk::CommandBufferLevel::ePrimary)
+        .setCommandPool(m_CommandPool)
+        .setCommandBufferCount(framesInFlight);
+
+    m_CommandBuffers = device.AllocateCommandBuffers(allocateInfo);
+
+    vk::QueryPoolCreateInfo queryCreateInfo{};
+    queryCreateInfo.setQueryType(vk::QueryType::eTimestamp).setQueryCount(framesInFlight * 2);
+
+    m_ComputeQueries = device.CreateQueryPool(queryCreateInfo);
+    m_GraphicsQueries = device.CreateQueryPool(queryCreateInfo);
+
+    TRY_CATCH_END()
+
+    m_HasComputeTimestamps.assign(framesInFlight, false);
+    m_HasGraphicsTimestamps.assign(framesInFlight, false);
+
+    LOGF(Vulkan, Info, "Async compute on the queue family %d, graphics on %d%s", computeFamily, graphicsFamily,
+         m_HasComputeTimer ? "" : ", the compute queue has no timestamps")
+}
+
+vk::CommandBuffer AsyncCompute::Begin()
+{
+    const uint32_t frameIndex = m_Scheduler->GetFrameIndex();
+    const vk::CommandBuffer cmdBuffer = m_CommandBuffers[frameIndex];
+
+    cmdBuffer.reset();
+
+    vk::CommandBufferBeginInfo beginInfo{};
+    beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+
+    cmdBuffer.begin(beginInfo);
+
+    if (m_HasComputeTimer)
+    {
+        cmdBuffer.resetQueryPool(m_ComputeQueries, frameIndex * 2, 2);
+        cmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, m_ComputeQueries, frameIndex * 2);
+        m_HasComputeTimestamps[frameIndex] = true;
+    }
+
+    // Orders the passes after the ones of the previous frames on the queue, e.g. for the state kept across the
+    // frames. Only the compute stages are waited for, so the rasterization before them keeps running.
+    vk::MemoryBarrier memoryBarrier;
+    memoryBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+    memoryBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {},
+                              memoryBarrier, {}, {});
+
+    return cmdBuffer;
+}
+
+void AsyncCompute::Submit(const vk::PipelineStageFlags waitStage)
+{
+    const uint32_t frameIndex = m_Scheduler->GetFrameIndex();
+    const uint64_t frameNumber = m_Scheduler->GetFrameNumber();
+    const vk::CommandBuffer cmdBuffer = m_CommandBuffers[frameIndex];
+
+    if (m_HasComputeTimer)
+    {
+        cmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, m_ComputeQueries, frameIndex * 2 + 1);
+    }
+
+    cmdBuffer.end();
+
+    // The CPU has waited for the frame last recorded into the slot already, the wait only orders the passes after
+    // its accesses on the GPU as well. The very first frames have nothing to wait for.
+    const uint32_t framesInFlight = m_Scheduler->GetFramesInFlight();
+    const bool hasWait = frameNumber > framesInFlight;
+
+    const vk::Semaphore waitSemaphore = m_Scheduler->GetTimeline();
+    const uint64_t waitValue = hasWait ? frameNumber - framesInFlight : 0;
+    const vk::PipelineStageFlags computeWaitStage = vk::PipelineStageFlagBits::eAllCommands;
+
+    vk::TimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.setWaitSemaphoreValueCount(hasWait)
+        .setPWaitSemaphoreValues(&waitValue)
+        .setSignalSemaphoreValues(frameNumber);
+
+    vk::SubmitInfo submitInfo{};
+    submitInfo.setCommandBuffers(cmdBuffer)
+        .setWaitSemaphoreCount(hasWait)
+        .setPWaitSemaphores(&waitSemaphore)
+        .setPWaitDstStageMask(&computeWaitStage)
+        .setSignalSemaphores(m_Timeline)
+        .setPNext(&timelineInfo);
+
+    TRY_CATCH_BEGIN()
+
+    m_ComputeQueue.submit(submitInfo);
+
+    TRY_CATCH_END()
+
+    m_Scheduler->AddTimelineWait(m_Timeline, frameNumber, waitStage);
+}
+
+void AsyncCompute::ReleaseBuffers(const vk::CommandBuffer& computeCmdBuffer,
+                                  std::vector<vk::BufferMemoryBarrier> barriers) const
+{
+    if (!IsDedicated())
+    {
+        return;
+    }
+
+    for (vk::BufferMemoryBarrier& barrier : barriers)
+    {
+        barrier.setSrcQueueFamilyIndex(m_ComputeFamily)
+            .setDstQueueFamilyIndex(m_GraphicsFamily)
+            .setDstAccessMask({});
+    }
+
+    computeCmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands, vk::PipelineStageFlagBits::eBottomOfPipe,
+                                     {}, {}, barriers, {});
+}
+
+void AsyncCompute::AcquireBuffers(const vk::CommandBuffer& graphicsCmdBuffer,
+                                  std::vector<vk::BufferMemoryBarrier> barriers,
+                                  const vk::PipelineStageFlags dstStage) const
+{
+    if (!IsDedicated())
+    {
+        return;
+    }
+
+    for (vk::BufferMemoryBarrier& barrier : barriers)
+    {
+        barrier.setSrcQueueFamilyIndex(m_ComputeFamily)
+            .setDstQueueFamilyIndex(m_GraphicsFamily)
+            .setSrcAccessMask({});
+    }
+
+    graphicsCmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, dstStage, {}, {}, barriers, {});
+}
+
+void AsyncCompute::ReleaseImages(const vk::CommandBuffer& computeCmdBuffer,
+                                 std::vector<vk::ImageMemoryBarrier> barriers) const
+{
+    if (!IsDedicated())
+    {
+        return;
+    }
+
+    for (vk::ImageMemoryBarrier& barrier : barriers)
+    {
+        barrier.setSrcQueueFamilyIndex(m_ComputeFamily)
+            .setDstQueueFamilyIndex(m_GraphicsFamily)
+            .setDstAccessMask({});
+    }
+
+    computeCmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands, vk::PipelineStageFlagBits::eBottomOfPipe,
+                                     {}, {}, {}, barriers);
+}
+
+void AsyncCompute::AcquireImages(const vk::CommandBuffer& graphicsCmdBuffer,
+                                 std::vector<vk::ImageMemoryBarrier> barriers,
+                                 const vk::PipelineStageFlags dstStage) const
+{
+    if (!IsDedicated())
+    {
+        return;
+    }
+
+    for (vk::ImageMemoryBarrier& barrier : barriers)
+    {
+        barrier.setSrcQueueFamilyIndex(m_ComputeFamily)
+            .setDstQueueFamilyIndex(m_GraphicsFamily)
+            .setSrcAccessMask({});
+    }
+
+    graphicsCmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, dstStage, {}, {}, {}, barriers);
+}
+
+void AsyncCompute::WriteGraphicsBegin(const vk::CommandBuffer& graphicsCmdBuffer)
+{
+    const uint32_t frameIndex = m_Scheduler->GetFrameIndex();
+
+    graphicsCmdBuffer.resetQueryPool(m_GraphicsQueries, frameIndex * 2, 2);
+    graphicsCmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, m_GraphicsQueries, frameIndex * 2);
+}
+
+void AsyncCompute::WriteGraphicsEnd(const vk::CommandBuffer& graphicsCmdBuffer)
+{
+    const uint32_t frameIndex = m_Scheduler->GetFrameIndex();
+
+    graphicsCmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, m_GraphicsQueries, frameIndex * 2 + 1);
+    m_HasGraphicsTimestamps[frameIndex] = true;
+}
+
+void AsyncCompute::ReadTimestamps()
+{
+    if (!m_Scheduler->HasFinishedFrame())
+    {
+        return;
+    }
+
+    const uint32_t frameIndex = m_Scheduler->GetFrameIndex();
+
+    Interval compute, graphics;
+
+    const bool hasCompute =
+        m_HasComputeTimestamps[frameIndex] && ReadInterval(m_ComputeQueries, frameIndex, compute);
+    const bool hasGraphics =
+        m_HasGraphicsTimestamps[frameIndex] && ReadInterval(m_GraphicsQueries, frameIndex, graphics);
+
+    m_HasComputeTimestamps[frameIndex] = false;
+    m_HasGraphicsTimestamps[frameIndex] = false;
+
+    m_ComputeMs = hasCompute ? (compute.end - compute.begin) * m_TimestampPeriod / 1000000.f : 0.f;
+    m_GraphicsMs = hasGraphics ? (graphics.end - graphics.begin) * m_TimestampPeriod / 1000000.f : 0.f;
+
+    // The spec only guarantees the timestamps of a single queue to be comparable, the desktop GPUs share the timer
+    // between their queues though.
+    m_OverlapMs = 0.f;
+
+    if (hasCompute && m_LastGraphics.end > 0)
+    {
+        const uint64_t overlapBegin = std::max(compute.begin, m_LastGraphics.begin);
+        const uint64_t overlapEnd = std::min(compute.end, m_LastGraphics.end);
+
+        if (overlapEnd > overlapBegin)
+        {
+            m_OverlapMs = (overlapEnd - overlapBegin) * m_TimestampPeriod / 1000000.f;
+        }
+    }
+
+    m_LastGraphics = hasGraphics ? graphics : Interval();
+}
+
+bool AsyncCompute::ReadInterval(const vk::QueryPool& queryPool, const uint32_t frameIndex, Interval& interval) const
+{
+    // The frame in the slot is finished, so the wait never blocks.
+    vk::ResultValue<std::vector<uint64_t>> rv =
+        (*VkCore::DeviceManager::GetDevice())
+            .getQueryPoolResults<uint64_t>(queryPool, frameIndex * 2, 2, 2 * sizeof(uint64_t), sizeof(uint64_t),
+                                           vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+
+    if (rv.result != vk::Result::eSuccess)
+    {
+        LOGF(Vulkan, Error, "Failed to get the timestamps of the frame!: %d", rv.result)
+        return false;
+    }
+
+    interval.begin = rv.value[0];
+    interval.end = rv.value[1];
+
+    return true;
+}
+
+void AsyncCompute::Destroy()
+{
+    VkCore::Device& device = VkCore::DeviceManager::GetDevice();
+
+    device.DestroyCommandPool(m_CommandPool);
+    device.DestroyQueryPool(m_ComputeQueries);
+    device.DestroyQueryPool(m_GraphicsQueries);
+    (*device).destroySemaphore(m_Timeline);
+
+    m_CommandBuffers.clear();
+    m_HasComputeTimestamps.clear();
+    m_HasGraphicsTimestamps.clear();
+    m_Timeline = nullptr;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "FrameScheduler.h"
+#include "vulkan/vulkan_handles.hpp"
+#include "vulkan/vulkan_structs.hpp"
+
+/**
+ * Submits the compute passes of a frame separately from its graphics work, so that the compute of the next frame
+ * overlaps the rasterization of the current one instead of being serialized in front of it.
+ *
+ * Every frame in flight has a compute command buffer, submitted ahead of the graphics one. It signals a timeline
+ * semaphore with the frame number, which the graphics submission of the frame waits for at the stage consuming the
+ * results. The compute submission waits for the graphics frame last recorded into the slot in turn, so the per-frame
+ * resources of the slot are free once the passes start.
+ *
+ * On a queue of another family than the graphics one, the buffers and the images written by the passes have to be
+ * released after them and acquired by the graphics buffer. Their contents are overwritten by the next passes, so they
+ * aren't transferred back. Resources read by both queues, e.g. the instances, need the concurrent sharing mode then.
+ *
+ * Both queues write timestamps at the start and the end of their buffers. They are read once the slot comes around
+ * again, along with the time the compute of the frame overlapped the rasterization of the frame before it.
+ */
+class AsyncCompute
+{
+  public:
+    AsyncCompute() {};
+
+    void Initialize(FrameScheduler& scheduler, const uint32_t graphicsFamily, const uint32_t computeFamily,
+                    const vk::Queue& computeQueue);
+
+    // Begins the compute buffer of the current frame, has to be called once the slot is free, i.e. after BeginFrame.
+    vk::CommandBuffer Begin();
+
+    // Submits the compute buffer, the graphics submission of the frame waits for it at the waitStage.
+    void Submit(const vk::PipelineStageFlags waitStage);
+
+    /**
+     * Records the queue family ownership transfer of the buffers written by the compute passes, the release into the
+     * compute buffer and the acquire into the graphics one. Nothing is recorded if both queues are of one family.
+     */
+    void ReleaseBuffers(const vk::CommandBuffer& computeCmdBuffer, std::vector<vk::BufferMemoryBarrier> barriers) const;
+    void AcquireBuffers(const vk::CommandBuffer& graphicsCmdBuffer, std::vector<vk::BufferMemoryBarrier> barriers,
+                        const vk::PipelineStageFlags dstStage) const;
+
+    // Same as the buffers, the layout of the barriers has to be the same on both sides.
+    void ReleaseImages(const vk::CommandBuffer& computeCmdBuffer, std::vector<vk::ImageMemoryBarrier> barriers) const;
+    void AcquireImages(const vk::CommandBuffer& graphicsCmdBuffer, std::vector<vk::ImageMemoryBarrier> barriers,
+                       const vk::PipelineStageFlags dstStage) const;
+
+    // Brackets the graphics buffer of the current frame with its timestamps.
+    void WriteGraphicsBegin(const vk::CommandBuffer& graphicsCmdBuffer);
+    void WriteGraphicsEnd(const vk::CommandBuffer& graphicsCmdBuffer);
+
+    // Reads the timestamps of the frame finished in the current slot, has to be called after BeginFrame.
+    void ReadTimestamps();
+
+    void Destroy();
+
+    // Whether the compute queue is of another family than the graphics one.
+    bool IsDedicated() const
+    {
+        return m_ComputeFamily != m_GraphicsFamily;
+    }
+
+    // Family of the queue the compute buffers are submitted to.
+    uint32_t GetComputeFamily() const
+    {
+        return m_ComputeFamily;
+    }
+
+    // GPU times of the last finished frame, the overlap of its compute with the graphics of the frame before.
+    float GetComputeMs() const
+    {
+        return m_ComputeMs;
+    }
+
+    float GetGraphicsMs() const
+    {
+        return m_GraphicsMs;
+    }
+
+    float GetOverlapMs() const
+    {
+        return m_OverlapMs;
+    }
+
+  private:
+    struct Interval
+    {
+        uint64_t begin = 0;
+        uint64_t end = 0;
+    };
+
+    // Both timestamps of the queue written by the frame in the slot.
+    bool ReadInterval(const vk::QueryPool& queryPool, const uint32_t frameIndex, Interval& interval) const;
+
+  private:
+    FrameScheduler* m_Scheduler = nullptr;
+
+    uint32_t m_GraphicsFamily = 0;
+    uint32_t m_ComputeFamily = 0;
+    vk::Queue m_ComputeQueue = nullptr;
+
+    // Signaled with the frame number once the compute of the frame is done.
+    vk::Semaphore m_Timeline = nullptr;
+
+    vk::CommandPool m_CommandPool = nullptr;
+    std::vector<vk::CommandBuffer> m_CommandBuffers;
+
+    // Two timestamps per slot each, the flags tell which of them were written by the frame in the slot.
+    vk::QueryPool m_ComputeQueries = nullptr;
+    vk::QueryPool m_GraphicsQueries = nullptr;
+    std::vector<bool> m_HasComputeTimestamps;
+    std::vector<bool> m_HasGraphicsTimestamps;
+    bool m_HasComputeTimer = false;
+    float m_TimestampPeriod = 0.f;
+
+    Interval m_LastGraphics;
+    float m_ComputeMs = 0.f;
+    float m_GraphicsMs = 0.f;
+    float m_OverlapMs = 0.f;
+};
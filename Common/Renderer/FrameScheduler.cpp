@@ -0,0 +1,179 @@
+#include "FrameScheduler.h"
+
+#include <cstdint>
+
+#include "Log/Log.h"
+#include "Vk/Devices/DeviceManager.h"
+#include "vulkan/vulkan_enums.hpp"
+#include "vulkan/vulkan_structs.hpp"
+
+void FrameScheduler::Initialize(const uint32_t framesInFlight, const uint32_t queueFamilyIndex)
+{
+    ASSERT(framesInFlight > 0, "At least a single frame has to be in flight!")
+
+    m_FramesInFlight = framesInFlight;
+    m_SubmittedFrames = 0;
+
+    VkCore::Device& device = VkCore::DeviceManager::GetDevice();
+
+    TRY_CATCH_BEGIN()
+
+    vk::SemaphoreTypeCreateInfo timelineTypeInfo{vk::SemaphoreType::eTimeline, 0};
+    vk::SemaphoreCreateInfo timelineCreateInfo{};
+    timelineCreateInfo.setPNext(&timelineTypeInfo);
+
+    m_Timeline = device.CreateSemaphore(timelineCreateInfo);
+
+    vk::SemaphoreCreateInfo imageAvailableCreateInfo{};
+
+    for (uint32_t i = 0; i < m_FramesInFlight; i++)
+    {
+        m_ImageAvailableSemaphores.emplace_back(device.CreateSemaphore(imageAvailableCreateInfo));
+    }
+
+    vk::CommandPoolCreateInfo createInfo{vk::CommandPoolCreateFlagBits::eResetCommandBuffer, queueFamilyIndex};
+
+    m_CommandPool = device.CreateCommandPool(createInfo);
+
+    vk::CommandBufferAllocateInfo allocateInfo{};
+
+    allocateInfo.setLevel(vk::CommandBufferLevel::ePrimary)
+        .setCommandPool(m_CommandPool)
+        .setCommandBufferCount(m_FramesInFlight);
+
+    m_CommandBuffers = device.AllocateCommandBuffers(allocateInfo);
+
+    TRY_CATCH_END()
+}
+
+uint32_t FrameScheduler::BeginFrame()
+{
+    // The slot was last used by the frame framesInFlight frames before the one about to be recorded.
+    if (m_SubmittedFrames >= m_FramesInFlight)
+    {
+        WaitForFrame(GetFrameNumber() - m_FramesInFlight);
+    }
+
+    ReleaseDeferred((*VkCore::DeviceManager::GetDevice()).getSemaphoreCounterValue(m_Timeline));
+
+    m_CommandBuffers[GetFrameIndex()].reset();
+
+    return GetFrameIndex();
+}
+
+void FrameScheduler::Submit(const vk::Queue& queue, const vk::Semaphore& waitSemaphore,
+                            const vk::PipelineStageFlags waitStage, const vk::Semaphore& signalSemaphore)
+{
+    const uint64_t frameNumber = GetFrameNumber();
+
+    // The values of the binary semaphores are ignored, they are only there to match the semaphore counts. The headless
+    // frames have neither an image to acquire nor to present.
+    const bool hasSignal = signalSemaphore != nullptr;
+
+    std::vector<vk::Semaphore> waitSemaphores;
+    std::vector<uint64_t> waitValues;
+    std::vector<vk::PipelineStageFlags> waitStages;
+
+    if (waitSemaphore != nullptr)
+    {
+        waitSemaphores.emplace_back(waitSemaphore);
+        waitValues.emplace_back(0);
+        waitStages.emplace_back(waitStage);
+    }
+
+    for (const TimelineWait& wait : m_TimelineWaits)
+    {
+        waitSemaphores.emplace_back(wait.timeline);
+        waitValues.emplace_back(wait.value);
+        waitStages.emplace_back(wait.waitStage);
+    }
+
+    m_TimelineWaits.clear();
+
+    const uint64_t signalValues[] = {0, frameNumber};
+    const vk::Semaphore signalSemaphores[] = {signalSemaphore, m_Timeline};
+
+    vk::TimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.setWaitSemaphoreValues(waitValues)
+        .setSignalSemaphoreValueCount(hasSignal + 1)
+        .setPSignalSemaphoreValues(signalValues + !hasSignal);
+
+    const vk::CommandBuffer cmdBuffer = m_CommandBuffers[GetFrameIndex()];
+
+    vk::SubmitInfo submitInfo{};
+    submitInfo.setCommandBuffers(cmdBuffer)
+        .setWaitSemaphores(waitSemaphores)
+        .setWaitDstStageMask(waitStages)
+        .setSignalSemaphoreCount(hasSignal + 1)
+        .setPSignalSemaphores(signalSemaphores + !hasSignal)
+        .setPNext(&timelineInfo);
+
+    TRY_CATCH_BEGIN()
+
+    queue.submit(submitInfo);
+
+    TRY_CATCH_END()
+
+    m_SubmittedFrames++;
+}
+
+void FrameScheduler::AddTimelineWait(const vk::Semaphore& timeline, const uint64_t value,
+                                     const vk::PipelineStageFlags waitStage)
+{
+    m_TimelineWaits.push_back({timeline, value, waitStage});
+}
+
+void FrameScheduler::DeferDestroy(std::function<void()>&& destroy)
+{
+    m_DeferredDestructions.push_back({GetFrameNumber(), std::move(destroy)});
+}
+
+void FrameScheduler::WaitIdle()
+{
+    if (m_SubmittedFrames > 0)
+    {
+        WaitForFrame(m_SubmittedFrames);
+    }
+
+    ReleaseDeferred(m_SubmittedFrames);
+}
+
+void FrameScheduler::Destroy()
+{
+    WaitIdle();
+
+    // Whatever was deferred by a frame that never got submitted isn't used by the GPU either.
+    ReleaseDeferred(UINT64_MAX);
+
+    VkCore::Device& device = VkCore::DeviceManager::GetDevice();
+
+    device.DestroyCommandPool(m_CommandPool);
+    device.DestroySemaphores(m_ImageAvailableSemaphores);
+    (*device).destroySemaphore(m_Timeline);
+
+    m_CommandBuffers.clear();
+    m_ImageAvailableSemaphores.clear();
+    m_Timeline = nullptr;
+}
+
+void FrameScheduler::WaitForFrame(const uint64_t frameNumber)
+{
+    vk::SemaphoreWaitInfo waitInfo{};
+    waitInfo.setSemaphores(m_Timeline).setValues(frameNumber);
+
+    const vk::Result result = (*VkCore::DeviceManager::GetDevice()).waitSemaphores(waitInfo, UINT64_MAX);
+
+    if (result != vk::Result::eSuccess)
+    {
+        LOGF(Vulkan, Error, "Failed to wait for the frame %llu!: %d", frameNumber, result)
+    }
+}
+
+void FrameScheduler::ReleaseDeferred(const uint64_t finishedFrame)
+{
+    while (!m_DeferredDestructions.empty() && m_DeferredDestructions.front().frameNumber <= finishedFrame)
+    {
+        m_DeferredDestructions.front().destroy();
+        m_DeferredDestructions.pop_front();
+    }
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include "vulkan/vulkan_handles.hpp"
+
+constexpr uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+
+/**
+ * Paces the CPU recording against the GPU execution with a single timeline semaphore.
+ *
+ * Every submitted frame signals the timeline with its frame number, so the CPU only waits before it reuses the slot
+ * of the frame recorded framesInFlight frames ago, while the frames in between keep executing. A slot owns the
+ * command buffer and the image acquire semaphore of its frame, so the frames in flight are independent of the
+ * swapchain image count. The per-frame resources of the applications are indexed by the slot as well.
+ *
+ * Resources still referenced by the recorded frames are handed to DeferDestroy and released once the GPU has
+ * finished all of them, without waiting for the device to idle.
+ */
+class FrameScheduler
+{
+  public:
+    FrameScheduler() {};
+
+    void Initialize(const uint32_t framesInFlight, const uint32_t queueFamilyIndex);
+
+    /**
+     * Waits until the GPU has finished the frame last recorded into the slot of the next frame and releases the
+     * resources deferred until then. Has to be called before recording a frame.
+     * @return - Slot of the next frame.
+     */
+    uint32_t BeginFrame();
+
+    /**
+     * Submits the command buffer of the current frame and moves on to the next slot.
+     * @param waitSemaphore - Binary semaphore the frame waits for at the waitStage, e.g. the image acquire. Optional.
+     * @param signalSemaphore - Binary semaphore signaled alongside the timeline, e.g. the presentation. Optional.
+     */
+    void Submit(const vk::Queue& queue, const vk::Semaphore& waitSemaphore, const vk::PipelineStageFlags waitStage,
+                const vk::Semaphore& signalSemaphore);
+
+    // Makes the next submitted frame wait at the waitStage until the timeline semaphore reaches the value, e.g. for
+    // the work of the frame submitted to another queue.
+    void AddTimelineWait(const vk::Semaphore& timeline, const uint64_t value, const vk::PipelineStageFlags waitStage);
+
+    // Releases the resource once the GPU has finished every frame recorded so far, including the current one.
+    void DeferDestroy(std::function<void()>&& destroy);
+
+    // Waits for all the submitted frames and releases the resources deferred by them.
+    void WaitIdle();
+
+    void Destroy();
+
+    uint32_t GetFramesInFlight() const
+    {
+        return m_FramesInFlight;
+    }
+
+    // Slot of the frame being recorded.
+    uint32_t GetFrameIndex() const
+    {
+        return m_SubmittedFrames % m_FramesInFlight;
+    }
+
+    // Timeline value the frame being recorded signals once it's finished, starting from 1.
+    uint64_t GetFrameNumber() const
+    {
+        return m_SubmittedFrames + 1;
+    }
+
+    // Whether the slot of the current frame holds a frame finished by the GPU, e.g. with query results to read.
+    bool HasFinishedFrame() const
+    {
+        return m_SubmittedFrames >= m_FramesInFlight;
+    }
+
+    // Signaled with the number of every frame finished by the GPU.
+    vk::Semaphore GetTimeline() const
+    {
+        return m_Timeline;
+    }
+
+    vk::CommandBuffer GetCommandBuffer() const
+    {
+        return m_CommandBuffers[GetFrameIndex()];
+    }
+
+    const std::vector<vk::CommandBuffer>& GetCommandBuffers() const
+    {
+        return m_CommandBuffers;
+    }
+
+    vk::CommandPool GetCommandPool() const
+    {
+        return m_CommandPool;
+    }
+
+    vk::Semaphore GetImageAvailableSemaphore() const
+    {
+        return m_ImageAvailableSemaphores[GetFrameIndex()];
+    }
+
+    const std::vector<vk::Semaphore>& GetImageAvailableSemaphores() const
+    {
+        return m_ImageAvailableSemaphores;
+    }
+
+  private:
+    void WaitForFrame(const uint64_t frameNumber);
+    void ReleaseDeferred(const uint64_t finishedFrame);
+
+  private:
+    struct DeferredDestruction
+    {
+        uint64_t frameNumber = 0;
+        std::function<void()> destroy;
+    };
+
+    struct TimelineWait
+    {
+        vk::Semaphore timeline = nullptr;
+        uint64_t value = 0;
+        vk::PipelineStageFlags waitStage;
+    };
+
+    uint32_t m_FramesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
+    uint64_t m_SubmittedFrames = 0;
+
+    vk::Semaphore m_Timeline = nullptr;
+
+    vk::CommandPool m_CommandPool = nullptr;
+    std::vector<vk::CommandBuffer> m_CommandBuffers;
+    std::vector<vk::Semaphore> m_ImageAvailableSemaphores;
+
+    // Waits of the next submitted frame besides the image acquire.
+    std::vector<TimelineWait> m_TimelineWaits;
+
+    // Ordered by the frame number, since the frame number never decreases.
+    std::deque<DeferredDestruction> m_DeferredDestructions;
+};
@@ -0,0 +1,106 @@
+#include "LaunchOptions.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include "Log/Log.h"
+
+static uint32_t ParseCount(const char* flag, const char* value)
+{
+    char* end = nullptr;
+    const unsigned long count = value ? std::strtoul(value, &end, 10) : 0;
+
+    if (!value || *end != '\0' || count == 0 || count > UINT32_MAX)
+    {
+        LOGF(Application, Fatal, "%s expects a positive number!", flag)
+        throw std::runtime_error("Invalid command line argument!");
+    }
+
+    return (uint32_t)count;
+}
+
+// Parses WIDTHxHEIGHT, the options are left untouched unless both are positive.
+static bool ParseSize(const char* value, uint32_t& width, uint32_t& height)
+{
+    uint32_t parsedWidth = 0;
+    uint32_t parsedHeight = 0;
+
+    if (std::sscanf(value, "%ux%u", &parsedWidth, &parsedHeight) != 2 || parsedWidth == 0 || parsedHeight == 0)
+    {
+        return false;
+    }
+
+    width = parsedWidth;
+    height = parsedHeight;
+
+    return true;
+}
+
+LaunchOptions ParseLaunchOptions(const int argc, char* argv[])
+{
+    LaunchOptions options;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (std::strcmp(arg, "--headless") == 0)
+        {
+            options.headless = true;
+        }
+        else if (std::strcmp(arg, "--hash") == 0)
+        {
+            options.printHash = true;
+        }
+        else if (std::strcmp(arg, "--no-dedicated-compute") == 0)
+        {
+            options.dedicatedCompute = false;
+        }
+        else if (std::strcmp(arg, "--no-dedicated-transfer") == 0)
+        {
+            options.dedicatedTransfer = false;
+        }
+        else if (std::strcmp(arg, "--no-pipeline-cache") == 0)
+        {
+            options.pipelineCachePath.clear();
+        }
+        else if (std::strcmp(arg, "--pipeline-cache") == 0 && value)
+        {
+            options.pipelineCachePath = value;
+            i++;
+        }
+        else if (std::strcmp(arg, "--frames") == 0)
+        {
+            options.frameCount = ParseCount(arg, value);
+            i++;
+        }
+        else if (std::strcmp(arg, "--frames-in-flight") == 0)
+        {
+            options.framesInFlight = ParseCount(arg, value);
+            i++;
+        }
+        else if (std::strcmp(arg, "--capture") == 0 && value)
+        {
+            options.capturePath = value;
+            i++;
+        }
+        else if (std::strcmp(arg, "--size") == 0 && value && ParseSize(value, options.width, options.height))
+        {
+            i++;
+        }
+        else
+        {
+            LOGF(Application, Warning, "Ignoring the unknown or incomplete command line argument %s", arg)
+        }
+    }
+
+    if (!options.headless && (!options.capturePath.empty() || options.printHash))
+    {
+        LOG(Application, Warning, "The frame capture is only available in the headless mode (--headless)")
+    }
+
+    return options;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "FrameScheduler.h"
+
+// Rendering setup of the applications, chosen on the command line.
+struct LaunchOptions
+{
+    uint32_t width = 1280;
+    uint32_t height = 720;
+    uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
+
+    // Renders into offscreen images without a window or a swapchain, e.g. on machines without a display.
+    bool headless = false;
+    // Frames rendered by the headless mode before the application exits.
+    uint32_t frameCount = 300;
+    // PNG the last headless frame is written to, none if empty.
+    std::string capturePath;
+    // Prints a hash of the last headless frame, so that the output of two runs can be compared.
+    bool printHash = false;
+
+    // File the pipeline cache is kept in between the runs, an empty path always compiles the pipelines cold.
+    std::string pipelineCachePath = "pipeline.cache";
+
+    // Submits the async compute to a queue of a compute-only family, if there is one. Only for the applications
+    // transferring all the resources shared by the compute and the graphics passes in between the queues.
+    bool dedicatedCompute = true;
+    // Submits the uploads to a queue of a transfer-only family, if there is one.
+    bool dedicatedTransfer = true;
+};
+
+/**
+ * Parses the command line of the applications:
+ *   --headless             Render offscreen, without a window.
+ *   --frames <count>       Frames rendered by the headless mode.
+ *   --capture <file.png>   Write the last headless frame to a PNG.
+ *   --hash                 Print a hash of the last headless frame.
+ *   --pipeline-cache <file>
+ *   --no-pipeline-cache    Neither load nor save the pipeline cache.
+ *   --size <width>x<height>
+ *   --frames-in-flight <count>
+ *   --no-dedicated-compute Submit the async compute to the graphics queue.
+ *   --no-dedicated-transfer
+ */
+LaunchOptions ParseLaunchOptions(const int argc, char* argv[]);
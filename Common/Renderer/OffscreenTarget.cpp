@@ -0,0 +1,242 @@
+#include "OffscreenTarget.h"
+
+#include "Log/Log.h"
+#include "Vk/Devices/DeviceManager.h"
+#include "vulkan/vulkan_enums.hpp"
+#include "vulkan/vulkan_structs.hpp"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+// RGBA8 keeps the readback directly writable as a PNG.
+static constexpr vk::Format OFFSCREEN_COLOR_FORMAT = vk::Format::eR8G8B8A8Unorm;
+static constexpr vk::Format OFFSCREEN_DEPTH_FORMAT = vk::Format::eD32Sfloat;
+
+void OffscreenTarget::Initialize(const uint32_t width, const uint32_t height, const uint32_t imageCount)
+{
+    m_Width = width;
+    m_Height = height;
+
+    CreateRenderPass();
+
+    vk::Device device = *VkCore::DeviceManager::GetDevice();
+
+    for (uint32_t i = 0; i < imageCount; i++)
+    {
+        m_ColorAttachments.emplace_back(CreateAttachment(OFFSCREEN_COLOR_FORMAT,
+                                                         vk::ImageUsageFlagBits::eColorAttachment |
+                                                             vk::ImageUsageFlagBits::eTransferSrc,
+                                                         vk::ImageAspectFlagBits::eColor));
+        m_DepthAttachments.emplace_back(CreateAttachment(OFFSCREEN_DEPTH_FORMAT,
+                                                         vk::ImageUsageFlagBits::eDepthStencilAttachment,
+                                                         vk::ImageAspectFlagBits::eDepth));
+
+        const vk::ImageView attachments[] = {m_ColorAttachments.back().view, m_DepthAttachments.back().view};
+
+        vk::FramebufferCreateInfo createInfo{};
+        createInfo.setRenderPass(m_RenderPass)
+            .setAttachments(attachments)
+            .setWidth(width)
+            .setHeight(height)
+            .setLayers(1);
+
+        m_Framebuffers.emplace_back(device.createFramebuffer(createInfo));
+    }
+
+    m_Readback.Initialize((vk::DeviceSize)width * height * 4, vk::BufferUsageFlagBits::eTransferDst);
+
+    LOGF(Application, Info, "Rendering headless into %d offscreen images of %dx%d", imageCount, width, height)
+}
+
+void OffscreenTarget::CreateRenderPass()
+{
+    vk::AttachmentDescription attachments[2] = {};
+
+    attachments[0]
+        .setFormat(OFFSCREEN_COLOR_FORMAT)
+        .setSamples(vk::SampleCountFlagBits::e1)
+        .setLoadOp(vk::AttachmentLoadOp::eClear)
+        .setStoreOp(vk::AttachmentStoreOp::eStore)
+        .setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
+        .setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
+        .setInitialLayout(vk::ImageLayout::eUndefined)
+        .setFinalLayout(vk::ImageLayout::eTransferSrcOptimal);
+
+    attachments[1]
+        .setFormat(OFFSCREEN_DEPTH_FORMAT)
+        .setSamples(vk::SampleCountFlagBits::e1)
+        .setLoadOp(vk::AttachmentLoadOp::eClear)
+        .setStoreOp(vk::AttachmentStoreOp::eDontCare)
+        .setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
+        .setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
+        .setInitialLayout(vk::ImageLayout::eUndefined)
+        .setFinalLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal);
+
+    const vk::AttachmentReference colorReference{0, vk::ImageLayout::eColorAttachmentOptimal};
+    const vk::AttachmentReference depthReference{1, vk::ImageLayout::eDepthStencilAttachmentOptimal};
+
+    vk::SubpassDescription subpass{};
+    subpass.setPipelineBindPoint(vk::PipelineBindPoint::eGraphics)
+        .setColorAttachments(colorReference)
+        .setPDepthStencilAttachment(&depthReference);
+
+    // The previous readback of the image has to finish before it's cleared, and the color has to be written before
+    // the next readback.
+    vk::SubpassDependency dependencies[2] = {};
+
+    dependencies[0]
+        .setSrcSubpass(VK_SUBPASS_EXTERNAL)
+        .setDstSubpass(0)
+        .setSrcStageMask(vk::PipelineStageFlagBits::eTransfer)
+        .setDstStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput |
+                         vk::PipelineStageFlagBits::eEarlyFragmentTests)
+        .setSrcAccessMask({})
+        .setDstAccessMask(vk::AccessFlagBits::eColorAttachmentWrite |
+                          vk::AccessFlagBits::eDepthStencilAttachmentWrite);
+
+    dependencies[1]
+        .setSrcSubpass(0)
+        .setDstSubpass(VK_SUBPASS_EXTERNAL)
+        .setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
+        .setDstStageMask(vk::PipelineStageFlagBits::eTransfer)
+        .setSrcAccessMask(vk::AccessFlagBits::eColorAttachmentWrite)
+        .setDstAccessMask(vk::AccessFlagBits::eTransferRead);
+
+    vk::RenderPassCreateInfo createInfo{};
+    createInfo.setAttachments(attachments).setSubpasses(subpass).setDependencies(dependencies);
+
+    m_RenderPass = (*VkCore::DeviceManager::GetDevice()).createRenderPass(createInfo);
+}
+
+OffscreenTarget::Attachment OffscreenTarget::CreateAttachment(const vk::Format format, const vk::ImageUsageFlags usage,
+                                                              const vk::ImageAspectFlags aspect) const
+{
+    vk::Device device = *VkCore::DeviceManager::GetDevice();
+    vk::PhysicalDevice physicalDevice = *VkCore::DeviceManager::GetPhysicalDevice();
+
+    Attachment attachment{};
+
+    vk::ImageCreateInfo createInfo{};
+    createInfo.setImageType(vk::ImageType::e2D)
+        .setFormat(format)
+        .setExtent(vk::Extent3D(m_Width, m_Height, 1))
+        .setMipLevels(1)
+        .setArrayLayers(1)
+        .setSamples(vk::SampleCountFlagBits::e1)
+        .setTiling(vk::ImageTiling::eOptimal)
+        .setUsage(usage)
+        .setSharingMode(vk::SharingMode::eExclusive)
+        .setInitialLayout(vk::ImageLayout::eUndefined);
+
+    attachment.image = device.createImage(createInfo);
+
+    const vk::MemoryRequirements requirements = device.getImageMemoryRequirements(attachment.image);
+    const vk::PhysicalDeviceMemoryProperties memoryProperties = physicalDevice.getMemoryProperties();
+
+    // CPU implementations like lavapipe may only expose host visible memory, so any allowed type is the fallback.
+    uint32_t memoryType = UINT32_MAX;
+
+    for (const vk::MemoryPropertyFlags flags :
+         {vk::MemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal), vk::MemoryPropertyFlags()})
+    {
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount && memoryType == UINT32_MAX; i++)
+        {
+            if ((requirements.memoryTypeBits & (1 << i)) &&
+                (memoryProperties.memoryTypes[i].propertyFlags & flags) == flags)
+            {
+                memoryType = i;
+            }
+        }
+    }
+
+    ASSERT(memoryType != UINT32_MAX, "No memory type found for the offscreen image!")
+
+    vk::MemoryAllocateInfo allocateInfo{};
+    allocateInfo.setAllocationSize(requirements.size).setMemoryTypeIndex(memoryType);
+
+    attachment.memory = device.allocateMemory(allocateInfo);
+    device.bindImageMemory(attachment.image, attachment.memory, 0);
+
+    vk::ImageViewCreateInfo viewCreateInfo{};
+    viewCreateInfo.setImage(attachment.image)
+        .setViewType(vk::ImageViewType::e2D)
+        .setFormat(format)
+        .setSubresourceRange(vk::ImageSubresourceRange(aspect, 0, 1, 0, 1));
+
+    attachment.view = device.createImageView(viewCreateInfo);
+
+    return attachment;
+}
+
+void OffscreenTarget::DestroyAttachment(const Attachment& attachment) const
+{
+    vk::Device device = *VkCore::DeviceManager::GetDevice();
+
+    device.destroyImageView(attachment.view);
+    device.destroyImage(attachment.image);
+    device.freeMemory(attachment.memory);
+}
+
+void OffscreenTarget::RecordReadback(const vk::CommandBuffer& cmdBuffer, const uint32_t imageIndex)
+{
+    // The render pass leaves the color in the transfer source layout, its dependency makes the writes visible.
+    vk::BufferImageCopy region{};
+    region.setImageSubresource(vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1))
+        .setImageExtent(vk::Extent3D(m_Width, m_Height, 1));
+
+    cmdBuffer.copyImageToBuffer(m_ColorAttachments[imageIndex].image, vk::ImageLayout::eTransferSrcOptimal,
+                                m_Readback.GetVkBuffer(), region);
+
+    vk::MemoryBarrier hostBarrier;
+    hostBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    hostBarrier.dstAccessMask = vk::AccessFlagBits::eHostRead;
+
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {},
+                              hostBarrier, {}, {});
+}
+
+uint64_t OffscreenTarget::WriteReadback(const std::string& pngPath) const
+{
+    const uint8_t* pixels = static_cast<const uint8_t*>(m_Readback.GetData());
+    const uint64_t size = (uint64_t)m_Width * m_Height * 4;
+
+    uint64_t hash = 14695981039346656037ull;
+
+    for (uint64_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ pixels[i]) * 1099511628211ull;
+    }
+
+    if (!pngPath.empty())
+    {
+        if (stbi_write_png(pngPath.c_str(), m_Width, m_Height, 4, pixels, m_Width * 4))
+        {
+            LOGF(Application, Info, "Wrote the last frame to %s", pngPath.c_str())
+        }
+        else
+        {
+            LOGF(Application, Error, "Failed to write the last frame to %s!", pngPath.c_str())
+        }
+    }
+
+    return hash;
+}
+
+void OffscreenTarget::Destroy()
+{
+    vk::Device device = *VkCore::DeviceManager::GetDevice();
+
+    for (uint32_t i = 0; i < m_Framebuffers.size(); i++)
+    {
+        device.destroyFramebuffer(m_Framebuffers[i]);
+        DestroyAttachment(m_ColorAttachments[i]);
+        DestroyAttachment(m_DepthAttachments[i]);
+    }
+
+    m_Framebuffers.clear();
+    m_ColorAttachments.clear();
+    m_DepthAttachments.clear();
+
+    device.destroyRenderPass(m_RenderPass);
+    m_Readback.Destroy();
+}
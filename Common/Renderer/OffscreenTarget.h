@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../HostBuffer.h"
+#include "vulkan/vulkan_handles.hpp"
+
+/**
+ * Color and depth images the headless mode renders into instead of the swapchain, one pair per frame in flight.
+ *
+ * The render pass clears both attachments like the swapchain render pass does, the pipelines are built against it
+ * in the headless mode. The color ends up in a transfer source layout, so any frame can be read back to the host
+ * and written out as a PNG or hashed to compare the output of two runs.
+ */
+class OffscreenTarget
+{
+  public:
+    OffscreenTarget() {};
+
+    void Initialize(const uint32_t width, const uint32_t height, const uint32_t imageCount);
+
+    void Destroy();
+
+    // Copies the color of the image to the host. Has to be recorded after the render pass.
+    void RecordReadback(const vk::CommandBuffer& cmdBuffer, const uint32_t imageIndex);
+
+    /**
+     * Writes the read back color to a PNG, unless the path is empty. Has to be called once the frame recording the
+     * readback has finished.
+     * @return - FNV-1a hash of the RGBA8 pixels.
+     */
+    uint64_t WriteReadback(const std::string& pngPath) const;
+
+    vk::RenderPass GetVkRenderPass() const
+    {
+        return m_RenderPass;
+    }
+
+    vk::Framebuffer GetFramebuffer(const uint32_t imageIndex) const
+    {
+        return m_Framebuffers[imageIndex];
+    }
+
+    uint32_t GetWidth() const
+    {
+        return m_Width;
+    }
+
+    uint32_t GetHeight() const
+    {
+        return m_Height;
+    }
+
+  private:
+    struct Attachment
+    {
+        vk::Image image = nullptr;
+        vk::DeviceMemory memory = nullptr;
+        vk::ImageView view = nullptr;
+    };
+
+    Attachment CreateAttachment(const vk::Format format, const vk::ImageUsageFlags usage,
+                                const vk::ImageAspectFlags aspect) const;
+    void DestroyAttachment(const Attachment& attachment) const;
+    void CreateRenderPass();
+
+  private:
+    uint32_t m_Width = 0;
+    uint32_t m_Height = 0;
+
+    vk::RenderPass m_RenderPass = nullptr;
+    std::vector<Attachment> m_ColorAttachments;
+    std::vector<Attachment> m_DepthAttachments;
+    std::vector<vk::Framebuffer> m_Framebuffers;
+
+    HostBuffer m_Readback;
+};
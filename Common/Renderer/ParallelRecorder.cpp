@@ -0,0 +1,256 @@
+#include "ParallelRecorder.h"
+
+#include <algorithm>
+
+#include "Log/Log.h"
+#include "Vk/Devices/DeviceManager.h"
+#include "vulkan/vulkan_enums.hpp"
+#include "vulkan/vulkan_structs.hpp"
+
+void ParallelRecorder::Initialize(const uint32_t framesInFlight, const uint32_t queueFamilyIndex,
+                                  const uint32_t threadCount)
+{
+    const uint32_t hardwareThreads = std::max(2u, std::thread::hardware_concurrency());
+    const uint32_t workerCount = threadCount > 0 ? threadCount : hardwareThreads - 1;
+
+    m_FramesInFlight = framesInFlight;
+    m_IsStopping = false;
+
+    VkCore::Device& device = VkCore::DeviceManager::GetDevice();
+
+    TRY_CATCH_BEGIN()
+
+    // The secondaries of the workers are reset together with their pool every time the slot comes around.
+    vk::CommandPoolCreateInfo createInfo{vk::CommandPoolCreateFlagBits::eTransient, queueFamilyIndex};
+
+    m_WorkerPools.resize(workerCount);
+
+    for (WorkerPools& workerPools : m_WorkerPools)
+    {
+        for (uint32_t i = 0; i < m_FramesInFlight; i++)
+        {
+            workerPools.pools.emplace_back(device.CreateCommandPool(createInfo));
+        }
+
+        workerPools.buffers.resize(m_FramesInFlight);
+        workerPools.usedBuffers.resize(m_FramesInFlight, 0);
+    }
+
+    createInfo.setFlags(vk::CommandPoolCreateFlagBits::eResetCommandBuffer);
+    m_StaticPool = device.CreateCommandPool(createInfo);
+
+    TRY_CATCH_END()
+
+    for (uint32_t i = 0; i < workerCount; i++)
+    {
+        m_Workers.emplace_back(&ParallelRecorder::Work, this, i);
+    }
+
+    LOGF(Application, Info, "Recording the passes on %d threads", workerCount)
+}
+
+void ParallelRecorder::Begin(const uint32_t frameIndex, const vk::RenderPass& renderPass, const uint32_t width,
+                             const uint32_t height)
+{
+    m_FrameIndex = frameIndex;
+    m_RenderPass = renderPass;
+    m_Width = width;
+    m_Height = height;
+
+    m_Secondaries.clear();
+
+    const vk::Device device = *VkCore::DeviceManager::GetDevice();
+
+    // The workers are idle in between the frames, so their pools can be reset from here.
+    for (WorkerPools& workerPools : m_WorkerPools)
+    {
+        device.resetCommandPool(workerPools.pools[frameIndex]);
+        workerPools.usedBuffers[frameIndex] = 0;
+    }
+}
+
+void ParallelRecorder::Record(RecordFunc&& record)
+{
+    ASSERT(!m_Workers.empty(), "The recorder has to be initialized before recording with it!")
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        // Filled in by the worker picking up the job.
+        m_Queue.push_back({(uint32_t)m_Secondaries.size(), std::move(record)});
+        m_Secondaries.emplace_back(nullptr);
+        m_PendingJobs++;
+    }
+
+    m_QueueChanged.notify_one();
+}
+
+void ParallelRecorder::RecordStatic(const uint32_t id, const RecordFunc& record)
+{
+    if (id >= m_StaticPasses.size())
+    {
+        m_StaticPasses.resize(id + 1);
+    }
+
+    std::vector<StaticPass>& passes = m_StaticPasses[id];
+
+    if (passes.empty())
+    {
+        vk::CommandBufferAllocateInfo allocateInfo{};
+        allocateInfo.setLevel(vk::CommandBufferLevel::eSecondary)
+            .setCommandPool(m_StaticPool)
+            .setCommandBufferCount(m_FramesInFlight);
+
+        for (const vk::CommandBuffer& buffer : VkCore::DeviceManager::GetDevice().AllocateCommandBuffers(allocateInfo))
+        {
+            passes.push_back({buffer});
+        }
+    }
+
+    StaticPass& pass = passes[m_FrameIndex];
+
+    // The slot of the frame is free, so is its secondary.
+    if (pass.renderPass != m_RenderPass || pass.width != m_Width || pass.height != m_Height)
+    {
+        pass.buffer.reset();
+
+        BeginSecondary(pass.buffer, {});
+        record(pass.buffer);
+        pass.buffer.end();
+
+        pass.renderPass = m_RenderPass;
+        pass.width = m_Width;
+        pass.height = m_Height;
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Secondaries.emplace_back(pass.buffer);
+}
+
+void ParallelRecorder::Execute(const vk::CommandBuffer& primary)
+{
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_JobFinished.wait(lock, [this]() { return m_PendingJobs == 0; });
+    }
+
+    if (!m_Secondaries.empty())
+    {
+        primary.executeCommands(m_Secondaries);
+    }
+}
+
+void ParallelRecorder::InvalidateStatic()
+{
+    for (std::vector<StaticPass>& passes : m_StaticPasses)
+    {
+        for (StaticPass& pass : passes)
+        {
+            pass.renderPass = nullptr;
+        }
+    }
+}
+
+void ParallelRecorder::Destroy()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_IsStopping = true;
+    }
+
+    m_QueueChanged.notify_all();
+
+    for (std::thread& worker : m_Workers)
+    {
+        worker.join();
+    }
+
+    m_Workers.clear();
+
+    VkCore::Device& device = VkCore::DeviceManager::GetDevice();
+
+    for (WorkerPools& workerPools : m_WorkerPools)
+    {
+        for (const vk::CommandPool& pool : workerPools.pools)
+        {
+            device.DestroyCommandPool(pool);
+        }
+    }
+
+    device.DestroyCommandPool(m_StaticPool);
+
+    m_WorkerPools.clear();
+    m_StaticPasses.clear();
+    m_Secondaries.clear();
+}
+
+void ParallelRecorder::Work(const uint32_t worker)
+{
+    WorkerPools& workerPools = m_WorkerPools[worker];
+
+    while (true)
+    {
+        Job job;
+
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_QueueChanged.wait(lock, [this]() { return m_IsStopping || !m_Queue.empty(); });
+
+            if (m_Queue.empty())
+            {
+                return;
+            }
+
+            job = std::move(m_Queue.front());
+            m_Queue.pop_front();
+        }
+
+        std::vector<vk::CommandBuffer>& buffers = workerPools.buffers[m_FrameIndex];
+        uint32_t& usedBuffers = workerPools.usedBuffers[m_FrameIndex];
+
+        // The secondaries are kept along with the pool, so they are only allocated by the first frames.
+        if (usedBuffers == buffers.size())
+        {
+            vk::CommandBufferAllocateInfo allocateInfo{};
+            allocateInfo.setLevel(vk::CommandBufferLevel::eSecondary)
+                .setCommandPool(workerPools.pools[m_FrameIndex])
+                .setCommandBufferCount(1);
+
+            buffers.emplace_back(VkCore::DeviceManager::GetDevice().AllocateCommandBuffers(allocateInfo)[0]);
+        }
+
+        const vk::CommandBuffer cmdBuffer = buffers[usedBuffers++];
+
+        BeginSecondary(cmdBuffer, vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+        job.record(cmdBuffer);
+        cmdBuffer.end();
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+
+            m_Secondaries[job.slot] = cmdBuffer;
+            m_PendingJobs--;
+        }
+
+        m_JobFinished.notify_all();
+    }
+}
+
+void ParallelRecorder::BeginSecondary(const vk::CommandBuffer& cmdBuffer, const vk::CommandBufferUsageFlags usage) const
+{
+    // No framebuffer, so that the secondaries can be executed with any image of the swapchain.
+    vk::CommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.setRenderPass(m_RenderPass).setSubpass(0);
+
+    vk::CommandBufferBeginInfo beginInfo{};
+    beginInfo.setFlags(usage | vk::CommandBufferUsageFlagBits::eRenderPassContinue)
+        .setPInheritanceInfo(&inheritanceInfo);
+
+    cmdBuffer.begin(beginInfo);
+
+    const vk::Rect2D scissor = vk::Rect2D({0, 0}, {m_Width, m_Height});
+    cmdBuffer.setScissor(0, 1, &scissor);
+
+    const vk::Viewport viewport = vk::Viewport(0, 0, m_Width, m_Height, 0, 1);
+    cmdBuffer.setViewport(0, 1, &viewport);
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "vulkan/vulkan_handles.hpp"
+
+/**
+ * Records the passes of a render pass into secondary command buffers on worker threads.
+ *
+ * Every worker owns a command pool per frame in flight, since a pool may only be used by a single thread, and
+ * allocates as many secondary buffers from it as the jobs it picks up need. The pools of a frame are reset by Begin,
+ * once the scheduler has waited for the frame recorded in the slot before. Execute waits for the jobs and executes
+ * the secondaries in the order they were queued, so the order of the draws doesn't depend on the workers.
+ *
+ * The secondaries of the static passes, i.e. whose commands never change while their buffers are updated in place,
+ * are recorded once per slot and replayed until the render pass or the size of the frame changes.
+ *
+ * Every secondary starts with the viewport and the scissor of the frame set, since the dynamic state isn't
+ * inherited from the primary buffer. The render pass has to be begun with secondary command buffer contents.
+ */
+class ParallelRecorder
+{
+  public:
+    using RecordFunc = std::function<void(const vk::CommandBuffer&)>;
+
+    ParallelRecorder() {};
+
+    /**
+     * @param threadCount - Worker threads, all the hardware threads but the main one if zero.
+     */
+    void Initialize(const uint32_t framesInFlight, const uint32_t queueFamilyIndex, const uint32_t threadCount = 0);
+
+    // Starts the passes of the frame, has to be called once the slot of the frame is free again.
+    void Begin(const uint32_t frameIndex, const vk::RenderPass& renderPass, const uint32_t width,
+               const uint32_t height);
+
+    // Queues the recording of a pass on the workers. The function may only record into the given buffer.
+    void Record(RecordFunc&& record);
+
+    /**
+     * Queues the static pass with the given id, recorded on the calling thread only when its secondary of the slot
+     * is missing or outdated.
+     */
+    void RecordStatic(const uint32_t id, const RecordFunc& record);
+
+    // Waits for the queued passes and executes them in the queued order.
+    void Execute(const vk::CommandBuffer& primary);
+
+    // Records the static passes again, e.g. once the render pass they were recorded against was destroyed.
+    void InvalidateStatic();
+
+    void Destroy();
+
+    uint32_t GetThreadCount() const
+    {
+        return m_Workers.size();
+    }
+
+  private:
+    struct Job
+    {
+        uint32_t slot = 0;
+        RecordFunc record;
+    };
+
+    struct WorkerPools
+    {
+        // One pool per frame in flight, along with the secondaries allocated from it so far.
+        std::vector<vk::CommandPool> pools;
+        std::vector<std::vector<vk::CommandBuffer>> buffers;
+        std::vector<uint32_t> usedBuffers;
+    };
+
+    struct StaticPass
+    {
+        vk::CommandBuffer buffer = nullptr;
+        vk::RenderPass renderPass = nullptr;
+        uint32_t width = 0;
+        uint32_t height = 0;
+    };
+
+    void Work(const uint32_t worker);
+    void BeginSecondary(const vk::CommandBuffer& cmdBuffer, const vk::CommandBufferUsageFlags usage) const;
+
+  private:
+    uint32_t m_FramesInFlight = 0;
+    uint32_t m_FrameIndex = 0;
+
+    vk::RenderPass m_RenderPass = nullptr;
+    uint32_t m_Width = 0;
+    uint32_t m_Height = 0;
+
+    std::vector<std::thread> m_Workers;
+    std::vector<WorkerPools> m_WorkerPools;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_QueueChanged;
+    std::condition_variable m_JobFinished;
+    std::deque<Job> m_Queue;
+    uint32_t m_PendingJobs = 0;
+    bool m_IsStopping = false;
+
+    // Secondaries of the frame in the order they are executed in.
+    std::vector<vk::CommandBuffer> m_Secondaries;
+
+    // Static passes of every id, a secondary per frame in flight each, allocated from a pool of the main thread.
+    vk::CommandPool m_StaticPool = nullptr;
+    std::vector<std::vector<StaticPass>> m_StaticPasses;
+};
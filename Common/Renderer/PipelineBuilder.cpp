@@ -0,0 +1,260 @@
+#include "PipelineBuilder.h"
+
+#include "Log/Log.h"
+#include "Vk/Devices/DeviceManager.h"
+
+static vk::PipelineLayout CreatePipelineLayout(const std::vector<vk::DescriptorSetLayout>& descriptorLayouts,
+                                               const std::vector<vk::PushConstantRange>& pushConstantRanges)
+{
+    vk::PipelineLayoutCreateInfo createInfo{};
+    createInfo.setSetLayouts(descriptorLayouts).setPushConstantRanges(pushConstantRanges);
+
+    return (*VkCore::DeviceManager::GetDevice()).createPipelineLayout(createInfo);
+}
+
+static vk::ShaderModule CreateShaderModule(const ShaderBinary& shader)
+{
+    vk::ShaderModuleCreateInfo createInfo{};
+    createInfo.setCode(shader.code);
+
+    return (*VkCore::DeviceManager::GetDevice()).createShaderModule(createInfo);
+}
+
+VertexLayout& VertexLayout::SetBinding(const uint32_t binding)
+{
+    m_Binding = binding;
+
+    for (vk::VertexInputAttributeDescription& attribute : m_Attributes)
+    {
+        attribute.binding = binding;
+    }
+
+    return *this;
+}
+
+vk::VertexInputBindingDescription VertexLayout::GetBindingDescription() const
+{
+    return vk::VertexInputBindingDescription(m_Binding, m_Stride, vk::VertexInputRate::eVertex);
+}
+
+std::vector<vk::VertexInputAttributeDescription> VertexLayout::GetAttributeDescriptions() const
+{
+    return m_Attributes;
+}
+
+void VertexLayout::PushFloatAttribute(const uint32_t count)
+{
+    static constexpr vk::Format formats[4] = {vk::Format::eR32Sfloat, vk::Format::eR32G32Sfloat,
+                                              vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32A32Sfloat};
+
+    ASSERT(count > 0 && count <= 4, "A vertex attribute has one to four components!")
+
+    m_Attributes.emplace_back((uint32_t)m_Attributes.size(), m_Binding, formats[count - 1], m_Stride);
+    m_Stride += count * sizeof(float);
+}
+
+GraphicsPipelineBuilder::GraphicsPipelineBuilder(const PipelineCache& pipelineCache) : m_PipelineCache(pipelineCache)
+{
+    m_InputAssembly.setTopology(vk::PrimitiveTopology::eTriangleList);
+
+    m_Rasterization.setPolygonMode(vk::PolygonMode::eFill)
+        .setCullMode(vk::CullModeFlagBits::eNone)
+        .setFrontFace(vk::FrontFace::eCounterClockwise)
+        .setLineWidth(1.f);
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::BindShaderModules(const std::vector<ShaderBinary>& shaders)
+{
+    m_Shaders.insert(m_Shaders.end(), shaders.begin(), shaders.end());
+    return *this;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::BindRenderPass(const vk::RenderPass renderPass,
+                                                                 const uint32_t subpass)
+{
+    m_RenderPass = renderPass;
+    m_Subpass = subpass;
+    return *this;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::BindVertexAttributes(const VertexLayout& layout)
+{
+    const std::vector<vk::VertexInputAttributeDescription> attributes = layout.GetAttributeDescriptions();
+
+    m_VertexBindings.emplace_back(layout.GetBindingDescription());
+    m_VertexAttributes.insert(m_VertexAttributes.end(), attributes.begin(), attributes.end());
+    return *this;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::EnableDepthTest()
+{
+    m_DepthStencil.setDepthTestEnable(true).setDepthWriteEnable(true).setDepthCompareOp(vk::CompareOp::eLess);
+    return *this;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::AddViewport(const glm::uvec4& viewport)
+{
+    m_Viewports.emplace_back((float)viewport.x, (float)viewport.y, (float)viewport.z, (float)viewport.w, 0.f, 1.f);
+    m_Scissors.emplace_back(vk::Offset2D((int32_t)viewport.x, (int32_t)viewport.y),
+                            vk::Extent2D(viewport.z, viewport.w));
+    return *this;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::FrontFaceDirection(const vk::FrontFace frontFace)
+{
+    m_Rasterization.setFrontFace(frontFace);
+    return *this;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::SetCullMode(const vk::CullModeFlags cullMode)
+{
+    m_Rasterization.setCullMode(cullMode);
+    return *this;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::SetLineWidth(const float lineWidth)
+{
+    m_Rasterization.setLineWidth(lineWidth);
+    return *this;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::SetPrimitiveAssembly(const vk::PrimitiveTopology topology)
+{
+    m_InputAssembly.setTopology(topology);
+    return *this;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::AddDisabledBlendAttachment()
+{
+    vk::PipelineColorBlendAttachmentState attachment{};
+    attachment.setBlendEnable(false).setColorWriteMask(
+        vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB |
+        vk::ColorComponentFlagBits::eA);
+
+    m_BlendAttachments.emplace_back(attachment);
+    return *this;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::AddBlendAttachment(
+    const vk::PipelineColorBlendAttachmentState& attachment)
+{
+    m_BlendAttachments.emplace_back(attachment);
+    return *this;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::AddDescriptorLayout(const vk::DescriptorSetLayout& layout)
+{
+    m_DescriptorLayouts.emplace_back(layout);
+    return *this;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::AddDynamicState(const vk::DynamicState state)
+{
+    m_DynamicStates.emplace_back(state);
+    return *this;
+}
+
+vk::Pipeline GraphicsPipelineBuilder::Build(vk::PipelineLayout& pipelineLayout)
+{
+    ASSERT(!m_Shaders.empty() && m_RenderPass, "A graphics pipeline needs its shaders and a render pass!")
+
+    const vk::Device device = *VkCore::DeviceManager::GetDevice();
+
+    std::vector<vk::PipelineShaderStageCreateInfo> stages;
+    bool isMeshShading = false;
+
+    for (const ShaderBinary& shader : m_Shaders)
+    {
+        stages.emplace_back(vk::PipelineShaderStageCreateFlags(), shader.stage, CreateShaderModule(shader), "main");
+        isMeshShading |= shader.stage == vk::ShaderStageFlagBits::eMeshEXT;
+    }
+
+    vk::PipelineVertexInputStateCreateInfo vertexInput{};
+    vertexInput.setVertexBindingDescriptions(m_VertexBindings).setVertexAttributeDescriptions(m_VertexAttributes);
+
+    vk::PipelineViewportStateCreateInfo viewport{};
+    viewport.setViewports(m_Viewports).setScissors(m_Scissors);
+
+    vk::PipelineMultisampleStateCreateInfo multisample{};
+    multisample.setRasterizationSamples(vk::SampleCountFlagBits::e1);
+
+    vk::PipelineColorBlendStateCreateInfo colorBlend{};
+    colorBlend.setAttachments(m_BlendAttachments);
+
+    vk::PipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.setDynamicStates(m_DynamicStates);
+
+    pipelineLayout = CreatePipelineLayout(m_DescriptorLayouts, m_PushConstantRanges);
+
+    vk::GraphicsPipelineCreateInfo createInfo{};
+    createInfo.setStages(stages)
+        .setPVertexInputState(isMeshShading ? nullptr : &vertexInput)
+        .setPInputAssemblyState(isMeshShading ? nullptr : &m_InputAssembly)
+        .setPViewportState(&viewport)
+        .setPRasterizationState(&m_Rasterization)
+        .setPMultisampleState(&multisample)
+        .setPDepthStencilState(&m_DepthStencil)
+        .setPColorBlendState(&colorBlend)
+        .setPDynamicState(&dynamicState)
+        .setLayout(pipelineLayout)
+        .setRenderPass(m_RenderPass)
+        .setSubpass(m_Subpass);
+
+    vk::Pipeline pipeline;
+
+    TRY_CATCH_BEGIN()
+
+    pipeline = m_PipelineCache.CreateGraphicsPipeline(createInfo);
+
+    TRY_CATCH_END()
+
+    for (const vk::PipelineShaderStageCreateInfo& stage : stages)
+    {
+        device.destroyShaderModule(stage.module);
+    }
+
+    return pipeline;
+}
+
+ComputePipelineBuilder::ComputePipelineBuilder(const PipelineCache& pipelineCache) : m_PipelineCache(pipelineCache)
+{
+}
+
+ComputePipelineBuilder& ComputePipelineBuilder::BindShaderModule(const ShaderBinary& shader)
+{
+    ASSERT(shader.stage == vk::ShaderStageFlagBits::eCompute, "A compute pipeline needs a compute shader!")
+
+    m_Shader = shader;
+    return *this;
+}
+
+ComputePipelineBuilder& ComputePipelineBuilder::AddDescriptorLayout(const vk::DescriptorSetLayout& layout)
+{
+    m_DescriptorLayouts.emplace_back(layout);
+    return *this;
+}
+
+vk::Pipeline ComputePipelineBuilder::Build(vk::PipelineLayout& pipelineLayout)
+{
+    ASSERT(!m_Shader.code.empty(), "A compute pipeline needs its shader!")
+
+    const vk::ShaderModule module = CreateShaderModule(m_Shader);
+
+    pipelineLayout = CreatePipelineLayout(m_DescriptorLayouts, m_PushConstantRanges);
+
+    vk::ComputePipelineCreateInfo createInfo{};
+    createInfo.setStage(vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eCompute, module, "main"))
+        .setLayout(pipelineLayout);
+
+    vk::Pipeline pipeline;
+
+    TRY_CATCH_BEGIN()
+
+    pipeline = m_PipelineCache.CreateComputePipeline(createInfo);
+
+    TRY_CATCH_END()
+
+    (*VkCore::DeviceManager::GetDevice()).destroyShaderModule(module);
+
+    return pipeline;
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "PipelineCache.h"
+#include "ShaderCache.h"
+#include "glm/vec4.hpp"
+#include "vulkan/vulkan_enums.hpp"
+#include "vulkan/vulkan_handles.hpp"
+#include "vulkan/vulkan_structs.hpp"
+
+// Interleaved float attributes of a single vertex binding, their locations follow the order they are pushed in.
+class VertexLayout
+{
+  public:
+    VertexLayout() {};
+
+    template <typename T>
+    VertexLayout& PushAttribute(const uint32_t count)
+    {
+        static_assert(std::is_same<T, float>::value, "Only the float attributes are supported!");
+
+        PushFloatAttribute(count);
+        return *this;
+    }
+
+    VertexLayout& SetBinding(const uint32_t binding);
+
+    vk::VertexInputBindingDescription GetBindingDescription() const;
+    std::vector<vk::VertexInputAttributeDescription> GetAttributeDescriptions() const;
+
+  private:
+    void PushFloatAttribute(const uint32_t count);
+
+  private:
+    uint32_t m_Binding = 0;
+    uint32_t m_Stride = 0;
+
+    std::vector<vk::VertexInputAttributeDescription> m_Attributes;
+};
+
+/**
+ * Builds a graphics pipeline and its layout through the pipeline cache.
+ *
+ * The pipeline is a mesh shading one when the shaders contain a mesh shader, in which case the vertex input and the
+ * input assembly are left out. The shader modules only live for the duration of Build.
+ */
+class GraphicsPipelineBuilder
+{
+  public:
+    GraphicsPipelineBuilder(const PipelineCache& pipelineCache);
+
+    GraphicsPipelineBuilder& BindShaderModules(const std::vector<ShaderBinary>& shaders);
+    GraphicsPipelineBuilder& BindRenderPass(const vk::RenderPass renderPass, const uint32_t subpass = 0);
+    GraphicsPipelineBuilder& BindVertexAttributes(const VertexLayout& layout);
+
+    // Depth test and write with the less compare op, the depth is cleared to 1.
+    GraphicsPipelineBuilder& EnableDepthTest();
+
+    // @param viewport - x, y, width and height of the viewport and of its scissor.
+    GraphicsPipelineBuilder& AddViewport(const glm::uvec4& viewport);
+
+    GraphicsPipelineBuilder& FrontFaceDirection(const vk::FrontFace frontFace);
+    GraphicsPipelineBuilder& SetCullMode(const vk::CullModeFlags cullMode);
+    GraphicsPipelineBuilder& SetLineWidth(const float lineWidth);
+    GraphicsPipelineBuilder& SetPrimitiveAssembly(const vk::PrimitiveTopology topology);
+
+    GraphicsPipelineBuilder& AddDisabledBlendAttachment();
+    GraphicsPipelineBuilder& AddBlendAttachment(const vk::PipelineColorBlendAttachmentState& attachment);
+
+    GraphicsPipelineBuilder& AddDescriptorLayout(const vk::DescriptorSetLayout& layout);
+
+    template <typename T>
+    GraphicsPipelineBuilder& AddPushConstantRange(const vk::ShaderStageFlags stages, const uint32_t offset = 0)
+    {
+        m_PushConstantRanges.emplace_back(stages, offset, (uint32_t)sizeof(T));
+        return *this;
+    }
+
+    GraphicsPipelineBuilder& AddDynamicState(const vk::DynamicState state);
+
+    /**
+     * @param pipelineLayout - Layout created for the pipeline, destroyed by the caller along with the pipeline.
+     */
+    vk::Pipeline Build(vk::PipelineLayout& pipelineLayout);
+
+  private:
+    const PipelineCache& m_PipelineCache;
+
+    std::vector<ShaderBinary> m_Shaders;
+
+    vk::RenderPass m_RenderPass = nullptr;
+    uint32_t m_Subpass = 0;
+
+    std::vector<vk::VertexInputBindingDescription> m_VertexBindings;
+    std::vector<vk::VertexInputAttributeDescription> m_VertexAttributes;
+
+    vk::PipelineInputAssemblyStateCreateInfo m_InputAssembly;
+    vk::PipelineRasterizationStateCreateInfo m_Rasterization;
+    vk::PipelineDepthStencilStateCreateInfo m_DepthStencil;
+
+    std::vector<vk::Viewport> m_Viewports;
+    std::vector<vk::Rect2D> m_Scissors;
+
+    std::vector<vk::PipelineColorBlendAttachmentState> m_BlendAttachments;
+    std::vector<vk::DynamicState> m_DynamicStates;
+
+    std::vector<vk::DescriptorSetLayout> m_DescriptorLayouts;
+    std::vector<vk::PushConstantRange> m_PushConstantRanges;
+};
+
+// Builds a compute pipeline and its layout through the pipeline cache.
+class ComputePipelineBuilder
+{
+  public:
+    ComputePipelineBuilder(const PipelineCache& pipelineCache);
+
+    ComputePipelineBuilder& BindShaderModule(const ShaderBinary& shader);
+
+    ComputePipelineBuilder& AddDescriptorLayout(const vk::DescriptorSetLayout& layout);
+
+    template <typename T>
+    ComputePipelineBuilder& AddPushConstantRange(const vk::ShaderStageFlags stages, const uint32_t offset = 0)
+    {
+        m_PushConstantRanges.emplace_back(stages, offset, (uint32_t)sizeof(T));
+        return *this;
+    }
+
+    /**
+     * @param pipelineLayout - Layout created for the pipeline, destroyed by the caller along with the pipeline.
+     */
+    vk::Pipeline Build(vk::PipelineLayout& pipelineLayout);
+
+  private:
+    const PipelineCache& m_PipelineCache;
+
+    ShaderBinary m_Shader;
+
+    std::vector<vk::DescriptorSetLayout> m_DescriptorLayouts;
+    std::vector<vk::PushConstantRange> m_PushConstantRanges;
+};
@@ -0,0 +1,125 @@
+#include "PipelineCache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "Log/Log.h"
+#include "Vk/Devices/DeviceManager.h"
+#include "vulkan/vulkan_core.h"
+#include "vulkan/vulkan_enums.hpp"
+#include "vulkan/vulkan_structs.hpp"
+
+// Whether the cache data was written by the driver of the physical device the application runs on.
+static bool IsCompatible(const std::vector<uint8_t>& data, const vk::PhysicalDeviceProperties& properties)
+{
+    VkPipelineCacheHeaderVersionOne header{};
+
+    if (data.size() < sizeof(header))
+    {
+        return false;
+    }
+
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    return header.headerSize >= sizeof(header) && header.headerSize <= data.size() &&
+           header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE && header.vendorID == properties.vendorID &&
+           header.deviceID == properties.deviceID &&
+           std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID.data(), VK_UUID_SIZE) == 0;
+}
+
+void PipelineCache::Initialize(const std::string& path)
+{
+    const auto loadStart = std::chrono::high_resolution_clock::now();
+
+    m_Path = path;
+    m_LoadedSize = 0;
+
+    std::vector<uint8_t> data;
+
+    if (!m_Path.empty())
+    {
+        std::ifstream file(m_Path, std::ios::binary);
+
+        if (file.is_open())
+        {
+            data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+    }
+
+    const vk::PhysicalDeviceProperties properties = (*VkCore::DeviceManager::GetPhysicalDevice()).getProperties();
+
+    if (!data.empty() && !IsCompatible(data, properties))
+    {
+        LOGF(Vulkan, Warning, "The pipeline cache %s was written by another device or driver, starting with a cold one",
+             m_Path.c_str())
+        data.clear();
+    }
+
+    vk::PipelineCacheCreateInfo createInfo{};
+    createInfo.setInitialDataSize(data.size()).setPInitialData(data.data());
+
+    TRY_CATCH_BEGIN()
+
+    m_Cache = (*VkCore::DeviceManager::GetDevice()).createPipelineCache(createInfo);
+
+    TRY_CATCH_END()
+
+    m_LoadedSize = data.size();
+    m_LoadMs =
+        std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count();
+}
+
+void PipelineCache::Save() const
+{
+    if (m_Path.empty() || !m_Cache)
+    {
+        return;
+    }
+
+    const std::vector<uint8_t> data = (*VkCore::DeviceManager::GetDevice()).getPipelineCacheData(m_Cache);
+    const std::string tempPath = m_Path + ".tmp";
+
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+
+        if (!file.write((const char*)data.data(), data.size()))
+        {
+            LOGF(Vulkan, Warning, "Failed to write the pipeline cache to %s!", tempPath.c_str())
+            return;
+        }
+    }
+
+    if (std::rename(tempPath.c_str(), m_Path.c_str()) != 0)
+    {
+        LOGF(Vulkan, Warning, "Failed to replace the pipeline cache %s!", m_Path.c_str())
+        return;
+    }
+
+    LOGF(Vulkan, Info, "Saved %zu bytes of the pipeline cache to %s", data.size(), m_Path.c_str())
+}
+
+vk::Pipeline PipelineCache::CreateGraphicsPipeline(const vk::GraphicsPipelineCreateInfo& createInfo) const
+{
+    const vk::ResultValue<std::vector<vk::Pipeline>> result =
+        (*VkCore::DeviceManager::GetDevice()).createGraphicsPipelines(m_Cache, createInfo);
+
+    return result.value[0];
+}
+
+vk::Pipeline PipelineCache::CreateComputePipeline(const vk::ComputePipelineCreateInfo& createInfo) const
+{
+    const vk::ResultValue<std::vector<vk::Pipeline>> result =
+        (*VkCore::DeviceManager::GetDevice()).createComputePipelines(m_Cache, createInfo);
+
+    return result.value[0];
+}
+
+void PipelineCache::Destroy()
+{
+    (*VkCore::DeviceManager::GetDevice()).destroyPipelineCache(m_Cache);
+    m_Cache = nullptr;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "vulkan/vulkan_handles.hpp"
+#include "vulkan/vulkan_structs.hpp"
+
+/**
+ * Pipeline cache kept on disk between the runs, so that only the first launch pays for the full compilation of the
+ * pipelines by the driver.
+ *
+ * The file is the data returned by the driver, loaded only when its header matches the vendor, the device and the
+ * cache UUID of the physical device, since the driver may reject or even crash on data of another device or driver
+ * version. Otherwise the cache starts empty. On Save, the data of the loaded and of the newly created pipelines is
+ * written to a temporary file first and renamed over the old one, so an interrupted run never leaves a broken cache.
+ */
+class PipelineCache
+{
+  public:
+    PipelineCache() {};
+
+    /**
+     * @param path - File the cache is loaded from and saved to. An empty path keeps the cache in memory only.
+     */
+    void Initialize(const std::string& path);
+
+    // Writes the cache to its file.
+    void Save() const;
+
+    void Destroy();
+
+    // Create the pipeline through the cache. Vulkan synchronizes the cache internally, so any thread may call these.
+    vk::Pipeline CreateGraphicsPipeline(const vk::GraphicsPipelineCreateInfo& createInfo) const;
+    vk::Pipeline CreateComputePipeline(const vk::ComputePipelineCreateInfo& createInfo) const;
+
+    vk::PipelineCache GetVkPipelineCache() const
+    {
+        return m_Cache;
+    }
+
+    // Whether valid data of a previous run was loaded, i.e. the pipelines are created warm.
+    bool IsWarm() const
+    {
+        return m_LoadedSize > 0;
+    }
+
+    size_t GetLoadedSize() const
+    {
+        return m_LoadedSize;
+    }
+
+    float GetLoadTime() const
+    {
+        return m_LoadMs;
+    }
+
+  private:
+    std::string m_Path;
+
+    vk::PipelineCache m_Cache = nullptr;
+
+    size_t m_LoadedSize = 0;
+    float m_LoadMs = 0.f;
+};
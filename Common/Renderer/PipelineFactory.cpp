@@ -0,0 +1,96 @@
+#include "PipelineFactory.h"
+
+#include <algorithm>
+
+#include "Log/Log.h"
+
+void PipelineFactory::Initialize(const uint32_t threadCount)
+{
+    const uint32_t workerCount = threadCount > 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+
+    m_IsStopping = false;
+
+    for (uint32_t i = 0; i < workerCount; i++)
+    {
+        m_Workers.emplace_back(&PipelineFactory::Work, this);
+    }
+
+    LOGF(Application, Info, "Building the pipelines on %d threads", workerCount)
+}
+
+std::shared_future<void> PipelineFactory::Submit(std::function<void()>&& build)
+{
+    ASSERT(!m_Workers.empty(), "The pipeline factory has to be initialized before submitting to it!")
+
+    std::packaged_task<void()> task(std::move(build));
+    std::shared_future<void> future = task.get_future().share();
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        m_Queue.emplace_back(std::move(task));
+        m_Builds.emplace_back(future);
+    }
+
+    m_QueueChanged.notify_one();
+
+    return future;
+}
+
+void PipelineFactory::WaitIdle()
+{
+    std::vector<std::shared_future<void>> builds;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        builds.swap(m_Builds);
+    }
+
+    // The failed builds are reported by the get() of their users, only their completion matters here.
+    for (const std::shared_future<void>& build : builds)
+    {
+        build.wait();
+    }
+}
+
+void PipelineFactory::Destroy()
+{
+    WaitIdle();
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_IsStopping = true;
+    }
+
+    m_QueueChanged.notify_all();
+
+    for (std::thread& worker : m_Workers)
+    {
+        worker.join();
+    }
+
+    m_Workers.clear();
+}
+
+void PipelineFactory::Work()
+{
+    while (true)
+    {
+        std::packaged_task<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_QueueChanged.wait(lock, [this]() { return m_IsStopping || !m_Queue.empty(); });
+
+            if (m_Queue.empty())
+            {
+                return;
+            }
+
+            task = std::move(m_Queue.front());
+            m_Queue.pop_front();
+        }
+
+        task();
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Compiles the shaders and builds the pipelines on a pool of worker threads, so that the startup isn't bound by
+ * building them one after another on the main thread.
+ *
+ * Every build gets a future, which the frame loop waits for only right before it binds the pipeline for the first
+ * time. Rarely used debug pipelines are simply submitted once they are needed. The builds may only create the
+ * shader modules, the layouts and the pipelines, which the Vulkan device allows from any thread. Anything recorded
+ * into or submitted to a queue, e.g. the buffer uploads, has to stay on the main thread.
+ */
+class PipelineFactory
+{
+  public:
+    PipelineFactory() {};
+
+    /**
+     * @param threadCount - Worker threads, one per hardware thread if zero.
+     */
+    void Initialize(const uint32_t threadCount = 0);
+
+    /**
+     * Queues the build on the workers.
+     * @return - Future ready once the build has finished, its get() rethrows whatever the build has thrown.
+     */
+    std::shared_future<void> Submit(std::function<void()>&& build);
+
+    // Waits for all the queued builds, e.g. before destroying the pipelines.
+    void WaitIdle();
+
+    // Finishes the queued builds and joins the workers.
+    void Destroy();
+
+  private:
+    void Work();
+
+  private:
+    std::vector<std::thread> m_Workers;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_QueueChanged;
+    std::deque<std::packaged_task<void()>> m_Queue;
+    std::vector<std::shared_future<void>> m_Builds;
+    bool m_IsStopping = false;
+};
@@ -0,0 +1,697 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+
+#include "Log/Log.h"
+#include "Vk/Devices/DeviceManager.h"
+#include "vulkan/vulkan_enums.hpp"
+
+static void GetStageAccess(const EGraphStage stage, const bool isWrite, vk::PipelineStageFlags& stages,
+                           vk::AccessFlags& access)
+{
+    switch (stage)
+    {
+    case EGraphStage::Transfer:
+        stages = vk::PipelineStageFlagBits::eTransfer;
+        access = isWrite ? vk::AccessFlagBits::eTransferWrite : vk::AccessFlagBits::eTransferRead;
+        break;
+    case EGraphStage::Indirect:
+        stages = vk::PipelineStageFlagBits::eDrawIndirect;
+        access = vk::AccessFlagBits::eIndirectCommandRead;
+        break;
+    case EGraphStage::Compute:
+        stages = vk::PipelineStageFlagBits::eComputeShader;
+        access = isWrite ? vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite
+                         : vk::AccessFlagBits::eShaderRead;
+        break;
+    case EGraphStage::Vertex:
+        stages = vk::PipelineStageFlagBits::eVertexShader;
+        access = isWrite ? vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite
+                         : vk::AccessFlagBits::eShaderRead;
+        break;
+    case EGraphStage::Fragment:
+        stages = vk::PipelineStageFlagBits::eFragmentShader;
+        access = isWrite ? vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite
+                         : vk::AccessFlagBits::eShaderRead;
+        break;
+    case EGraphStage::Host:
+        stages = vk::PipelineStageFlagBits::eHost;
+        access = vk::AccessFlagBits::eHostRead;
+        break;
+    }
+}
+
+// The general layout is usable by all the accesses, so an image in it is never transitioned.
+static vk::ImageLayout GetImageLayout(const EGraphStage stage, const bool isWrite, const vk::ImageLayout current)
+{
+    if (current == vk::ImageLayout::eGeneral)
+    {
+        return current;
+    }
+
+    switch (stage)
+    {
+    case EGraphStage::Transfer:
+        return isWrite ? vk::ImageLayout::eTransferDstOptimal : vk::ImageLayout::eTransferSrcOptimal;
+    case EGraphStage::Vertex:
+    case EGraphStage::Fragment:
+        return isWrite ? vk::ImageLayout::eGeneral : vk::ImageLayout::eShaderReadOnlyOptimal;
+    default:
+        // Storage images.
+        return vk::ImageLayout::eGeneral;
+    }
+}
+
+static vk::AccessFlags GetWriteAccess(const vk::AccessFlags access)
+{
+    return access & (vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eShaderWrite);
+}
+
+static vk::DeviceSize AlignUp(const vk::DeviceSize value, const vk::DeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Read(const RenderGraphResource resource, const EGraphStage stage)
+{
+    m_Graph.AddAccess(m_Pass, resource, stage, false);
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Write(const RenderGraphResource resource, const EGraphStage stage)
+{
+    m_Graph.AddAccess(m_Pass, resource, stage, true);
+    return *this;
+}
+
+RenderGraphResource RenderGraph::ImportBuffers(const std::string& name, const std::vector<vk::Buffer>& buffers)
+{
+    ASSERT(!buffers.empty(), "No buffers imported into the render graph!")
+
+    Resource resource;
+    resource.name = name;
+    resource.buffers = buffers;
+
+    m_Resources.emplace_back(std::move(resource));
+
+    return (RenderGraphResource)m_Resources.size() - 1;
+}
+
+RenderGraphResource RenderGraph::ImportImages(const std::string& name, const std::vector<vk::Image>& images,
+                                              const vk::ImageAspectFlags aspect, const vk::ImageLayout layout)
+{
+    ASSERT(!images.empty(), "No images imported into the render graph!")
+
+    Resource resource;
+    resource.name = name;
+    resource.images = images;
+    resource.aspect = aspect;
+    resource.importedLayout = layout;
+
+    m_Resources.emplace_back(std::move(resource));
+
+    return (RenderGraphResource)m_Resources.size() - 1;
+}
+
+RenderGraphResource RenderGraph::CreateBuffer(const std::string& name, const vk::DeviceSize size,
+                                              const vk::BufferUsageFlags usage)
+{
+    Resource resource;
+    resource.name = name;
+    resource.isTransient = true;
+    resource.size = size;
+    resource.usage = usage;
+
+    m_Resources.emplace_back(std::move(resource));
+
+    return (RenderGraphResource)m_Resources.size() - 1;
+}
+
+RenderGraph::PassBuilder RenderGraph::AddPass(const std::string& name, ExecuteFunc&& execute)
+{
+    Pass pass;
+    pass.name = name;
+    pass.execute = std::move(execute);
+
+    m_Passes.emplace_back(std::move(pass));
+
+    return PassBuilder(*this, (uint32_t)m_Passes.size() - 1);
+}
+
+void RenderGraph::Export(const RenderGraphResource resource, const EGraphStage stage)
+{
+    ASSERT(!m_Resources[resource].IsImage(), "Images are returned to their imported layout instead of exported!")
+    ASSERT(!m_Resources[resource].isTransient, "Transient buffers can't be exported from the render graph!")
+
+    m_Exports.emplace_back(resource, stage);
+}
+
+void RenderGraph::AddAccess(const uint32_t pass, const RenderGraphResource resource, const EGraphStage stage,
+                            const bool isWrite)
+{
+    ASSERT(resource < m_Resources.size(), "Unknown render graph resource!")
+    ASSERT(stage != EGraphStage::Host, "Passes can't access the resources from the host!")
+
+    std::vector<Access>& accesses = m_Passes[pass].accesses;
+
+    // A read and a write of a pass are merged, so the pass doesn't wait for itself.
+    for (Access& access : accesses)
+    {
+        if (access.resource == resource && access.stage == stage)
+        {
+            access.isWrite |= isWrite;
+            return;
+        }
+    }
+
+    accesses.push_back({resource, stage, isWrite});
+}
+
+void RenderGraph::Compile(const uint32_t framesInFlight, const uint32_t queueFamilyIndex)
+{
+    AssignLevels();
+    CreateTransients(framesInFlight);
+    ComputeBarriers();
+
+    VkCore::Device& device = VkCore::DeviceManager::GetDevice();
+    const vk::PhysicalDevice physicalDevice = *VkCore::DeviceManager::GetPhysicalDevice();
+
+    m_Timings.clear();
+
+    for (const Level& level : m_Levels)
+    {
+        for (const uint32_t pass : level.passes)
+        {
+            m_Timings.push_back({m_Passes[pass].name});
+        }
+    }
+
+    m_QueriesPerFrame = (uint32_t)m_Passes.size() * 2;
+    m_HasTimestamps.assign(framesInFlight, false);
+    m_TimestampPeriod = VkCore::DeviceManager::GetPhysicalDevice().GetDeviceLimits().timestampPeriod;
+
+    if (physicalDevice.getQueueFamilyProperties()[queueFamilyIndex].timestampValidBits > 0)
+    {
+        vk::QueryPoolCreateInfo queryCreateInfo{};
+        queryCreateInfo.setQueryType(vk::QueryType::eTimestamp).setQueryCount(framesInFlight * m_QueriesPerFrame);
+
+        TRY_CATCH_BEGIN()
+
+        m_QueryPool = device.CreateQueryPool(queryCreateInfo);
+
+        TRY_CATCH_END()
+    }
+
+    // Only present with the debug utils enabled.
+    m_BeginLabel = (PFN_vkCmdBeginDebugUtilsLabelEXT)(*device).getProcAddr("vkCmdBeginDebugUtilsLabelEXT");
+    m_EndLabel = (PFN_vkCmdEndDebugUtilsLabelEXT)(*device).getProcAddr("vkCmdEndDebugUtilsLabelEXT");
+
+    LOGF(Vulkan, Info, "Render graph compiled, %d passes in %d levels, %llu of %llu bytes of transient memory",
+         (uint32_t)m_Passes.size(), (uint32_t)m_Levels.size(), (unsigned long long)m_TransientMemorySize,
+         (unsigned long long)m_TransientBufferSize)
+}
+
+bool RenderGraph::Conflicts(const Pass& first, const Pass& second) const
+{
+    for (const Access& a : first.accesses)
+    {
+        for (const Access& b : second.accesses)
+        {
+            if (a.resource != b.resource)
+            {
+                continue;
+            }
+
+            // The reads of an image from different stages may need different layouts.
+            if (a.isWrite || b.isWrite || (m_Resources[a.resource].IsImage() && a.stage != b.stage))
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void RenderGraph::AssignLevels()
+{
+    m_Levels.clear();
+
+    // The declared order is a valid one, so a pass only has to stay behind the declared passes it conflicts with.
+    for (uint32_t i = 0; i < m_Passes.size(); i++)
+    {
+        uint32_t level = 0;
+
+        for (uint32_t j = 0; j < i; j++)
+        {
+            if (Conflicts(m_Passes[j], m_Passes[i]))
+            {
+                level = std::max(level, m_Passes[j].level + 1);
+            }
+        }
+
+        m_Passes[i].level = level;
+
+        if (level >= m_Levels.size())
+        {
+            m_Levels.resize(level + 1);
+        }
+
+        m_Levels[level].passes.push_back(i);
+
+        for (const Access& access : m_Passes[i].accesses)
+        {
+            Resource& resource = m_Resources[access.resource];
+
+            resource.firstLevel = std::min(resource.firstLevel, level);
+            resource.lastLevel = std::max(resource.lastLevel, level);
+        }
+    }
+}
+
+void RenderGraph::CreateTransients(const uint32_t framesInFlight)
+{
+    const vk::Device device = *VkCore::DeviceManager::GetDevice();
+    const vk::PhysicalDevice physicalDevice = *VkCore::DeviceManager::GetPhysicalDevice();
+
+    std::vector<RenderGraphResource> transients;
+    uint32_t memoryTypeBits = UINT32_MAX;
+    vk::DeviceSize alignment = 1;
+
+    m_TransientBufferSize = 0;
+
+    TRY_CATCH_BEGIN()
+
+    for (RenderGraphResource i = 0; i < m_Resources.size(); i++)
+    {
+        Resource& resource = m_Resources[i];
+
+        if (!resource.isTransient)
+        {
+            continue;
+        }
+
+        ASSERT(resource.firstLevel != UINT32_MAX, "Transient buffer not used by any pass of the render graph!")
+
+        vk::BufferCreateInfo createInfo{};
+        createInfo.setSize(resource.size).setUsage(resource.usage).setSharingMode(vk::SharingMode::eExclusive);
+
+        for (uint32_t frame = 0; frame < framesInFlight; frame++)
+        {
+            resource.buffers.emplace_back(device.createBuffer(createInfo));
+        }
+
+        const vk::MemoryRequirements requirements = device.getBufferMemoryRequirements(resource.buffers[0]);
+
+        // The placement is shared by the frames, so every buffer uses the largest alignment.
+        resource.size = requirements.size;
+        memoryTypeBits &= requirements.memoryTypeBits;
+        alignment = std::max(alignment, requirements.alignment);
+
+        m_TransientBufferSize += requirements.size;
+        transients.push_back(i);
+    }
+
+    TRY_CATCH_END()
+
+    if (transients.empty())
+    {
+        return;
+    }
+
+    // The largest buffers are placed first, the rest fill the gaps next to the ones they don't overlap in time with.
+    std::sort(transients.begin(), transients.end(), [this](const RenderGraphResource a, const RenderGraphResource b) {
+        return m_Resources[a].size > m_Resources[b].size;
+    });
+
+    m_TransientMemorySize = 0;
+
+    for (uint32_t i = 0; i < transients.size(); i++)
+    {
+        Resource& resource = m_Resources[transients[i]];
+
+        std::vector<std::pair<vk::DeviceSize, vk::DeviceSize>> occupied;
+
+        for (uint32_t j = 0; j < i; j++)
+        {
+            const Resource& placed = m_Resources[transients[j]];
+
+            if (placed.firstLevel <= resource.lastLevel && resource.firstLevel <= placed.lastLevel)
+            {
+                occupied.emplace_back(placed.offset, placed.offset + placed.size);
+            }
+        }
+
+        std::sort(occupied.begin(), occupied.end());
+
+        vk::DeviceSize offset = 0;
+
+        for (const std::pair<vk::DeviceSize, vk::DeviceSize>& range : occupied)
+        {
+            if (AlignUp(offset, alignment) + resource.size <= range.first)
+            {
+                break;
+            }
+
+            offset = std::max(offset, range.second);
+        }
+
+        resource.offset = AlignUp(offset, alignment);
+        m_TransientMemorySize = std::max(m_TransientMemorySize, resource.offset + resource.size);
+    }
+
+    const vk::PhysicalDeviceMemoryProperties memoryProperties = physicalDevice.getMemoryProperties();
+
+    // CPU implementations like lavapipe may only expose host visible memory, so any allowed type is the fallback.
+    uint32_t memoryType = UINT32_MAX;
+
+    for (const vk::MemoryPropertyFlags flags :
+         {vk::MemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal), vk::MemoryPropertyFlags()})
+    {
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount && memoryType == UINT32_MAX; i++)
+        {
+            if ((memoryTypeBits & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & flags) == flags)
+            {
+                memoryType = i;
+            }
+        }
+    }
+
+    ASSERT(memoryType != UINT32_MAX, "No memory type found for the transient buffers of the render graph!")
+
+    vk::MemoryAllocateInfo allocateInfo{};
+    allocateInfo.setAllocationSize(m_TransientMemorySize).setMemoryTypeIndex(memoryType);
+
+    TRY_CATCH_BEGIN()
+
+    for (uint32_t frame = 0; frame < framesInFlight; frame++)
+    {
+        m_TransientMemory.emplace_back(device.allocateMemory(allocateInfo));
+
+        for (const RenderGraphResource transient : transients)
+        {
+            const Resource& resource = m_Resources[transient];
+            device.bindBufferMemory(resource.buffers[frame], m_TransientMemory[frame], resource.offset);
+        }
+    }
+
+    TRY_CATCH_END()
+}
+
+void RenderGraph::ComputeBarriers()
+{
+    std::vector<ResourceState> states(m_Resources.size());
+
+    for (RenderGraphResource i = 0; i < m_Resources.size(); i++)
+    {
+        states[i].layout = m_Resources[i].importedLayout;
+    }
+
+    for (uint32_t levelIndex = 0; levelIndex < m_Levels.size(); levelIndex++)
+    {
+        Level& level = m_Levels[levelIndex];
+
+        for (const uint32_t pass : level.passes)
+        {
+            for (const Access& access : m_Passes[pass].accesses)
+            {
+                const Resource& resource = m_Resources[access.resource];
+                ResourceState& state = states[access.resource];
+
+                // The memory of the buffer was used by the transients before it, so the first write waits for them.
+                if (resource.isTransient && resource.firstLevel == levelIndex)
+                {
+                    ASSERT(access.isWrite, "The first access of a transient buffer has to write it!")
+
+                    for (RenderGraphResource j = 0; j < m_Resources.size(); j++)
+                    {
+                        const Resource& other = m_Resources[j];
+
+                        if (other.isTransient && other.lastLevel < levelIndex &&
+                            other.offset < resource.offset + resource.size &&
+                            resource.offset < other.offset + other.size)
+                        {
+                            state.writeStages |= states[j].writeStages;
+                            state.writeAccess |= states[j].writeAccess;
+                            state.readStages |= states[j].readStages;
+                        }
+                    }
+                }
+
+                Synchronize(access.resource, state, access.stage, access.isWrite, level.barrier);
+            }
+        }
+    }
+
+    m_ExportBarrier = BarrierBatch();
+
+    for (const std::pair<RenderGraphResource, EGraphStage>& exported : m_Exports)
+    {
+        Synchronize(exported.first, states[exported.first], exported.second, false, m_ExportBarrier);
+    }
+
+    // The frame's semaphores make the accesses visible to the next users, only the layout has to be restored.
+    for (RenderGraphResource i = 0; i < m_Resources.size(); i++)
+    {
+        const ResourceState& state = states[i];
+
+        if (m_Resources[i].IsImage() && state.layout != m_Resources[i].importedLayout)
+        {
+            m_ExportBarrier.transitions.push_back(
+                {i, state.layout, m_Resources[i].importedLayout, state.writeAccess, vk::AccessFlags()});
+            m_ExportBarrier.srcStages |= state.writeStages | state.readStages;
+            m_ExportBarrier.dstStages |= vk::PipelineStageFlagBits::eBottomOfPipe;
+        }
+    }
+}
+
+void RenderGraph::Synchronize(const RenderGraphResource resource, ResourceState& state, const EGraphStage stage,
+                              const bool isWrite, BarrierBatch& batch) const
+{
+    vk::PipelineStageFlags stages;
+    vk::AccessFlags access;
+    GetStageAccess(stage, isWrite, stages, access);
+
+    if (m_Resources[resource].IsImage())
+    {
+        const vk::ImageLayout layout = GetImageLayout(stage, isWrite, state.layout);
+
+        // The transition is a write of its own, made visible to the access by the barrier.
+        if (layout != state.layout)
+        {
+            batch.transitions.push_back({resource, state.layout, layout, state.writeAccess, access});
+            batch.srcStages |= state.writeStages | state.readStages;
+            batch.dstStages |= stages;
+
+            state.writeStages = isWrite ? stages : vk::PipelineStageFlags();
+            state.writeAccess = GetWriteAccess(access);
+            state.visibleStages = isWrite ? vk::PipelineStageFlags() : stages;
+            state.visibleAccess = isWrite ? vk::AccessFlags() : access;
+            state.readStages = isWrite ? vk::PipelineStageFlags() : stages;
+            state.layout = layout;
+
+            return;
+        }
+    }
+
+    if (isWrite)
+    {
+        // The previous write has to be finished and visible, the reads since then only finished.
+        if (state.writeStages)
+        {
+            batch.srcStages |= state.writeStages;
+            batch.srcAccess |= state.writeAccess;
+            batch.dstStages |= stages;
+            batch.dstAccess |= access;
+        }
+
+        if (state.readStages)
+        {
+            batch.srcStages |= state.readStages;
+            batch.dstStages |= stages;
+        }
+
+        state.writeStages = stages;
+        state.writeAccess = GetWriteAccess(access);
+        state.visibleStages = vk::PipelineStageFlags();
+        state.visibleAccess = vk::AccessFlags();
+        state.readStages = vk::PipelineStageFlags();
+
+        return;
+    }
+
+    // Only the first read from a stage waits for the write, the ones after it can see it already.
+    if (state.writeStages && ((state.visibleStages & stages) != stages || (state.visibleAccess & access) != access))
+    {
+        batch.srcStages |= state.writeStages;
+        batch.srcAccess |= state.writeAccess;
+        batch.dstStages |= stages;
+        batch.dstAccess |= access;
+
+        state.visibleStages |= stages;
+        state.visibleAccess |= access;
+    }
+
+    state.readStages |= stages;
+}
+
+void RenderGraph::Execute(const vk::CommandBuffer& cmdBuffer, const uint32_t frameIndex)
+{
+    uint32_t query = frameIndex * m_QueriesPerFrame;
+
+    if (m_QueryPool)
+    {
+        cmdBuffer.resetQueryPool(m_QueryPool, query, m_QueriesPerFrame);
+    }
+
+    for (const Level& level : m_Levels)
+    {
+        RecordBarrier(cmdBuffer, level.barrier, frameIndex);
+
+        for (const uint32_t passIndex : level.passes)
+        {
+            const Pass& pass = m_Passes[passIndex];
+
+            if (m_BeginLabel)
+            {
+                VkDebugUtilsLabelEXT label{VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT};
+                label.pLabelName = pass.name.c_str();
+
+                m_BeginLabel(static_cast<VkCommandBuffer>(cmdBuffer), &label);
+            }
+
+            if (m_QueryPool)
+            {
+                cmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, m_QueryPool, query++);
+            }
+
+            pass.execute(cmdBuffer, frameIndex);
+
+            if (m_QueryPool)
+            {
+                cmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, m_QueryPool, query++);
+            }
+
+            if (m_EndLabel)
+            {
+                m_EndLabel(static_cast<VkCommandBuffer>(cmdBuffer));
+            }
+        }
+    }
+
+    RecordBarrier(cmdBuffer, m_ExportBarrier, frameIndex);
+
+    m_HasTimestamps[frameIndex] = m_QueryPool != nullptr;
+}
+
+void RenderGraph::RecordBarrier(const vk::CommandBuffer& cmdBuffer, const BarrierBatch& batch,
+                                const uint32_t frameIndex) const
+{
+    if (batch.IsEmpty())
+    {
+        return;
+    }
+
+    std::vector<vk::ImageMemoryBarrier> imageBarriers;
+
+    for (const ImageTransition& transition : batch.transitions)
+    {
+        const Resource& resource = m_Resources[transition.resource];
+        const vk::Image image = resource.images[resource.images.size() == 1 ? 0 : frameIndex];
+
+        vk::ImageMemoryBarrier barrier{};
+        barrier.setSrcAccessMask(transition.srcAccess)
+            .setDstAccessMask(transition.dstAccess)
+            .setOldLayout(transition.oldLayout)
+            .setNewLayout(transition.newLayout)
+            .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+            .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+            .setImage(image)
+            .setSubresourceRange({resource.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS});
+
+        imageBarriers.push_back(barrier);
+    }
+
+    vk::MemoryBarrier memoryBarrier{};
+    memoryBarrier.setSrcAccessMask(batch.srcAccess).setDstAccessMask(batch.dstAccess);
+
+    // Transitions of the images not accessed before have nothing to wait for.
+    const vk::PipelineStageFlags srcStages = batch.srcStages ? batch.srcStages : vk::PipelineStageFlagBits::eTopOfPipe;
+
+    cmdBuffer.pipelineBarrier(srcStages, batch.dstStages, {}, memoryBarrier, {}, imageBarriers);
+}
+
+void RenderGraph::ReadTimings(const uint32_t frameIndex)
+{
+    if (!m_QueryPool || !m_HasTimestamps[frameIndex])
+    {
+        return;
+    }
+
+    m_HasTimestamps[frameIndex] = false;
+
+    // The frame in the slot is finished, so the wait never blocks.
+    vk::ResultValue<std::vector<uint64_t>> rv = (*VkCore::DeviceManager::GetDevice())
+                                                     .getQueryPoolResults<uint64_t>(
+                                                         m_QueryPool, frameIndex * m_QueriesPerFrame, m_QueriesPerFrame,
+                                                         m_QueriesPerFrame * sizeof(uint64_t), sizeof(uint64_t),
+                                                         vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+
+    if (rv.result != vk::Result::eSuccess)
+    {
+        LOGF(Vulkan, Error, "Failed to get the timestamps of the render graph!: %d", rv.result)
+        return;
+    }
+
+    const uint64_t graphBegin = rv.value[0];
+
+    for (uint32_t i = 0; i < m_Timings.size(); i++)
+    {
+        const uint64_t begin = std::max(rv.value[i * 2], graphBegin);
+        const uint64_t end = std::max(rv.value[i * 2 + 1], begin);
+
+        m_Timings[i].beginMs = (begin - graphBegin) * m_TimestampPeriod / 1000000.f;
+        m_Timings[i].durationMs = (end - begin) * m_TimestampPeriod / 1000000.f;
+    }
+}
+
+vk::Buffer RenderGraph::GetBuffer(const RenderGraphResource resource, const uint32_t frameIndex) const
+{
+    const std::vector<vk::Buffer>& buffers = m_Resources[resource].buffers;
+
+    ASSERT(!buffers.empty(), "Transient buffers exist only once the render graph is compiled!")
+
+    return buffers[buffers.size() == 1 ? 0 : frameIndex];
+}
+
+void RenderGraph::Destroy()
+{
+    const vk::Device device = *VkCore::DeviceManager::GetDevice();
+
+    for (const Resource& resource : m_Resources)
+    {
+        if (resource.isTransient)
+        {
+            for (const vk::Buffer& buffer : resource.buffers)
+            {
+                device.destroyBuffer(buffer);
+            }
+        }
+    }
+
+    for (const vk::DeviceMemory& memory : m_TransientMemory)
+    {
+        device.freeMemory(memory);
+    }
+
+    VkCore::DeviceManager::GetDevice().DestroyQueryPool(m_QueryPool);
+
+    m_Passes.clear();
+    m_Resources.clear();
+    m_Exports.clear();
+    m_Levels.clear();
+    m_TransientMemory.clear();
+    m_Timings.clear();
+    m_HasTimestamps.clear();
+    m_QueryPool = nullptr;
+}
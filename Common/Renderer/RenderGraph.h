@@ -0,0 +1,242 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan_core.h"
+#include "vulkan/vulkan_handles.hpp"
+#include "vulkan/vulkan_structs.hpp"
+
+// Pipeline stage a pass accesses a resource from.
+enum class EGraphStage
+{
+    Transfer,
+    Indirect,
+    Compute,
+    Vertex,
+    Fragment,
+    Host,
+};
+
+using RenderGraphResource = uint32_t;
+
+/**
+ * Records a fixed set of passes into a single command buffer, with the barriers between them derived from the reads
+ * and the writes the passes declare.
+ *
+ * Compile places every pass into the earliest level after all the passes it conflicts with, i.e. sharing a resource
+ * with at least one of them writing it. The passes of a level are independent of each other, so a declared pass may
+ * move ahead of the unrelated ones before it. Every level starts with a single barrier, covering only the stages and
+ * the accesses the level depends on, with the layout transitions of the images batched into it. The imported images
+ * keep their layout as long as it's usable by the accesses, e.g. the general one, and are returned to it at the end.
+ *
+ * The transient buffers are created by the graph and live only from their first to their last level, so the ones
+ * whose levels don't overlap share their memory. Every frame in flight has its own memory block.
+ *
+ * The graph doesn't synchronize with the work submitted before it, the frame does, e.g. by its semaphores. Every pass
+ * is wrapped in a debug label and a pair of timestamps, so it shows up by its name in the GPU profilers and in the
+ * timeline read by ReadTimings.
+ */
+class RenderGraph
+{
+  public:
+    using ExecuteFunc = std::function<void(const vk::CommandBuffer& cmdBuffer, const uint32_t frameIndex)>;
+
+    struct PassTiming
+    {
+        std::string name;
+        // Relative to the start of the first pass.
+        float beginMs = 0.f;
+        float durationMs = 0.f;
+    };
+
+    class PassBuilder
+    {
+      public:
+        PassBuilder(RenderGraph& graph, const uint32_t pass) : m_Graph(graph), m_Pass(pass)
+        {
+        }
+
+        PassBuilder& Read(const RenderGraphResource resource, const EGraphStage stage);
+        // Covers the reads of the pass as well, e.g. the atomics.
+        PassBuilder& Write(const RenderGraphResource resource, const EGraphStage stage);
+
+      private:
+        RenderGraph& m_Graph;
+        uint32_t m_Pass = 0;
+    };
+
+    RenderGraph() {};
+
+    // One buffer per frame in flight, or a single one used by all of them.
+    RenderGraphResource ImportBuffers(const std::string& name, const std::vector<vk::Buffer>& buffers);
+
+    // The images are in the layout at the start of the graph and are returned to it at the end.
+    RenderGraphResource ImportImages(const std::string& name, const std::vector<vk::Image>& images,
+                                     const vk::ImageAspectFlags aspect, const vk::ImageLayout layout);
+
+    // Buffer created by Compile, once per frame in flight. Its contents are undefined before the first write.
+    RenderGraphResource CreateBuffer(const std::string& name, const vk::DeviceSize size,
+                                     const vk::BufferUsageFlags usage);
+
+    // Passes are recorded in the declared order, unless a pass doesn't depend on the ones before it.
+    PassBuilder AddPass(const std::string& name, ExecuteFunc&& execute);
+
+    // Makes the results in the resource available to the stage after the graph, e.g. a readback to the host.
+    void Export(const RenderGraphResource resource, const EGraphStage stage);
+
+    /**
+     * Orders the passes, computes their barriers and allocates the transient buffers.
+     * @param queueFamilyIndex - Family of the queue the graph is submitted to, the timestamps need its support.
+     */
+    void Compile(const uint32_t framesInFlight, const uint32_t queueFamilyIndex);
+
+    void Execute(const vk::CommandBuffer& cmdBuffer, const uint32_t frameIndex);
+
+    // Reads the pass timings of the frame in the slot, has to be called once the frame is finished.
+    void ReadTimings(const uint32_t frameIndex);
+
+    void Destroy();
+
+    vk::Buffer GetBuffer(const RenderGraphResource resource, const uint32_t frameIndex) const;
+
+    // In the order the passes are recorded in.
+    const std::vector<PassTiming>& GetTimings() const
+    {
+        return m_Timings;
+    }
+
+    // Memory of the transient buffers of a single frame, with and without the aliasing.
+    vk::DeviceSize GetTransientMemorySize() const
+    {
+        return m_TransientMemorySize;
+    }
+
+    vk::DeviceSize GetTransientBufferSize() const
+    {
+        return m_TransientBufferSize;
+    }
+
+  private:
+    struct Access
+    {
+        RenderGraphResource resource = 0;
+        EGraphStage stage = EGraphStage::Compute;
+        bool isWrite = false;
+    };
+
+    struct Pass
+    {
+        std::string name;
+        ExecuteFunc execute;
+        std::vector<Access> accesses;
+        uint32_t level = 0;
+    };
+
+    struct Resource
+    {
+        std::string name;
+
+        std::vector<vk::Buffer> buffers;
+        std::vector<vk::Image> images;
+        vk::ImageAspectFlags aspect;
+        vk::ImageLayout importedLayout = vk::ImageLayout::eUndefined;
+
+        // Transient buffers only.
+        bool isTransient = false;
+        vk::DeviceSize size = 0;
+        vk::BufferUsageFlags usage;
+        vk::DeviceSize offset = 0;
+        uint32_t firstLevel = UINT32_MAX;
+        uint32_t lastLevel = 0;
+
+        bool IsImage() const
+        {
+            return !images.empty();
+        }
+    };
+
+    // Synchronization state of a resource while the barriers are computed.
+    struct ResourceState
+    {
+        vk::PipelineStageFlags writeStages;
+        vk::AccessFlags writeAccess;
+        // Stages and accesses the last write is visible to already.
+        vk::PipelineStageFlags visibleStages;
+        vk::AccessFlags visibleAccess;
+        // Stages reading the resource since the last write, the next write has to wait for them.
+        vk::PipelineStageFlags readStages;
+        vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+    };
+
+    struct ImageTransition
+    {
+        RenderGraphResource resource = 0;
+        vk::ImageLayout oldLayout = vk::ImageLayout::eUndefined;
+        vk::ImageLayout newLayout = vk::ImageLayout::eUndefined;
+        vk::AccessFlags srcAccess;
+        vk::AccessFlags dstAccess;
+    };
+
+    struct BarrierBatch
+    {
+        vk::PipelineStageFlags srcStages;
+        vk::PipelineStageFlags dstStages;
+        vk::AccessFlags srcAccess;
+        vk::AccessFlags dstAccess;
+        std::vector<ImageTransition> transitions;
+
+        bool IsEmpty() const
+        {
+            return !srcStages && transitions.empty();
+        }
+    };
+
+    struct Level
+    {
+        BarrierBatch barrier;
+        std::vector<uint32_t> passes;
+    };
+
+    void AddAccess(const uint32_t pass, const RenderGraphResource resource, const EGraphStage stage,
+                   const bool isWrite);
+
+    // Places every pass into the level after the last of the passes it conflicts with.
+    void AssignLevels();
+    // Creates the transient buffers, places them into the memory and binds them to it.
+    void CreateTransients(const uint32_t framesInFlight);
+    void ComputeBarriers();
+
+    bool Conflicts(const Pass& first, const Pass& second) const;
+
+    // Adds the dependency of the access on the state of the resource to the batch and updates the state.
+    void Synchronize(const RenderGraphResource resource, ResourceState& state, const EGraphStage stage,
+                     const bool isWrite, BarrierBatch& batch) const;
+
+    void RecordBarrier(const vk::CommandBuffer& cmdBuffer, const BarrierBatch& batch, const uint32_t frameIndex) const;
+
+  private:
+    std::vector<Pass> m_Passes;
+    std::vector<Resource> m_Resources;
+    std::vector<std::pair<RenderGraphResource, EGraphStage>> m_Exports;
+
+    std::vector<Level> m_Levels;
+    BarrierBatch m_ExportBarrier;
+
+    // One block per frame in flight, shared by the transient buffers of the frame.
+    std::vector<vk::DeviceMemory> m_TransientMemory;
+    vk::DeviceSize m_TransientMemorySize = 0;
+    vk::DeviceSize m_TransientBufferSize = 0;
+
+    // Two timestamps per pass and frame in flight, in the recorded order.
+    vk::QueryPool m_QueryPool = nullptr;
+    uint32_t m_QueriesPerFrame = 0;
+    std::vector<bool> m_HasTimestamps;
+    float m_TimestampPeriod = 0.f;
+    std::vector<PassTiming> m_Timings;
+
+    PFN_vkCmdBeginDebugUtilsLabelEXT m_BeginLabel = nullptr;
+    PFN_vkCmdEndDebugUtilsLabelEXT m_EndLabel = nullptr;
+};
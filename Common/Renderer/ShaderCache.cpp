@@ -0,0 +1,319 @@
+#include "ShaderCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <regex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "Log/Log.h"
+#include "shaderc/shaderc.hpp"
+
+struct ShaderKind
+{
+    vk::ShaderStageFlagBits stage;
+    shaderc_shader_kind kind;
+};
+
+static bool ReadFile(const std::string& path, std::string& content)
+{
+    std::ifstream file(path, std::ios::binary);
+
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+static bool FileExists(const std::string& path)
+{
+    return std::ifstream(path).good();
+}
+
+static std::string GetDirectory(const std::string& path)
+{
+    const size_t separator = path.find_last_of("/\\");
+
+    return separator == std::string::npos ? "" : path.substr(0, separator + 1);
+}
+
+static std::string GetExtension(const std::string& path)
+{
+    const size_t dot = path.find_last_of('.');
+
+    return dot == std::string::npos ? "" : path.substr(dot + 1);
+}
+
+static ShaderKind GetShaderKind(const std::string& path)
+{
+    const std::string extension = GetExtension(path);
+
+    // The NV and the EXT mesh shading stages share the same flags.
+    if (extension == "vert")
+        return {vk::ShaderStageFlagBits::eVertex, shaderc_glsl_vertex_shader};
+    if (extension == "frag")
+        return {vk::ShaderStageFlagBits::eFragment, shaderc_glsl_fragment_shader};
+    if (extension == "comp")
+        return {vk::ShaderStageFlagBits::eCompute, shaderc_glsl_compute_shader};
+    if (extension == "task")
+        return {vk::ShaderStageFlagBits::eTaskEXT, shaderc_glsl_task_shader};
+    if (extension == "mesh")
+        return {vk::ShaderStageFlagBits::eMeshEXT, shaderc_glsl_mesh_shader};
+    if (extension == "tesc")
+        return {vk::ShaderStageFlagBits::eTessellationControl, shaderc_glsl_tess_control_shader};
+    if (extension == "tese")
+        return {vk::ShaderStageFlagBits::eTessellationEvaluation, shaderc_glsl_tess_evaluation_shader};
+    if (extension == "geom")
+        return {vk::ShaderStageFlagBits::eGeometry, shaderc_glsl_geometry_shader};
+
+    LOGF(Application, Fatal, "Unknown shader stage of %s!", path.c_str())
+    throw std::runtime_error("Unknown shader stage!");
+}
+
+// Only the EXT mesh shading stages are told which extension they are compiled for, the NV variants have their own
+// files.
+static std::vector<std::string> GetShaderDefines(const std::string& path)
+{
+    const std::string extension = GetExtension(path);
+    const bool isMeshShading = extension == "mesh" || extension == "task";
+
+    if (isMeshShading && path.find(".nv.") == std::string::npos)
+    {
+        return {"VK_MESH_EXT"};
+    }
+
+    return {};
+}
+
+// Reads the source along with every file it includes, so that editing an include invalidates the shader as well.
+// Mirrors read_sources of CompileShaders.lua, the keys have to match.
+static std::string ReadSources(const std::string& path, std::set<std::string>& visited)
+{
+    if (!visited.insert(path).second)
+    {
+        return "";
+    }
+
+    std::string source;
+
+    if (!ReadFile(path, source))
+    {
+        LOGF(Application, Fatal, "Failed to read the shader %s!", path.c_str())
+        throw std::runtime_error("Failed to read the shader!");
+    }
+
+    static const std::regex includePattern("#include\\s*\"([^\"]+)\"");
+
+    std::string sources = source;
+
+    for (std::sregex_iterator it(source.begin(), source.end(), includePattern), end; it != end; ++it)
+    {
+        sources += ReadSources(GetDirectory(path) + (*it)[1].str(), visited);
+    }
+
+    return sources;
+}
+
+// FNV-1a, simple enough to be computed by the premake action as well.
+static std::string HashKey(const std::string& text)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    for (const char c : text)
+    {
+        hash = (hash ^ (uint8_t)c) * 0x100000001b3ull;
+    }
+
+    char key[17];
+    std::snprintf(key, sizeof(key), "%016llx", (unsigned long long)hash);
+
+    return key;
+}
+
+// Resolves the includes relative to the file including them.
+class ShaderIncluder : public shaderc::CompileOptions::IncluderInterface
+{
+  public:
+    shaderc_include_result* GetInclude(const char* requestedSource, shaderc_include_type type,
+                                       const char* requestingSource, size_t includeDepth) override
+    {
+        Include* include = new Include();
+        include->path = GetDirectory(requestingSource) + requestedSource;
+
+        // An empty source name tells shaderc that the content is the error message.
+        if (!ReadFile(include->path, include->content))
+        {
+            include->content = "Failed to read the include " + include->path;
+            include->path.clear();
+        }
+
+        include->result.source_name = include->path.c_str();
+        include->result.source_name_length = include->path.size();
+        include->result.content = include->content.c_str();
+        include->result.content_length = include->content.size();
+        include->result.user_data = include;
+
+        return &include->result;
+    }
+
+    void ReleaseInclude(shaderc_include_result* result) override
+    {
+        delete static_cast<Include*>(result->user_data);
+    }
+
+  private:
+    struct Include
+    {
+        std::string path;
+        std::string content;
+        shaderc_include_result result;
+    };
+};
+
+static std::vector<uint32_t> Compile(const std::string& path, const ShaderKind& kind,
+                                     const std::vector<std::string>& defines)
+{
+    std::string source;
+
+    if (!ReadFile(path, source))
+    {
+        LOGF(Application, Fatal, "Failed to read the shader %s!", path.c_str())
+        throw std::runtime_error("Failed to read the shader!");
+    }
+
+    shaderc::CompileOptions options;
+    options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_3);
+    options.SetIncluder(std::make_unique<ShaderIncluder>());
+
+    for (const std::string& define : defines)
+    {
+        options.AddMacroDefinition(define);
+    }
+
+    const shaderc::Compiler compiler;
+    const shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(source, kind.kind, path.c_str(), options);
+
+    if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+    {
+        LOGF(Application, Fatal, "Failed to compile the shader %s!:\n%s", path.c_str(),
+             result.GetErrorMessage().c_str())
+        throw std::runtime_error("Failed to compile the shader!");
+    }
+
+    return std::vector<uint32_t>(result.cbegin(), result.cend());
+}
+
+// Writes through a temporary file, so that an interrupted run or another thread never leaves a broken blob behind.
+static bool WriteFile(const std::string& path, const void* data, const size_t size)
+{
+    std::ostringstream tempPath;
+    tempPath << path << "." << std::hash<std::thread::id>{}(std::this_thread::get_id()) << ".tmp";
+
+    {
+        std::ofstream file(tempPath.str(), std::ios::binary | std::ios::trunc);
+
+        if (!file.write((const char*)data, size))
+        {
+            return false;
+        }
+    }
+
+    return std::rename(tempPath.str().c_str(), path.c_str()) == 0;
+}
+
+ShaderBinary LoadShader(const std::string& path)
+{
+    ShaderBinary shader;
+    shader.path = path;
+
+    const ShaderKind kind = GetShaderKind(path);
+    const std::vector<std::string> defines = GetShaderDefines(path);
+
+    shader.stage = kind.stage;
+
+    std::set<std::string> visited;
+    std::string keyText = ReadSources(path, visited);
+
+    for (const std::string& define : defines)
+    {
+        keyText += "-D" + define + " ";
+    }
+
+    const std::string key = HashKey(keyText);
+    const std::string blobPath = path + ".spv";
+
+    std::string blobKey, blob;
+
+    if (ReadFile(blobPath + ".key", blobKey) && blobKey == key && ReadFile(blobPath, blob) && !blob.empty() &&
+        blob.size() % sizeof(uint32_t) == 0)
+    {
+        shader.code.resize(blob.size() / sizeof(uint32_t));
+        std::memcpy(shader.code.data(), blob.data(), blob.size());
+        return shader;
+    }
+
+    shader.code = Compile(path, kind, defines);
+
+    // The key goes last, a blob without its key is compiled again.
+    std::remove((blobPath + ".key").c_str());
+
+    if (!WriteFile(blobPath, shader.code.data(), shader.code.size() * sizeof(uint32_t)) ||
+        !WriteFile(blobPath + ".key", key.data(), key.size()))
+    {
+        LOGF(Application, Warning, "Failed to write the SPIR-V blob %s, it will be compiled again", blobPath.c_str())
+    }
+
+    return shader;
+}
+
+static std::string GetShaderName(std::string dir)
+{
+    while (!dir.empty() && (dir.back() == '/' || dir.back() == '\\'))
+    {
+        dir.pop_back();
+    }
+
+    const size_t separator = dir.find_last_of("/\\");
+
+    return dir + "/" + (separator == std::string::npos ? dir : dir.substr(separator + 1));
+}
+
+std::vector<ShaderBinary> LoadMeshShaders(const std::string& dir)
+{
+    const std::string name = GetShaderName(dir);
+
+#ifdef VK_MESH_EXT
+    const std::string variant = "";
+#else
+    // The shaders written for the EXT extension only have no NV variant.
+    const std::string variant = FileExists(name + ".nv.mesh") ? ".nv" : "";
+#endif
+
+    std::vector<ShaderBinary> shaders;
+
+    if (FileExists(name + variant + ".task"))
+    {
+        shaders.emplace_back(LoadShader(name + variant + ".task"));
+    }
+
+    shaders.emplace_back(LoadShader(name + variant + ".mesh"));
+    shaders.emplace_back(LoadShader(name + ".frag"));
+
+    return shaders;
+}
+
+std::vector<ShaderBinary> LoadClassicShaders(const std::string& dir)
+{
+    const std::string name = GetShaderName(dir);
+
+    return {LoadShader(name + ".vert"), LoadShader(name + ".frag")};
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan_enums.hpp"
+
+// SPIR-V of a single shader stage.
+struct ShaderBinary
+{
+    vk::ShaderStageFlagBits stage = vk::ShaderStageFlagBits::eVertex;
+    std::string path;
+    std::vector<uint32_t> code;
+};
+
+/**
+ * Loads a GLSL shader as SPIR-V, e.g. lod.mesh from the blob lod.mesh.spv next to it.
+ *
+ * The blob is keyed by a hash of the source, the sources it includes and the defines, kept in <blob>.key. It's only
+ * read when the key matches, otherwise the source is compiled by shaderc and the blob is written for the next run.
+ * The compile-shaders action of premake precompiles the blobs with the same keys.
+ *
+ * The EXT mesh and task shaders are compiled with VK_MESH_EXT defined, their NV variants (*.nv.mesh, *.nv.task) and
+ * the other stages without it.
+ */
+ShaderBinary LoadShader(const std::string& path);
+
+/**
+ * Loads <dir>/<name>.task, <name>.mesh and <name>.frag, where name is the last directory of the path. The NV
+ * variants are loaded instead when the demo is built without VK_MESH_EXT and the shader has them. The task shader is
+ * optional.
+ */
+std::vector<ShaderBinary> LoadMeshShaders(const std::string& dir);
+
+// Loads <dir>/<name>.vert and <name>.frag, where name is the last directory of the path.
+std::vector<ShaderBinary> LoadClassicShaders(const std::string& dir);
@@ -0,0 +1,506 @@
+#include "StagingUploader.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Log/Log.h"
+#include "Vk/Devices/DeviceManager.h"
+#include "vulkan/vulkan_enums.hpp"
+
+// Submissions in flight at once, a flush waits for the oldest one beyond that.
+static const uint32_t BATCH_COUNT = 8;
+
+// Keeps the copies in the ring aligned for the memcpy.
+static const vk::DeviceSize RING_ALIGNMENT = 16;
+
+static vk::DeviceSize AlignUp(const vk::DeviceSize value, const vk::DeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Ownership transfers of the whole buffers in between the two families.
+static std::vector<vk::BufferMemoryBarrier> CreateHandoverBarriers(const std::vector<vk::Buffer>& buffers,
+                                                                   const uint32_t srcFamily, const uint32_t dstFamily,
+                                                                   const vk::AccessFlags srcAccess,
+                                                                   const vk::AccessFlags dstAccess)
+{
+    std::vector<vk::BufferMemoryBarrier> barriers;
+
+    for (const vk::Buffer& buffer : buffers)
+    {
+        barriers.emplace_back(srcAccess, dstAccess, srcFamily, dstFamily, buffer, 0, VK_WHOLE_SIZE);
+    }
+
+    return barriers;
+}
+
+// Records a command buffer holding a single barrier.
+static void RecordBarrier(const vk::CommandBuffer& cmdBuffer, const vk::PipelineStageFlags srcStage,
+                          const vk::PipelineStageFlags dstStage, const std::vector<vk::BufferMemoryBarrier>& barriers)
+{
+    cmdBuffer.reset();
+    cmdBuffer.begin(vk::CommandBufferBeginInfo{vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    cmdBuffer.pipelineBarrier(srcStage, dstStage, {}, {}, barriers, {});
+    cmdBuffer.end();
+}
+
+void StagingUploader::Initialize(const uint32_t queueFamilyIndex, const vk::Queue& queue,
+                                 const uint32_t graphicsFamilyIndex, const vk::Queue& graphicsQueue,
+                                 const vk::DeviceSize ringSize)
+{
+    m_QueueFamilyIndex = queueFamilyIndex;
+    m_Queue = queue;
+    m_GraphicsFamilyIndex = graphicsFamilyIndex;
+    m_GraphicsQueue = graphicsQueue;
+
+    m_Ring.Initialize(AlignUp(ringSize, RING_ALIGNMENT), vk::BufferUsageFlagBits::eTransferSrc);
+
+    const vk::PhysicalDevice physicalDevice = *VkCore::DeviceManager::GetPhysicalDevice();
+
+    m_HasTimer = physicalDevice.getQueueFamilyProperties()[queueFamilyIndex].timestampValidBits > 0;
+    m_TimestampPeriod = VkCore::DeviceManager::GetPhysicalDevice().GetDeviceLimits().timestampPeriod;
+
+    VkCore::Device& device = VkCore::DeviceManager::GetDevice();
+
+    TRY_CATCH_BEGIN()
+
+    vk::SemaphoreTypeCreateInfo timelineTypeInfo{vk::SemaphoreType::eTimeline, 0};
+    vk::SemaphoreCreateInfo timelineCreateInfo{};
+    timelineCreateInfo.setPNext(&timelineTypeInfo);
+
+    m_Timeline = device.CreateSemaphore(timelineCreateInfo);
+
+    vk::CommandPoolCreateInfo createInfo{vk::CommandPoolCreateFlagBits::eResetCommandBuffer, queueFamilyIndex};
+
+    m_CommandPool = device.CreateCommandPool(createInfo);
+
+    vk::CommandBufferAllocateInfo allocateInfo{};
+    allocateInfo.setLevel(vk::CommandBufferLevel::ePrimary)
+        .setCommandPool(m_CommandPool)
+        .setCommandBufferCount(BATCH_COUNT);
+
+    for (const vk::CommandBuffer& cmdBuffer : device.AllocateCommandBuffers(allocateInfo))
+    {
+        m_Batches.push_back({cmdBuffer});
+    }
+
+    if (IsDedicated())
+    {
+        m_HandoverTimeline = device.CreateSemaphore(timelineCreateInfo);
+
+        vk::CommandPoolCreateInfo graphicsCreateInfo{vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+                                                     graphicsFamilyIndex};
+
+        m_GraphicsCommandPool = device.CreateCommandPool(graphicsCreateInfo);
+
+        const std::vector<vk::CommandBuffer> acquireCmdBuffers = device.AllocateCommandBuffers(allocateInfo);
+
+        allocateInfo.setCommandPool(m_GraphicsCommandPool).setCommandBufferCount(BATCH_COUNT * 2);
+        const std::vector<vk::CommandBuffer> graphicsCmdBuffers = device.AllocateCommandBuffers(allocateInfo);
+
+        for (uint32_t i = 0; i < BATCH_COUNT; i++)
+        {
+            m_Batches[i].acquireCmdBuffer = acquireCmdBuffers[i];
+            m_Batches[i].graphicsReleaseCmdBuffer = graphicsCmdBuffers[i * 2];
+            m_Batches[i].graphicsAcquireCmdBuffer = graphicsCmdBuffers[i * 2 + 1];
+        }
+    }
+
+    if (m_HasTimer)
+    {
+        vk::QueryPoolCreateInfo queryCreateInfo{};
+        queryCreateInfo.setQueryType(vk::QueryType::eTimestamp).setQueryCount(BATCH_COUNT * 2);
+
+        m_QueryPool = device.CreateQueryPool(queryCreateInfo);
+    }
+
+    TRY_CATCH_END()
+}
+
+void StagingUploader::Upload(const vk::Buffer& dstBuffer, const void* data, const vk::DeviceSize size,
+                             const vk::DeviceSize dstOffset)
+{
+    ASSERT(m_CommandPool, "The uploader has to be initialized before uploading with it!")
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+    for (vk::DeviceSize done = 0; done < size;)
+    {
+        const vk::DeviceSize chunk = std::min(size - done, m_Ring.GetSize());
+        const vk::DeviceSize offset = Allocate(chunk);
+
+        std::memcpy(static_cast<uint8_t*>(m_Ring.GetData()) + offset, bytes + done, chunk);
+
+        // The allocation may have flushed the batch recorded so far.
+        BeginBatch();
+
+        Batch& batch = m_Batches[m_CurrentBatch];
+        batch.cmdBuffer.copyBuffer(m_Ring.GetVkBuffer(), dstBuffer, vk::BufferCopy(offset, dstOffset + done, chunk));
+        batch.bytes += chunk;
+
+        AddBuffer(dstBuffer);
+
+        done += chunk;
+    }
+}
+
+void StagingUploader::Copy(const vk::Buffer& srcBuffer, const vk::Buffer& dstBuffer, const vk::BufferCopy& region)
+{
+    BeginBatch();
+
+    Batch& batch = m_Batches[m_CurrentBatch];
+    batch.cmdBuffer.copyBuffer(srcBuffer, dstBuffer, region);
+    batch.bytes += region.size;
+
+    AddBuffer(srcBuffer);
+    AddBuffer(dstBuffer);
+}
+
+uint64_t StagingUploader::Flush()
+{
+    if (m_CurrentBatch < 0)
+    {
+        return m_NextValue - 1;
+    }
+
+    Batch& batch = m_Batches[m_CurrentBatch];
+
+    if (batch.hasTimestamps)
+    {
+        batch.cmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, m_QueryPool, m_CurrentBatch * 2 + 1);
+    }
+
+    if (IsDedicated())
+    {
+        RecordHandover(batch);
+    }
+    else
+    {
+        // Makes the copies visible to everything submitted after them, the vertex input and the indirect reads
+        // included.
+        vk::MemoryBarrier memoryBarrier;
+        memoryBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+        memoryBarrier.dstAccessMask = vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite;
+
+        batch.cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands,
+                                        {}, memoryBarrier, {}, {});
+    }
+
+    batch.cmdBuffer.end();
+
+    Submit(batch);
+
+    batch.value = m_NextValue;
+    m_UploadedBytes += batch.bytes;
+    m_SubmitCount++;
+    m_CurrentBatch = -1;
+
+    return m_NextValue++;
+}
+
+bool StagingUploader::IsComplete(const uint64_t value) const
+{
+    return (*VkCore::DeviceManager::GetDevice()).getSemaphoreCounterValue(m_Timeline) >= value;
+}
+
+void StagingUploader::Wait(const uint64_t value) const
+{
+    if (value == 0)
+    {
+        return;
+    }
+
+    vk::SemaphoreWaitInfo waitInfo{};
+    waitInfo.setSemaphores(m_Timeline).setValues(value);
+
+    const vk::Result result = (*VkCore::DeviceManager::GetDevice()).waitSemaphores(waitInfo, UINT64_MAX);
+
+    if (result != vk::Result::eSuccess)
+    {
+        LOGF(Vulkan, Error, "Failed to wait for the upload %llu!: %d", (unsigned long long)value, result)
+    }
+}
+
+void StagingUploader::WaitIdle()
+{
+    Wait(Flush());
+    Retire();
+}
+
+void StagingUploader::LogStatistics()
+{
+    WaitIdle();
+
+    const double megabytes = m_UploadedBytes / (1024.0 * 1024.0);
+    const double gigabytesPerSecond = m_CopyMs > 0.0 ? m_UploadedBytes / (m_CopyMs * 1000000.0) : 0.0;
+
+    LOGF(Application, Info, "Uploaded %.2f MB in %d submits, %.3f ms of copies on the GPU, %.2f GB/s", megabytes,
+         m_SubmitCount, m_CopyMs, gigabytesPerSecond)
+}
+
+void StagingUploader::Destroy()
+{
+    WaitIdle();
+
+    VkCore::Device& device = VkCore::DeviceManager::GetDevice();
+
+    device.DestroyCommandPool(m_CommandPool);
+    device.DestroyCommandPool(m_GraphicsCommandPool);
+    device.DestroyQueryPool(m_QueryPool);
+    (*device).destroySemaphore(m_Timeline);
+    (*device).destroySemaphore(m_HandoverTimeline);
+
+    m_Ring.Destroy();
+
+    m_Batches.clear();
+    m_Regions.clear();
+    m_CommandPool = nullptr;
+    m_GraphicsCommandPool = nullptr;
+    m_QueryPool = nullptr;
+    m_Timeline = nullptr;
+    m_HandoverTimeline = nullptr;
+}
+
+void StagingUploader::BeginBatch()
+{
+    if (m_CurrentBatch >= 0)
+    {
+        return;
+    }
+
+    Retire();
+
+    auto freeBatch =
+        std::find_if(m_Batches.begin(), m_Batches.end(), [](const Batch& batch) { return batch.value == 0; });
+
+    // All the batches are in flight, the oldest one is waited for.
+    if (freeBatch == m_Batches.end())
+    {
+        const auto oldest = std::min_element(m_Batches.begin(), m_Batches.end(),
+                                             [](const Batch& a, const Batch& b) { return a.value < b.value; });
+        Wait(oldest->value);
+        Retire();
+
+        freeBatch = oldest;
+    }
+
+    m_CurrentBatch = (int32_t)(freeBatch - m_Batches.begin());
+
+    Batch& batch = *freeBatch;
+    batch.bytes = 0;
+    batch.hasTimestamps = m_HasTimer;
+    batch.buffers.clear();
+
+    batch.cmdBuffer.reset();
+    batch.cmdBuffer.begin(vk::CommandBufferBeginInfo{vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+
+    if (batch.hasTimestamps)
+    {
+        batch.cmdBuffer.resetQueryPool(m_QueryPool, m_CurrentBatch * 2, 2);
+        batch.cmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, m_QueryPool, m_CurrentBatch * 2);
+    }
+}
+
+void StagingUploader::AddBuffer(const vk::Buffer& buffer)
+{
+    std::vector<vk::Buffer>& buffers = m_Batches[m_CurrentBatch].buffers;
+
+    if (IsDedicated() && std::find(buffers.begin(), buffers.end(), buffer) == buffers.end())
+    {
+        buffers.push_back(buffer);
+    }
+}
+
+void StagingUploader::RecordHandover(Batch& batch)
+{
+    // The graphics queue hands the buffers over once the commands submitted to it before are done with them.
+    RecordBarrier(batch.graphicsReleaseCmdBuffer, vk::PipelineStageFlagBits::eAllCommands,
+                  vk::PipelineStageFlagBits::eBottomOfPipe,
+                  CreateHandoverBarriers(batch.buffers, m_GraphicsFamilyIndex, m_QueueFamilyIndex,
+                                         vk::AccessFlagBits::eMemoryWrite, {}));
+
+    // Submitted ahead of the copies, in the same submission.
+    RecordBarrier(batch.acquireCmdBuffer, vk::PipelineStageFlagBits::eTopOfPipe,
+                  vk::PipelineStageFlagBits::eTransfer,
+                  CreateHandoverBarriers(batch.buffers, m_GraphicsFamilyIndex, m_QueueFamilyIndex, {},
+                                         vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite));
+
+    const std::vector<vk::BufferMemoryBarrier> releaseBarriers = CreateHandoverBarriers(
+        batch.buffers, m_QueueFamilyIndex, m_GraphicsFamilyIndex, vk::AccessFlagBits::eTransferWrite, {});
+
+    batch.cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe,
+                                    {}, {}, releaseBarriers, {});
+
+    // Makes the copies visible to everything submitted to the graphics queue after them, the vertex input and the
+    // indirect reads included.
+    RecordBarrier(batch.graphicsAcquireCmdBuffer, vk::PipelineStageFlagBits::eTopOfPipe,
+                  vk::PipelineStageFlagBits::eAllCommands,
+                  CreateHandoverBarriers(batch.buffers, m_QueueFamilyIndex, m_GraphicsFamilyIndex, {},
+                                         vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite));
+}
+
+void StagingUploader::Submit(const Batch& batch)
+{
+    if (!IsDedicated())
+    {
+        vk::TimelineSemaphoreSubmitInfo timelineInfo{};
+        timelineInfo.setSignalSemaphoreValues(m_NextValue);
+
+        vk::SubmitInfo submitInfo{};
+        submitInfo.setCommandBuffers(batch.cmdBuffer).setSignalSemaphores(m_Timeline).setPNext(&timelineInfo);
+
+        TRY_CATCH_BEGIN()
+
+        m_Queue.submit(submitInfo);
+
+        TRY_CATCH_END()
+
+        return;
+    }
+
+    const uint64_t releaseValue = m_NextValue * 2 - 1;
+    const uint64_t copyValue = m_NextValue * 2;
+
+    const vk::PipelineStageFlags copyWaitStage = vk::PipelineStageFlagBits::eTransfer;
+    const vk::PipelineStageFlags acquireWaitStage = vk::PipelineStageFlagBits::eAllCommands;
+
+    const std::vector<vk::CommandBuffer> copyCmdBuffers = {batch.acquireCmdBuffer, batch.cmdBuffer};
+
+    vk::TimelineSemaphoreSubmitInfo releaseTimelineInfo{};
+    releaseTimelineInfo.setSignalSemaphoreValues(releaseValue);
+
+    vk::SubmitInfo releaseInfo{};
+    releaseInfo.setCommandBuffers(batch.graphicsReleaseCmdBuffer)
+        .setSignalSemaphores(m_HandoverTimeline)
+        .setPNext(&releaseTimelineInfo);
+
+    vk::TimelineSemaphoreSubmitInfo copyTimelineInfo{};
+    copyTimelineInfo.setWaitSemaphoreValues(releaseValue).setSignalSemaphoreValues(copyValue);
+
+    vk::SubmitInfo copyInfo{};
+    copyInfo.setCommandBuffers(copyCmdBuffers)
+        .setWaitSemaphores(m_HandoverTimeline)
+        .setWaitDstStageMask(copyWaitStage)
+        .setSignalSemaphores(m_HandoverTimeline)
+        .setPNext(&copyTimelineInfo);
+
+    vk::TimelineSemaphoreSubmitInfo acquireTimelineInfo{};
+    acquireTimelineInfo.setWaitSemaphoreValues(copyValue).setSignalSemaphoreValues(m_NextValue);
+
+    vk::SubmitInfo acquireInfo{};
+    acquireInfo.setCommandBuffers(batch.graphicsAcquireCmdBuffer)
+        .setWaitSemaphores(m_HandoverTimeline)
+        .setWaitDstStageMask(acquireWaitStage)
+        .setSignalSemaphores(m_Timeline)
+        .setPNext(&acquireTimelineInfo);
+
+    TRY_CATCH_BEGIN()
+
+    m_GraphicsQueue.submit(releaseInfo);
+    m_Queue.submit(copyInfo);
+    m_GraphicsQueue.submit(acquireInfo);
+
+    TRY_CATCH_END()
+}
+
+vk::DeviceSize StagingUploader::Allocate(const vk::DeviceSize size)
+{
+    const vk::DeviceSize alignedSize = AlignUp(size, RING_ALIGNMENT);
+
+    Retire();
+
+    vk::DeviceSize offset = 0;
+
+    while (!TryAllocate(alignedSize, offset))
+    {
+        // The ring may be full of the copies queued since the last flush, so they are submitted before the wait.
+        Flush();
+        Wait(m_Regions.front().value);
+        Retire();
+    }
+
+    return offset;
+}
+
+bool StagingUploader::TryAllocate(const vk::DeviceSize size, vk::DeviceSize& offset)
+{
+    const vk::DeviceSize ringSize = m_Ring.GetSize();
+
+    if (m_Regions.empty())
+    {
+        m_Head = 0;
+        m_Tail = 0;
+    }
+
+    // The space in use runs from the tail to the head, wrapping around the end of the ring.
+    if (m_Regions.empty() || m_Head > m_Tail)
+    {
+        if (m_Head + size <= ringSize)
+        {
+            offset = m_Head;
+        }
+        else if (size <= m_Tail)
+        {
+            offset = 0;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    else if (m_Head + size <= m_Tail)
+    {
+        offset = m_Head;
+    }
+    else
+    {
+        return false;
+    }
+
+    m_Head = offset + size;
+    m_Regions.push_back({m_Head, m_NextValue});
+
+    return true;
+}
+
+void StagingUploader::Retire()
+{
+    const uint64_t completed = (*VkCore::DeviceManager::GetDevice()).getSemaphoreCounterValue(m_Timeline);
+
+    while (!m_Regions.empty() && m_Regions.front().value <= completed)
+    {
+        m_Tail = m_Regions.front().end;
+        m_Regions.pop_front();
+    }
+
+    for (uint32_t i = 0; i < m_Batches.size(); i++)
+    {
+        if (m_Batches[i].value != 0 && m_Batches[i].value <= completed)
+        {
+            ReadTimestamps(i);
+            m_Batches[i].value = 0;
+        }
+    }
+}
+
+void StagingUploader::ReadTimestamps(const uint32_t batch)
+{
+    if (!m_Batches[batch].hasTimestamps)
+    {
+        return;
+    }
+
+    // The batch is finished, so the wait never blocks.
+    vk::ResultValue<std::vector<uint64_t>> rv =
+        (*VkCore::DeviceManager::GetDevice())
+            .getQueryPoolResults<uint64_t>(m_QueryPool, batch * 2, 2, 2 * sizeof(uint64_t), sizeof(uint64_t),
+                                           vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+
+    if (rv.result != vk::Result::eSuccess)
+    {
+        LOGF(Vulkan, Error, "Failed to get the timestamps of the upload!: %d", rv.result)
+        return;
+    }
+
+    m_CopyMs += (rv.value[1] - rv.value[0]) * m_TimestampPeriod / 1000000.0;
+}
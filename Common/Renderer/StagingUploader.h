@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "../HostBuffer.h"
+#include "vulkan/vulkan_handles.hpp"
+#include "vulkan/vulkan_structs.hpp"
+
+/**
+ * Uploads data to device local buffers through a single persistently mapped staging ring, coalescing all the copies
+ * queued in between two flushes into one submission.
+ *
+ * Upload copies the data into the ring right away, so the caller may free it as soon as the call returns. Flush
+ * submits the copies without waiting for them, the submission signals a timeline semaphore with the value Flush
+ * returns. The copies end with a barrier making them visible to all the commands submitted to the graphics queue after
+ * them, so the frames need no wait of their own. The ring space of a submission is reused once the semaphore reaches
+ * its value, an upload not fitting into the free space flushes and waits for the oldest submissions.
+ *
+ * On a transfer queue of another family than the graphics one, the buffers are exclusive to the graphics family, so
+ * every buffer copied from or to is handed over to the transfer queue and back. The graphics queue releases them
+ * before the copies, the transfer queue acquires them, copies and releases them after, and the graphics queue
+ * acquires them again before signaling the timeline semaphore.
+ *
+ * Data larger than the ring is split into several copies.
+ */
+class StagingUploader
+{
+  public:
+    StagingUploader() {};
+
+    /**
+     * @param queueFamilyIndex - Family of the queue the copies are submitted to.
+     * @param graphicsFamilyIndex - Family of the graphics queue, the buffers are handed over to it if it's another one.
+     */
+    void Initialize(const uint32_t queueFamilyIndex, const vk::Queue& queue, const uint32_t graphicsFamilyIndex,
+                    const vk::Queue& graphicsQueue, const vk::DeviceSize ringSize = 64 * 1024 * 1024);
+
+    // Queues a copy of the data to the buffer, which needs the transfer destination usage.
+    void Upload(const vk::Buffer& dstBuffer, const void* data, const vk::DeviceSize size,
+                const vk::DeviceSize dstOffset = 0);
+
+    // Queues a copy between two buffers on the GPU, e.g. for merging buffers already in device local memory.
+    void Copy(const vk::Buffer& srcBuffer, const vk::Buffer& dstBuffer, const vk::BufferCopy& region);
+
+    /**
+     * Submits the queued copies.
+     * @return - Value the timeline semaphore is signaled with once the copies are done, 0 if nothing was queued.
+     */
+    uint64_t Flush();
+
+    bool IsComplete(const uint64_t value) const;
+    void Wait(const uint64_t value) const;
+
+    // Flushes the queued copies and waits for all the submissions.
+    void WaitIdle();
+
+    // Logs the uploaded bytes, the submissions and the throughput of the copies since the start.
+    void LogStatistics();
+
+    // Whether the copies are submitted to a queue of another family than the graphics one.
+    bool IsDedicated() const
+    {
+        return m_QueueFamilyIndex != m_GraphicsFamilyIndex;
+    }
+
+    void Destroy();
+
+    vk::Semaphore GetTimeline() const
+    {
+        return m_Timeline;
+    }
+
+    uint32_t GetSubmitCount() const
+    {
+        return m_SubmitCount;
+    }
+
+  private:
+    // Command buffers of a submission, reused once its timeline value is reached.
+    struct Batch
+    {
+        vk::CommandBuffer cmdBuffer = nullptr;
+        uint64_t value = 0;
+        vk::DeviceSize bytes = 0;
+        bool hasTimestamps = false;
+
+        // Only used on a dedicated queue, the ownership transfers of the buffers copied from or to.
+        vk::CommandBuffer acquireCmdBuffer = nullptr;
+        vk::CommandBuffer graphicsReleaseCmdBuffer = nullptr;
+        vk::CommandBuffer graphicsAcquireCmdBuffer = nullptr;
+        std::vector<vk::Buffer> buffers;
+    };
+
+    // Ring space used by the copies of a submission, up to the end offset.
+    struct Region
+    {
+        vk::DeviceSize end = 0;
+        uint64_t value = 0;
+    };
+
+    // Begins recording into a free batch, if not recording already.
+    void BeginBatch();
+
+    // Remembers the buffer for the ownership transfers of the batch.
+    void AddBuffer(const vk::Buffer& buffer);
+
+    // Records the ownership transfers of the batch buffers, the copies are recorded already.
+    void RecordHandover(Batch& batch);
+
+    // Submits the batch, along with the ownership transfers on the graphics queue if the copies are on another one.
+    void Submit(const Batch& batch);
+
+    // Reserves ring space, flushing and waiting for the older submissions if there isn't enough of it.
+    vk::DeviceSize Allocate(const vk::DeviceSize size);
+    bool TryAllocate(const vk::DeviceSize size, vk::DeviceSize& offset);
+
+    // Frees the ring space of the finished submissions and reads their timestamps.
+    void Retire();
+    void ReadTimestamps(const uint32_t batch);
+
+  private:
+    uint32_t m_QueueFamilyIndex = 0;
+    vk::Queue m_Queue = nullptr;
+
+    uint32_t m_GraphicsFamilyIndex = 0;
+    vk::Queue m_GraphicsQueue = nullptr;
+
+    HostBuffer m_Ring;
+    vk::DeviceSize m_Head = 0;
+    vk::DeviceSize m_Tail = 0;
+    std::deque<Region> m_Regions;
+
+    vk::Semaphore m_Timeline = nullptr;
+    // Value the next submission signals.
+    uint64_t m_NextValue = 1;
+
+    // Orders the ownership transfers of a batch on the two queues, signaled with 2 * value - 1 by the release on the
+    // graphics queue and with 2 * value by the copies.
+    vk::Semaphore m_HandoverTimeline = nullptr;
+
+    vk::CommandPool m_CommandPool = nullptr;
+    vk::CommandPool m_GraphicsCommandPool = nullptr;
+    std::vector<Batch> m_Batches;
+    // Batch recorded into, -1 if none.
+    int32_t m_CurrentBatch = -1;
+
+    // Two timestamps per batch.
+    vk::QueryPool m_QueryPool = nullptr;
+    bool m_HasTimer = false;
+    float m_TimestampPeriod = 0.f;
+
+    vk::DeviceSize m_UploadedBytes = 0;
+    uint32_t m_SubmitCount = 0;
+    double m_CopyMs = 0.0;
+};
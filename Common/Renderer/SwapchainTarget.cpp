@@ -0,0 +1,317 @@
+#include "SwapchainTarget.h"
+
+#include <algorithm>
+
+#include "Log/Log.h"
+#include "Vk/Devices/DeviceManager.h"
+#include "vulkan/vulkan_enums.hpp"
+
+static constexpr vk::Format SWAPCHAIN_DEPTH_FORMAT = vk::Format::eD32Sfloat;
+
+static vk::SurfaceFormatKHR ChooseSurfaceFormat(const std::vector<vk::SurfaceFormatKHR>& formats)
+{
+    for (const vk::SurfaceFormatKHR& format : formats)
+    {
+        if (format.format == vk::Format::eB8G8R8A8Srgb && format.colorSpace == vk::ColorSpaceKHR::eSrgbNonlinear)
+        {
+            return format;
+        }
+    }
+
+    return formats[0];
+}
+
+static vk::PresentModeKHR ChoosePresentMode(const std::vector<vk::PresentModeKHR>& presentModes)
+{
+    // FIFO is the only one guaranteed to be supported.
+    const bool hasMailbox = std::find(presentModes.begin(), presentModes.end(), vk::PresentModeKHR::eMailbox) !=
+                            presentModes.end();
+
+    return hasMailbox ? vk::PresentModeKHR::eMailbox : vk::PresentModeKHR::eFifo;
+}
+
+void SwapchainTarget::Initialize(const vk::SurfaceKHR& surface, const uint32_t width, const uint32_t height)
+{
+    m_Surface = surface;
+
+    const vk::PhysicalDevice physicalDevice = *VkCore::DeviceManager::GetPhysicalDevice();
+
+    TRY_CATCH_BEGIN()
+
+    m_SurfaceFormat = ChooseSurfaceFormat(physicalDevice.getSurfaceFormatsKHR(m_Surface));
+    m_PresentMode = ChoosePresentMode(physicalDevice.getSurfacePresentModesKHR(m_Surface));
+
+    TRY_CATCH_END()
+
+    CreateSwapchain(width, height, nullptr);
+    CreateRenderPass();
+    CreateSizeDependent();
+}
+
+void SwapchainTarget::Recreate(const uint32_t width, const uint32_t height, FrameScheduler& scheduler)
+{
+    const vk::SwapchainKHR oldSwapchain = m_Swapchain;
+    const std::vector<vk::ImageView> oldImageViews = m_ImageViews;
+    const std::vector<vk::Framebuffer> oldFramebuffers = m_Framebuffers;
+    const DepthAttachment oldDepth = m_Depth;
+
+    CreateSwapchain(width, height, oldSwapchain);
+    CreateSizeDependent();
+
+    // The frames recorded so far may still render into the old images, or wait for their presentation.
+    scheduler.DeferDestroy([oldSwapchain, oldImageViews, oldFramebuffers, oldDepth]() {
+        vk::Device device = *VkCore::DeviceManager::GetDevice();
+
+        for (const vk::Framebuffer& framebuffer : oldFramebuffers)
+        {
+            device.destroyFramebuffer(framebuffer);
+        }
+
+        for (const vk::ImageView& view : oldImageViews)
+        {
+            device.destroyImageView(view);
+        }
+
+        DestroyDepth(oldDepth);
+        device.destroySwapchainKHR(oldSwapchain);
+    });
+
+    LOGF(Vulkan, Verbose, "Recreated the swapchain with %d images of %dx%d", GetImageCount(), m_Extent.width,
+         m_Extent.height)
+}
+
+void SwapchainTarget::CreateSwapchain(const uint32_t width, const uint32_t height,
+                                      const vk::SwapchainKHR& oldSwapchain)
+{
+    vk::Device device = *VkCore::DeviceManager::GetDevice();
+    VkCore::PhysicalDevice& physicalDevice = VkCore::DeviceManager::GetPhysicalDevice();
+
+    const vk::SurfaceCapabilitiesKHR capabilities = (*physicalDevice).getSurfaceCapabilitiesKHR(m_Surface);
+
+    // The surface either dictates the extent, or leaves it up to the swapchain within its limits.
+    if (capabilities.currentExtent.width != UINT32_MAX)
+    {
+        m_Extent = capabilities.currentExtent;
+    }
+    else
+    {
+        m_Extent.width = std::clamp(width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width);
+        m_Extent.height = std::clamp(height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height);
+    }
+
+    uint32_t imageCount = capabilities.minImageCount + 1;
+
+    if (capabilities.maxImageCount > 0)
+    {
+        imageCount = std::min(imageCount, capabilities.maxImageCount);
+    }
+
+    const uint32_t graphicsFamily = physicalDevice.GetQueueFamilyIndices().m_GraphicsFamily.value();
+    const uint32_t presentFamily = physicalDevice.GetQueueFamilyIndices().m_PresentFamily.value();
+    const uint32_t queueFamilies[] = {graphicsFamily, presentFamily};
+
+    vk::SwapchainCreateInfoKHR createInfo{};
+    createInfo.setSurface(m_Surface)
+        .setMinImageCount(imageCount)
+        .setImageFormat(m_SurfaceFormat.format)
+        .setImageColorSpace(m_SurfaceFormat.colorSpace)
+        .setImageExtent(m_Extent)
+        .setImageArrayLayers(1)
+        .setImageUsage(vk::ImageUsageFlagBits::eColorAttachment)
+        .setPreTransform(capabilities.currentTransform)
+        .setCompositeAlpha(vk::CompositeAlphaFlagBitsKHR::eOpaque)
+        .setPresentMode(m_PresentMode)
+        .setClipped(true)
+        .setOldSwapchain(oldSwapchain);
+
+    if (graphicsFamily != presentFamily)
+    {
+        createInfo.setImageSharingMode(vk::SharingMode::eConcurrent).setQueueFamilyIndices(queueFamilies);
+    }
+    else
+    {
+        createInfo.setImageSharingMode(vk::SharingMode::eExclusive);
+    }
+
+    TRY_CATCH_BEGIN()
+
+    m_Swapchain = device.createSwapchainKHR(createInfo);
+    m_Images = device.getSwapchainImagesKHR(m_Swapchain);
+
+    TRY_CATCH_END()
+
+    m_ImageViews.clear();
+
+    for (const vk::Image& image : m_Images)
+    {
+        vk::ImageViewCreateInfo viewCreateInfo{};
+        viewCreateInfo.setImage(image)
+            .setViewType(vk::ImageViewType::e2D)
+            .setFormat(m_SurfaceFormat.format)
+            .setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1));
+
+        m_ImageViews.emplace_back(device.createImageView(viewCreateInfo));
+    }
+}
+
+void SwapchainTarget::CreateRenderPass()
+{
+    vk::AttachmentDescription attachments[2] = {};
+
+    attachments[0]
+        .setFormat(m_SurfaceFormat.format)
+        .setSamples(vk::SampleCountFlagBits::e1)
+        .setLoadOp(vk::AttachmentLoadOp::eClear)
+        .setStoreOp(vk::AttachmentStoreOp::eStore)
+        .setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
+        .setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
+        .setInitialLayout(vk::ImageLayout::eUndefined)
+        .setFinalLayout(vk::ImageLayout::ePresentSrcKHR);
+
+    attachments[1]
+        .setFormat(SWAPCHAIN_DEPTH_FORMAT)
+        .setSamples(vk::SampleCountFlagBits::e1)
+        .setLoadOp(vk::AttachmentLoadOp::eClear)
+        .setStoreOp(vk::AttachmentStoreOp::eDontCare)
+        .setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
+        .setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
+        .setInitialLayout(vk::ImageLayout::eUndefined)
+        .setFinalLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal);
+
+    const vk::AttachmentReference colorReference{0, vk::ImageLayout::eColorAttachmentOptimal};
+    const vk::AttachmentReference depthReference{1, vk::ImageLayout::eDepthStencilAttachmentOptimal};
+
+    vk::SubpassDescription subpass{};
+    subpass.setPipelineBindPoint(vk::PipelineBindPoint::eGraphics)
+        .setColorAttachments(colorReference)
+        .setPDepthStencilAttachment(&depthReference);
+
+    // The image is written once the acquire semaphore lets the color output through, and the depth once the previous
+    // frame is done testing against it.
+    vk::SubpassDependency dependency{};
+    dependency.setSrcSubpass(VK_SUBPASS_EXTERNAL)
+        .setDstSubpass(0)
+        .setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput |
+                         vk::PipelineStageFlagBits::eLateFragmentTests)
+        .setDstStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput |
+                         vk::PipelineStageFlagBits::eEarlyFragmentTests)
+        .setSrcAccessMask(vk::AccessFlagBits::eDepthStencilAttachmentWrite)
+        .setDstAccessMask(vk::AccessFlagBits::eColorAttachmentWrite |
+                          vk::AccessFlagBits::eDepthStencilAttachmentWrite);
+
+    vk::RenderPassCreateInfo createInfo{};
+    createInfo.setAttachments(attachments).setSubpasses(subpass).setDependencies(dependency);
+
+    m_RenderPass = (*VkCore::DeviceManager::GetDevice()).createRenderPass(createInfo);
+}
+
+void SwapchainTarget::CreateSizeDependent()
+{
+    vk::Device device = *VkCore::DeviceManager::GetDevice();
+    vk::PhysicalDevice physicalDevice = *VkCore::DeviceManager::GetPhysicalDevice();
+
+    vk::ImageCreateInfo createInfo{};
+    createInfo.setImageType(vk::ImageType::e2D)
+        .setFormat(SWAPCHAIN_DEPTH_FORMAT)
+        .setExtent(vk::Extent3D(m_Extent.width, m_Extent.height, 1))
+        .setMipLevels(1)
+        .setArrayLayers(1)
+        .setSamples(vk::SampleCountFlagBits::e1)
+        .setTiling(vk::ImageTiling::eOptimal)
+        .setUsage(vk::ImageUsageFlagBits::eDepthStencilAttachment)
+        .setSharingMode(vk::SharingMode::eExclusive)
+        .setInitialLayout(vk::ImageLayout::eUndefined);
+
+    m_Depth.image = device.createImage(createInfo);
+
+    const vk::MemoryRequirements requirements = device.getImageMemoryRequirements(m_Depth.image);
+    const vk::PhysicalDeviceMemoryProperties memoryProperties = physicalDevice.getMemoryProperties();
+
+    uint32_t memoryType = UINT32_MAX;
+
+    for (const vk::MemoryPropertyFlags flags :
+         {vk::MemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal), vk::MemoryPropertyFlags()})
+    {
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount && memoryType == UINT32_MAX; i++)
+        {
+            if ((requirements.memoryTypeBits & (1 << i)) &&
+                (memoryProperties.memoryTypes[i].propertyFlags & flags) == flags)
+            {
+                memoryType = i;
+            }
+        }
+    }
+
+    ASSERT(memoryType != UINT32_MAX, "No memory type found for the depth image!")
+
+    vk::MemoryAllocateInfo allocateInfo{};
+    allocateInfo.setAllocationSize(requirements.size).setMemoryTypeIndex(memoryType);
+
+    m_Depth.memory = device.allocateMemory(allocateInfo);
+    device.bindImageMemory(m_Depth.image, m_Depth.memory, 0);
+
+    vk::ImageViewCreateInfo viewCreateInfo{};
+    viewCreateInfo.setImage(m_Depth.image)
+        .setViewType(vk::ImageViewType::e2D)
+        .setFormat(SWAPCHAIN_DEPTH_FORMAT)
+        .setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eDepth, 0, 1, 0, 1));
+
+    m_Depth.view = device.createImageView(viewCreateInfo);
+
+    m_Framebuffers.clear();
+
+    for (const vk::ImageView& view : m_ImageViews)
+    {
+        const vk::ImageView attachments[] = {view, m_Depth.view};
+
+        vk::FramebufferCreateInfo framebufferCreateInfo{};
+        framebufferCreateInfo.setRenderPass(m_RenderPass)
+            .setAttachments(attachments)
+            .setWidth(m_Extent.width)
+            .setHeight(m_Extent.height)
+            .setLayers(1);
+
+        m_Framebuffers.emplace_back(device.createFramebuffer(framebufferCreateInfo));
+    }
+}
+
+vk::ResultValue<uint32_t> SwapchainTarget::AcquireNextImage(const vk::Semaphore& semaphore) const
+{
+    return (*VkCore::DeviceManager::GetDevice()).acquireNextImageKHR(m_Swapchain, UINT64_MAX, semaphore, nullptr);
+}
+
+void SwapchainTarget::DestroyDepth(const DepthAttachment& depth)
+{
+    vk::Device device = *VkCore::DeviceManager::GetDevice();
+
+    device.destroyImageView(depth.view);
+    device.destroyImage(depth.image);
+    device.freeMemory(depth.memory);
+}
+
+void SwapchainTarget::Destroy()
+{
+    vk::Device device = *VkCore::DeviceManager::GetDevice();
+
+    for (const vk::Framebuffer& framebuffer : m_Framebuffers)
+    {
+        device.destroyFramebuffer(framebuffer);
+    }
+
+    for (const vk::ImageView& view : m_ImageViews)
+    {
+        device.destroyImageView(view);
+    }
+
+    DestroyDepth(m_Depth);
+
+    device.destroyRenderPass(m_RenderPass);
+    device.destroySwapchainKHR(m_Swapchain);
+
+    m_Framebuffers.clear();
+    m_ImageViews.clear();
+    m_Images.clear();
+    m_Depth = {};
+    m_RenderPass = nullptr;
+    m_Swapchain = nullptr;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "FrameScheduler.h"
+#include "vulkan/vulkan_handles.hpp"
+#include "vulkan/vulkan_structs.hpp"
+
+/**
+ * Swapchain of the window together with the render pass, the depth image and the framebuffers drawn into it.
+ *
+ * A resize replaces only what depends on the size. The new swapchain is created from the old one, so the surface is
+ * handed over without the device having to idle, and the old swapchain, its views, the framebuffers and the depth
+ * image are handed to the scheduler, which destroys them once the frames recorded against them are finished. The
+ * formats stay the same, so the render pass and all the pipelines built against it are kept, their viewport and
+ * scissor being dynamic.
+ */
+class SwapchainTarget
+{
+  public:
+    SwapchainTarget() {};
+
+    void Initialize(const vk::SurfaceKHR& surface, const uint32_t width, const uint32_t height);
+
+    // Replaces the swapchain and the resources of its size, the retired ones are destroyed through the scheduler.
+    void Recreate(const uint32_t width, const uint32_t height, FrameScheduler& scheduler);
+
+    void Destroy();
+
+    // Throws the out of date result once the swapchain no longer matches the surface.
+    vk::ResultValue<uint32_t> AcquireNextImage(const vk::Semaphore& semaphore) const;
+
+    vk::SwapchainKHR GetVkSwapchain() const
+    {
+        return m_Swapchain;
+    }
+
+    vk::RenderPass GetVkRenderPass() const
+    {
+        return m_RenderPass;
+    }
+
+    vk::Framebuffer GetFramebuffer(const uint32_t imageIndex) const
+    {
+        return m_Framebuffers[imageIndex];
+    }
+
+    const std::vector<vk::Image>& GetImages() const
+    {
+        return m_Images;
+    }
+
+    const std::vector<vk::ImageView>& GetImageViews() const
+    {
+        return m_ImageViews;
+    }
+
+    uint32_t GetImageCount() const
+    {
+        return m_Images.size();
+    }
+
+    vk::SurfaceFormatKHR GetSurfaceFormat() const
+    {
+        return m_SurfaceFormat;
+    }
+
+    vk::PresentModeKHR GetPresentMode() const
+    {
+        return m_PresentMode;
+    }
+
+    uint32_t GetWidth() const
+    {
+        return m_Extent.width;
+    }
+
+    uint32_t GetHeight() const
+    {
+        return m_Extent.height;
+    }
+
+  private:
+    struct DepthAttachment
+    {
+        vk::Image image = nullptr;
+        vk::DeviceMemory memory = nullptr;
+        vk::ImageView view = nullptr;
+    };
+
+    void CreateSwapchain(const uint32_t width, const uint32_t height, const vk::SwapchainKHR& oldSwapchain);
+    void CreateRenderPass();
+    // Depth image and framebuffers of the current size.
+    void CreateSizeDependent();
+
+    static void DestroyDepth(const DepthAttachment& depth);
+
+  private:
+    vk::SurfaceKHR m_Surface = nullptr;
+    vk::SurfaceFormatKHR m_SurfaceFormat;
+    vk::PresentModeKHR m_PresentMode = vk::PresentModeKHR::eFifo;
+    vk::Extent2D m_Extent;
+
+    vk::SwapchainKHR m_Swapchain = nullptr;
+    std::vector<vk::Image> m_Images;
+    std::vector<vk::ImageView> m_ImageViews;
+
+    vk::RenderPass m_RenderPass = nullptr;
+    // A single one, the frames in flight are ordered by the dependency of the render pass.
+    DepthAttachment m_Depth;
+    std::vector<vk::Framebuffer> m_Framebuffers;
+};
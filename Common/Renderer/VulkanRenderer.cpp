@@ -1,4 +1,5 @@
 #include "VulkanRenderer.h"
+#include "GLFW/glfw3.h"
 #include "Vk/Utils.h"
 #include "Vk/Devices/DeviceManager.h"
 #include "Vk/Services/Allocator/VmaAllocatorService.h"
@@ -10,15 +11,48 @@
 #include "vulkan/vulkan_core.h"
 #include "vulkan/vulkan_enums.hpp"
 #include "vulkan/vulkan_structs.hpp"
+#include <algorithm>
 #include <cstdint>
+#include <cstdio>
+
+// Fixed time step of the headless frames, so that the animations are the same in every run.
+static constexpr double HEADLESS_FRAME_TIME = 1.0 / 60.0;
+
+// First queue family with all the required flags and none of the excluded ones, -1 if there's none.
+static int32_t FindDedicatedFamily(const vk::QueueFlags required, const vk::QueueFlags excluded)
+{
+    const std::vector<vk::QueueFamilyProperties> families =
+        (*VkCore::DeviceManager::GetPhysicalDevice()).getQueueFamilyProperties();
+
+    for (uint32_t i = 0; i < families.size(); i++)
+    {
+        const vk::QueueFlags flags = families[i].queueFlags;
+
+        if ((flags & required) == required && !(flags & excluded))
+        {
+            return (int32_t)i;
+        }
+    }
+
+    return -1;
+}
 
 VulkanRenderer::VulkanRenderer(const std::string& title, VkCore::Window* window,
                                const std::vector<const char*>& deviceExtensions,
-                               const std::vector<const char*>& instanceExtensions)
+                               const std::vector<const char*>& instanceExtensions, const LaunchOptions& options)
+    : m_Window(window), m_LaunchOptions(options), m_IsHeadless(options.headless),
+      m_StartupBegin(std::chrono::high_resolution_clock::now())
 {
+    ASSERT(m_IsHeadless || window != nullptr, "Only the headless mode renders without a window!")
 
     for (const char* ext : deviceExtensions)
     {
+        // Nothing is presented in the headless mode, so the device doesn't need to support it.
+        if (m_IsHeadless && std::strcmp(ext, VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0)
+        {
+            continue;
+        }
+
         VkCore::DeviceManager::AddDeviceExtension(ext);
     }
 
@@ -35,9 +69,17 @@ VulkanRenderer::VulkanRenderer(const std::string& title, VkCore::Window* window,
     std::vector<const char*> reqInstanceExtensions = instanceExtensions;
     std::vector<const char*> layers;
 
-    for (const char*& ext : VkCore::Window::GetRequiredInstanceExtensions())
+    if (m_IsHeadless)
     {
-        reqInstanceExtensions.emplace_back(ext);
+        reqInstanceExtensions.emplace_back(VK_KHR_SURFACE_EXTENSION_NAME);
+        reqInstanceExtensions.emplace_back(VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME);
+    }
+    else
+    {
+        for (const char*& ext : VkCore::Window::GetRequiredInstanceExtensions())
+        {
+            reqInstanceExtensions.emplace_back(ext);
+        }
     }
 
 #ifdef DEBUG
@@ -97,11 +139,25 @@ VulkanRenderer::VulkanRenderer(const std::string& title, VkCore::Window* window,
 #endif
 
     VkSurfaceKHR surface = VK_NULL_HANDLE;
+    VkResult err = VK_SUCCESS;
 
-    VkResult err =
-        glfwCreateWindowSurface(static_cast<VkInstance>(m_Instance), window->GetGLFWWindow(), nullptr, &surface);
+    if (m_IsHeadless)
+    {
+        // The devices pick their present queue through a surface, the headless surface stands in for the window.
+        const auto createHeadlessSurface = (PFN_vkCreateHeadlessSurfaceEXT)vkGetInstanceProcAddr(
+            static_cast<VkInstance>(m_Instance), "vkCreateHeadlessSurfaceEXT");
 
-    window->RefreshResolution();
+        VkHeadlessSurfaceCreateInfoEXT surfaceCreateInfo = {};
+        surfaceCreateInfo.sType = VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT;
+
+        err = createHeadlessSurface(static_cast<VkInstance>(m_Instance), &surfaceCreateInfo, nullptr, &surface);
+    }
+    else
+    {
+        err = glfwCreateWindowSurface(static_cast<VkInstance>(m_Instance), window->GetGLFWWindow(), nullptr, &surface);
+
+        window->RefreshResolution();
+    }
 
     VkCore::Utils::CheckVkResult(err);
     m_Surface = surface;
@@ -113,78 +169,169 @@ VulkanRenderer::VulkanRenderer(const std::string& title, VkCore::Window* window,
     VkCore::VmaAllocatorService* allocationService = new VkCore::VmaAllocatorService(m_Instance);
     VkCore::ServiceLocator::ProvideAllocatorService(allocationService);
 
-    m_Swapchain = VkCore::Swapchain(m_Surface, window->GetHeight(), window->GetWidth());
-    m_RenderPass = VkCore::SwapchainRenderPass(m_Swapchain);
+    m_DeviceCreationMs =
+        std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - m_StartupBegin).count();
 
-    CreateFramebuffers(window->GetWidth(), window->GetHeight());
+    // Has to be there before the first pipeline, ImGui creates its own in InitImGui.
+    m_PipelineCache.Initialize(options.pipelineCachePath);
 
-    TRY_CATCH_BEGIN()
+    InitializeUploader();
+
+    const uint32_t graphicsFamily =
+        VkCore::DeviceManager::GetPhysicalDevice().GetQueueFamilyIndices().m_GraphicsFamily.value();
+
+    if (m_IsHeadless)
+    {
+        // Every frame in flight renders into its own offscreen images.
+        m_Offscreen.Initialize(options.width, options.height, options.framesInFlight);
+        m_Scheduler.Initialize(options.framesInFlight, graphicsFamily);
+        InitializeAsyncCompute();
+
+        LOGF(Vulkan, Info, "Rendering %d headless frames with %d frames in flight", options.frameCount,
+             m_Scheduler.GetFramesInFlight())
+        return;
+    }
+
+    m_Swapchain.Initialize(m_Surface, window->GetWidth(), window->GetHeight());
+
+    CreateRenderFinishedSemaphores();
+
+    // More frames than images in flight would just wait for the acquire instead of the timeline.
+    m_Scheduler.Initialize(std::min(options.framesInFlight, (uint32_t)m_Swapchain.GetImageCount()), graphicsFamily);
+    InitializeAsyncCompute();
+
+    LOGF(Vulkan, Info, "Rendering with %d frames in flight to %d swapchain images", m_Scheduler.GetFramesInFlight(),
+         m_Swapchain.GetImageCount())
+}
 
-    // Sync Objects
-    vk::FenceCreateInfo fenceCreateInfo{vk::FenceCreateFlagBits::eSignaled};
+void VulkanRenderer::CreateRenderFinishedSemaphores()
+{
+    TRY_CATCH_BEGIN()
 
-    vk::SemaphoreCreateInfo imageAvailableCreateInfo{};
     vk::SemaphoreCreateInfo renderFinishedCreateInfo{};
 
-    for (int i = 0; i < m_Swapchain.GetNumberOfSwapBuffers(); i++)
+    while (m_RenderFinishedSemaphores.size() < m_Swapchain.GetImageCount())
     {
-        m_ImageAvailableSemaphores.emplace_back(
-            VkCore::DeviceManager::GetDevice().CreateSemaphore(imageAvailableCreateInfo));
         m_RenderFinishedSemaphores.emplace_back(
             VkCore::DeviceManager::GetDevice().CreateSemaphore(renderFinishedCreateInfo));
-
-        m_InFlightFences.emplace_back(VkCore::DeviceManager::GetDevice().CreateFence(fenceCreateInfo));
     }
+
     TRY_CATCH_END()
+}
 
-    TRY_CATCH_BEGIN()
+void VulkanRenderer::InitializeAsyncCompute()
+{
+    const uint32_t graphicsFamily =
+        VkCore::DeviceManager::GetPhysicalDevice().GetQueueFamilyIndices().m_GraphicsFamily.value();
 
-    vk::CommandPoolCreateInfo createInfo{
-        vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
-        VkCore::DeviceManager::GetPhysicalDevice().GetQueueFamilyIndices().m_GraphicsFamily.value()};
+    // The compute-only families are usually backed by the asynchronous compute engines of the GPU.
+    const int32_t computeFamily = FindDedicatedFamily(vk::QueueFlagBits::eCompute, vk::QueueFlagBits::eGraphics);
 
-    // Command Buffers
-    m_CommandPool = VkCore::DeviceManager::GetDevice().CreateCommandPool(createInfo);
+#ifdef VK_DEDICATED_QUEUES
+    // VulkanCore creates the device with a queue of every dedicated family when built with the option.
+    if (computeFamily >= 0 && m_LaunchOptions.dedicatedCompute)
+    {
+        const vk::Queue computeQueue = (*VkCore::DeviceManager::GetDevice()).getQueue(computeFamily, 0);
 
-    vk::CommandBufferAllocateInfo allocateInfo{};
+        m_AsyncCompute.Initialize(m_Scheduler, graphicsFamily, computeFamily, computeQueue);
+        return;
+    }
 
-    allocateInfo.setLevel(vk::CommandBufferLevel::ePrimary)
-        .setCommandPool(m_CommandPool)
-        .setCommandBufferCount(m_Swapchain.GetImageViews().size());
+    const char* reason = computeFamily < 0 ? "the GPU has no dedicated compute queue family"
+                                           : "it's disabled by the application or --no-dedicated-compute";
+#else
+    const char* reason = computeFamily < 0 ? "the GPU has no dedicated compute queue family"
+                                           : "the dedicated queues aren't enabled (--with-dedicated-queues)";
+#endif
 
-    m_CommandBuffers = VkCore::DeviceManager::GetDevice().AllocateCommandBuffers(allocateInfo);
+    // The passes are still submitted on their own, ahead of the graphics buffer, so the GPU is free to run them
+    // alongside the rasterization of the previous frame.
+    LOGF(Vulkan, Warning, "The async compute falls back to the graphics queue, %s", reason)
 
-    TRY_CATCH_END()
+    m_AsyncCompute.Initialize(m_Scheduler, graphicsFamily, graphicsFamily,
+                              VkCore::DeviceManager::GetDevice().GetGraphicsQueue());
 }
 
-void VulkanRenderer::CreateFramebuffers(const uint32_t width, const uint32_t height)
+void VulkanRenderer::InitializeUploader()
 {
-    std::vector<vk::ImageView> imageViews = m_Swapchain.GetImageViews();
+    const uint32_t graphicsFamily =
+        VkCore::DeviceManager::GetPhysicalDevice().GetQueueFamilyIndices().m_GraphicsFamily.value();
 
-    for (const vk::ImageView& view : imageViews)
-    {
+    const vk::Queue graphicsQueue = VkCore::DeviceManager::GetDevice().GetGraphicsQueue();
 
-        vk::ImageView imageViews[] = {view, m_RenderPass.GetDepthImage().GetImageView()};
+    // The transfer-only families are usually backed by the copy engines of the GPU.
+    const int32_t transferFamily = FindDedicatedFamily(vk::QueueFlagBits::eTransfer,
+                                                       vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute);
 
-        vk::FramebufferCreateInfo createInfo{};
+#ifdef VK_DEDICATED_QUEUES
+    // VulkanCore creates the device with a queue of every dedicated family when built with the option.
+    if (transferFamily >= 0 && m_LaunchOptions.dedicatedTransfer)
+    {
+        const vk::Queue transferQueue = (*VkCore::DeviceManager::GetDevice()).getQueue(transferFamily, 0);
 
-        createInfo.width = width;
-        createInfo.height = height;
-        createInfo.layers = 1;
-        createInfo.renderPass = m_RenderPass.GetVkRenderPass();
-        createInfo.setAttachments(imageViews);
+        LOGF(Vulkan, Info, "Uploading on the queue family %d, graphics on %d", transferFamily, graphicsFamily)
 
-        m_FrameBuffers.emplace_back(VkCore::DeviceManager::GetDevice().CreateFrameBuffer(createInfo));
+        m_Uploader.Initialize(transferFamily, transferQueue, graphicsFamily, graphicsQueue);
+        return;
     }
+
+    const char* reason = transferFamily < 0 ? "the GPU has no dedicated transfer queue family"
+                                            : "it's disabled by --no-dedicated-transfer";
+#else
+    const char* reason = transferFamily < 0 ? "the GPU has no dedicated transfer queue family"
+                                            : "the dedicated queues aren't enabled (--with-dedicated-queues)";
+#endif
+
+    LOGF(Vulkan, Warning, "The uploads fall back to the graphics queue, %s", reason)
+
+    m_Uploader.Initialize(graphicsFamily, graphicsQueue, graphicsFamily, graphicsQueue);
 }
-void VulkanRenderer::CreateSwapchain(const uint32_t width, const uint32_t height)
+
+void VulkanRenderer::RecreateSwapchain()
 {
-    m_Swapchain = VkCore::Swapchain(m_Surface, width, height);
-    m_RenderPass = VkCore::SwapchainRenderPass(m_Swapchain);
+    m_Window->RefreshResolution();
+
+    // A minimized window has no size to create the swapchain with.
+    while (m_Window->GetWidth() == 0 || m_Window->GetHeight() == 0)
+    {
+        m_Window->WaitEvents();
+        m_Window->RefreshResolution();
+    }
+
+    m_Swapchain.Recreate(GetWidth(), GetHeight(), m_Scheduler);
+
+    // The presentations of the old images may still wait for them.
+    const std::vector<vk::Semaphore> oldSemaphores = m_RenderFinishedSemaphores;
+
+    m_Scheduler.DeferDestroy([oldSemaphores]() {
+        for (const vk::Semaphore& semaphore : oldSemaphores)
+        {
+            (*VkCore::DeviceManager::GetDevice()).destroySemaphore(semaphore);
+        }
+    });
+
+    m_RenderFinishedSemaphores.clear();
+    CreateRenderFinishedSemaphores();
+
+    // Only waits for the device if the image count has changed, ImGui rebuilds its buffers then.
+    ImGui_ImplVulkan_SetMinImageCount(m_Swapchain.GetImageCount());
+    ResizeImGui(GetWidth(), GetHeight());
 }
 
 void VulkanRenderer::InitImGui(const VkCore::Window* window, const uint32_t width, const uint32_t height)
 {
+    if (m_IsHeadless)
+    {
+        // The UI is still built every frame, but never drawn, so it doesn't end up in the captured frames.
+        IMGUI_CHECKVERSION();
+        ImGui::CreateContext();
+
+        ImGuiIO& io = ImGui::GetIO();
+        io.DisplaySize = ImVec2((float)width, (float)height);
+        io.Fonts->Build();
+        return;
+    }
+
     const VkFormat requestSurfaceImageFormat[] = {VK_FORMAT_B8G8R8A8_UNORM, VK_FORMAT_R8G8B8A8_UNORM,
                                                   VK_FORMAT_B8G8R8_UNORM, VK_FORMAT_R8G8B8_UNORM};
     const VkColorSpaceKHR requestSurfaceColorSpace = VK_COLORSPACE_SRGB_NONLINEAR_KHR;
@@ -195,37 +342,12 @@ void VulkanRenderer::InitImGui(const VkCore::Window* window, const uint32_t widt
     // ImGui_ImplVulkanH_Window data. Mainly, the function doesn't create a render pass with depth.
 
     m_MainWindowData.Surface = m_Surface;
-    m_MainWindowData.Swapchain = m_Swapchain.GetVkSwapchain();
-    m_MainWindowData.SurfaceFormat = m_Swapchain.GetVkSurfaceFormat().surfaceFormat;
+    m_MainWindowData.SurfaceFormat = static_cast<VkSurfaceFormatKHR>(m_Swapchain.GetSurfaceFormat());
     m_MainWindowData.PresentMode = static_cast<VkPresentModeKHR>(m_Swapchain.GetPresentMode());
-    m_MainWindowData.Width = width;
-    m_MainWindowData.Height = height;
-    m_MainWindowData.RenderPass = m_RenderPass.GetVkRenderPass();
-    m_MainWindowData.Frames = new ImGui_ImplVulkanH_Frame[m_FrameBuffers.size()];
-    m_MainWindowData.FrameIndex = m_CurrentFrame;
-    m_MainWindowData.SemaphoreCount = m_FrameBuffers.size();
-    m_MainWindowData.FrameSemaphores = new ImGui_ImplVulkanH_FrameSemaphores[m_FrameBuffers.size()];
-    m_MainWindowData.ImageCount = m_FrameBuffers.size();
     m_MainWindowData.UseDynamicRendering = true;
-    m_MainWindowData.SemaphoreIndex = m_CurrentFrame;
     m_MainWindowData.ClearEnable = false; // TODO: Check later. It might not be work properly.
 
-    for (int i = 0; i < m_FrameBuffers.size(); i++)
-    {
-        const ImGui_ImplVulkanH_Frame frame = {.CommandPool = m_CommandPool,
-                                               .CommandBuffer = m_CommandBuffers[i],
-                                               .Fence = m_InFlightFences[i],
-                                               .Backbuffer = m_Swapchain.GetImages()[i],
-                                               .BackbufferView = m_Swapchain.GetImageViews()[i],
-                                               .Framebuffer = m_FrameBuffers[i]};
-
-        const ImGui_ImplVulkanH_FrameSemaphores frameSemaphores = {
-            .ImageAcquiredSemaphore = m_ImageAvailableSemaphores[i],
-            .RenderCompleteSemaphore = m_RenderFinishedSemaphores[i]};
-
-        m_MainWindowData.Frames[i] = frame;
-        m_MainWindowData.FrameSemaphores[i] = frameSemaphores;
-    }
+    ResizeImGui(width, height);
 
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
@@ -265,12 +387,12 @@ void VulkanRenderer::InitImGui(const VkCore::Window* window, const uint32_t widt
     initInfo.Device = *VkCore::DeviceManager::GetDevice();
     initInfo.QueueFamily = VkCore::DeviceManager::GetPhysicalDevice().GetQueueFamilyIndices().m_GraphicsFamily.value();
     initInfo.Queue = VkCore::DeviceManager::GetDevice().GetGraphicsQueue();
-    initInfo.PipelineCache = nullptr;
+    initInfo.PipelineCache = m_PipelineCache.GetVkPipelineCache();
     initInfo.DescriptorPool = m_ImGuiDescPool;
     initInfo.RenderPass = m_MainWindowData.RenderPass;
     initInfo.Subpass = 0;
-    initInfo.MinImageCount = m_FrameBuffers.size();
-    initInfo.ImageCount = m_FrameBuffers.size();
+    initInfo.MinImageCount = m_Swapchain.GetImageCount();
+    initInfo.ImageCount = m_Swapchain.GetImageCount();
     initInfo.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
     initInfo.Allocator = nullptr;
     initInfo.CheckVkResultFn = &VkCore::Utils::CheckVkResult;
@@ -279,15 +401,14 @@ void VulkanRenderer::InitImGui(const VkCore::Window* window, const uint32_t widt
 
 void VulkanRenderer::ImGuiNewFrame(const uint32_t width, const uint32_t height)
 {
-    if (m_FrameBufferResized)
+    if (m_IsHeadless)
     {
-        if (width > 0 && height > 0)
-        {
-            ImGui_ImplVulkan_SetMinImageCount(m_FrameBuffers.size());
-            ResizeImGui(width, height);
-            m_MainWindowData.FrameIndex = 0;
-            m_FrameBufferResized = false;
-        }
+        ImGuiIO& io = ImGui::GetIO();
+        io.DisplaySize = ImVec2((float)width, (float)height);
+        io.DeltaTime = (float)HEADLESS_FRAME_TIME;
+
+        ImGui::NewFrame();
+        return;
     }
 
     ImGui_ImplVulkan_NewFrame();
@@ -343,13 +464,33 @@ void VulkanRenderer::ImGuiNewFrame(const uint32_t width, const uint32_t height)
 }
 
 void VulkanRenderer::ImGuiRender(const vk::CommandBuffer& cmdBuffer)
+{
+    ImGuiEndFrame();
+    ImGuiRecord(cmdBuffer);
+    ImGuiRenderPlatformWindows();
+}
+
+void VulkanRenderer::ImGuiEndFrame()
 {
     ImGui::Render();
-    ImDrawData* drawData = ImGui::GetDrawData();
+}
 
-    VkDevice device = *VkCore::DeviceManager::GetDevice();
+void VulkanRenderer::ImGuiRecord(const vk::CommandBuffer& cmdBuffer)
+{
+    if (m_IsHeadless)
+    {
+        return;
+    }
 
-    ImGui_ImplVulkan_RenderDrawData(drawData, cmdBuffer);
+    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmdBuffer);
+}
+
+void VulkanRenderer::ImGuiRenderPlatformWindows()
+{
+    if (m_IsHeadless)
+    {
+        return;
+    }
 
     // Update and Render additional Platform Windows
     ImGuiIO& io = ImGui::GetIO();
@@ -360,173 +501,133 @@ void VulkanRenderer::ImGuiRender(const vk::CommandBuffer& cmdBuffer)
     }
 }
 
-void VulkanRenderer::DestroySwapchain()
+void VulkanRenderer::ResizeImGui(const uint32_t width, const uint32_t height)
 {
-    m_RenderPass.Destroy();
-    VkCore::DeviceManager::GetDevice().DestroySwapchain(m_Swapchain.GetVkSwapchain());
-}
+    const uint32_t imageCount = m_Swapchain.GetImageCount();
 
-void VulkanRenderer::DestroyFrameBuffers()
-{
-    VkCore::DeviceManager::GetDevice().DestroyFrameBuffers(m_FrameBuffers);
-    m_FrameBuffers.clear();
-}
+    // The recreated swapchain may have a different number of images.
+    if (m_MainWindowData.ImageCount != imageCount)
+    {
+        delete[] m_MainWindowData.Frames;
+        delete[] m_MainWindowData.FrameSemaphores;
+
+        m_MainWindowData.Frames = new ImGui_ImplVulkanH_Frame[imageCount];
+        m_MainWindowData.FrameSemaphores = new ImGui_ImplVulkanH_FrameSemaphores[imageCount];
+        m_MainWindowData.ImageCount = imageCount;
+        m_MainWindowData.SemaphoreCount = imageCount;
+    }
 
-void VulkanRenderer::ResizeImGui(const uint32_t width, const uint32_t height)
-{
-    m_MainWindowData.Surface = m_Surface;
     m_MainWindowData.Swapchain = m_Swapchain.GetVkSwapchain();
-    // m_MainWindowData.SurfaceFormat = m_Swapchain.GetVkSurfaceFormat().surfaceFormat;
-    // m_MainWindowData.PresentMode = static_cast<VkPresentModeKHR>(m_Swapchain.GetPresentMode());
     m_MainWindowData.Width = width;
     m_MainWindowData.Height = height;
-    m_MainWindowData.RenderPass = m_RenderPass.GetVkRenderPass();
-    // m_MainWindowData.Frames = new ImGui_ImplVulkanH_Frame[m_FrameBuffers.size()];
-    // m_MainWindowData.FrameIndex = m_CurrentFrame;
-    // m_MainWindowData.SemaphoreCount = m_FrameBuffers.size();
-    // m_MainWindowData.FrameSemaphores = new ImGui_ImplVulkanH_FrameSemaphores[m_FrameBuffers.size()];
-    m_MainWindowData.ImageCount = m_FrameBuffers.size();
-    // m_MainWindowData.UseDynamicRendering = true;
-    // m_MainWindowData.SemaphoreIndex = m_CurrentFrame;
-    // m_MainWindowData.ClearEnable = false; // TODO: Check later. It might not be work properly.
-
-    for (int i = 0; i < m_FrameBuffers.size(); i++)
-    {
-        const ImGui_ImplVulkanH_Frame frame = {.CommandPool = m_CommandPool,
-                                               .CommandBuffer = m_CommandBuffers[i],
-                                               .Fence = m_InFlightFences[i],
+    m_MainWindowData.RenderPass = m_Swapchain.GetVkRenderPass();
+    m_MainWindowData.FrameIndex = 0;
+    m_MainWindowData.SemaphoreIndex = 0;
+
+    // The frames are paced by the timeline of the scheduler, so there are no fences to hand over.
+    for (uint32_t i = 0; i < imageCount; i++)
+    {
+        const uint32_t frameIndex = i % m_Scheduler.GetFramesInFlight();
+
+        const ImGui_ImplVulkanH_Frame frame = {.CommandPool = m_Scheduler.GetCommandPool(),
+                                               .CommandBuffer = m_Scheduler.GetCommandBuffers()[frameIndex],
+                                               .Fence = VK_NULL_HANDLE,
                                                .Backbuffer = m_Swapchain.GetImages()[i],
                                                .BackbufferView = m_Swapchain.GetImageViews()[i],
-                                               .Framebuffer = m_FrameBuffers[i]};
+                                               .Framebuffer = m_Swapchain.GetFramebuffer(i)};
 
-        m_MainWindowData.Frames[i].Backbuffer = m_Swapchain.GetImages()[i];
-        m_MainWindowData.Frames[i].BackbufferView = m_Swapchain.GetImageViews()[i];
-        m_MainWindowData.Frames[i].Framebuffer = m_FrameBuffers[i];
+        const ImGui_ImplVulkanH_FrameSemaphores frameSemaphores = {
+            .ImageAcquiredSemaphore = m_Scheduler.GetImageAvailableSemaphores()[frameIndex],
+            .RenderCompleteSemaphore = m_RenderFinishedSemaphores[i]};
+
+        m_MainWindowData.Frames[i] = frame;
+        m_MainWindowData.FrameSemaphores[i] = frameSemaphores;
     }
 }
 
 void VulkanRenderer::BeginDraw(const vk::ClearColorValue& clearValue, const uint32_t width, const uint32_t height)
 {
-    vk::CommandBufferBeginInfo cmdBufferBeginInfo{};
-
-    vk::ClearValue clearValues[2] = {};
-
-    clearValues[0].color = clearValue;
-    clearValues[1].depthStencil = vk::ClearDepthStencilValue(1.f, 0);
-
-    vk::RenderPassBeginInfo renderPassBeginInfo{};
-    renderPassBeginInfo.setRenderPass(m_RenderPass.GetVkRenderPass())
-        .setRenderArea(vk::Rect2D({0, 0}, {width, height}))
-        .setFramebuffer(m_FrameBuffers[m_CurrentFrame])
-        .setClearValues(clearValues);
-
-    vk::CommandBuffer commandBuffer = m_CommandBuffers[m_CurrentFrame];
-    commandBuffer.begin(cmdBufferBeginInfo);
-    commandBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
+    BeginCmdBuffer();
+    BeginRenderPass(clearValue, width, height);
 }
 
 void VulkanRenderer::BeginCmdBuffer()
 {
     vk::CommandBufferBeginInfo cmdBufferBeginInfo{};
+    cmdBufferBeginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+
+    m_Scheduler.GetCommandBuffer().begin(cmdBufferBeginInfo);
 
-    m_CommandBuffers[m_CurrentFrame].begin(cmdBufferBeginInfo);
+    m_AsyncCompute.WriteGraphicsBegin(m_Scheduler.GetCommandBuffer());
 }
-void VulkanRenderer::BeginRenderPass(const vk::ClearColorValue& clearValue, const uint32_t width, const uint32_t height)
+void VulkanRenderer::BeginRenderPass(const vk::ClearColorValue& clearValue, const uint32_t width, const uint32_t height,
+                                     const vk::SubpassContents contents)
 {
     vk::ClearValue clearValues[2] = {};
 
     clearValues[0].color = clearValue;
     clearValues[1].depthStencil = vk::ClearDepthStencilValue(1.f, 0);
 
+    const vk::Framebuffer framebuffer =
+        m_IsHeadless ? m_Offscreen.GetFramebuffer(m_ImageIndex) : m_Swapchain.GetFramebuffer(m_ImageIndex);
+
     vk::RenderPassBeginInfo renderPassBeginInfo{};
-    renderPassBeginInfo.setRenderPass(m_RenderPass.GetVkRenderPass())
+    renderPassBeginInfo.setRenderPass(GetVkRenderPass())
         .setRenderArea(vk::Rect2D({0, 0}, {width, height}))
-        .setFramebuffer(m_FrameBuffers[m_CurrentFrame])
+        .setFramebuffer(framebuffer)
         .setClearValues(clearValues);
 
-    m_CommandBuffers[m_CurrentFrame].beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
+    m_Scheduler.GetCommandBuffer().beginRenderPass(renderPassBeginInfo, contents);
 }
 
 uint32_t VulkanRenderer::EndDraw()
 {
-    vk::CommandBuffer commandBuffer = m_CommandBuffers[m_CurrentFrame];
-    commandBuffer.endRenderPass();
-    commandBuffer.end();
-
-    vk::PipelineStageFlags dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
-
-    vk::SubmitInfo submitInfo{};
-    submitInfo.setCommandBuffers(m_CommandBuffers[m_CurrentFrame])
-        .setWaitSemaphores(m_ImageAvailableSemaphores[m_CurrentFrame])
-        .setWaitDstStageMask(dstStageMask)
-        .setSignalSemaphores(m_RenderFinishedSemaphores[m_CurrentFrame]);
-
-    TRY_CATCH_BEGIN()
+    EndRenderPass();
 
-    VkCore::DeviceManager::GetDevice().GetGraphicsQueue().submit(submitInfo, m_InFlightFences[m_CurrentFrame]);
-
-    TRY_CATCH_END()
-
-    vk::SwapchainKHR swapchain = m_Swapchain.GetVkSwapchain();
-
-    vk::PresentInfoKHR presentInfo{};
-    presentInfo.setWaitSemaphores(m_RenderFinishedSemaphores[m_CurrentFrame])
-        .setSwapchains(swapchain)
-        .setImageIndices(m_CurrentFrame)
-        .setPResults(nullptr);
-
-    try
-    {
-        const vk::Result presentResult = VkCore::DeviceManager::GetDevice().GetPresentQueue().presentKHR(presentInfo);
-    }
-    catch (vk::SystemError const& err)
-    {
-        const int32_t resultValue = err.code().value();
-
-        if (resultValue == (int)vk::Result::eErrorOutOfDateKHR)
-        {
-            return -1;
-        }
-        else if (resultValue != (int)vk::Result::eSuccess && resultValue != (int)vk::Result::eSuboptimalKHR)
-        {
-            throw std::runtime_error("Failed to acquire next swap chain image!");
-        }
-    }
-
-    m_CurrentFrame = (m_CurrentFrame + 1) % m_Swapchain.GetNumberOfSwapBuffers();
-    return 0;
+    return EndCmdBuffer();
 }
 
 void VulkanRenderer::EndRenderPass()
 {
-    m_CommandBuffers[m_CurrentFrame].endRenderPass();
+    m_Scheduler.GetCommandBuffer().endRenderPass();
 }
 
 int VulkanRenderer::EndCmdBuffer()
 {
-    vk::CommandBuffer commandBuffer = m_CommandBuffers[m_CurrentFrame];
-    commandBuffer.end();
+    const bool isCaptured = !m_LaunchOptions.capturePath.empty() || m_LaunchOptions.printHash;
+
+    if (m_IsHeadless && isCaptured && m_Scheduler.GetFrameNumber() == m_LaunchOptions.frameCount)
+    {
+        m_Offscreen.RecordReadback(m_Scheduler.GetCommandBuffer(), m_ImageIndex);
+    }
 
-    vk::PipelineStageFlags dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+    m_AsyncCompute.WriteGraphicsEnd(m_Scheduler.GetCommandBuffer());
 
-    vk::SubmitInfo submitInfo{};
-    submitInfo.setCommandBuffers(m_CommandBuffers[m_CurrentFrame])
-        .setWaitSemaphores(m_ImageAvailableSemaphores[m_CurrentFrame])
-        .setWaitDstStageMask(dstStageMask)
-        .setSignalSemaphores(m_RenderFinishedSemaphores[m_CurrentFrame]);
+    m_Scheduler.GetCommandBuffer().end();
 
-    TRY_CATCH_BEGIN()
+    return SubmitAndPresent();
+}
 
-    VkCore::DeviceManager::GetDevice().GetGraphicsQueue().submit(submitInfo, m_InFlightFences[m_CurrentFrame]);
+int VulkanRenderer::SubmitAndPresent()
+{
+    if (m_IsHeadless)
+    {
+        m_Scheduler.Submit(VkCore::DeviceManager::GetDevice().GetGraphicsQueue(), nullptr, {}, nullptr);
+        return 0;
+    }
 
-    TRY_CATCH_END()
+    const vk::Semaphore renderFinished = m_RenderFinishedSemaphores[m_ImageIndex];
+
+    m_Scheduler.Submit(VkCore::DeviceManager::GetDevice().GetGraphicsQueue(),
+                       m_Scheduler.GetImageAvailableSemaphore(), vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                       renderFinished);
 
     vk::SwapchainKHR swapchain = m_Swapchain.GetVkSwapchain();
 
     vk::PresentInfoKHR presentInfo{};
-    presentInfo.setWaitSemaphores(m_RenderFinishedSemaphores[m_CurrentFrame])
+    presentInfo.setWaitSemaphores(renderFinished)
         .setSwapchains(swapchain)
-        .setImageIndices(m_CurrentFrame)
+        .setImageIndices(m_ImageIndex)
         .setPResults(nullptr);
 
     try
@@ -547,7 +648,6 @@ int VulkanRenderer::EndCmdBuffer()
         }
     }
 
-    m_CurrentFrame = (m_CurrentFrame + 1) % m_Swapchain.GetNumberOfSwapBuffers();
     return 0;
 }
 
@@ -555,18 +655,29 @@ void VulkanRenderer::Shutdown()
 {
     VkCore::Device& device = VkCore::DeviceManager::GetDevice();
 
-    device.DestroyCommandPool(m_CommandPool);
-    m_RenderPass.Destroy();
+    // The graphics frames have waited for their compute passes, so those are finished as well.
+    m_Scheduler.Destroy();
+    m_AsyncCompute.Destroy();
+    m_Uploader.Destroy();
+
+    // Holds the pipelines of both the application and ImGui by now.
+    m_PipelineCache.Save();
+    m_PipelineCache.Destroy();
 
-    device.DestroySemaphores(m_RenderFinishedSemaphores);
-    device.DestroySemaphores(m_ImageAvailableSemaphores);
+    if (m_IsHeadless)
+    {
+        m_Offscreen.Destroy();
+    }
+    else
+    {
+        m_Swapchain.Destroy();
 
-    device.DestroyFences(m_InFlightFences);
+        device.DestroySemaphores(m_RenderFinishedSemaphores);
 
-    device.DestroyFrameBuffers(m_FrameBuffers);
+        ImGui_ImplVulkan_Shutdown();
+        ImGui_ImplGlfw_Shutdown();
+    }
 
-    ImGui_ImplVulkan_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
 
     m_Instance.destroySurfaceKHR(m_Surface);
@@ -578,15 +689,22 @@ void VulkanRenderer::Shutdown()
 
 uint32_t VulkanRenderer::AcquireNextImage()
 {
+    // Only the frame recorded framesInFlight frames ago has to be finished, the ones after it keep running.
+    const uint32_t frameIndex = m_Scheduler.BeginFrame();
 
-    VkCore::DeviceManager::GetDevice().WaitForFences(m_InFlightFences[m_CurrentFrame], false);
+    m_AsyncCompute.ReadTimestamps();
 
-    uint32_t imageIndex;
+    // Every frame in flight has its own offscreen images.
+    if (m_IsHeadless)
+    {
+        m_ImageIndex = frameIndex;
+        return frameIndex;
+    }
 
     try
     {
-        vk::ResultValue<uint32_t> result = m_Swapchain.AcquireNextImageKHR(m_ImageAvailableSemaphores[m_CurrentFrame]);
-        imageIndex = result.value;
+        vk::ResultValue<uint32_t> result = m_Swapchain.AcquireNextImage(m_Scheduler.GetImageAvailableSemaphore());
+        m_ImageIndex = result.value;
     }
     catch (vk::SystemError const& err)
     {
@@ -602,9 +720,85 @@ uint32_t VulkanRenderer::AcquireNextImage()
         }
     }
 
-    VkCore::DeviceManager::GetDevice().ResetFences(m_InFlightFences[m_CurrentFrame]);
+    return frameIndex;
+}
 
-    m_CommandBuffers[m_CurrentFrame].reset();
+bool VulkanRenderer::ShouldClose() const
+{
+    if (m_IsHeadless)
+    {
+        return m_Scheduler.GetFrameNumber() > m_LaunchOptions.frameCount;
+    }
 
-    return m_CurrentFrame;
+    return m_Window->ShouldClose();
+}
+
+void VulkanRenderer::PollEvents()
+{
+    if (!m_IsHeadless)
+    {
+        glfwPollEvents();
+    }
+}
+
+double VulkanRenderer::GetTime() const
+{
+    if (m_IsHeadless)
+    {
+        return (m_Scheduler.GetFrameNumber() - 1) * HEADLESS_FRAME_TIME;
+    }
+
+    return glfwGetTime();
+}
+
+void VulkanRenderer::BeginPipelineCreation()
+{
+    m_PipelineCreationBegin = std::chrono::high_resolution_clock::now();
+    m_IsPipelineCacheUsed = false;
+}
+
+void VulkanRenderer::EndPipelineCreation()
+{
+    const auto now = std::chrono::high_resolution_clock::now();
+
+    const float pipelineMs = std::chrono::duration<float, std::milli>(now - m_PipelineCreationBegin).count();
+    const float startupMs = std::chrono::duration<float, std::milli>(now - m_StartupBegin).count();
+
+    if (m_IsPipelineCacheUsed)
+    {
+        LOGF(Application, Info,
+             "Startup took %.2f ms: device %.2f ms, pipeline cache load %.2f ms, pipeline creation %.2f ms (%s cache, "
+             "%zu bytes loaded)",
+             startupMs, m_DeviceCreationMs, m_PipelineCache.GetLoadTime(), pipelineMs,
+             m_PipelineCache.IsWarm() ? "warm" : "cold", m_PipelineCache.GetLoadedSize())
+    }
+    else
+    {
+        LOGF(Application, Info, "Startup took %.2f ms: device %.2f ms, pipeline creation %.2f ms (without the cache)",
+             startupMs, m_DeviceCreationMs, pipelineMs)
+    }
+
+    if (m_Uploader.GetSubmitCount() > 0)
+    {
+        m_Uploader.LogStatistics();
+    }
+}
+
+void VulkanRenderer::WriteHeadlessCapture()
+{
+    if (!m_IsHeadless || (m_LaunchOptions.capturePath.empty() && !m_LaunchOptions.printHash))
+    {
+        return;
+    }
+
+    // The readback was recorded into the last frame.
+    m_Scheduler.WaitIdle();
+
+    const uint64_t hash = m_Offscreen.WriteReadback(m_LaunchOptions.capturePath);
+
+    if (m_LaunchOptions.printHash)
+    {
+        // Printed on its own line to stdout, so that the scripts comparing the runs don't have to parse the log.
+        std::printf("frame_hash=%016llx\n", (unsigned long long)hash);
+    }
 }
@@ -1,11 +1,17 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <vector>
 
+#include "AsyncCompute.h"
+#include "FrameScheduler.h"
+#include "LaunchOptions.h"
+#include "OffscreenTarget.h"
+#include "PipelineCache.h"
+#include "StagingUploader.h"
+#include "SwapchainTarget.h"
 #include "Platform/Window.h"
-#include "Vk/SwapchainRenderPass.h"
-#include "Vk/Swapchain.h"
 #include "vulkan/vulkan_handles.hpp"
 
 #include "imgui.h"
@@ -20,24 +26,35 @@ class VulkanRenderer
     {
     }
 
+    /**
+     * @param window - Window presented to, nullptr in the headless mode.
+     * @param options - Frames in flight, clamped to the swapchain image count, and the headless mode, which renders
+     * into offscreen images instead of a swapchain.
+     */
     VulkanRenderer(const std::string& title, VkCore::Window* window, const std::vector<const char*>& deviceExtensions,
-                   const std::vector<const char*>& instanceExtensions);
-
-    void CreateFramebuffers(const uint32_t width, const uint32_t height);
-    void CreateSwapchain(const uint32_t width, const uint32_t height);
+                   const std::vector<const char*>& instanceExtensions, const LaunchOptions& options = LaunchOptions());
 
     void InitImGui(const VkCore::Window* window, const uint32_t width, const uint32_t height);
     void ImGuiNewFrame(const uint32_t width, const uint32_t height);
     void ImGuiRender(const vk::CommandBuffer& cmdBuffer);
-    void ResizeImGui(const uint32_t width, const uint32_t height);
 
-    void DestroySwapchain();
-    void DestroyFrameBuffers();
+    // ImGuiRender split up, so that the draw data can be recorded on another thread, e.g. into a secondary buffer.
+    // ImGuiEndFrame and ImGuiRenderPlatformWindows have to be called on the main thread, ImGuiRecord in between.
+    void ImGuiEndFrame();
+    void ImGuiRecord(const vk::CommandBuffer& cmdBuffer);
+    void ImGuiRenderPlatformWindows();
+
+    /**
+     * Recreates the swapchain for the current size of the window, waiting for the events while it's minimized. The
+     * frames in flight keep running, the resources they use are destroyed once they are finished.
+     */
+    void RecreateSwapchain();
 
     void BeginDraw(const vk::ClearColorValue& clearValue, const uint32_t width, const uint32_t height);
 
 	void BeginCmdBuffer();
-	void BeginRenderPass(const vk::ClearColorValue& clearValue, const uint32_t width, const uint32_t height);
+	void BeginRenderPass(const vk::ClearColorValue& clearValue, const uint32_t width, const uint32_t height,
+                         const vk::SubpassContents contents = vk::SubpassContents::eInline);
 
 
     uint32_t EndDraw();
@@ -47,8 +64,24 @@ class VulkanRenderer
 
     void Shutdown();
 
-    // Waits for an image to be available for rendering. **THIS HAS TO BE CALLED BEFORE DRAWING A FRAME**
-    // @return - Image index. If -1 is returned, the Swapchain is out of date, and has to be recreated.
+    // Whether the application should stop, either the window was closed or all the headless frames were rendered.
+    bool ShouldClose() const;
+    void PollEvents();
+
+    // Seconds since the start, advanced by a fixed step every frame in the headless mode.
+    double GetTime() const;
+
+    // Brackets the creation of the pipelines of the application, logs the startup breakdown at the end.
+    void BeginPipelineCreation();
+    void EndPipelineCreation();
+
+    // Writes out the last headless frame as requested by the launch options. Has to be called after the last frame.
+    void WriteHeadlessCapture();
+
+    // Waits for the slot of the next frame and acquires an image to render it to. **THIS HAS TO BE CALLED BEFORE
+    // DRAWING A FRAME**
+    // @return - Frame index, the slot the per-frame resources are indexed by. If -1 is returned, the Swapchain is out
+    // of date, and has to be recreated.
     uint32_t AcquireNextImage();
 
     void SetSurface(const vk::SurfaceKHR& surface)
@@ -58,7 +91,7 @@ class VulkanRenderer
 
     // -------------- GETTERS ------------------
 
-    VkCore::Swapchain& GetSwapchain()
+    SwapchainTarget& GetSwapchain()
     {
         return m_Swapchain;
     }
@@ -75,47 +108,119 @@ class VulkanRenderer
 
     uint32_t GetCurrentFrame() const
     {
-        return m_CurrentFrame;
+        return m_Scheduler.GetFrameIndex();
+    }
+
+    uint32_t GetFramesInFlight() const
+    {
+        return m_Scheduler.GetFramesInFlight();
+    }
+
+    // Swapchain image the current frame is rendered to.
+    uint32_t GetImageIndex() const
+    {
+        return m_ImageIndex;
+    }
+
+    FrameScheduler& GetScheduler()
+    {
+        return m_Scheduler;
+    }
+
+    // Compute passes submitted ahead of the graphics buffer of the frame, overlapping the previous frame.
+    AsyncCompute& GetAsyncCompute()
+    {
+        return m_AsyncCompute;
+    }
+
+    // Uploads the data of the buffers created at the startup, coalesced into as few submissions as possible.
+    StagingUploader& GetUploader()
+    {
+        return m_Uploader;
+    }
+
+    // Creates every pipeline through the pipeline builders, so that it can be reused by the next run. Has to be called
+    // on the main thread, the startup breakdown only reports the cache once the pipelines have asked for it.
+    PipelineCache& GetPipelineCache()
+    {
+        m_IsPipelineCacheUsed = true;
+        return m_PipelineCache;
+    }
+
+    // Render pass the pipelines are built against, the offscreen one in the headless mode. It outlives the
+    // recreations of the swapchain.
+    vk::RenderPass GetVkRenderPass()
+    {
+        return m_IsHeadless ? m_Offscreen.GetVkRenderPass() : m_Swapchain.GetVkRenderPass();
+    }
+
+    bool IsHeadless() const
+    {
+        return m_IsHeadless;
     }
 
-    VkCore::SwapchainRenderPass& GetRenderPass()
+    // Size of the rendered frames.
+    uint32_t GetWidth() const
     {
-        return m_RenderPass;
+        return m_IsHeadless ? m_Offscreen.GetWidth() : m_Window->GetWidth();
     }
 
-    std::vector<vk::Framebuffer>& GetFrameBuffers()
+    uint32_t GetHeight() const
     {
-        return m_FrameBuffers;
+        return m_IsHeadless ? m_Offscreen.GetHeight() : m_Window->GetHeight();
     }
 
     vk::CommandBuffer GetCurrentCmdBuffer()
     {
-        return m_CommandBuffers[m_CurrentFrame];
+        return m_Scheduler.GetCommandBuffer();
     }
 
+  private:
+    void CreateRenderFinishedSemaphores();
+    void InitializeAsyncCompute();
+    void InitializeUploader();
+
+    // Points the ImGui window data at the current swapchain images and framebuffers.
+    void ResizeImGui(const uint32_t width, const uint32_t height);
+
+    // Submits the current frame and presents its image.
+    // @return - If -1 is returned, the Swapchain is out of date, and has to be recreated.
+    int SubmitAndPresent();
+
+  public:
     // -------------- SETTERS ------------------
 
-    VkCore::Swapchain m_Swapchain;
+    SwapchainTarget m_Swapchain;
     vk::Instance m_Instance = nullptr;
     vk::DebugUtilsMessengerEXT m_DebugMessenger = nullptr;
     vk::SurfaceKHR m_Surface = nullptr;
 
-    vk::CommandPool m_CommandPool = nullptr;
+    FrameScheduler m_Scheduler;
+    AsyncCompute m_AsyncCompute;
+    StagingUploader m_Uploader;
+
+    VkCore::Window* m_Window = nullptr;
+    LaunchOptions m_LaunchOptions;
+    bool m_IsHeadless = false;
+    OffscreenTarget m_Offscreen;
+
+    PipelineCache m_PipelineCache;
+    // Whether a pipeline created since BeginPipelineCreation was given the cache.
+    bool m_IsPipelineCacheUsed = false;
+
+    // Startup breakdown, from the construction of the renderer on.
+    std::chrono::high_resolution_clock::time_point m_StartupBegin;
+    std::chrono::high_resolution_clock::time_point m_PipelineCreationBegin;
+    float m_DeviceCreationMs = 0.f;
 
     VkDescriptorPool m_ImGuiDescPool = nullptr;
 
     ImGui_ImplVulkanH_Window m_MainWindowData;
 
-    bool m_FrameBufferResized = false;
-
+    // One per swapchain image, the presentation of an image waits for the frame rendered to it.
     std::vector<vk::Semaphore> m_RenderFinishedSemaphores;
-    std::vector<vk::Semaphore> m_ImageAvailableSemaphores;
-    std::vector<vk::Fence> m_InFlightFences;
-    std::vector<vk::CommandBuffer> m_CommandBuffers;
 
-    uint32_t m_CurrentFrame = 0;
-    VkCore::SwapchainRenderPass m_RenderPass;
-    std::vector<vk::Framebuffer> m_FrameBuffers;
+    uint32_t m_ImageIndex = 0;
 
 	bool m_IsMeshShadingEnabled = false;
 };
@@ -0,0 +1,125 @@
+#include "ScalingBenchmark.h"
+
+#include <fstream>
+
+#include "Log/Log.h"
+
+void ScalingBenchmark::Start(const std::string& name, const std::vector<uint32_t>& instanceCounts,
+                             const uint32_t warmupFrames, const uint32_t measuredFrames)
+{
+    ASSERT(!instanceCounts.empty(), "The benchmark needs at least a single instance count!")
+    ASSERT(measuredFrames > 0, "The benchmark has to measure at least a single frame!")
+
+    m_Name = name;
+    m_InstanceCounts = instanceCounts;
+    m_WarmupFrames = warmupFrames;
+    m_MeasuredFrames = measuredFrames;
+
+    m_Results.clear();
+    m_Running = true;
+    m_StepReady = false;
+    m_Step = 0;
+    m_Frame = 0;
+
+    LOGF(Application, Info, "Benchmark %s: sweeping %d instance counts", m_Name.c_str(), (int)m_InstanceCounts.size())
+}
+
+void ScalingBenchmark::Stop()
+{
+    m_Running = false;
+    m_StepReady = false;
+}
+
+void ScalingBenchmark::Setup(const uint64_t memoryBytes)
+{
+    m_Accumulated = ScalingResult{};
+    m_Accumulated.instanceCount = GetInstanceCount();
+    m_Accumulated.memoryBytes = memoryBytes;
+
+    m_Frame = 0;
+    m_StepReady = true;
+}
+
+void ScalingBenchmark::AddFrame(const float cpuMs, const float gpuMs, const uint32_t visibleMeshlets)
+{
+    if (!m_Running || !m_StepReady)
+    {
+        return;
+    }
+
+    m_Frame++;
+
+    if (m_Frame <= m_WarmupFrames)
+    {
+        return;
+    }
+
+    m_Accumulated.cpuMs += cpuMs;
+    m_Accumulated.gpuMs += gpuMs;
+    m_Accumulated.visibleMeshlets += visibleMeshlets;
+
+    if (m_Frame == m_WarmupFrames + m_MeasuredFrames)
+    {
+        FinishStep();
+    }
+}
+
+float ScalingBenchmark::GetProgress() const
+{
+    if (m_InstanceCounts.empty())
+    {
+        return 0.f;
+    }
+
+    const float stepProgress = m_StepReady ? (float)m_Frame / (m_WarmupFrames + m_MeasuredFrames) : 0.f;
+
+    return (m_Step + stepProgress) / m_InstanceCounts.size();
+}
+
+void ScalingBenchmark::FinishStep()
+{
+    ScalingResult result = m_Accumulated;
+    result.cpuMs /= m_MeasuredFrames;
+    result.gpuMs /= m_MeasuredFrames;
+    result.visibleMeshlets /= m_MeasuredFrames;
+
+    m_Results.push_back(result);
+
+    LOGF(Application, Info, "Benchmark %s: %u instances, CPU %.3f ms, GPU %.3f ms, %.0f visible meshlets, %.2f MB",
+         m_Name.c_str(), result.instanceCount, result.cpuMs, result.gpuMs, result.visibleMeshlets,
+         result.memoryBytes / (1024.f * 1024.f))
+
+    m_StepReady = false;
+    m_Step++;
+
+    if (m_Step == m_InstanceCounts.size())
+    {
+        m_Running = false;
+        m_Step = 0;
+
+        WriteResults();
+    }
+}
+
+void ScalingBenchmark::WriteResults() const
+{
+    // Same separator as the other measurements of the repository.
+    const std::string path = m_Name + "_benchmark.csv";
+    std::ofstream file(path);
+
+    if (!file.is_open())
+    {
+        LOGF(Application, Error, "Benchmark %s: failed to open %s", m_Name.c_str(), path.c_str())
+        return;
+    }
+
+    file << "instances;cpu_ms;gpu_ms;visible_meshlets;memory_mb\n";
+
+    for (const ScalingResult& result : m_Results)
+    {
+        file << result.instanceCount << ";" << result.cpuMs << ";" << result.gpuMs << ";" << result.visibleMeshlets
+             << ";" << result.memoryBytes / (1024.f * 1024.f) << "\n";
+    }
+
+    LOGF(Application, Info, "Benchmark %s: results written to %s", m_Name.c_str(), path.c_str())
+}
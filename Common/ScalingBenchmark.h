@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Averages of a single instance count of the sweep.
+struct ScalingResult
+{
+    uint32_t instanceCount = 0;
+    float cpuMs = 0.f;
+    float gpuMs = 0.f;
+    float visibleMeshlets = 0.f;
+    uint64_t memoryBytes = 0;
+};
+
+/**
+ * Sweeps the instance count of an application and averages the cost of its frames for each of the counts.
+ *
+ * The benchmark only keeps the state of the sweep, the application drives it. Whenever NeedsSetup returns true, the
+ * application regenerates its scene with GetInstanceCount instances and calls Setup. After that it reports every
+ * frame through AddFrame. The first frames of every count aren't measured, so that the uploads and the caches of
+ * the new scene settle first.
+ *
+ * Once the sweep is done, the results are logged and written as a CSV file with one line per instance count.
+ */
+class ScalingBenchmark
+{
+  public:
+    ScalingBenchmark() {};
+
+    /**
+     * @param name Name of the measured pipeline, used for the logs and as the name of the CSV file.
+     */
+    void Start(const std::string& name, const std::vector<uint32_t>& instanceCounts, const uint32_t warmupFrames = 30,
+               const uint32_t measuredFrames = 120);
+
+    void Stop();
+
+    bool IsRunning() const
+    {
+        return m_Running;
+    }
+
+    bool NeedsSetup() const
+    {
+        return m_Running && !m_StepReady;
+    }
+
+    uint32_t GetInstanceCount() const
+    {
+        return m_InstanceCounts[m_Step];
+    }
+
+    // Marks the scene of the current count as ready.
+    void Setup(const uint64_t memoryBytes);
+
+    void AddFrame(const float cpuMs, const float gpuMs, const uint32_t visibleMeshlets);
+
+    // Fraction of the sweep which is done.
+    float GetProgress() const;
+
+    const std::vector<ScalingResult>& GetResults() const
+    {
+        return m_Results;
+    }
+
+  private:
+    void FinishStep();
+    void WriteResults() const;
+
+  private:
+    std::string m_Name;
+    std::vector<uint32_t> m_InstanceCounts;
+    std::vector<ScalingResult> m_Results;
+
+    uint32_t m_WarmupFrames = 0;
+    uint32_t m_MeasuredFrames = 0;
+
+    bool m_Running = false;
+    bool m_StepReady = false;
+    uint32_t m_Step = 0;
+    uint32_t m_Frame = 0;
+
+    ScalingResult m_Accumulated;
+};
@@ -0,0 +1,154 @@
+#include "SceneGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include "glm/ext/matrix_transform.hpp"
+#include "glm/gtc/constants.hpp"
+#include "Log/Log.h"
+
+// Instances of a single cluster of the clustered layout.
+static constexpr uint32_t CLUSTER_SIZE = 1000;
+
+// Stateless hash of the PCG generator, turns an index into well distributed bits.
+static uint32_t Hash(uint32_t value)
+{
+    const uint32_t state = value * 747796405u + 2891336453u;
+    const uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+
+    return (word >> 22u) ^ word;
+}
+
+// Uniform random number in [0, 1) of the given stream of an instance.
+static float Random(const uint32_t seed, const uint32_t index, const uint32_t stream)
+{
+    return Hash(Hash(Hash(seed) ^ index) + stream) / 4294967296.f;
+}
+
+static glm::vec3 RandomVec3(const uint32_t seed, const uint32_t index, const uint32_t stream)
+{
+    return glm::vec3(Random(seed, index, stream), Random(seed, index, stream + 1), Random(seed, index, stream + 2));
+}
+
+static glm::mat4 GenerateTransform(const SceneGeneratorSettings& settings, const uint32_t index, uint32_t& modelId)
+{
+    const uint32_t seed = settings.seed;
+    const float spacing = settings.spacing;
+
+    glm::vec3 position = glm::vec3(0.f);
+    float scale = 1.f;
+    float yaw = 0.f;
+
+    switch (settings.layout)
+    {
+    case ESceneLayout::Grid:
+    {
+        const uint32_t side = (uint32_t)std::ceil(std::cbrt((double)settings.instanceCount));
+
+        position = glm::vec3(index % side, (index / side) % side, index / (side * side)) * spacing;
+        modelId = index % settings.modelCount;
+        break;
+    }
+    case ESceneLayout::Clustered:
+    {
+        const uint32_t cluster = index / CLUSTER_SIZE;
+        const float extent = std::cbrt((float)settings.instanceCount) * spacing * 2.f;
+        const float clusterRadius = std::cbrt((float)CLUSTER_SIZE) * spacing * 0.5f;
+
+        // The centers are hashed from the cluster, so every instance finds the center of its cluster on its own.
+        const glm::vec3 center = RandomVec3(seed, cluster, 0) * extent;
+
+        // Sum of uniform numbers, denser towards the center of the cluster.
+        const glm::vec3 offset = RandomVec3(seed, index, 0) + RandomVec3(seed, index, 3) - 1.f;
+
+        position = center + offset * clusterRadius;
+        yaw = Random(seed, index, 6) * glm::two_pi<float>();
+        modelId = Hash(seed ^ cluster) % settings.modelCount;
+        break;
+    }
+    case ESceneLayout::Forest:
+    {
+        const float extent = std::sqrt((float)settings.instanceCount) * spacing * 0.25f;
+
+        position = glm::vec3(Random(seed, index, 0) * extent, 0.f, Random(seed, index, 1) * extent);
+        scale = 0.5f + Random(seed, index, 2);
+        yaw = Random(seed, index, 3) * glm::two_pi<float>();
+        modelId = Hash(seed ^ index) % settings.modelCount;
+        break;
+    }
+    case ESceneLayout::SparseWorld:
+    {
+        const float extent = std::sqrt((float)settings.instanceCount) * spacing * 50.f;
+
+        position = glm::vec3(Random(seed, index, 0) * extent, Random(seed, index, 1) * spacing * 10.f,
+                             Random(seed, index, 2) * extent);
+        scale = 0.5f + Random(seed, index, 3) * 1.5f;
+        yaw = Random(seed, index, 4) * glm::two_pi<float>();
+        modelId = Hash(seed ^ index) % settings.modelCount;
+        break;
+    }
+    }
+
+    glm::mat4 transform = glm::translate(glm::identity<glm::mat4>(), position);
+    transform = glm::rotate(transform, yaw, glm::vec3(0.f, 1.f, 0.f));
+
+    return glm::scale(transform, glm::vec3(scale));
+}
+
+const char* GetSceneLayoutName(const ESceneLayout layout)
+{
+    switch (layout)
+    {
+    case ESceneLayout::Grid:
+        return "Grid";
+    case ESceneLayout::Clustered:
+        return "Clustered";
+    case ESceneLayout::Forest:
+        return "Forest";
+    case ESceneLayout::SparseWorld:
+        return "SparseWorld";
+    }
+
+    return "Unknown";
+}
+
+std::vector<PackedInstance> GenerateScene(const SceneGeneratorSettings& settings)
+{
+    ASSERT(settings.instanceCount <= SCENE_GENERATOR_MAX_INSTANCES, "Too many instances requested from the generator!")
+    ASSERT(settings.modelCount > 0, "The generated scene needs at least a single model!")
+
+    std::vector<PackedInstance> instances(settings.instanceCount);
+
+    const uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+    const uint32_t rangeSize = (settings.instanceCount + threadCount - 1) / threadCount;
+
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount);
+
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+        const uint32_t first = std::min(i * rangeSize, settings.instanceCount);
+        const uint32_t last = std::min(first + rangeSize, settings.instanceCount);
+
+        threads.emplace_back([&settings, &instances, first, last]() {
+            for (uint32_t index = first; index < last; index++)
+            {
+                uint32_t modelId = 0;
+                const glm::mat4 transform = GenerateTransform(settings, index, modelId);
+
+                instances[index] = PackInstance(transform, modelId);
+            }
+        });
+    }
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    LOGF(Application, Info, "Generated scene: %s layout, %u instances, seed %u", GetSceneLayoutName(settings.layout),
+         settings.instanceCount, settings.seed)
+
+    return instances;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "InstanceTransform.h"
+
+// Largest scene the generator is meant for. Bigger ones don't fit the instance buffers of the applications anyway.
+constexpr uint32_t SCENE_GENERATOR_MAX_INSTANCES = 10000000;
+
+enum class ESceneLayout : uint32_t
+{
+    // Cube of evenly spaced instances, the layout the applications used to hard-code.
+    Grid = 0,
+    // Dense spherical clusters of about a thousand instances, scattered through a volume.
+    Clustered = 1,
+    // Flat field where about sixteen instances overlap every grid cell, stressing the overdraw.
+    Forest = 2,
+    // Flat world fifty times wider than the grid, where most instances are small and far away.
+    SparseWorld = 3,
+};
+
+const char* GetSceneLayoutName(const ESceneLayout layout);
+
+struct SceneGeneratorSettings
+{
+    ESceneLayout layout = ESceneLayout::Grid;
+    uint32_t instanceCount = 8000;
+    // Equal seeds give equal scenes, no matter how many threads generated them.
+    uint32_t seed = 1;
+    // Distance of the neighbouring instances of the grid, the other layouts are scaled by it as well.
+    float spacing = 1.f;
+    // Instances get a model ID below this count.
+    uint32_t modelCount = 1;
+};
+
+/**
+ * Generates the instances of a procedural scene.
+ *
+ * Every instance is derived from its index and the seed only, so the instances are generated in parallel, split
+ * into equal ranges over all hardware threads. The instances are returned in the compressed format, which halves
+ * the memory of the biggest scenes, the full matrices can be recovered by UnpackInstance.
+ */
+std::vector<PackedInstance> GenerateScene(const SceneGeneratorSettings& settings);
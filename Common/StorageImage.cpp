@@ -0,0 +1,106 @@
+#include "StorageImage.h"
+
+#include "Log/Log.h"
+#include "Vk/Devices/DeviceManager.h"
+
+void StorageImage::Initialize(const uint32_t width, const uint32_t height, const vk::Format format)
+{
+    vk::Device device = *VkCore::DeviceManager::GetDevice();
+    vk::PhysicalDevice physicalDevice = *VkCore::DeviceManager::GetPhysicalDevice();
+
+    vk::ImageCreateInfo createInfo{};
+    createInfo.setImageType(vk::ImageType::e2D)
+        .setFormat(format)
+        .setExtent(vk::Extent3D(width, height, 1))
+        .setMipLevels(1)
+        .setArrayLayers(1)
+        .setSamples(vk::SampleCountFlagBits::e1)
+        .setTiling(vk::ImageTiling::eOptimal)
+        .setUsage(vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled)
+        .setSharingMode(vk::SharingMode::eExclusive)
+        .setInitialLayout(vk::ImageLayout::eUndefined);
+
+    m_Image = device.createImage(createInfo);
+
+    const vk::MemoryRequirements requirements = device.getImageMemoryRequirements(m_Image);
+    const vk::PhysicalDeviceMemoryProperties memoryProperties = physicalDevice.getMemoryProperties();
+
+    uint32_t memoryType = UINT32_MAX;
+
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount && memoryType == UINT32_MAX; i++)
+    {
+        if ((requirements.memoryTypeBits & (1 << i)) &&
+            (memoryProperties.memoryTypes[i].propertyFlags & vk::MemoryPropertyFlagBits::eDeviceLocal))
+        {
+            memoryType = i;
+        }
+    }
+
+    ASSERT(memoryType != UINT32_MAX, "No device local memory type found for the storage image!")
+
+    vk::MemoryAllocateInfo allocateInfo{};
+    allocateInfo.setAllocationSize(requirements.size).setMemoryTypeIndex(memoryType);
+
+    m_Memory = device.allocateMemory(allocateInfo);
+    device.bindImageMemory(m_Image, m_Memory, 0);
+
+    vk::ImageViewCreateInfo viewCreateInfo{};
+    viewCreateInfo.setImage(m_Image)
+        .setViewType(vk::ImageViewType::e2D)
+        .setFormat(format)
+        .setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1));
+
+    m_View = device.createImageView(viewCreateInfo);
+
+    // Not every GPU filters the 32 bit float formats linearly.
+    const bool isFilterable = (bool)(physicalDevice.getFormatProperties(format).optimalTilingFeatures &
+                                     vk::FormatFeatureFlagBits::eSampledImageFilterLinear);
+    const vk::Filter filter = isFilterable ? vk::Filter::eLinear : vk::Filter::eNearest;
+
+    vk::SamplerCreateInfo samplerCreateInfo{};
+    samplerCreateInfo.setMagFilter(filter)
+        .setMinFilter(filter)
+        .setAddressModeU(vk::SamplerAddressMode::eRepeat)
+        .setAddressModeV(vk::SamplerAddressMode::eRepeat)
+        .setAddressModeW(vk::SamplerAddressMode::eRepeat);
+
+    m_Sampler = device.createSampler(samplerCreateInfo);
+}
+
+void StorageImage::Destroy()
+{
+    vk::Device device = *VkCore::DeviceManager::GetDevice();
+
+    device.destroySampler(m_Sampler);
+    device.destroyImageView(m_View);
+    device.destroyImage(m_Image);
+    device.freeMemory(m_Memory);
+
+    m_Sampler = nullptr;
+    m_View = nullptr;
+    m_Image = nullptr;
+    m_Memory = nullptr;
+}
+
+vk::DescriptorImageInfo StorageImage::CreateDescriptorImageInfo(const vk::ImageLayout layout) const
+{
+    return vk::DescriptorImageInfo(m_Sampler, m_View, layout);
+}
+
+vk::ImageMemoryBarrier StorageImage::CreateImageMemoryBarrier(const vk::AccessFlags srcAccess,
+                                                              const vk::AccessFlags dstAccess,
+                                                              const vk::ImageLayout oldLayout,
+                                                              const vk::ImageLayout newLayout) const
+{
+    vk::ImageMemoryBarrier barrier{};
+    barrier.setSrcAccessMask(srcAccess)
+        .setDstAccessMask(dstAccess)
+        .setOldLayout(oldLayout)
+        .setNewLayout(newLayout)
+        .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+        .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+        .setImage(m_Image)
+        .setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1));
+
+    return barrier;
+}
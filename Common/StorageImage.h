@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+
+#include <vulkan/vulkan.hpp>
+
+/**
+ * 2D image in device local memory, written by the compute shaders as a storage image and sampled by the graphics
+ * ones. Unlike the VkCore images its handle is exposed, so the queue family ownership of it can be transferred in
+ * between the async compute and the graphics queue.
+ *
+ * The image is used in the general layout only. Its contents are regenerated before every use, so the writer
+ * transitions it from the undefined layout, discarding what the previous owner left in it.
+ */
+class StorageImage
+{
+  public:
+    StorageImage() {};
+
+    void Initialize(const uint32_t width, const uint32_t height, const vk::Format format);
+
+    void Destroy();
+
+    vk::DescriptorImageInfo CreateDescriptorImageInfo(const vk::ImageLayout layout) const;
+
+    // Barrier of the whole image, the queue families are ignored unless set by the caller.
+    vk::ImageMemoryBarrier CreateImageMemoryBarrier(const vk::AccessFlags srcAccess, const vk::AccessFlags dstAccess,
+                                                    const vk::ImageLayout oldLayout,
+                                                    const vk::ImageLayout newLayout) const;
+
+    vk::Image GetVkImage() const
+    {
+        return m_Image;
+    }
+
+  private:
+    vk::Image m_Image = nullptr;
+    vk::DeviceMemory m_Memory = nullptr;
+    vk::ImageView m_View = nullptr;
+    vk::Sampler m_Sampler = nullptr;
+};
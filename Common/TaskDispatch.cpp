@@ -0,0 +1,44 @@
+#include "TaskDispatch.h"
+
+#include <algorithm>
+
+#include "Log/Log.h"
+#include "Vk/Devices/DeviceManager.h"
+#include "vulkan/vulkan.hpp"
+
+TaskDispatchLimits QueryTaskDispatchLimits()
+{
+    TaskDispatchLimits limits;
+
+    // The properties of the mesh shading extension that isn't enabled are left zeroed by the driver.
+#ifdef VK_MESH_EXT
+    vk::PhysicalDeviceMeshShaderPropertiesEXT meshShaderProperties{};
+    vk::PhysicalDeviceProperties2 properties{};
+    properties.pNext = &meshShaderProperties;
+
+    (*VkCore::DeviceManager::GetPhysicalDevice()).getProperties2(&properties);
+
+    limits.maxGroupCountX =
+        std::min(meshShaderProperties.maxTaskWorkGroupCount[0], meshShaderProperties.maxTaskWorkGroupTotalCount);
+#else
+    vk::PhysicalDeviceMeshShaderPropertiesNV meshShaderProperties{};
+    vk::PhysicalDeviceProperties2 properties{};
+    properties.pNext = &meshShaderProperties;
+
+    (*VkCore::DeviceManager::GetPhysicalDevice()).getProperties2(&properties);
+
+    // The NV draws take a single task count.
+    limits.maxGroupCountX = meshShaderProperties.maxDrawMeshTasksCount;
+#endif
+
+    LOGF(Application, Verbose, "Task dispatch limits: %u workgroups per command", limits.maxGroupCountX)
+
+    return limits;
+}
+
+uint32_t GetTaskCommandCount(const uint64_t taskCount, const TaskDispatchLimits& limits)
+{
+    ASSERT(limits.maxGroupCountX > 0, "The task dispatch limits have to be queried first!")
+
+    return (uint32_t)std::max((taskCount + limits.maxGroupCountX - 1) / limits.maxGroupCountX, (uint64_t)1);
+}
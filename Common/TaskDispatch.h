@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Limits of a single task shader dispatch.
+ *
+ * The task workgroups of the applications are flattened into a linear index and split into several indirect
+ * commands, each of which stays within these limits. The workgroup of a command then finds its linear index as
+ * gl_DrawID * maxGroupCountX + gl_WorkGroupID.x, or through the first index stored for the command.
+ */
+struct TaskDispatchLimits
+{
+    // Most workgroups of a single command in x, clamped by the limit of the total workgroup count as well.
+    uint32_t maxGroupCountX = 0;
+};
+
+TaskDispatchLimits QueryTaskDispatchLimits();
+
+// Indirect commands needed for the given number of task workgroups.
+uint32_t GetTaskCommandCount(const uint64_t taskCount, const TaskDispatchLimits& limits);
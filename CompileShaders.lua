@@ -0,0 +1,106 @@
+---@diagnostic disable: undefined-global
+
+-- Precompiles the shaders of all the demos into SPIR-V blobs next to their sources, e.g. lod.mesh -> lod.mesh.spv,
+-- so that the first run doesn't have to compile them through shaderc.
+--
+-- Optional and never run by the build, glslc isn't required to build the demos. The demos load the blobs through
+-- LoadShader of Common/Renderer/ShaderCache.h, which compiles the missing or outdated ones itself.
+--
+-- Every blob is keyed by a hash of its source, the sources it includes and the defines, which is kept in <blob>.key.
+-- The key has to match the one of LoadShader, so both hash the same text with FNV-1a. A shader is only compiled
+-- again once its key changes. The blobs are checked by spirv-val when it is installed.
+
+local shader_dirs = { "Common", "MeshletCulling", "MeshInstancing", "MeshLOD", "ClassicMeshLOD", "Tesselation" }
+local shader_extensions = { "vert", "frag", "comp", "task", "mesh", "tesc", "tese", "geom" }
+
+-- Only the EXT mesh shading stages get VK_MESH_EXT, the NV variants (*.nv.mesh, *.nv.task) have their own files.
+local function get_defines(file, extension)
+	if (extension == "mesh" or extension == "task") and not file:find(".nv.", 1, true) then
+		return "-DVK_MESH_EXT "
+	end
+
+	return ""
+end
+
+local function hash_key(text)
+	local hash = 0xcbf29ce484222325
+
+	for i = 1, #text do
+		hash = (hash ~ text:byte(i)) * 0x100000001b3
+	end
+
+	return string.format("%016x", hash)
+end
+
+-- Reads the source along with every file it includes, so that editing an include invalidates the shader as well.
+local function read_sources(file, visited)
+	if visited[file] then
+		return ""
+	end
+
+	visited[file] = true
+
+	local source = io.readfile(file)
+
+	if source == nil then
+		error("Failed to read the shader " .. file)
+	end
+
+	local sources = source
+
+	for include in source:gmatch('#include%s*"([^"]+)"') do
+		sources = sources .. read_sources(path.join(path.getdirectory(file), include), visited)
+	end
+
+	return sources
+end
+
+newaction {
+	trigger = "compile-shaders",
+	description = "Optionally precompile the shaders into SPIR-V, skipping the ones that haven't changed",
+
+	execute = function()
+		local _, result = os.outputof("glslc --version")
+
+		if result ~= 0 then
+			error("glslc was not found! Install the Vulkan SDK or the shaderc tools.")
+		end
+
+		local _, validator_result = os.outputof("spirv-val --version")
+		local has_validator = validator_result == 0
+
+		local compiled, skipped, failed = 0, 0, 0
+
+		for _, dir in ipairs(shader_dirs) do
+			for _, extension in ipairs(shader_extensions) do
+				for _, file in ipairs(os.matchfiles(dir .. "/Res/Shaders/**." .. extension)) do
+					local blob = file .. ".spv"
+					local defines = get_defines(file, extension)
+					local key = hash_key(read_sources(file, {}) .. defines)
+
+					if os.isfile(blob) and io.readfile(blob .. ".key") == key then
+						skipped = skipped + 1
+					elseif os.execute(string.format('glslc --target-env=vulkan1.3 %s -o "%s" "%s"', defines, blob,
+						file)) then
+						io.writefile(blob .. ".key", key)
+						compiled = compiled + 1
+
+						if has_validator and not os.execute(string.format('spirv-val --target-env vulkan1.3 "%s"',
+							blob)) then
+							print("SPIR-V validation failed: " .. blob)
+						end
+					else
+						os.remove(blob .. ".key")
+						failed = failed + 1
+					end
+				end
+			end
+		end
+
+		printf("Shaders: %d compiled, %d up to date, %d failed", compiled, skipped, failed)
+
+		if failed > 0 then
+			error("Failed to compile some of the shaders!")
+		end
+	end,
+}
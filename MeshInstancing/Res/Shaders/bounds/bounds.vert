@@ -5,6 +5,7 @@ layout (location = 1) in vec3 a_normal;
 layout (location = 2) in vec3 a_color;
 
 #extension GL_EXT_debug_printf : enable
+#extension GL_EXT_buffer_reference : require
 
 struct s_meshlet_bound {
 	vec3 normal;
@@ -13,9 +14,29 @@ struct s_meshlet_bound {
 	float sphere_radius;
 };
 
-layout (std430, set = 1, binding = 4) buffer MeshletBounds {
-	s_meshlet_bound bounds[];	
-} meshlet_bounds;
+layout (buffer_reference, std430, buffer_reference_align = 16) readonly buffer MeshletBounds {
+	s_meshlet_bound bounds[];
+};
+
+// Only the bounds are read here, the rest of the addresses are kept opaque.
+struct s_mesh_geometry {
+	uvec2 vertices;
+	uvec2 meshlets;
+	uvec2 meshlet_vertices;
+	uvec2 meshlet_triangles;
+	MeshletBounds meshlet_bounds;
+	uint meshlet_count;
+};
+
+struct s_scene_mesh {
+	s_mesh_geometry geometry;
+	uint model_id;
+	uint instances_per_task;
+};
+
+layout (std430, set = 1, binding = 0) buffer SceneMeshes {
+	s_scene_mesh meshes[];
+} scene_meshes;
 
 struct Frustum {
 	vec3 left;
@@ -43,7 +64,8 @@ layout (location = 0) out vec3 o_color;
 
 void main() {
 	
-	s_meshlet_bound bound = meshlet_bounds.bounds[gl_InstanceIndex];
+	// Debug view of the first mesh of the scene only.
+	s_meshlet_bound bound = scene_meshes.meshes[0].geometry.meshlet_bounds.bounds[gl_InstanceIndex];
 
 	gl_Position = mat_buffer.proj * mat_buffer.view * vec4(a_position * bound.sphere_radius + bound.sphere_pos , 1.f);
 	o_color = vec3(1.f, 1.f, 1.f);
@@ -1,5 +1,7 @@
 #include "InstancingApplication.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <cstdint>
 #include <cstdio>
@@ -7,21 +9,18 @@
 #include <stddef.h>
 #include <stdexcept>
 
+#include "../../Common/Query.h"
+#include "../../Common/Renderer/PipelineBuilder.h"
+#include "../../Common/TaskDispatch.h"
 #include "GLFW/glfw3.h"
 #include "Log/Log.h"
 #include "Model/Camera.h"
 #include "Model/MatrixBuffer.h"
-#include "Model/Shaders/ShaderData.h"
-#include "Model/Shaders/ShaderLoader.h"
 #include "Model/Structures/OcTree.h"
 #include "Vk/Buffers/Buffer.h"
 #include "Vk/Descriptors/DescriptorBuilder.h"
 #include "Vk/Devices/DeviceManager.h"
-#include "Vk/GraphicsPipeline/GraphicsPipelineBuilder.h"
-#include "Vk/Swapchain.h"
-#include "Vk/SwapchainRenderPass.h"
 #include "Vk/Utils.h"
-#include "Vk/Vertex/VertexAttributeBuilder.h"
 #include "backends/imgui_impl_glfw.h"
 #include "glm/ext/matrix_transform.hpp"
 #include "glm/ext/vector_float3.hpp"
@@ -34,14 +33,18 @@
 #include "vulkan/vulkan_structs.hpp"
 #include "glm/gtc/type_ptr.hpp"
 
-void InstancingApplication::Run(const uint32_t winWidth, const uint32_t winHeight)
+void InstancingApplication::Run(const LaunchOptions& options)
 {
     Logger::SetSeverityFilter(ESeverity::Verbose);
 
     std::cout << sizeof(Frustum) << std::endl;
 
-    m_Window = new VkCore::Window("Mesh Application", winWidth, winHeight);
-    m_Window->SetEventCallback(std::bind(&InstancingApplication::OnEvent, this, std::placeholders::_1));
+    // The headless mode renders offscreen, without opening a window.
+    if (!options.headless)
+    {
+        m_Window = new VkCore::Window("Mesh Application", options.width, options.height);
+        m_Window->SetEventCallback(std::bind(&InstancingApplication::OnEvent, this, std::placeholders::_1));
+    }
 
     m_Renderer = VulkanRenderer("Mesh Application", m_Window,
                                 {VK_KHR_SWAPCHAIN_EXTENSION_NAME, VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME,
@@ -52,8 +55,8 @@ void InstancingApplication::Run(const uint32_t winWidth, const uint32_t winHeigh
                                  VK_EXT_MESH_SHADER_EXTENSION_NAME,
 #endif
                                  VK_KHR_SHADER_NON_SEMANTIC_INFO_EXTENSION_NAME},
-                                {});
-    m_Renderer.InitImGui(m_Window, winWidth, winHeight);
+                                {}, options);
+    m_Renderer.InitImGui(m_Window, m_Renderer.GetWidth(), m_Renderer.GetHeight());
 
 #ifndef VK_MESH_EXT
     vkCmdDrawMeshTasksNv =
@@ -61,20 +64,22 @@ void InstancingApplication::Run(const uint32_t winWidth, const uint32_t winHeigh
 #else
     vkCmdDrawMeshTasksEXT =
         (PFN_vkCmdDrawMeshTasksEXT)vkGetDeviceProcAddr(*VkCore::DeviceManager::GetDevice(), "vkCmdDrawMeshTasksEXT");
+    vkCmdDrawMeshTasksIndirectCountEXT = (PFN_vkCmdDrawMeshTasksIndirectCountEXT)vkGetDeviceProcAddr(
+        *VkCore::DeviceManager::GetDevice(), "vkCmdDrawMeshTasksIndirectCountEXT");
 #endif
 
     m_Camera =
-        Camera({0.f, 0.f, -1.f}, {0.f, 0.f, 0.f}, (float)m_Window->GetWidth() / m_Window->GetHeight(), 45.f, 50.f);
+        Camera({0.f, 0.f, -1.f}, {0.f, 0.f, 0.f}, (float)m_Renderer.GetWidth() / m_Renderer.GetHeight(), 45.f, 50.f);
     m_CurrentCamera = &m_Camera;
     m_FrustumCamera =
-        Camera({0.f, 0.f, -1.f}, {0.f, 0.f, 0.f}, (float)m_Window->GetWidth() / m_Window->GetHeight(), 45.f, 25.f);
+        Camera({0.f, 0.f, -1.f}, {0.f, 0.f, 0.f}, (float)m_Renderer.GetWidth() / m_Renderer.GetHeight(), 45.f, 25.f);
 
     m_ZenithAngle = m_FrustumCamera.GetZenith();
     m_AzimuthAngle = m_FrustumCamera.GetAzimuth();
     m_Position = m_FrustumCamera.GetPosition();
 
     // Create Uniform Buffers
-    for (int i = 0; i < m_Renderer.m_Swapchain.GetImageCount(); i++)
+    for (int i = 0; i < m_Renderer.GetFramesInFlight(); i++)
     {
         VkCore::Buffer matBuffer = VkCore::Buffer(vk::BufferUsageFlagBits::eUniformBuffer);
         matBuffer.InitializeOnCpu(sizeof(FrustumMatrixBuffer));
@@ -85,7 +90,7 @@ void InstancingApplication::Run(const uint32_t winWidth, const uint32_t winHeigh
     // Camera Matrix Descriptor Sets
     m_DescriptorBuilder = VkCore::DescriptorBuilder(VkCore::DeviceManager::GetDevice());
 
-    for (uint32_t i = 0; i < m_Renderer.m_Swapchain.GetImageCount(); i++)
+    for (uint32_t i = 0; i < m_Renderer.GetFramesInFlight(); i++)
     {
         vk::DescriptorSet tempSet;
 
@@ -98,45 +103,55 @@ void InstancingApplication::Run(const uint32_t winWidth, const uint32_t winHeigh
         m_MatrixDescriptorSets.emplace_back(tempSet);
     }
 
+    InitializeScene();
     InitializeInstancing();
 
+    // The geometry and the tables of the scene go out in a single submission, the frames are ordered after it.
+    m_SceneUploadValue = m_Renderer.GetUploader().Flush();
+
+    m_PipelineFactory.Initialize();
+
+    // The pipelines are built on the workers, the first frame waits for them. The bounds pipeline is only used by the
+    // disabled bounds pass, so it's left to InitializeBoundsPipeline to build it once the pass is needed.
+    m_Renderer.BeginPipelineCreation();
     InitializeModelPipeline();
+    InitializeScenePipeline();
     InitializeAxisPipeline();
-    InitializeBoundsPipeline();
     InitializeFrustumPipeline();
 
     Loop();
+
+    m_Renderer.WriteHeadlessCapture();
     Shutdown();
 }
 
 void InstancingApplication::InitializeModelPipeline()
 {
-
-    const std::vector<VkCore::ShaderData> shaders =
-        VkCore::ShaderLoader::LoadMeshShaders("MeshInstancing/Res/Shaders/instancing");
-
-    m_Model = new Model("MeshInstancing/Res/Artwork/OBJs/happy_smoothed.obj");
-
-    // Pipeline
-    VkCore::GraphicsPipelineBuilder pipelineBuilder(VkCore::DeviceManager::GetDevice(), true);
-
-    m_ModelPipeline = pipelineBuilder.BindShaderModules(shaders)
-                          .BindRenderPass(m_Renderer.m_RenderPass.GetVkRenderPass())
-                          .EnableDepthTest()
-                          .AddViewport(glm::uvec4(0, 0, m_Window->GetWidth(), m_Window->GetHeight()))
-                          .FrontFaceDirection(vk::FrontFace::eClockwise)
-                          .SetCullMode(vk::CullModeFlagBits::eBack)
-                          .AddDisabledBlendAttachment()
-                          .AddDescriptorLayout(m_MatrixDescSetLayout)
-                          .AddDescriptorLayout(m_Model->GetMeshes()[0].GetDescriptorSetLayout())
-                          .AddDescriptorLayout(m_InstancesDescSetLayout)
-                          .AddPushConstantRange<FragmentPC>(vk::ShaderStageFlagBits::eFragment)
-                          .AddPushConstantRange<MeshPC>(
-                              vk::ShaderStageFlagBits::eMeshEXT | vk::ShaderStageFlagBits::eTaskEXT, sizeof(FragmentPC))
-                          .SetPrimitiveAssembly(vk::PrimitiveTopology::eTriangleList)
-                          .AddDynamicState(vk::DynamicState::eScissor)
-                          .AddDynamicState(vk::DynamicState::eViewport)
-                          .Build(m_ModelPipelineLayout);
+    m_ModelPipelineBuild = m_PipelineFactory.Submit([this, &pipelineCache = m_Renderer.GetPipelineCache()]() {
+        const std::vector<ShaderBinary> shaders = LoadMeshShaders("MeshInstancing/Res/Shaders/instancing");
+
+        GraphicsPipelineBuilder pipelineBuilder(pipelineCache);
+
+        m_ModelPipeline = pipelineBuilder.BindShaderModules(shaders)
+                              .BindRenderPass(m_Renderer.GetVkRenderPass())
+                              .EnableDepthTest()
+                              .AddViewport(glm::uvec4(0, 0, m_Renderer.GetWidth(), m_Renderer.GetHeight()))
+                              .FrontFaceDirection(vk::FrontFace::eClockwise)
+                              .SetCullMode(vk::CullModeFlagBits::eBack)
+                              .AddDisabledBlendAttachment()
+                              .AddDescriptorLayout(m_MatrixDescSetLayout)
+                              .AddDescriptorLayout(m_SceneDescSetLayout)
+                              .AddDescriptorLayout(m_InstancesDescSetLayout)
+                              .AddDescriptorLayout(m_TaskWorkSetLayout)
+                              .AddPushConstantRange<FragmentPC>(vk::ShaderStageFlagBits::eFragment)
+                              .AddPushConstantRange<MeshPC>(vk::ShaderStageFlagBits::eMeshEXT |
+                                                                vk::ShaderStageFlagBits::eTaskEXT,
+                                                            sizeof(FragmentPC))
+                              .SetPrimitiveAssembly(vk::PrimitiveTopology::eTriangleList)
+                              .AddDynamicState(vk::DynamicState::eScissor)
+                              .AddDynamicState(vk::DynamicState::eViewport)
+                              .Build(m_ModelPipelineLayout);
+    });
 }
 
 void InstancingApplication::InitializeAxisPipeline()
@@ -156,133 +171,373 @@ void InstancingApplication::InitializeAxisPipeline()
     m_AxisIndexBuffer = VkCore::Buffer(vk::BufferUsageFlagBits::eIndexBuffer);
     m_AxisIndexBuffer.InitializeOnGpu(&m_AxisIndexData, sizeof(uint32_t) * 6);
 
-    VkCore::VertexAttributeBuilder attributeBuilder{};
-
-    attributeBuilder.PushAttribute<float>(3);
-    attributeBuilder.SetBinding(0);
-
-    std::vector<VkCore::ShaderData> shaderData =
-        VkCore::ShaderLoader::LoadClassicShaders("MeshInstancing/Res/Shaders/axis");
-    VkCore::GraphicsPipelineBuilder pipelineBuilder(VkCore::DeviceManager::GetDevice());
-
-    m_AxisPipeline = pipelineBuilder.BindShaderModules(shaderData)
-                         .BindRenderPass(m_Renderer.m_RenderPass.GetVkRenderPass())
-                         .AddViewport(glm::uvec4(0, 0, m_Window->GetWidth(), m_Window->GetHeight()))
-                         .FrontFaceDirection(vk::FrontFace::eCounterClockwise)
-                         .SetCullMode(vk::CullModeFlagBits::eBack)
-                         .BindVertexAttributes(attributeBuilder)
-                         .AddDisabledBlendAttachment()
-                         .AddDescriptorLayout(m_MatrixDescSetLayout)
-                         .SetPrimitiveAssembly(vk::PrimitiveTopology::eLineList)
-                         .AddDynamicState(vk::DynamicState::eScissor)
-                         .AddDynamicState(vk::DynamicState::eViewport)
-                         .Build(m_AxisPipelineLayout);
+    m_AxisPipelineBuild = m_PipelineFactory.Submit([this, &pipelineCache = m_Renderer.GetPipelineCache()]() {
+        VertexLayout vertexLayout;
+
+        vertexLayout.PushAttribute<float>(3);
+        vertexLayout.SetBinding(0);
+
+        const std::vector<ShaderBinary> shaderData = LoadClassicShaders("MeshInstancing/Res/Shaders/axis");
+        GraphicsPipelineBuilder pipelineBuilder(pipelineCache);
+
+        m_AxisPipeline = pipelineBuilder.BindShaderModules(shaderData)
+                             .BindRenderPass(m_Renderer.GetVkRenderPass())
+                             .AddViewport(glm::uvec4(0, 0, m_Renderer.GetWidth(), m_Renderer.GetHeight()))
+                             .FrontFaceDirection(vk::FrontFace::eCounterClockwise)
+                             .SetCullMode(vk::CullModeFlagBits::eBack)
+                             .BindVertexAttributes(vertexLayout)
+                             .AddDisabledBlendAttachment()
+                             .AddDescriptorLayout(m_MatrixDescSetLayout)
+                             .SetPrimitiveAssembly(vk::PrimitiveTopology::eLineList)
+                             .AddDynamicState(vk::DynamicState::eScissor)
+                             .AddDynamicState(vk::DynamicState::eViewport)
+                             .Build(m_AxisPipelineLayout);
+    });
 }
 
 void InstancingApplication::InitializeBoundsPipeline()
 {
+    // Built on the first use only, it's a debug view.
+    if (m_BoundsPipelineBuild.valid())
+    {
+        return;
+    }
 
     m_Sphere = SphereModel(Vec3f(0.f, 0.f, 0.f));
 
-    VkCore::VertexAttributeBuilder attributeBuilder;
-
-    attributeBuilder.PushAttribute<float>(3).PushAttribute<float>(3).PushAttribute<float>(3);
-
-    VkCore::GraphicsPipelineBuilder pipelineBuilder(VkCore::DeviceManager::GetDevice());
-
-    std::vector<VkCore::ShaderData> shaderData =
-        VkCore::ShaderLoader::LoadClassicShaders("MeshInstancing/Res/Shaders/bounds");
-
-    m_BoundsPipeline = pipelineBuilder.BindShaderModules(shaderData)
-                           .BindRenderPass(m_Renderer.m_RenderPass.GetVkRenderPass())
-                           .EnableDepthTest()
-                           .AddViewport(glm::uvec4(0, 0, m_Window->GetWidth(), m_Window->GetHeight()))
-                           .FrontFaceDirection(vk::FrontFace::eClockwise)
-                           .SetCullMode(vk::CullModeFlagBits::eNone)
-                           .BindVertexAttributes(attributeBuilder)
-                           .AddDisabledBlendAttachment()
-                           .AddDescriptorLayout(m_MatrixDescSetLayout)
-                           .AddDescriptorLayout(m_Model->GetMeshes()[0].GetDescriptorSetLayout())
-                           .SetPrimitiveAssembly(vk::PrimitiveTopology::eLineList)
-                           .AddDynamicState(vk::DynamicState::eScissor)
-                           .AddDynamicState(vk::DynamicState::eViewport)
-                           .Build(m_BoundsPipelineLayout);
+    m_BoundsPipelineBuild = m_PipelineFactory.Submit([this, &pipelineCache = m_Renderer.GetPipelineCache()]() {
+        VertexLayout vertexLayout;
+
+        vertexLayout.PushAttribute<float>(3).PushAttribute<float>(3).PushAttribute<float>(3);
+
+        GraphicsPipelineBuilder pipelineBuilder(pipelineCache);
+
+        const std::vector<ShaderBinary> shaderData = LoadClassicShaders("MeshInstancing/Res/Shaders/bounds");
+
+        m_BoundsPipeline = pipelineBuilder.BindShaderModules(shaderData)
+                               .BindRenderPass(m_Renderer.GetVkRenderPass())
+                               .EnableDepthTest()
+                               .AddViewport(glm::uvec4(0, 0, m_Renderer.GetWidth(), m_Renderer.GetHeight()))
+                               .FrontFaceDirection(vk::FrontFace::eClockwise)
+                               .SetCullMode(vk::CullModeFlagBits::eNone)
+                               .BindVertexAttributes(vertexLayout)
+                               .AddDisabledBlendAttachment()
+                               .AddDescriptorLayout(m_MatrixDescSetLayout)
+                               .AddDescriptorLayout(m_SceneDescSetLayout)
+                               .SetPrimitiveAssembly(vk::PrimitiveTopology::eLineList)
+                               .AddDynamicState(vk::DynamicState::eScissor)
+                               .AddDynamicState(vk::DynamicState::eViewport)
+                               .Build(m_BoundsPipelineLayout);
+    });
 }
 
 void InstancingApplication::InitializeFrustumPipeline()
 {
     std::tie(m_FrustumBuffer, m_FrustumIndexBuffer) = m_FrustumCamera.ConstructFrustumModel();
 
-    VkCore::VertexAttributeBuilder attributeBuilder{};
-
-    attributeBuilder.PushAttribute<float>(3).PushAttribute<float>(3).PushAttribute<float>(3);
-    attributeBuilder.SetBinding(0);
-
-    std::vector<VkCore::ShaderData> shaderData =
-        VkCore::ShaderLoader::LoadClassicShaders("MeshletCulling/Res/Shaders/frustum");
-
-    VkCore::GraphicsPipelineBuilder pipelineBuilder(VkCore::DeviceManager::GetDevice());
-
-    m_FrustumPipeline = pipelineBuilder.BindShaderModules(shaderData)
-                            .BindRenderPass(m_Renderer.m_RenderPass.GetVkRenderPass())
-                            .AddViewport(glm::uvec4(0, 0, m_Window->GetWidth(), m_Window->GetHeight()))
-                            .FrontFaceDirection(vk::FrontFace::eCounterClockwise)
-                            .SetCullMode(vk::CullModeFlagBits::eNone)
-                            .BindVertexAttributes(attributeBuilder)
-                            .AddDisabledBlendAttachment()
-                            .SetLineWidth(2.f)
-                            .AddDescriptorLayout(m_MatrixDescSetLayout)
-                            .SetPrimitiveAssembly(vk::PrimitiveTopology::eLineList)
-                            .AddDynamicState(vk::DynamicState::eScissor)
-                            .AddDynamicState(vk::DynamicState::eViewport)
-                            .Build(m_FrustumPipelineLayout);
+    m_FrustumPipelineBuild = m_PipelineFactory.Submit([this, &pipelineCache = m_Renderer.GetPipelineCache()]() {
+        VertexLayout vertexLayout;
+
+        vertexLayout.PushAttribute<float>(3).PushAttribute<float>(3).PushAttribute<float>(3);
+        vertexLayout.SetBinding(0);
+
+        const std::vector<ShaderBinary> shaderData = LoadClassicShaders("MeshletCulling/Res/Shaders/frustum");
+
+        GraphicsPipelineBuilder pipelineBuilder(pipelineCache);
+
+        m_FrustumPipeline = pipelineBuilder.BindShaderModules(shaderData)
+                                .BindRenderPass(m_Renderer.GetVkRenderPass())
+                                .AddViewport(glm::uvec4(0, 0, m_Renderer.GetWidth(), m_Renderer.GetHeight()))
+                                .FrontFaceDirection(vk::FrontFace::eCounterClockwise)
+                                .SetCullMode(vk::CullModeFlagBits::eNone)
+                                .BindVertexAttributes(vertexLayout)
+                                .AddDisabledBlendAttachment()
+                                .SetLineWidth(2.f)
+                                .AddDescriptorLayout(m_MatrixDescSetLayout)
+                                .SetPrimitiveAssembly(vk::PrimitiveTopology::eLineList)
+                                .AddDynamicState(vk::DynamicState::eScissor)
+                                .AddDynamicState(vk::DynamicState::eViewport)
+                                .Build(m_FrustumPipelineLayout);
+    });
+}
+
+void InstancingApplication::InitializeScene()
+{
+    for (const char* path : m_AvailableModels)
+    {
+        m_Scene.AddModel(path);
+    }
+
+    m_Scene.Build(m_Renderer.GetUploader());
+
+    // The geometry itself is reached through the device addresses in the mesh table, so the set stays the same no
+    // matter how many meshes the scene has.
+    m_DescriptorBuilder
+        .BindBuffer(0, m_Scene.GetMeshInfoBuffer(), vk::DescriptorType::eStorageBuffer,
+                    vk::ShaderStageFlagBits::eMeshEXT | vk::ShaderStageFlagBits::eTaskEXT |
+                        vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eCompute)
+        .BindBuffer(1, m_Scene.GetModelInfoBuffer(), vk::DescriptorType::eStorageBuffer,
+                    vk::ShaderStageFlagBits::eCompute)
+        .Build(m_SceneDescSet, m_SceneDescSetLayout);
+
+    m_DescriptorBuilder.Clear();
 }
 
 void InstancingApplication::InitializeInstancing()
 {
+    m_SceneSettings.modelCount = m_Scene.GetModelCount();
+
+    CreateInstanceBuffers();
 
-    const glm::vec3 span = glm::vec3(1.f);
+    m_DescriptorBuilder
+        .BindBuffer(0, m_Streamer.GetInstanceBuffer(), vk::DescriptorType::eStorageBuffer,
+                    vk::ShaderStageFlagBits::eMeshEXT | vk::ShaderStageFlagBits::eTaskEXT |
+                        vk::ShaderStageFlagBits::eCompute)
+        .BindBuffer(1, m_Streamer.GetPageBuffer(), vk::DescriptorType::eStorageBuffer,
+                    vk::ShaderStageFlagBits::eCompute)
+        .BindBuffer(2, m_Streamer.GetSectorBuffer(), vk::DescriptorType::eStorageBuffer,
+                    vk::ShaderStageFlagBits::eCompute)
+        .BindBuffer(3, m_Streamer.GetFeedbackBuffer(), vk::DescriptorType::eStorageBuffer,
+                    vk::ShaderStageFlagBits::eCompute)
+        .Build(m_InstancesDescSet, m_InstancesDescSetLayout);
 
-    std::vector<glm::mat4> instances;
-    instances.resize(m_InstanceCountMax);
+    m_DescriptorBuilder.Clear();
 
-    for (uint32_t z = 0; z < m_InstanceSize.z; z++)
+    for (uint32_t i = 0; i < m_Renderer.GetFramesInFlight(); i++)
     {
-        for (uint32_t y = 0; y < m_InstanceSize.y; y++)
-        {
-            for (uint32_t x = 0; x < m_InstanceSize.x; x++)
-            {
-                glm::vec3 instancePos = {x * span.x, y * span.y, z * span.z};
+        vk::DescriptorSet set;
 
-                const uint32_t index = x + m_InstanceSize.y * y + m_InstanceSize.x * m_InstanceSize.y * z;
+        m_DescriptorBuilder
+            .BindBuffer(0, m_TaskWorkBuffers[i], vk::DescriptorType::eStorageBuffer,
+                        vk::ShaderStageFlagBits::eCompute | vk::ShaderStageFlagBits::eTaskEXT)
+            .BindBuffer(1, m_TaskInstanceBuffers[i], vk::DescriptorType::eStorageBuffer,
+                        vk::ShaderStageFlagBits::eCompute | vk::ShaderStageFlagBits::eTaskEXT)
+            .BindBuffer(2, m_TransformCacheBuffers[i], vk::DescriptorType::eStorageBuffer,
+                        vk::ShaderStageFlagBits::eCompute | vk::ShaderStageFlagBits::eMeshEXT)
+            .Build(set, m_TaskWorkSetLayout);
 
-                instances[index] = (glm::translate(glm::identity<glm::mat4>(), instancePos));
-            }
-        }
+        m_TaskWorkSets.emplace_back(set);
+
+        m_DescriptorBuilder.Clear();
+
+        m_VisibleMeshletReadbacks.emplace_back();
+        m_VisibleMeshletReadbacks[i].Initialize(sizeof(uint32_t), vk::BufferUsageFlagBits::eTransferDst);
+
+        m_DurationQueries.emplace_back(std::make_unique<DurationQuery>());
+        m_HasFrameResults.emplace_back(false);
     }
 
-    m_InstancesBuffer = VkCore::Buffer(vk::BufferUsageFlagBits::eStorageBuffer);
-    m_InstancesBuffer.InitializeOnGpu(instances.data(), instances.size() * sizeof(glm::mat4));
+    mesh_pc.packed_instances = m_InstanceFormat == EInstanceFormat::Packed;
+    scene_pc.packed_instances = m_InstanceFormat == EInstanceFormat::Packed;
+}
 
-    m_DescriptorBuilder
-        .BindBuffer(0, m_InstancesBuffer, vk::DescriptorType::eStorageBuffer,
-                    vk::ShaderStageFlagBits::eMeshEXT | vk::ShaderStageFlagBits::eTaskEXT)
-        .Build(m_InstancesDescSet, m_InstancesDescSetLayout);
+void InstancingApplication::CreateInstanceBuffers()
+{
+    const std::vector<PackedInstance> packedInstances = GenerateScene(m_SceneSettings);
+
+    m_Streamer.Initialize(packedInstances, m_InstanceFormat, m_StreamingSettings,
+                          m_Renderer.GetFramesInFlight(),
+                          vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTaskShaderEXT |
+                              vk::PipelineStageFlagBits::eMeshShaderEXT);
+
+    // The culling pass and the per instance buffers cover the slots of the pool rather than the instances of the
+    // scene, which bounds them by the pool when streaming.
+    m_InstanceCountMax = m_Streamer.GetSlotCount();
+    m_InstanceCount = std::min((uint32_t)m_InstanceCount, m_InstanceCountMax);
+
+    LOGF(Application, Info, "Instance buffer: %u instances in %u slots, %.2f MB", (uint32_t)packedInstances.size(),
+         m_InstanceCountMax, m_Streamer.GetInstanceBuffer().GetSize() / (1024.f * 1024.f))
+
+    // The work list is split into several indirect commands, so it's only bounded by the commands of the header
+    // and by the memory budget, not by the workgroup count of a single dispatch.
+    const TaskDispatchLimits limits = QueryTaskDispatchLimits();
+
+    const uint64_t requiredCapacity = (uint64_t)m_InstanceCountMax * m_Scene.GetMaxTasksPerInstance();
+    const uint64_t maxCapacity = std::min((uint64_t)SCENE_MAX_TASK_COMMANDS * limits.maxGroupCountX,
+                                          SCENE_TASK_WORK_BUDGET / sizeof(SceneTaskWork));
+
+    m_TaskWorkCapacity = (uint32_t)std::min(std::max(requiredCapacity, (uint64_t)1), maxCapacity);
+
+    scene_pc.work_capacity = m_TaskWorkCapacity;
+    scene_pc.max_task_groups = limits.maxGroupCountX;
+    mesh_pc.max_task_groups = limits.maxGroupCountX;
+
+    LOGF(Application, Info, "Task work list: %u workgroups in up to %u commands", m_TaskWorkCapacity,
+         GetTaskCommandCount(m_TaskWorkCapacity, limits))
+
+    if (m_TaskWorkCapacity < requiredCapacity)
+    {
+        LOGF(Application, Info, "The task work list is limited to %u workgroups, some instances won't be drawn!",
+             m_TaskWorkCapacity)
+    }
+
+    m_TransformCacheCapacity = (uint32_t)std::min((uint64_t)std::max(m_InstanceCountMax, 1u),
+                                                  SCENE_TRANSFORM_CACHE_BUDGET / sizeof(CachedInstanceTransform));
+
+    if (m_TransformCacheCapacity < m_InstanceCountMax)
+    {
+        LOGF(Application, Info, "The transform cache is limited to %u instances, the rest is transformed per meshlet",
+             m_TransformCacheCapacity)
+    }
+
+    for (uint32_t i = 0; i < m_Renderer.GetFramesInFlight(); i++)
+    {
+        // Header of the indirect mesh tasks command and the counters, followed by the task workgroups.
+        m_TaskWorkBuffers.emplace_back(vk::BufferUsageFlagBits::eStorageBuffer |
+                                       vk::BufferUsageFlagBits::eIndirectBuffer |
+                                       vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc);
+        m_TaskWorkBuffers[i].InitializeOnGpu(SCENE_TASK_WORK_HEADER_SIZE + m_TaskWorkCapacity * sizeof(SceneTaskWork));
+
+        // Every instance is listed at most once per frame.
+        m_TaskInstanceBuffers.emplace_back(vk::BufferUsageFlagBits::eStorageBuffer);
+        m_TaskInstanceBuffers[i].InitializeOnGpu(std::max(m_InstanceCountMax, 1u) * sizeof(uint32_t));
+
+        m_TransformCacheBuffers.emplace_back(vk::BufferUsageFlagBits::eStorageBuffer);
+        m_TransformCacheBuffers[i].InitializeOnGpu((uint64_t)m_TransformCacheCapacity *
+                                                   sizeof(CachedInstanceTransform));
+    }
+}
+
+void InstancingApplication::DestroyInstanceBuffers()
+{
+    m_Streamer.Destroy();
+
+    for (VkCore::Buffer& buffer : m_TaskWorkBuffers)
+    {
+        buffer.Destroy();
+    }
+
+    m_TaskWorkBuffers.clear();
+
+    for (VkCore::Buffer& buffer : m_TaskInstanceBuffers)
+    {
+        buffer.Destroy();
+    }
+
+    m_TaskInstanceBuffers.clear();
+
+    for (VkCore::Buffer& buffer : m_TransformCacheBuffers)
+    {
+        buffer.Destroy();
+    }
+
+    m_TransformCacheBuffers.clear();
+}
+
+void InstancingApplication::RegenerateInstances()
+{
+    vk::Device device = *VkCore::DeviceManager::GetDevice();
+    device.waitIdle();
+
+    // The results of the finished frames belong to the previous scene and its streaming state.
+    std::fill(m_HasFrameResults.begin(), m_HasFrameResults.end(), false);
+
+    DestroyInstanceBuffers();
+    CreateInstanceBuffers();
+
+    // The layouts are referenced by the pipelines, so the existing sets are just pointed to the new buffers.
+    std::vector<vk::DescriptorBufferInfo> bufferInfos;
+    bufferInfos.reserve(m_TaskWorkBuffers.size() * 3 + 4);
+    bufferInfos.emplace_back(m_Streamer.GetInstanceBuffer().GetVkBuffer(), 0, VK_WHOLE_SIZE);
+    bufferInfos.emplace_back(m_Streamer.GetPageBuffer().GetVkBuffer(), 0, VK_WHOLE_SIZE);
+    bufferInfos.emplace_back(m_Streamer.GetSectorBuffer().GetVkBuffer(), 0, VK_WHOLE_SIZE);
+    bufferInfos.emplace_back(m_Streamer.GetFeedbackBuffer().GetVkBuffer(), 0, VK_WHOLE_SIZE);
+
+    for (uint32_t i = 0; i < m_TaskWorkBuffers.size(); i++)
+    {
+        bufferInfos.emplace_back(m_TaskWorkBuffers[i].GetVkBuffer(), 0, VK_WHOLE_SIZE);
+        bufferInfos.emplace_back(m_TaskInstanceBuffers[i].GetVkBuffer(), 0, VK_WHOLE_SIZE);
+        bufferInfos.emplace_back(m_TransformCacheBuffers[i].GetVkBuffer(), 0, VK_WHOLE_SIZE);
+    }
+
+    std::vector<vk::WriteDescriptorSet> writes;
+
+    for (uint32_t binding = 0; binding < 4; binding++)
+    {
+        writes.emplace_back(m_InstancesDescSet, binding, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr,
+                            &bufferInfos[binding]);
+    }
+
+    for (uint32_t i = 0; i < m_TaskWorkSets.size(); i++)
+    {
+        writes.emplace_back(m_TaskWorkSets[i], 0, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr,
+                            &bufferInfos[i * 3 + 4]);
+        writes.emplace_back(m_TaskWorkSets[i], 1, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr,
+                            &bufferInfos[i * 3 + 5]);
+        writes.emplace_back(m_TaskWorkSets[i], 2, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr,
+                            &bufferInfos[i * 3 + 6]);
+    }
+
+    device.updateDescriptorSets(writes, {});
+}
+
+uint64_t InstancingApplication::GetInstancingMemoryUsage()
+{
+    uint64_t bytes = m_Streamer.GetMemoryUsage() + m_Scene.GetGeometryPool().GetUsedBytes();
+
+    for (VkCore::Buffer& buffer : m_TaskWorkBuffers)
+    {
+        bytes += buffer.GetSize();
+    }
+
+    for (VkCore::Buffer& buffer : m_TaskInstanceBuffers)
+    {
+        bytes += buffer.GetSize();
+    }
+
+    for (VkCore::Buffer& buffer : m_TransformCacheBuffers)
+    {
+        bytes += buffer.GetSize();
+    }
+
+    return bytes;
+}
+
+void InstancingApplication::InitializeScenePipeline()
+{
+    m_SceneCullPipelineBuild = m_PipelineFactory.Submit([this, &pipelineCache = m_Renderer.GetPipelineCache()]() {
+        const ShaderBinary computeShader = LoadShader("MeshInstancing/Res/Shaders/scene_cull.comp");
+
+        ComputePipelineBuilder pipelineBuilder(pipelineCache);
+
+        m_SceneCullPipeline = pipelineBuilder.BindShaderModule(computeShader)
+                                  .AddPushConstantRange<ScenePC>(vk::ShaderStageFlagBits::eCompute)
+                                  .AddDescriptorLayout(m_MatrixDescSetLayout)
+                                  .AddDescriptorLayout(m_SceneDescSetLayout)
+                                  .AddDescriptorLayout(m_InstancesDescSetLayout)
+                                  .AddDescriptorLayout(m_TaskWorkSetLayout)
+                                  .Build(m_SceneCullPipelineLayout);
+    });
 }
 
 void InstancingApplication::DrawFrame()
 {
 
-    uint32_t imageIndex = m_Renderer.AcquireNextImage();
+    uint32_t frameIndex = m_Renderer.AcquireNextImage();
 
-    if (imageIndex == -1)
+    if (frameIndex == -1)
     {
         m_FramebufferResized = true;
         RecreateSwapchain();
         return;
     }
 
-    const double time = glfwGetTime();
+    // The frame last recorded into this slot is finished by now, so its results are read without stalling on the
+    // frames still in flight.
+    if (m_HasFrameResults[frameIndex])
+    {
+        m_GpuMs = m_DurationQueries[frameIndex]->GetResults() / 1000000.f;
+        m_VisibleMeshlets = *static_cast<const uint32_t*>(m_VisibleMeshletReadbacks[frameIndex].GetData());
+        m_Streamer.ReadFeedback(frameIndex);
+
+        m_Benchmark.AddFrame(m_CpuMs, m_GpuMs, m_VisibleMeshlets);
+    }
+
+    m_Scene.ReleaseSourceModels(m_Renderer.GetUploader(), m_SceneUploadValue);
+
+    const auto cpuStart = std::chrono::high_resolution_clock::now();
+
+    const double time = m_Renderer.GetTime();
 
     m_CurrentCamera->Update();
 
@@ -305,26 +560,87 @@ void InstancingApplication::DrawFrame()
     fragment_pc.cam_pos = m_CurrentCamera->GetPosition();
     fragment_pc.cam_view_dir = m_CurrentCamera->GetViewDirection();
 
-    m_Renderer.BeginDraw({0.3f, 0.f, 0.2f, 1.f}, m_Window->GetWidth(), m_Window->GetHeight());
-
-    m_MatBuffers[imageIndex].UpdateData(&ubo);
+    m_MatBuffers[frameIndex].UpdateData(&ubo);
 
+    m_Renderer.BeginCmdBuffer();
     vk::CommandBuffer commandBuffer = m_Renderer.GetCurrentCmdBuffer();
 
-    vk::Rect2D scissor = vk::Rect2D({0, 0}, {m_Window->GetWidth(), m_Window->GetHeight()});
+    DurationQuery& durationQuery = *m_DurationQueries[frameIndex];
+    durationQuery.Reset(commandBuffer);
+
+    scene_pc.instance_count = (uint32_t)m_InstanceCount;
+    scene_pc.pack_small_meshes = m_PackSmallMeshes;
+    mesh_pc.pack_small_meshes = m_PackSmallMeshes;
+
+    // The culling pass visits every instance once per frame, so it computes the transforms for the mesh shader
+    scene_pc.transform_cache_count =
+        m_UseTransformCache ? std::min(scene_pc.instance_count, m_TransformCacheCapacity) : 0;
+    scene_pc.model_mat = mesh_pc.rotation_mat * mesh_pc.scale_mat;
+    mesh_pc.transform_cache_count = scene_pc.transform_cache_count;
+
+    // Stream the sectors around the culling camera in and out of the instance pool
+    m_Streamer.RecordUploads(commandBuffer, frameIndex, m_FrustumCamera.GetPosition());
+    scene_pc.frame = m_Streamer.GetFrame();
+
+    {
+        // Expand the instances of all models into the task workgroups of their meshes
+        VkCore::Buffer& taskWork = m_TaskWorkBuffers[frameIndex];
+
+        // Zero counters and commands, the culling pass fills in the commands it writes workgroups to.
+        commandBuffer.fillBuffer(taskWork.GetVkBuffer(), 0, SCENE_TASK_WORK_HEADER_SIZE, 0);
+
+        vk::BufferMemoryBarrier clearBarrier = taskWork.CreateBufferMemoryBarrier(
+            vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader,
+                                      {}, {}, clearBarrier, {});
+
+        durationQuery.StartTimestamp(commandBuffer, vk::PipelineStageFlagBits::eComputeShader);
+
+        m_SceneCullPipelineBuild.get();
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_SceneCullPipeline);
+        commandBuffer.bindDescriptorSets(
+            vk::PipelineBindPoint::eCompute, m_SceneCullPipelineLayout, 0,
+            {m_MatrixDescriptorSets[frameIndex], m_SceneDescSet, m_InstancesDescSet, m_TaskWorkSets[frameIndex]}, {});
+
+        commandBuffer.pushConstants(m_SceneCullPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(ScenePC),
+                                    &scene_pc);
+
+        // Rows of at most the guaranteed workgroup count, the shader flattens them back.
+        const uint32_t groupCount = ((uint32_t)m_InstanceCount / 32) + 1;
+        const uint32_t rowSize = std::min(groupCount, 65535u);
+
+        commandBuffer.dispatch(rowSize, (groupCount + rowSize - 1) / rowSize, 1);
+
+        vk::MemoryBarrier memoryBarrier;
+        memoryBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+        memoryBarrier.dstAccessMask = vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead;
+
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                      vk::PipelineStageFlagBits::eDrawIndirect |
+                                          vk::PipelineStageFlagBits::eTaskShaderEXT |
+                                          vk::PipelineStageFlagBits::eMeshShaderEXT,
+                                      {}, memoryBarrier, {}, {});
+
+        m_Streamer.RecordFeedbackReadback(commandBuffer, frameIndex);
+    }
+
+    m_Renderer.BeginRenderPass({0.3f, 0.f, 0.2f, 1.f}, m_Renderer.GetWidth(), m_Renderer.GetHeight());
+
+    vk::Rect2D scissor = vk::Rect2D({0, 0}, {m_Renderer.GetWidth(), m_Renderer.GetHeight()});
     commandBuffer.setScissor(0, 1, &scissor);
 
-    vk::Viewport viewport = vk::Viewport(0, 0, m_Window->GetWidth(), m_Window->GetHeight(), 0, 1);
+    vk::Viewport viewport = vk::Viewport(0, 0, m_Renderer.GetWidth(), m_Renderer.GetHeight(), 0, 1);
     commandBuffer.setViewport(0, 1, &viewport);
 
     {
-
+        m_ModelPipelineBuild.get();
         commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_ModelPipeline);
         commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_ModelPipelineLayout, 0, 1,
-                                         &m_MatrixDescriptorSets[imageIndex], 0, nullptr);
+                                         &m_MatrixDescriptorSets[frameIndex], 0, nullptr);
 
-        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_ModelPipelineLayout, 2, 1,
-                                         &m_InstancesDescSet, 0, nullptr);
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_ModelPipelineLayout, 1,
+                                         {m_SceneDescSet, m_InstancesDescSet, m_TaskWorkSets[frameIndex]}, {});
 
         commandBuffer.pushConstants(m_ModelPipelineLayout, vk::ShaderStageFlagBits::eFragment, 0, sizeof(FragmentPC),
                                     &fragment_pc);
@@ -333,46 +649,40 @@ void InstancingApplication::DrawFrame()
                                     vk::ShaderStageFlagBits::eMeshNV | vk::ShaderStageFlagBits ::eTaskEXT,
                                     sizeof(FragmentPC), sizeof(MeshPC), &mesh_pc);
 
-        for (const Mesh& mesh : m_Model->GetMeshes())
-        {
-            const vk::DescriptorSetLayout layout = mesh.GetDescriptorSetLayout();
-            const vk::DescriptorSet set = mesh.GetDescriptorSet();
-
-            mesh_pc.meshlet_count = mesh.GetMeshletCount();
-
-            commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_ModelPipelineLayout, 1, 1, &set, 0,
-                                             nullptr);
-
+        // All instances of all models at once, the commands and their count are written by the culling pass
 #ifndef VK_MESH_EXT
-            vkCmdDrawMeshTasksNv(&*commandBuffer, mesh.GetMeshletCount(), 0);
+        vkCmdDrawMeshTasksNv(&*commandBuffer, m_Scene.GetMeshletCount(), 0);
 #else
-            vkCmdDrawMeshTasksEXT(&*commandBuffer, (mesh.GetMeshletCount() / 32) + 1,
-                                  m_InstanceCount, 1);
+        const VkBuffer taskWorkBuffer = m_TaskWorkBuffers[frameIndex].GetVkBuffer();
+
+        vkCmdDrawMeshTasksIndirectCountEXT(&*commandBuffer, taskWorkBuffer, SCENE_TASK_COMMANDS_OFFSET, taskWorkBuffer,
+                                           0, SCENE_MAX_TASK_COMMANDS, sizeof(VkDrawMeshTasksIndirectCommandEXT));
 #endif
-        }
+
+        durationQuery.EndTimestamp(commandBuffer, vk::PipelineStageFlagBits::eEarlyFragmentTests);
     }
 
     // {
+    //     InitializeBoundsPipeline();
+    //     m_BoundsPipelineBuild.get();
+    //
     //     commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_BoundsPipeline);
     //     commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_BoundsPipelineLayout, 0, 1,
-    //                                      &m_MatrixDescriptorSets[imageIndex], 0, nullptr);
+    //                                      &m_MatrixDescriptorSets[frameIndex], 0, nullptr);
     //
     //     commandBuffer.bindVertexBuffers(0, m_Sphere.m_Vertexbuffer.GetVkBuffer(), {0});
     //     commandBuffer.bindIndexBuffer(m_Sphere.m_IndexBuffer.GetVkBuffer(), 0, vk::IndexType::eUint32);
     //
-    //     for (const Mesh& mesh : m_Model->GetMeshes())
-    //     {
-    //         const vk::DescriptorSet& set = mesh.GetDescriptorSet();
-    //         commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_BoundsPipelineLayout, 1, 1, &set, 0,
-    //                                          nullptr);
-    //         commandBuffer.drawIndexed(m_Sphere.indices.size(), mesh.GetMeshletCount(), 0, 0, 0);
-    //     }
+    //     commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_BoundsPipelineLayout, 1, 1,
+    //                                      &m_SceneDescSet, 0, nullptr);
+    //     commandBuffer.drawIndexed(m_Sphere.indices.size(), m_Scene.GetMeshletCount(), 0, 0, 0);
     // }
 
     {
+        m_AxisPipelineBuild.get();
         commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_AxisPipeline);
         commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_AxisPipelineLayout, 0, 1,
-                                         &m_MatrixDescriptorSets[imageIndex], 0, nullptr);
+                                         &m_MatrixDescriptorSets[frameIndex], 0, nullptr);
 
         commandBuffer.bindVertexBuffers(0, m_AxisBuffer.GetVkBuffer(), {0});
 
@@ -381,10 +691,10 @@ void InstancingApplication::DrawFrame()
     }
 
     {
-
+        m_FrustumPipelineBuild.get();
         commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_FrustumPipeline);
         commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_FrustumPipelineLayout, 0, 1,
-                                         &m_MatrixDescriptorSets[imageIndex], 0, nullptr);
+                                         &m_MatrixDescriptorSets[frameIndex], 0, nullptr);
 
         commandBuffer.bindVertexBuffers(0, m_FrustumBuffer.GetVkBuffer(), {0});
 
@@ -393,7 +703,7 @@ void InstancingApplication::DrawFrame()
     }
 
     {
-        m_Renderer.ImGuiNewFrame(m_Window->GetWidth(), m_Window->GetHeight());
+        m_Renderer.ImGuiNewFrame(m_Renderer.GetWidth(), m_Renderer.GetHeight());
 
         static bool open = true;
 
@@ -404,8 +714,119 @@ void InstancingApplication::DrawFrame()
 
         if (ImGui::Begin("Instancing", &open))
         {
+			ImGui::Text("Models: %u, meshes: %u, meshlets: %u", m_Scene.GetModelCount(), m_Scene.GetMeshCount(),
+						m_Scene.GetMeshletCount());
+			ImGui::Text("Geometry pool in MB: %.2f (%u blocks)",
+						m_Scene.GetGeometryPool().GetUsedBytes() / (1024.f * 1024.f),
+						m_Scene.GetGeometryPool().GetBlockCount());
+			ImGui::Text("Instance buffer (%s) in MB: %.2f",
+						m_InstanceFormat == EInstanceFormat::Packed ? "packed" : "mat4",
+						m_Streamer.GetInstanceBuffer().GetSize() / (1024.f * 1024.f));
 			ImGui::Text("Instance Count");
 			ImGui::SliderInt("##Instance Count", &m_InstanceCount, 0, (int)m_InstanceCountMax, "%d", ImGuiSliderFlags_AlwaysClamp);
+
+			ImGui::Text("Cull + Task/Mesh Shader execution in ms: %.4f", m_GpuMs);
+			ImGui::Text("CPU frame recording in ms: %.4f", m_CpuMs);
+			ImGui::Text("Visible meshlets: %u", m_VisibleMeshlets);
+
+			ImGui::Text("Pack Small Meshes");
+			ImGui::Checkbox("##Pack Small Meshes", &m_PackSmallMeshes);
+
+			ImGui::Text("Transform Cache");
+			ImGui::Checkbox("##Transform Cache", &m_UseTransformCache);
+
+			ImGui::Separator();
+
+			const char* layouts[] = {
+				GetSceneLayoutName(ESceneLayout::Grid), GetSceneLayoutName(ESceneLayout::Clustered),
+				GetSceneLayoutName(ESceneLayout::Forest), GetSceneLayoutName(ESceneLayout::SparseWorld)};
+
+			int layout = (int)m_SceneSettings.layout;
+			int seed = (int)m_SceneSettings.seed;
+			int generatedCount = (int)m_SceneSettings.instanceCount;
+
+			ImGui::Text("Scene Layout");
+			if (ImGui::Combo("##Scene Layout", &layout, layouts, IM_ARRAYSIZE(layouts)))
+			{
+				m_SceneSettings.layout = (ESceneLayout)layout;
+			}
+
+			ImGui::Text("Seed");
+			if (ImGui::InputInt("##Seed", &seed))
+			{
+				m_SceneSettings.seed = (uint32_t)seed;
+			}
+
+			ImGui::Text("Generated Instances");
+			if (ImGui::InputInt("##Generated Instances", &generatedCount, 10000, 100000))
+			{
+				m_SceneSettings.instanceCount =
+					(uint32_t)std::clamp(generatedCount, 1, (int)SCENE_GENERATOR_MAX_INSTANCES);
+			}
+
+			int poolCapacity = (int)m_StreamingSettings.poolCapacity;
+
+			// The pool is sized when the scene is generated, only the distances apply right away.
+			ImGui::Text("Stream Sectors");
+			ImGui::SameLine();
+			ImGui::Checkbox("##Stream Sectors", &m_StreamingSettings.enabled);
+
+			ImGui::Text("Instance Pool Capacity");
+			if (ImGui::InputInt("##Instance Pool Capacity", &poolCapacity, 10000, 100000))
+			{
+				m_StreamingSettings.poolCapacity =
+					(uint32_t)std::clamp(poolCapacity, (int)SECTOR_PAGE_SIZE, (int)SCENE_GENERATOR_MAX_INSTANCES);
+			}
+
+			ImGui::Text("Stream Distance");
+			if (ImGui::SliderFloat("##Stream Distance", &m_StreamingSettings.streamInDistance, 1.f, 5000.f, "%.0f",
+								   ImGuiSliderFlags_Logarithmic))
+			{
+				m_StreamingSettings.streamOutDistance = m_StreamingSettings.streamInDistance * 1.25f;
+				m_Streamer.SetStreamDistances(m_StreamingSettings.streamInDistance,
+											  m_StreamingSettings.streamOutDistance);
+			}
+
+			const SectorStreamingStats& streamingStats = m_Streamer.GetStats();
+
+			ImGui::Text("Sectors: %u resident of %u (%.1f units), %u pending", streamingStats.residentSectors,
+						m_Streamer.GetSectorCount(), m_Streamer.GetSectorSize(), streamingStats.pendingSectors);
+			ImGui::Text("Resident instances: %u, in: %u, out: %u, uploaded KB: %.1f",
+						streamingStats.residentInstances, streamingStats.streamedIn, streamingStats.streamedOut,
+						streamingStats.uploadedBytes / 1024.f);
+
+			if (!m_Benchmark.IsRunning())
+			{
+				if (ImGui::Button("Generate Scene"))
+				{
+					m_RegenerateScene = true;
+				}
+
+				ImGui::SameLine();
+
+				if (ImGui::Button("Run Scaling Benchmark"))
+				{
+					m_Benchmark.Start(std::string("MeshInstancing_") + GetSceneLayoutName(m_SceneSettings.layout),
+									  m_BenchmarkCounts);
+				}
+			}
+			else
+			{
+				ImGui::ProgressBar(m_Benchmark.GetProgress());
+
+				if (ImGui::Button("Stop Benchmark"))
+				{
+					m_Benchmark.Stop();
+				}
+			}
+
+			for (const ScalingResult& result : m_Benchmark.GetResults())
+			{
+				ImGui::Text("%u: CPU %.3f ms, GPU %.3f ms, %.0f meshlets, %.1f MB", result.instanceCount,
+							result.cpuMs, result.gpuMs, result.visibleMeshlets, result.memoryBytes / (1024.f * 1024.f));
+			}
+
+			ImGui::Separator();
 	
             ImGui::Text("Posses Preview Camera");
             ImGui::SameLine();
@@ -462,7 +883,41 @@ void InstancingApplication::DrawFrame()
         m_Renderer.ImGuiRender(commandBuffer);
     }
 
-    uint32_t endDrawResult = m_Renderer.EndDraw();
+    m_Renderer.EndRenderPass();
+
+    {
+        // Copy the visible meshlet count of this frame to the host, it's read once the frame is done
+        VkCore::Buffer& taskWork = m_TaskWorkBuffers[frameIndex];
+
+        vk::BufferMemoryBarrier countBarrier =
+            taskWork.CreateBufferMemoryBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eTransferRead);
+
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTaskShaderEXT, vk::PipelineStageFlagBits::eTransfer,
+                                      {}, {}, countBarrier, {});
+
+        commandBuffer.copyBuffer(taskWork.GetVkBuffer(), m_VisibleMeshletReadbacks[frameIndex].GetVkBuffer(),
+                                 vk::BufferCopy(SCENE_VISIBLE_MESHLETS_OFFSET, 0, sizeof(uint32_t)));
+
+        vk::MemoryBarrier hostBarrier;
+        hostBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+        hostBarrier.dstAccessMask = vk::AccessFlagBits::eHostRead;
+
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {},
+                                      hostBarrier, {}, {});
+    }
+
+    m_CpuMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - cpuStart).count();
+
+    int endDrawResult = m_Renderer.EndCmdBuffer();
+
+    // The startup lasts until the first frame, which had to wait for its pipelines.
+    if (!m_IsStartupLogged)
+    {
+        m_Renderer.EndPipelineCreation();
+        m_IsStartupLogged = true;
+    }
+
+    m_HasFrameResults[frameIndex] = true;
 
     if (endDrawResult == -1)
     {
@@ -474,14 +929,30 @@ void InstancingApplication::DrawFrame()
 
 void InstancingApplication::Loop()
 {
-    if (m_Window == nullptr)
+    if (m_Window == nullptr && !m_Renderer.IsHeadless())
     {
         throw std::runtime_error("Failed to run the App! The window is NULL!");
     }
 
-    while (!m_Window->ShouldClose())
+    while (!m_Renderer.ShouldClose())
     {
-        glfwPollEvents();
+        m_Renderer.PollEvents();
+
+        // The buffers can't be replaced while a frame is recorded, so the scene is regenerated in between the frames.
+        if (m_Benchmark.NeedsSetup())
+        {
+            m_SceneSettings.instanceCount = m_Benchmark.GetInstanceCount();
+            RegenerateInstances();
+
+            m_InstanceCount = m_InstanceCountMax;
+            m_Benchmark.Setup(GetInstancingMemoryUsage());
+        }
+        else if (m_RegenerateScene)
+        {
+            RegenerateInstances();
+            m_RegenerateScene = false;
+        }
+
         DrawFrame();
     }
 }
@@ -491,7 +962,10 @@ void InstancingApplication::Shutdown()
 
     VkCore::Device& device = VkCore::DeviceManager::GetDevice();
 
-    m_Renderer.m_Swapchain.Destroy();
+    device.WaitIdle();
+
+    // None of the pipelines may still be in the making when they are destroyed.
+    m_PipelineFactory.Destroy();
 
     device.DestroyPipeline(m_AxisPipeline);
     device.DestroyPipelineLayout(m_AxisPipelineLayout);
@@ -505,7 +979,18 @@ void InstancingApplication::Shutdown()
     device.DestroyPipeline(m_FrustumPipeline);
     device.DestroyPipelineLayout(m_FrustumPipelineLayout);
 
-    m_Model->Destroy();
+    device.DestroyPipeline(m_SceneCullPipeline);
+    device.DestroyPipelineLayout(m_SceneCullPipelineLayout);
+
+    m_Scene.Destroy();
+    DestroyInstanceBuffers();
+
+    for (HostBuffer& readback : m_VisibleMeshletReadbacks)
+    {
+        readback.Destroy();
+    }
+
+    m_DurationQueries.clear();
 
     m_AxisBuffer.Destroy();
     m_AxisIndexBuffer.Destroy();
@@ -519,6 +1004,9 @@ void InstancingApplication::Shutdown()
     }
 
     device.DestroyDescriptorSetLayout(m_MatrixDescSetLayout);
+    device.DestroyDescriptorSetLayout(m_SceneDescSetLayout);
+    device.DestroyDescriptorSetLayout(m_InstancesDescSetLayout);
+    device.DestroyDescriptorSetLayout(m_TaskWorkSetLayout);
 
     m_DescriptorBuilder.Clear();
     m_DescriptorBuilder.Cleanup();
@@ -694,20 +1182,10 @@ bool InstancingApplication::OnKeyPressed(KeyPressedEvent& event)
 
 void InstancingApplication::RecreateSwapchain()
 {
+    // The pipelines are kept, the frames still in flight finish with the old swapchain.
+    m_Renderer.RecreateSwapchain();
 
-    VkCore::Device& device = VkCore::DeviceManager::GetDevice();
-
-    device.WaitIdle();
-    m_Window->WaitEvents();
-
-    m_Renderer.DestroySwapchain();
-    m_Renderer.DestroyFrameBuffers();
-
-    m_Window->RefreshResolution();
-    m_Renderer.CreateSwapchain(m_Window->GetWidth(), m_Window->GetHeight());
-    m_Renderer.CreateFramebuffers(m_Window->GetWidth(), m_Window->GetHeight());
-
-    m_Camera.RecreateProjection(m_Window->GetWidth(), m_Window->GetHeight());
+    m_Camera.RecreateProjection(m_Renderer.GetWidth(), m_Renderer.GetHeight());
 
     m_FramebufferResized = false;
 }
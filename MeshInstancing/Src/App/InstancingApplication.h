@@ -1,8 +1,18 @@
 #include <cstdint>
+#include <future>
+#include <memory>
 #include <vector>
 
+#include "../Model/MeshScene.h"
 #include "../Model/PushConstants.h"
+#include "../Model/SectorStreamer.h"
+#include "../../Common/HostBuffer.h"
+#include "../../Common/InstanceTransform.h"
+#include "../../Common/Query.h"
+#include "../../Common/Renderer/PipelineFactory.h"
 #include "../../Common/Renderer/VulkanRenderer.h"
+#include "../../Common/ScalingBenchmark.h"
+#include "../../Common/SceneGenerator.h"
 #include "Event/KeyEvent.h"
 #include "Event/MouseEvent.h"
 #include "Event/WindowEvent.h"
@@ -20,7 +30,7 @@ class InstancingApplication
   public:
     InstancingApplication() {};
 
-    void Run(const uint32_t winWidth, const uint32_t winHeight);
+    void Run(const LaunchOptions& options);
 
     void DrawFrame();
     void Loop();
@@ -30,7 +40,16 @@ class InstancingApplication
     void InitializeAxisPipeline();
 	void InitializeBoundsPipeline();
 	void InitializeFrustumPipeline();
+	void InitializeScene();
 	void InitializeInstancing();
+	void InitializeScenePipeline();
+
+	// Generates the instances of m_SceneSettings and sizes the task work lists for them.
+	void CreateInstanceBuffers();
+	void DestroyInstanceBuffers();
+	// Replaces the instances by a newly generated scene, while the application is running.
+	void RegenerateInstances();
+	uint64_t GetInstancingMemoryUsage();
 
     void RecreateSwapchain();
 
@@ -61,6 +80,18 @@ class InstancingApplication
 	vk::Pipeline m_FrustumPipeline;
 	vk::PipelineLayout m_FrustumPipelineLayout;
 
+	vk::Pipeline m_SceneCullPipeline;
+	vk::PipelineLayout m_SceneCullPipelineLayout;
+
+    // Ready once the factory has built the pipelines above.
+    PipelineFactory m_PipelineFactory;
+    std::shared_future<void> m_AxisPipelineBuild;
+    std::shared_future<void> m_ModelPipelineBuild;
+    std::shared_future<void> m_BoundsPipelineBuild;
+    std::shared_future<void> m_FrustumPipelineBuild;
+    std::shared_future<void> m_SceneCullPipelineBuild;
+    bool m_IsStartupLogged = false;
+
     std::vector<VkCore::Buffer> m_MatBuffers;
     std::vector<vk::DescriptorSet> m_MatrixDescriptorSets;
     vk::DescriptorSetLayout m_MatrixDescSetLayout;
@@ -71,16 +102,53 @@ class InstancingApplication
 	VkCore::Buffer m_FrustumBuffer;
 	VkCore::Buffer m_FrustumIndexBuffer;
 
-	VkCore::Buffer m_InstancesBuffer;
+	// Compressed transforms halve the instance buffer, Mat4 keeps the full matrices.
+	EInstanceFormat m_InstanceFormat = EInstanceFormat::Packed;
+	// Instance pool of the resident sectors, the whole scene unless the streaming is enabled.
+	SectorStreamer m_Streamer;
+	SectorStreamingSettings m_StreamingSettings;
 	vk::DescriptorSet m_InstancesDescSet;
 	vk::DescriptorSetLayout m_InstancesDescSetLayout;
 
+	// Merged geometry and the mesh and model tables of all the models.
+	MeshScene m_Scene;
+	// Value of the uploader the geometry of the scene is copied by.
+	uint64_t m_SceneUploadValue = 0;
+	vk::DescriptorSet m_SceneDescSet;
+	vk::DescriptorSetLayout m_SceneDescSetLayout;
+
+	// Task workgroups of the visible instances, written by the culling pass every frame.
+	std::vector<VkCore::Buffer> m_TaskWorkBuffers;
+	std::vector<vk::DescriptorSet> m_TaskWorkSets;
+	vk::DescriptorSetLayout m_TaskWorkSetLayout;
+	uint32_t m_TaskWorkCapacity = 0;
+
+	// Instances of the packed task workgroups, grouped by model. Bound next to the task work of the same frame.
+	std::vector<VkCore::Buffer> m_TaskInstanceBuffers;
+	bool m_PackSmallMeshes = true;
+
+	// Clip space and normal matrices of the instances, written by the culling pass and read by the mesh shader.
+	std::vector<VkCore::Buffer> m_TransformCacheBuffers;
+	uint32_t m_TransformCacheCapacity = 0;
+	bool m_UseTransformCache = true;
+
+	// Visible meshlet counts of the frames, copied from the task work buffers.
+	std::vector<HostBuffer> m_VisibleMeshletReadbacks;
+
+	// Timings of the frames, read with the readbacks once the slot of the frame comes around again.
+	std::vector<std::unique_ptr<DurationQuery>> m_DurationQueries;
+	// Whether the slot holds a submitted frame of the current scene, cleared when the scene is regenerated.
+	std::vector<bool> m_HasFrameResults;
+
     glm::vec2 angles = {0.f, 0.f};
 
     MeshPC mesh_pc;
+	ScenePC scene_pc;
 
-	glm::uvec3 m_InstanceSize = glm::uvec3(20);
-	const uint32_t m_InstanceCountMax = m_InstanceSize.x * m_InstanceSize.y * m_InstanceSize.z;
+	// The default scene is the 20^3 grid the instances used to be hard-coded to.
+	SceneGeneratorSettings m_SceneSettings;
+	uint32_t m_InstanceCountMax = 0;
+	bool m_RegenerateScene = false;
 
 
     FragmentPC fragment_pc = {
@@ -104,11 +172,19 @@ class InstancingApplication
 	int m_InstanceCount = 0;
 	glm::vec3 m_Position;
 
+	// Scaling benchmark
+	ScalingBenchmark m_Benchmark;
+	std::vector<uint32_t> m_BenchmarkCounts = {100000, 300000, 1000000, 3000000, 10000000};
+	float m_CpuMs = 0.f;
+	float m_GpuMs = 0.f;
+	uint32_t m_VisibleMeshlets = 0;
+
 
 #ifndef VK_MESH_EXT
     PFN_vkCmdDrawMeshTasksNV vkCmdDrawMeshTasksNv;
 #else
     PFN_vkCmdDrawMeshTasksEXT vkCmdDrawMeshTasksEXT;
+    PFN_vkCmdDrawMeshTasksIndirectCountEXT vkCmdDrawMeshTasksIndirectCountEXT;
 #endif
 
 
@@ -119,9 +195,13 @@ class InstancingApplication
     VulkanRenderer m_Renderer;
     VkCore::Window* m_Window = nullptr;
 
-    Model* m_Model = nullptr;
-
-	std::array<Model*, 3> m_AvailableModels = {nullptr, nullptr, nullptr};
+	// The last three models are small enough for their instances to share the task workgroups.
+	std::array<const char*, 6> m_AvailableModels = {"MeshInstancing/Res/Artwork/OBJs/happy_smoothed.obj",
+													"MeshletCulling/Res/Artwork/OBJs/bunny.obj",
+													"MeshletCulling/Res/Artwork/OBJs/teapot.obj",
+													"MeshInstancing/Res/Artwork/OBJs/cube.obj",
+													"MeshInstancing/Res/Artwork/OBJs/sphere.obj",
+													"MeshInstancing/Res/Artwork/OBJs/plane.obj"};
 
     Camera m_Camera;
 	Camera m_FrustumCamera;
@@ -4,5 +4,5 @@
 int main(int argc, char* argv[])
 {
     InstancingApplication app = InstancingApplication();
-    app.Run(1280, 720);
+    app.Run(ParseLaunchOptions(argc, argv));
 }
@@ -0,0 +1,113 @@
+#include "MeshScene.h"
+
+#include <algorithm>
+
+#include "Log/Log.h"
+#include "Mesh/Mesh.h"
+#include "vulkan/vulkan_enums.hpp"
+
+uint32_t MeshScene::AddModel(const std::string& path)
+{
+    Model* model = new Model(path);
+
+    SceneModelInfo modelInfo{};
+    modelInfo.firstMesh = m_MeshInfos.size();
+    modelInfo.meshCount = model->GetMeshes().size();
+
+    for (const Mesh& mesh : model->GetMeshes())
+    {
+        SceneMeshInfo meshInfo{};
+        meshInfo.geometry.meshletCount = mesh.GetMeshletCount();
+        meshInfo.modelId = m_Models.size();
+
+        // The lanes of a task workgroup are shared by the instances of the meshes with at most half of its
+        // meshlets, every instance takes a run of lanes as long as its meshlet count.
+        if (meshInfo.geometry.meshletCount > 0 && meshInfo.geometry.meshletCount <= SCENE_MESHLETS_PER_TASK / 2)
+        {
+            meshInfo.instancesPerTask = SCENE_MESHLETS_PER_TASK / meshInfo.geometry.meshletCount;
+        }
+
+        modelInfo.taskCount +=
+            (meshInfo.geometry.meshletCount + SCENE_MESHLETS_PER_TASK - 1) / SCENE_MESHLETS_PER_TASK;
+
+        m_MeshInfos.emplace_back(meshInfo);
+    }
+
+    m_MaxTasksPerInstance = std::max(m_MaxTasksPerInstance, modelInfo.taskCount);
+
+    m_Models.emplace_back(model);
+    m_ModelInfos.emplace_back(modelInfo);
+
+    return m_ModelInfos.size() - 1;
+}
+
+void MeshScene::Build(StagingUploader& uploader)
+{
+    ASSERT(!m_Models.empty(), "The scene has to contain at least one model before building it!")
+
+    m_GeometryPool.Initialize();
+
+    uint32_t meshIndex = 0;
+
+    for (Model* model : m_Models)
+    {
+        for (Mesh& mesh : model->GetMeshes())
+        {
+            m_MeshInfos[meshIndex++].geometry = m_GeometryPool.AddMesh(mesh);
+            m_MeshletCount += mesh.GetMeshletCount();
+        }
+    }
+
+    m_GeometryPool.Flush(uploader);
+
+    const vk::BufferUsageFlags tableUsage =
+        vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst;
+
+    m_MeshInfoBuffer = VkCore::Buffer(tableUsage);
+    m_MeshInfoBuffer.InitializeOnGpu(m_MeshInfos.size() * sizeof(SceneMeshInfo));
+    uploader.Upload(m_MeshInfoBuffer.GetVkBuffer(), m_MeshInfos.data(), m_MeshInfos.size() * sizeof(SceneMeshInfo));
+
+    m_ModelInfoBuffer = VkCore::Buffer(tableUsage);
+    m_ModelInfoBuffer.InitializeOnGpu(m_ModelInfos.size() * sizeof(SceneModelInfo));
+    uploader.Upload(m_ModelInfoBuffer.GetVkBuffer(), m_ModelInfos.data(),
+                    m_ModelInfos.size() * sizeof(SceneModelInfo));
+
+    LOGF(Application, Info, "Built the scene with %d models, %d meshes and %d meshlets (%.2f MB in %d blocks)",
+         GetModelCount(), GetMeshCount(), m_MeshletCount, m_GeometryPool.GetUsedBytes() / (1024.f * 1024.f),
+         m_GeometryPool.GetBlockCount())
+}
+
+void MeshScene::ReleaseSourceModels(const StagingUploader& uploader, const uint64_t uploadValue)
+{
+    if (m_Models.empty() || !uploader.IsComplete(uploadValue))
+    {
+        return;
+    }
+
+    // The mesh and model tables hold everything the frames need, the models were only the source of the copies.
+    for (Model* model : m_Models)
+    {
+        model->Destroy();
+        delete model;
+    }
+
+    m_Models.clear();
+
+    LOG(Application, Verbose, "Released the source models of the scene")
+}
+
+void MeshScene::Destroy()
+{
+    for (Model* model : m_Models)
+    {
+        model->Destroy();
+        delete model;
+    }
+
+    m_Models.clear();
+
+    m_GeometryPool.Destroy();
+
+    m_MeshInfoBuffer.Destroy();
+    m_ModelInfoBuffer.Destroy();
+}
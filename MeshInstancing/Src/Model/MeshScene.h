@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../../Common/GeometryPool.h"
+#include "glm/mat4x4.hpp"
+#include "Mesh/Model.h"
+#include "Vk/Buffers/Buffer.h"
+
+// Every task workgroup culls and emits up to this many meshlets of a single mesh.
+constexpr uint32_t SCENE_MESHLETS_PER_TASK = 32;
+
+// Geometry of a single mesh in the geometry pool. Mirrors `s_scene_mesh` in the shaders.
+struct SceneMeshInfo
+{
+    MeshGeometry geometry;
+    uint32_t modelId = 0;
+    // Instances sharing a single task workgroup when the small meshes are packed, one for the larger meshes.
+    uint32_t instancesPerTask = 1;
+};
+
+// Range of meshes belonging to a single model. Mirrors `s_scene_model` in the shaders.
+struct SceneModelInfo
+{
+    uint32_t firstMesh = 0;
+    uint32_t meshCount = 0;
+    // Task workgroups needed to draw all meshes of the model once.
+    uint32_t taskCount = 0;
+    uint32_t padding = 0;
+};
+
+// Full instance transform as seen by the shaders. Mirrors `s_instance`.
+struct SceneInstance
+{
+    glm::mat4 transform;
+    uint32_t modelId = 0;
+    uint32_t padding[3] = {};
+};
+
+// Indirect mesh tasks commands the task workgroups of a frame are split into. Mirrors `MAX_TASK_CMDS`.
+constexpr uint32_t SCENE_MAX_TASK_COMMANDS = 16;
+
+// Upper bound of the memory of a single task work list. Past that, the instances don't get drawn.
+constexpr uint64_t SCENE_TASK_WORK_BUDGET = 256 * 1024 * 1024;
+
+// Upper bound of the memory of a single transform cache. The instances past it compute their transforms in the mesh
+// shader.
+constexpr uint64_t SCENE_TRANSFORM_CACHE_BUDGET = 128 * 1024 * 1024;
+
+// Layout of the header of the task work buffer: draw count, work count, visible meshlet count, listed instance count,
+// followed by the indirect mesh tasks commands. The task workgroups come right after it.
+constexpr uint32_t SCENE_VISIBLE_MESHLETS_OFFSET = 8;
+constexpr uint32_t SCENE_TASK_COMMANDS_OFFSET = 16;
+constexpr uint32_t SCENE_TASK_WORK_HEADER_SIZE =
+    SCENE_TASK_COMMANDS_OFFSET + SCENE_MAX_TASK_COMMANDS * sizeof(VkDrawMeshTasksIndirectCommandEXT);
+
+// A single task workgroup, written by the culling pass. Mirrors `s_task_work`. The workgroups of the packed meshes
+// store the offset of their first instance in the task instance list and their instance count instead.
+struct SceneTaskWork
+{
+    uint32_t instanceIndex = 0;
+    uint32_t meshIndex = 0;
+    uint32_t firstMeshlet = 0;
+};
+
+/**
+ * Collection of meshlet models whose geometry lives in a single geometry pool, so that all instances of all models
+ * can be culled and drawn by a single task dispatch. The mesh table holds the device addresses of the geometry of
+ * every mesh, the model table the range of meshes of every model.
+ */
+class MeshScene
+{
+  public:
+    MeshScene() {};
+
+    /**
+     * Loads a model into the scene.
+     * @return ID of the model, which should be assigned to the instances of this model.
+     */
+    uint32_t AddModel(const std::string& path);
+
+    /**
+     * Copies the geometry of all added models into the geometry pool and uploads the mesh and model tables.
+     * Has to be called after all models were added. The copies are queued to the uploader, the caller flushes them.
+     */
+    void Build(StagingUploader& uploader);
+
+    /**
+     * Releases the loaded models once the uploader has finished copying their geometry into the pool, so that the
+     * geometry isn't kept in the device memory twice. Doesn't wait, so it can be called every frame.
+     * @param uploadValue - Value returned by the flush of the uploader following Build.
+     */
+    void ReleaseSourceModels(const StagingUploader& uploader, const uint64_t uploadValue);
+
+    void Destroy();
+
+    uint32_t GetModelCount() const
+    {
+        return m_ModelInfos.size();
+    }
+
+    uint32_t GetMeshCount() const
+    {
+        return m_MeshInfos.size();
+    }
+
+    uint32_t GetMeshletCount() const
+    {
+        return m_MeshletCount;
+    }
+
+    // Most task workgroups a single instance of any model can take.
+    uint32_t GetMaxTasksPerInstance() const
+    {
+        return m_MaxTasksPerInstance;
+    }
+
+    // Task workgroups needed by an instance of the given model.
+    uint32_t GetTaskCount(const uint32_t modelId) const
+    {
+        return m_ModelInfos[modelId].taskCount;
+    }
+
+    const GeometryPool& GetGeometryPool() const
+    {
+        return m_GeometryPool;
+    }
+
+    VkCore::Buffer& GetMeshInfoBuffer()
+    {
+        return m_MeshInfoBuffer;
+    }
+
+    VkCore::Buffer& GetModelInfoBuffer()
+    {
+        return m_ModelInfoBuffer;
+    }
+
+  private:
+    std::vector<Model*> m_Models;
+    std::vector<SceneModelInfo> m_ModelInfos;
+    std::vector<SceneMeshInfo> m_MeshInfos;
+
+    uint32_t m_MeshletCount = 0;
+    uint32_t m_MaxTasksPerInstance = 0;
+
+    GeometryPool m_GeometryPool;
+
+    VkCore::Buffer m_MeshInfoBuffer;
+    VkCore::Buffer m_ModelInfoBuffer;
+};
@@ -18,7 +18,30 @@ struct FragmentPC {
 struct MeshPC {
     glm::mat4 rotation_mat = glm::identity<glm::mat4>();
     glm::mat4 scale_mat = glm::identity<glm::mat4>();
-	uint32_t meshlet_count = 0;
+	uint32_t packed_instances = false;
+	// Workgroups of every indirect command, the task shader flattens its workgroup index by it.
+	uint32_t max_task_groups = 0;
+	// Lets the instances of the small meshes share the task workgroups. Has to match ScenePC::pack_small_meshes.
+	uint32_t pack_small_meshes = true;
+	// Instances whose transforms are read from the transform cache, the rest computes them in the mesh shader. Has
+	// to match ScenePC::transform_cache_count.
+	uint32_t transform_cache_count = 0;
+};
+
+// Push constant of the compute pass which expands the instances into the task workgroups of their meshes.
+struct ScenePC {
+	uint32_t instance_count = 0;
+	// Number of task workgroups fitting into the work list.
+	uint32_t work_capacity = 0;
+	uint32_t packed_instances = false;
+	uint32_t max_task_groups = 0;
+	uint32_t pack_small_meshes = true;
+	// Instances whose transforms are written to the transform cache, zero disables the cache.
+	uint32_t transform_cache_count = 0;
+	// Stamped into the visibility feedback of the sectors.
+	uint32_t frame = 0;
+	// Rotation and scale of the mesh push constant, applied on top of every instance transform.
+	alignas(16) glm::mat4 model_mat = glm::identity<glm::mat4>();
 };
 
 struct InstancePC {
@@ -0,0 +1,566 @@
+#include "SectorStreamer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include "MeshScene.h"
+#include "glm/common.hpp"
+#include "glm/geometric.hpp"
+#include "Log/Log.h"
+#include "vulkan/vulkan_enums.hpp"
+#include "vulkan/vulkan_structs.hpp"
+
+void SectorStreamer::Initialize(const std::vector<PackedInstance>& instances, const EInstanceFormat format,
+                                const SectorStreamingSettings& settings, const uint32_t framesInFlight,
+                                const vk::PipelineStageFlags consumerStages)
+{
+    ASSERT(!instances.empty(), "The streamed scene needs at least a single instance!")
+
+    m_Settings = settings;
+    m_Settings.streamOutDistance = std::max(m_Settings.streamOutDistance, m_Settings.streamInDistance);
+    m_Format = format;
+    m_InstanceStride = format == EInstanceFormat::Packed ? sizeof(PackedInstance) : sizeof(SceneInstance);
+    m_ConsumerStages = consumerStages;
+
+    Partition(instances);
+
+    uint32_t requiredPages = 0;
+    uint32_t largestSector = 0;
+
+    for (uint32_t i = 0; i < m_Sectors.size(); i++)
+    {
+        requiredPages += GetPageCount(i);
+        largestSector = std::max(largestSector, m_Sectors[i].instanceCount);
+    }
+
+    m_PageCount = requiredPages;
+
+    if (m_Settings.enabled)
+    {
+        const uint32_t poolPages = (m_Settings.poolCapacity + SECTOR_PAGE_SIZE - 1) / SECTOR_PAGE_SIZE;
+        const uint32_t largestSectorPages = (largestSector + SECTOR_PAGE_SIZE - 1) / SECTOR_PAGE_SIZE;
+
+        m_PageCount = std::min(std::max(poolPages, largestSectorPages), requiredPages);
+    }
+
+    m_Pages.assign(m_PageCount, SectorPage{});
+    m_IsPageDirty.assign(m_PageCount, 0);
+    m_DirtyPages.reserve(m_PageCount);
+
+    m_InstanceBuffer = VkCore::Buffer(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst);
+    m_PageBuffer = VkCore::Buffer(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst);
+
+    if (m_Settings.enabled)
+    {
+        m_InstanceBuffer.InitializeOnGpu((uint64_t)GetSlotCount() * m_InstanceStride);
+        m_PageBuffer.InitializeOnGpu(m_Pages.data(), m_Pages.size() * sizeof(SectorPage));
+
+        // Lowest pages first, so a pool which is never full stays dense.
+        m_FreePages.resize(m_PageCount);
+
+        for (uint32_t i = 0; i < m_PageCount; i++)
+        {
+            m_FreePages[i] = m_PageCount - 1 - i;
+        }
+
+        // Every segment can hold the upload budget and the whole page table, the largest sector is always uploaded
+        // in one go.
+        m_RingInstanceCapacity = std::max(m_Settings.uploadBudget, largestSector);
+        m_RingSegmentSize =
+            (vk::DeviceSize)m_RingInstanceCapacity * m_InstanceStride + m_PageCount * sizeof(SectorPage);
+        m_UploadRing.Initialize(m_RingSegmentSize * framesInFlight, vk::BufferUsageFlagBits::eTransferSrc);
+    }
+    else
+    {
+        // The pool is sized for the whole scene, so every sector is made resident once.
+        std::vector<uint8_t> data((uint64_t)GetSlotCount() * m_InstanceStride);
+        uint32_t nextPage = 0;
+
+        for (uint32_t i = 0; i < m_Sectors.size(); i++)
+        {
+            Sector& sector = m_Sectors[i];
+
+            for (uint32_t first = 0; first < sector.instanceCount; first += SECTOR_PAGE_SIZE)
+            {
+                const uint32_t count = std::min(SECTOR_PAGE_SIZE, sector.instanceCount - first);
+
+                WriteInstances(data.data() + (uint64_t)nextPage * SECTOR_PAGE_SIZE * m_InstanceStride,
+                               sector.firstInstance + first, count);
+
+                m_Pages[nextPage] = SectorPage{i, count};
+                sector.pages.push_back(nextPage);
+                nextPage++;
+            }
+        }
+
+        m_InstanceBuffer.InitializeOnGpu(data.data(), data.size());
+        m_PageBuffer.InitializeOnGpu(m_Pages.data(), m_Pages.size() * sizeof(SectorPage));
+
+        m_Stats.residentSectors = m_Sectors.size();
+        m_Stats.residentInstances = m_Instances.size();
+    }
+
+    std::vector<glm::vec4> bounds(m_Sectors.size());
+
+    for (uint32_t i = 0; i < m_Sectors.size(); i++)
+    {
+        bounds[i] = m_Sectors[i].bounds;
+    }
+
+    m_SectorBuffer = VkCore::Buffer(vk::BufferUsageFlagBits::eStorageBuffer);
+    m_SectorBuffer.InitializeOnGpu(bounds.data(), bounds.size() * sizeof(glm::vec4));
+
+    // The frames start at one, so no sector has been visible yet.
+    const std::vector<uint32_t> feedback(m_Sectors.size(), 0);
+
+    m_FeedbackBuffer =
+        VkCore::Buffer(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc);
+    m_FeedbackBuffer.InitializeOnGpu(feedback.data(), feedback.size() * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < framesInFlight; i++)
+    {
+        m_FeedbackReadbacks.emplace_back();
+        m_FeedbackReadbacks[i].Initialize(feedback.size() * sizeof(uint32_t), vk::BufferUsageFlagBits::eTransferDst);
+        std::memset(m_FeedbackReadbacks[i].GetData(), 0, feedback.size() * sizeof(uint32_t));
+    }
+
+    LOGF(Application, Info, "Sector streaming %s: %u sectors of %.1f units, pool of %u slots, %.2f MB",
+         m_Settings.enabled ? "enabled" : "disabled", (uint32_t)m_Sectors.size(), m_SectorSize, GetSlotCount(),
+         m_InstanceBuffer.GetSize() / (1024.f * 1024.f))
+}
+
+void SectorStreamer::Partition(const std::vector<PackedInstance>& instances)
+{
+    glm::vec3 minPos = glm::vec3(FLT_MAX);
+    glm::vec3 maxPos = glm::vec3(-FLT_MAX);
+
+    for (const PackedInstance& instance : instances)
+    {
+        minPos = glm::min(minPos, instance.position);
+        maxPos = glm::max(maxPos, instance.position);
+    }
+
+    const glm::vec3 extent = glm::max(maxPos - minPos, glm::vec3(1e-3f));
+    const uint64_t targetSectors =
+        std::max<uint64_t>(instances.size() / std::max(m_Settings.instancesPerSector, 1u), 1);
+
+    const auto getCellCounts = [&extent](const float size) {
+        return glm::max(glm::ceil(extent / size), glm::vec3(1.f));
+    };
+
+    // Halves the cells until the grid would get more cells than the target. The flat layouts only spread along
+    // two of the axes, which a cubic root of the instance count wouldn't account for.
+    m_SectorSize = std::max({extent.x, extent.y, extent.z});
+
+    for (;;)
+    {
+        const glm::vec3 counts = getCellCounts(m_SectorSize * 0.5f);
+
+        if ((uint64_t)counts.x * (uint64_t)counts.y * (uint64_t)counts.z > targetSectors)
+        {
+            break;
+        }
+
+        m_SectorSize *= 0.5f;
+    }
+
+    const glm::uvec3 cellCounts = glm::uvec3(getCellCounts(m_SectorSize));
+    const uint32_t cellCount = cellCounts.x * cellCounts.y * cellCounts.z;
+
+    std::vector<uint32_t> instanceCells(instances.size());
+    std::vector<uint32_t> cellSectors(cellCount, 0);
+
+    for (uint32_t i = 0; i < instances.size(); i++)
+    {
+        const glm::uvec3 cell =
+            glm::min(glm::uvec3((instances[i].position - minPos) / m_SectorSize), cellCounts - glm::uvec3(1));
+
+        instanceCells[i] = cell.x + cellCounts.x * (cell.y + cellCounts.y * cell.z);
+        cellSectors[instanceCells[i]]++;
+    }
+
+    // Only the occupied cells become sectors, numbered in the order of the cells.
+    m_Sectors.clear();
+
+    for (uint32_t cell = 0; cell < cellCount; cell++)
+    {
+        const uint32_t count = cellSectors[cell];
+
+        cellSectors[cell] = INVALID_SECTOR;
+
+        if (count > 0)
+        {
+            cellSectors[cell] = m_Sectors.size();
+
+            Sector sector;
+            sector.instanceCount = count;
+            m_Sectors.emplace_back(sector);
+        }
+    }
+
+    uint32_t firstInstance = 0;
+
+    for (Sector& sector : m_Sectors)
+    {
+        sector.firstInstance = firstInstance;
+        firstInstance += sector.instanceCount;
+    }
+
+    // Counting sort of the instances by their sector, the bounds are gathered on the way.
+    std::vector<uint32_t> cursors(m_Sectors.size());
+    std::vector<glm::vec3> sectorMin(m_Sectors.size(), glm::vec3(FLT_MAX));
+    std::vector<glm::vec3> sectorMax(m_Sectors.size(), glm::vec3(-FLT_MAX));
+
+    for (uint32_t i = 0; i < m_Sectors.size(); i++)
+    {
+        cursors[i] = m_Sectors[i].firstInstance;
+    }
+
+    m_Instances.resize(instances.size());
+
+    for (uint32_t i = 0; i < instances.size(); i++)
+    {
+        const uint32_t sector = cellSectors[instanceCells[i]];
+
+        m_Instances[cursors[sector]++] = instances[i];
+
+        sectorMin[sector] = glm::min(sectorMin[sector], instances[i].position);
+        sectorMax[sector] = glm::max(sectorMax[sector], instances[i].position);
+    }
+
+    for (uint32_t i = 0; i < m_Sectors.size(); i++)
+    {
+        const glm::vec3 center = (sectorMin[i] + sectorMax[i]) * 0.5f;
+        const float radius = glm::length(sectorMax[i] - sectorMin[i]) * 0.5f + m_Settings.instanceRadius;
+
+        m_Sectors[i].bounds = glm::vec4(center, radius);
+    }
+}
+
+void SectorStreamer::WriteInstances(uint8_t* dst, const uint32_t first, const uint32_t count) const
+{
+    if (m_Format == EInstanceFormat::Packed)
+    {
+        std::memcpy(dst, &m_Instances[first], count * sizeof(PackedInstance));
+        return;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        SceneInstance instance;
+        instance.transform = UnpackInstance(m_Instances[first + i]);
+        instance.modelId = m_Instances[first + i].modelId;
+
+        std::memcpy(dst + i * sizeof(SceneInstance), &instance, sizeof(SceneInstance));
+    }
+}
+
+void SectorStreamer::Destroy()
+{
+    m_InstanceBuffer.Destroy();
+    m_PageBuffer.Destroy();
+    m_SectorBuffer.Destroy();
+    m_FeedbackBuffer.Destroy();
+
+    for (HostBuffer& readback : m_FeedbackReadbacks)
+    {
+        readback.Destroy();
+    }
+
+    if (m_UploadRing.GetSize() > 0)
+    {
+        m_UploadRing.Destroy();
+    }
+
+    m_FeedbackReadbacks.clear();
+    m_Sectors.clear();
+    m_Instances.clear();
+    m_Pages.clear();
+    m_FreePages.clear();
+    m_DirtyPages.clear();
+    m_IsPageDirty.clear();
+
+    m_Stats = {};
+    m_Frame = 0;
+}
+
+void SectorStreamer::SetStreamDistances(const float streamIn, const float streamOut)
+{
+    m_Settings.streamInDistance = streamIn;
+    m_Settings.streamOutDistance = std::max(streamIn, streamOut);
+}
+
+void SectorStreamer::ReadFeedback(const uint32_t frameIndex)
+{
+    const uint32_t* frames = static_cast<const uint32_t*>(m_FeedbackReadbacks[frameIndex].GetData());
+
+    for (uint32_t i = 0; i < m_Sectors.size(); i++)
+    {
+        m_Sectors[i].lastVisibleFrame = std::max(m_Sectors[i].lastVisibleFrame, frames[i]);
+    }
+}
+
+void SectorStreamer::Evict(const uint32_t sector)
+{
+    for (const uint32_t page : m_Sectors[sector].pages)
+    {
+        m_Pages[page] = SectorPage{};
+        m_FreePages.push_back(page);
+
+        if (!m_IsPageDirty[page])
+        {
+            m_IsPageDirty[page] = 1;
+            m_DirtyPages.push_back(page);
+        }
+    }
+
+    m_Sectors[sector].pages.clear();
+
+    m_Stats.residentSectors--;
+    m_Stats.residentInstances -= m_Sectors[sector].instanceCount;
+    m_Stats.streamedOut++;
+}
+
+uint32_t SectorStreamer::FindEvictionCandidate(const float distance) const
+{
+    uint32_t candidate = INVALID_SECTOR;
+    bool isCandidateStale = false;
+
+    for (uint32_t i = 0; i < m_Sectors.size(); i++)
+    {
+        const Sector& sector = m_Sectors[i];
+
+        // Only the sectors farther than the one needing the room are given up.
+        if (!IsResident(i) || sector.distance <= distance)
+        {
+            continue;
+        }
+
+        const bool isStale = m_Frame - sector.lastVisibleFrame > m_Settings.visibilityGraceFrames;
+
+        if (candidate == INVALID_SECTOR || (isStale && !isCandidateStale) ||
+            (isStale == isCandidateStale && sector.distance > m_Sectors[candidate].distance))
+        {
+            candidate = i;
+            isCandidateStale = isStale;
+        }
+    }
+
+    return candidate;
+}
+
+void SectorStreamer::RecordUploads(const vk::CommandBuffer& cmdBuffer, const uint32_t frameIndex,
+                                   const glm::vec3& cameraPos)
+{
+    m_Frame++;
+
+    m_Stats.streamedIn = 0;
+    m_Stats.streamedOut = 0;
+    m_Stats.pendingSectors = 0;
+    m_Stats.uploadedBytes = 0;
+
+    if (!m_Settings.enabled)
+    {
+        return;
+    }
+
+    std::vector<uint32_t> candidates;
+
+    for (uint32_t i = 0; i < m_Sectors.size(); i++)
+    {
+        Sector& sector = m_Sectors[i];
+
+        sector.distance = std::max(glm::length(glm::vec3(sector.bounds) - cameraPos) - sector.bounds.w, 0.f);
+
+        if (IsResident(i))
+        {
+            // The sectors which left the streaming range give their pages back right away.
+            if (sector.distance > m_Settings.streamOutDistance)
+            {
+                Evict(i);
+            }
+        }
+        else if (sector.distance <= m_Settings.streamInDistance)
+        {
+            candidates.push_back(i);
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(),
+              [this](const uint32_t a, const uint32_t b) { return m_Sectors[a].distance < m_Sectors[b].distance; });
+
+    m_LoadedSectors.clear();
+
+    uint32_t uploadedInstances = 0;
+
+    for (const uint32_t candidate : candidates)
+    {
+        Sector& sector = m_Sectors[candidate];
+        const uint32_t pageCount = GetPageCount(candidate);
+
+        if (uploadedInstances + sector.instanceCount > m_RingInstanceCapacity)
+        {
+            break;
+        }
+
+        while (m_FreePages.size() < pageCount)
+        {
+            const uint32_t victim = FindEvictionCandidate(sector.distance);
+
+            if (victim == INVALID_SECTOR)
+            {
+                break;
+            }
+
+            Evict(victim);
+        }
+
+        // The pool is full of sectors closer than this one.
+        if (m_FreePages.size() < pageCount)
+        {
+            break;
+        }
+
+        for (uint32_t first = 0; first < sector.instanceCount; first += SECTOR_PAGE_SIZE)
+        {
+            const uint32_t page = m_FreePages.back();
+            m_FreePages.pop_back();
+
+            m_Pages[page] = SectorPage{candidate, std::min(SECTOR_PAGE_SIZE, sector.instanceCount - first)};
+            sector.pages.push_back(page);
+
+            if (!m_IsPageDirty[page])
+            {
+                m_IsPageDirty[page] = 1;
+                m_DirtyPages.push_back(page);
+            }
+        }
+
+        // A sector gets the grace period before the culling pass had a chance to see it.
+        sector.lastVisibleFrame = m_Frame;
+
+        m_LoadedSectors.push_back(candidate);
+        uploadedInstances += sector.instanceCount;
+
+        m_Stats.residentSectors++;
+        m_Stats.residentInstances += sector.instanceCount;
+        m_Stats.streamedIn++;
+    }
+
+    m_Stats.pendingSectors = candidates.size() - m_LoadedSectors.size();
+
+    if (m_DirtyPages.empty())
+    {
+        return;
+    }
+
+    const vk::DeviceSize segmentOffset = frameIndex * m_RingSegmentSize;
+    const vk::DeviceSize pagesOffset = segmentOffset + (vk::DeviceSize)m_RingInstanceCapacity * m_InstanceStride;
+
+    uint8_t* ring = static_cast<uint8_t*>(m_UploadRing.GetData());
+
+    m_InstanceRegions.clear();
+    m_PageRegions.clear();
+
+    vk::DeviceSize cursor = segmentOffset;
+
+    for (const uint32_t index : m_LoadedSectors)
+    {
+        const Sector& sector = m_Sectors[index];
+
+        for (uint32_t i = 0; i < sector.pages.size(); i++)
+        {
+            const uint32_t count = std::min(SECTOR_PAGE_SIZE, sector.instanceCount - i * SECTOR_PAGE_SIZE);
+            const vk::DeviceSize size = (vk::DeviceSize)count * m_InstanceStride;
+            const vk::DeviceSize dstOffset = (vk::DeviceSize)sector.pages[i] * SECTOR_PAGE_SIZE * m_InstanceStride;
+
+            WriteInstances(ring + cursor, sector.firstInstance + i * SECTOR_PAGE_SIZE, count);
+
+            // The full pages taken in a row end up next to each other in the pool.
+            vk::BufferCopy* previous = m_InstanceRegions.empty() ? nullptr : &m_InstanceRegions.back();
+
+            if (previous && previous->srcOffset + previous->size == cursor &&
+                previous->dstOffset + previous->size == dstOffset)
+            {
+                previous->size += size;
+            }
+            else
+            {
+                m_InstanceRegions.emplace_back(cursor, dstOffset, size);
+            }
+
+            cursor += size;
+        }
+    }
+
+    std::sort(m_DirtyPages.begin(), m_DirtyPages.end());
+
+    vk::DeviceSize pageCursor = pagesOffset;
+    uint32_t previousPage = UINT32_MAX;
+
+    for (const uint32_t page : m_DirtyPages)
+    {
+        m_IsPageDirty[page] = 0;
+
+        std::memcpy(ring + pageCursor, &m_Pages[page], sizeof(SectorPage));
+
+        if (previousPage != UINT32_MAX && page == previousPage + 1)
+        {
+            m_PageRegions.back().size += sizeof(SectorPage);
+        }
+        else
+        {
+            m_PageRegions.emplace_back(pageCursor, page * sizeof(SectorPage), sizeof(SectorPage));
+        }
+
+        pageCursor += sizeof(SectorPage);
+        previousPage = page;
+    }
+
+    m_DirtyPages.clear();
+
+    m_Stats.uploadedBytes = (cursor - segmentOffset) + (pageCursor - pagesOffset);
+
+    // The previous frames may still read the pages which are about to be overwritten.
+    cmdBuffer.pipelineBarrier(m_ConsumerStages, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, {});
+
+    if (!m_InstanceRegions.empty())
+    {
+        cmdBuffer.copyBuffer(m_UploadRing.GetVkBuffer(), m_InstanceBuffer.GetVkBuffer(), m_InstanceRegions);
+    }
+
+    cmdBuffer.copyBuffer(m_UploadRing.GetVkBuffer(), m_PageBuffer.GetVkBuffer(), m_PageRegions);
+
+    vk::MemoryBarrier memoryBarrier;
+    memoryBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    memoryBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, m_ConsumerStages, {}, memoryBarrier, {}, {});
+}
+
+void SectorStreamer::RecordFeedbackReadback(const vk::CommandBuffer& cmdBuffer, const uint32_t frameIndex)
+{
+    vk::BufferMemoryBarrier feedbackBarrier = m_FeedbackBuffer.CreateBufferMemoryBarrier(
+        vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eTransferRead);
+
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer, {}, {},
+                              feedbackBarrier, {});
+
+    cmdBuffer.copyBuffer(m_FeedbackBuffer.GetVkBuffer(), m_FeedbackReadbacks[frameIndex].GetVkBuffer(),
+                         vk::BufferCopy(0, 0, m_FeedbackBuffer.GetSize()));
+
+    vk::MemoryBarrier hostBarrier;
+    hostBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    hostBarrier.dstAccessMask = vk::AccessFlagBits::eHostRead;
+
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {}, hostBarrier,
+                              {}, {});
+}
+
+uint64_t SectorStreamer::GetMemoryUsage()
+{
+    return m_InstanceBuffer.GetSize() + m_PageBuffer.GetSize() + m_SectorBuffer.GetSize() +
+           m_FeedbackBuffer.GetSize();
+}
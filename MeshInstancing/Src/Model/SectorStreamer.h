@@ -0,0 +1,225 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../../Common/HostBuffer.h"
+#include "../../Common/InstanceTransform.h"
+#include "glm/vec3.hpp"
+#include "glm/vec4.hpp"
+#include "Vk/Buffers/Buffer.h"
+#include "vulkan/vulkan_handles.hpp"
+
+// Instance slots of a single page of the instance pool. Mirrors SECTOR_PAGE_SIZE in scene_cull.comp, has to be a
+// multiple of the subgroup size, so that the lanes of a subgroup always share their page.
+constexpr uint32_t SECTOR_PAGE_SIZE = 128;
+
+constexpr uint32_t INVALID_SECTOR = UINT32_MAX;
+
+// Page of the instance pool, owned by a single resident sector. Mirrors `s_sector_page` in the shaders.
+struct SectorPage
+{
+    uint32_t sector = INVALID_SECTOR;
+    // Used slots at the start of the page, zero for the free pages.
+    uint32_t instanceCount = 0;
+};
+
+struct SectorStreamingSettings
+{
+    // Keeps only the sectors around the camera resident. Otherwise the pool is sized for the whole scene.
+    bool enabled = false;
+    // Instances of the pool when streaming, rounded up to whole pages.
+    uint32_t poolCapacity = 1000000;
+    // Average instance count the sector size is chosen for.
+    uint32_t instancesPerSector = 1024;
+    // Sectors closer to the camera than this are streamed in, the ones past the stream out distance are evicted.
+    float streamInDistance = 100.f;
+    float streamOutDistance = 125.f;
+    // Instances uploaded per frame at most, a single sector may exceed it.
+    uint32_t uploadBudget = 65536;
+    // Frames a sector stays protected from the eviction after it was last seen by the culling pass.
+    uint32_t visibilityGraceFrames = 60;
+    // Radius of the largest instance, added to the bounds of the sectors.
+    float instanceRadius = 2.f;
+};
+
+// Residency changes of the last SectorStreamer::RecordUploads call, and the resulting residency.
+struct SectorStreamingStats
+{
+    uint32_t residentSectors = 0;
+    uint32_t residentInstances = 0;
+    uint32_t streamedIn = 0;
+    uint32_t streamedOut = 0;
+    // Sectors within the stream in distance still waiting for their upload.
+    uint32_t pendingSectors = 0;
+    uint64_t uploadedBytes = 0;
+};
+
+/**
+ * Keeps the instances of the sectors around the camera resident in a fixed size instance pool.
+ *
+ * The instances are partitioned into the cells of a uniform grid, the sectors, and ordered by them on the CPU. The
+ * pool is split into pages of SECTOR_PAGE_SIZE slots, a resident sector owns as many pages as its instances need.
+ * The page table tells the culling pass which sector a page belongs to and how many of its slots are in use, the
+ * sector table holds the bounding sphere of every sector, so that the culling pass skips the sectors outside the
+ * frustum as a whole. Every sector it finds visible is stamped with the frame in the feedback buffer.
+ *
+ * Every frame RecordUploads streams in the closest missing sectors within the upload budget. When the pool is full,
+ * the sectors the culling pass hasn't seen for a while are evicted first, farthest first. The uploads go through a
+ * persistently mapped ring with a segment per frame in flight and are recorded into the frame, so the CPU never
+ * waits for them.
+ */
+class SectorStreamer
+{
+  public:
+    SectorStreamer() {};
+
+    /**
+     * @param consumerStages Pipeline stages reading the pool and the page table.
+     */
+    void Initialize(const std::vector<PackedInstance>& instances, const EInstanceFormat format,
+                    const SectorStreamingSettings& settings, const uint32_t framesInFlight,
+                    const vk::PipelineStageFlags consumerStages);
+
+    void Destroy();
+
+    /**
+     * Takes over the visibility feedback the culling pass wrote in the given frame. Has to be called once the frame
+     * has finished.
+     */
+    void ReadFeedback(const uint32_t frameIndex);
+
+    /**
+     * Streams the sectors in and out around the camera and records the copies of the changed pages. Has to be
+     * recorded outside of a render pass, before the culling pass.
+     */
+    void RecordUploads(const vk::CommandBuffer& cmdBuffer, const uint32_t frameIndex, const glm::vec3& cameraPos);
+
+    // Copies the visibility feedback to the host. Has to be recorded after the culling pass.
+    void RecordFeedbackReadback(const vk::CommandBuffer& cmdBuffer, const uint32_t frameIndex);
+
+    // Only the distances can be changed while streaming, the pool is sized by Initialize.
+    void SetStreamDistances(const float streamIn, const float streamOut);
+
+    // Instance slots of the pool, the culling pass is dispatched over all of them.
+    uint32_t GetSlotCount() const
+    {
+        return m_PageCount * SECTOR_PAGE_SIZE;
+    }
+
+    uint32_t GetSectorCount() const
+    {
+        return m_Sectors.size();
+    }
+
+    float GetSectorSize() const
+    {
+        return m_SectorSize;
+    }
+
+    // Frame stamped into the feedback by the culling pass of the frame recorded last.
+    uint32_t GetFrame() const
+    {
+        return m_Frame;
+    }
+
+    const SectorStreamingSettings& GetSettings() const
+    {
+        return m_Settings;
+    }
+
+    const SectorStreamingStats& GetStats() const
+    {
+        return m_Stats;
+    }
+
+    VkCore::Buffer& GetInstanceBuffer()
+    {
+        return m_InstanceBuffer;
+    }
+
+    VkCore::Buffer& GetPageBuffer()
+    {
+        return m_PageBuffer;
+    }
+
+    VkCore::Buffer& GetSectorBuffer()
+    {
+        return m_SectorBuffer;
+    }
+
+    VkCore::Buffer& GetFeedbackBuffer()
+    {
+        return m_FeedbackBuffer;
+    }
+
+    uint64_t GetMemoryUsage();
+
+  private:
+    struct Sector
+    {
+        // Range of the sector in the sorted instances.
+        uint32_t firstInstance = 0;
+        uint32_t instanceCount = 0;
+        // Bounding sphere (xyz - center, w - radius).
+        glm::vec4 bounds = glm::vec4(0.f);
+        std::vector<uint32_t> pages;
+        uint32_t lastVisibleFrame = 0;
+        float distance = 0.f;
+    };
+
+    void Partition(const std::vector<PackedInstance>& instances);
+    void WriteInstances(uint8_t* dst, const uint32_t first, const uint32_t count) const;
+
+    uint32_t GetPageCount(const uint32_t sector) const
+    {
+        return (m_Sectors[sector].instanceCount + SECTOR_PAGE_SIZE - 1) / SECTOR_PAGE_SIZE;
+    }
+
+    bool IsResident(const uint32_t sector) const
+    {
+        return !m_Sectors[sector].pages.empty();
+    }
+
+    void Evict(const uint32_t sector);
+    // Picks the resident sector to make room for a sector at the given distance, INVALID_SECTOR if there is none.
+    uint32_t FindEvictionCandidate(const float distance) const;
+
+  private:
+    SectorStreamingSettings m_Settings;
+    EInstanceFormat m_Format = EInstanceFormat::Packed;
+    uint32_t m_InstanceStride = 0;
+    vk::PipelineStageFlags m_ConsumerStages;
+
+    float m_SectorSize = 0.f;
+    std::vector<Sector> m_Sectors;
+    // The instances of all the sectors ordered by their sector.
+    std::vector<PackedInstance> m_Instances;
+
+    uint32_t m_PageCount = 0;
+    std::vector<uint32_t> m_FreePages;
+    std::vector<SectorPage> m_Pages;
+    std::vector<uint32_t> m_DirtyPages;
+    std::vector<uint8_t> m_IsPageDirty;
+    // Sectors streamed in this frame, in the order their pages were taken.
+    std::vector<uint32_t> m_LoadedSectors;
+
+    uint32_t m_Frame = 0;
+
+    VkCore::Buffer m_InstanceBuffer;
+    VkCore::Buffer m_PageBuffer;
+    VkCore::Buffer m_SectorBuffer;
+    // Last frame every sector was visible in, written by the culling pass.
+    VkCore::Buffer m_FeedbackBuffer;
+    std::vector<HostBuffer> m_FeedbackReadbacks;
+
+    // One segment of the upload budget and the whole page table per frame in flight.
+    HostBuffer m_UploadRing;
+    vk::DeviceSize m_RingSegmentSize = 0;
+    uint32_t m_RingInstanceCapacity = 0;
+
+    std::vector<vk::BufferCopy> m_InstanceRegions;
+    std::vector<vk::BufferCopy> m_PageRegions;
+
+    SectorStreamingStats m_Stats;
+};
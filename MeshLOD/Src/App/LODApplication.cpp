@@ -1,5 +1,7 @@
 #include "LODApplication.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <cstdint>
 #include <cstdio>
@@ -7,21 +9,17 @@
 #include <stddef.h>
 #include <stdexcept>
 
+#include "Constants.h"
 #include "GLFW/glfw3.h"
 #include "Log/Log.h"
+#include "Mesh/ClassicLODModel.h"
 #include "Mesh/LODMesh.h"
 #include "Model/Camera.h"
 #include "Model/MatrixBuffer.h"
-#include "Model/Shaders/ShaderData.h"
-#include "Model/Shaders/ShaderLoader.h"
 #include "Vk/Buffers/Buffer.h"
 #include "Vk/Descriptors/DescriptorBuilder.h"
 #include "Vk/Devices/DeviceManager.h"
-#include "Vk/GraphicsPipeline/GraphicsPipelineBuilder.h"
-#include "Vk/Swapchain.h"
-#include "Vk/SwapchainRenderPass.h"
 #include "Vk/Utils.h"
-#include "Vk/Vertex/VertexAttributeBuilder.h"
 #include "backends/imgui_impl_glfw.h"
 #include "glm/ext/matrix_transform.hpp"
 #include "glm/ext/vector_float3.hpp"
@@ -32,14 +30,19 @@
 #include "vulkan/vulkan_handles.hpp"
 #include "vulkan/vulkan_structs.hpp"
 #include "glm/gtc/type_ptr.hpp"
-#include "../../Common/Query.h"
+#include "../../Common/Renderer/PipelineBuilder.h"
+#include "../../Common/TaskDispatch.h"
 
-void LODApplication::Run(const uint32_t winWidth, const uint32_t winHeight)
+void LODApplication::Run(const LaunchOptions& options)
 {
     Logger::SetSeverityFilter(ESeverity::Verbose);
 
-    m_Window = new VkCore::Window("Mesh Application", winWidth, winHeight);
-    m_Window->SetEventCallback(std::bind(&LODApplication::OnEvent, this, std::placeholders::_1));
+    // The headless mode renders offscreen, without opening a window.
+    if (!options.headless)
+    {
+        m_Window = new VkCore::Window("Mesh Application", options.width, options.height);
+        m_Window->SetEventCallback(std::bind(&LODApplication::OnEvent, this, std::placeholders::_1));
+    }
 
     m_Renderer = VulkanRenderer("Mesh Application", m_Window,
                                 {VK_KHR_SWAPCHAIN_EXTENSION_NAME, VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME,
@@ -50,8 +53,8 @@ void LODApplication::Run(const uint32_t winWidth, const uint32_t winHeight)
                                  VK_EXT_MESH_SHADER_EXTENSION_NAME,
 #endif
                                  VK_KHR_SHADER_NON_SEMANTIC_INFO_EXTENSION_NAME},
-                                {});
-    m_Renderer.InitImGui(m_Window, winWidth, winHeight);
+                                {}, options);
+    m_Renderer.InitImGui(m_Window, m_Renderer.GetWidth(), m_Renderer.GetHeight());
 
 #ifndef VK_MESH_EXT
     vkCmdDrawMeshTasksNv =
@@ -59,12 +62,16 @@ void LODApplication::Run(const uint32_t winWidth, const uint32_t winHeight)
 #else
     vkCmdDrawMeshTasksEXT =
         (PFN_vkCmdDrawMeshTasksEXT)vkGetDeviceProcAddr(*VkCore::DeviceManager::GetDevice(), "vkCmdDrawMeshTasksEXT");
+    vkCmdDrawMeshTasksIndirectCountEXT = (PFN_vkCmdDrawMeshTasksIndirectCountEXT)vkGetDeviceProcAddr(
+        *VkCore::DeviceManager::GetDevice(), "vkCmdDrawMeshTasksIndirectCountEXT");
+    vkCmdDrawMeshTasksIndirectEXT = (PFN_vkCmdDrawMeshTasksIndirectEXT)vkGetDeviceProcAddr(
+        *VkCore::DeviceManager::GetDevice(), "vkCmdDrawMeshTasksIndirectEXT");
 #endif
 
     m_Camera =
-        Camera({-1.f, 3.f, -1.f}, {1.f, 0.5f, 1.f}, (float)m_Window->GetWidth() / m_Window->GetHeight(), 45.f, 50.f);
+        Camera({-1.f, 3.f, -1.f}, {1.f, 0.5f, 1.f}, (float)m_Renderer.GetWidth() / m_Renderer.GetHeight(), 45.f, 50.f);
     m_FrustumCamera =
-        Camera({-1.f, 3.f, -1.f}, {1.f, 0.5f, 1.f}, (float)m_Window->GetWidth() / m_Window->GetHeight(), 45.f, 40.f);
+        Camera({-1.f, 3.f, -1.f}, {1.f, 0.5f, 1.f}, (float)m_Renderer.GetWidth() / m_Renderer.GetHeight(), 45.f, 40.f);
 
     m_CurrentCamera = &m_FrustumCamera;
 
@@ -73,7 +80,7 @@ void LODApplication::Run(const uint32_t winWidth, const uint32_t winHeight)
     m_Position = m_FrustumCamera.GetPosition();
 
     // Create Uniform Buffers
-    for (int i = 0; i < m_Renderer.m_Swapchain.GetImageCount(); i++)
+    for (int i = 0; i < m_Renderer.GetFramesInFlight(); i++)
     {
         VkCore::Buffer matBuffer = VkCore::Buffer(vk::BufferUsageFlagBits::eUniformBuffer);
         matBuffer.InitializeOnCpu(sizeof(FrustumMatrixBuffer));
@@ -84,59 +91,68 @@ void LODApplication::Run(const uint32_t winWidth, const uint32_t winHeight)
     // Camera Matrix Descriptor Sets
     m_DescriptorBuilder = VkCore::DescriptorBuilder(VkCore::DeviceManager::GetDevice());
 
-    for (uint32_t i = 0; i < m_Renderer.m_Swapchain.GetImageCount(); i++)
+    for (uint32_t i = 0; i < m_Renderer.GetFramesInFlight(); i++)
     {
         vk::DescriptorSet tempSet;
 
         m_DescriptorBuilder.BindBuffer(0, m_MatBuffers[i], vk::DescriptorType::eUniformBuffer,
                                        vk::ShaderStageFlagBits::eMeshNV | vk::ShaderStageFlagBits::eVertex |
-                                           vk::ShaderStageFlagBits::eTaskEXT);
+                                           vk::ShaderStageFlagBits::eTaskEXT | vk::ShaderStageFlagBits::eCompute);
         m_DescriptorBuilder.Build(tempSet, m_MatrixDescSetLayout);
         m_DescriptorBuilder.Clear();
 
         m_MatrixDescriptorSets.emplace_back(tempSet);
     }
 
+    // The task commands of the instances are sized by the meshlets of the model.
+    m_Model = new LODModel("MeshLOD/Res/Artwork/OBJs/kitten_lod0.obj");
+
     InitializeInstancing();
 
+    m_PipelineFactory.Initialize();
+
+    // The pipelines are built on the workers, the first frame waits for them. The bounds pipeline is only used by the
+    // disabled bounds pass, so it's left to InitializeBoundsPipeline to build it once the pass is needed.
+    m_Renderer.BeginPipelineCreation();
     InitializeModelPipeline();
+    InitializeLODPrepass();
+    InitializeImpostors();
     InitializeAxisPipeline();
-    InitializeBoundsPipeline();
     InitializeFrustumPipeline();
 
     Loop();
+
+    m_Renderer.WriteHeadlessCapture();
     Shutdown();
 }
 
 void LODApplication::InitializeModelPipeline()
 {
-
-    m_Model = new LODModel("MeshLOD/Res/Artwork/OBJs/kitten_lod0.obj");
-
-
-    const std::vector<VkCore::ShaderData> shaders =
-        VkCore::ShaderLoader::LoadMeshShaders("MeshLOD/Res/Shaders/lod");
-
-    // Pipeline
-    VkCore::GraphicsPipelineBuilder pipelineBuilder(VkCore::DeviceManager::GetDevice(), true);
-
-    m_ModelPipeline = pipelineBuilder.BindShaderModules(shaders)
-                          .BindRenderPass(m_Renderer.m_RenderPass.GetVkRenderPass())
-                          .EnableDepthTest()
-                          .AddViewport(glm::uvec4(0, 0, m_Window->GetWidth(), m_Window->GetHeight()))
-                          .FrontFaceDirection(vk::FrontFace::eClockwise)
-                          .SetCullMode(vk::CullModeFlagBits::eBack)
-                          .AddDisabledBlendAttachment()
-                          .AddDescriptorLayout(m_MatrixDescSetLayout)
-                          .AddDescriptorLayout(m_Model->GetMeshSetLayout(0))
-                          .AddDescriptorLayout(m_InstancesDescSetLayout)
-                          .AddPushConstantRange<FragmentPC>(vk::ShaderStageFlagBits::eFragment)
-                          .AddPushConstantRange<LodPC>(
-                              vk::ShaderStageFlagBits::eMeshEXT | vk::ShaderStageFlagBits::eTaskEXT, sizeof(FragmentPC))
-                          .SetPrimitiveAssembly(vk::PrimitiveTopology::eTriangleList)
-                          .AddDynamicState(vk::DynamicState::eScissor)
-                          .AddDynamicState(vk::DynamicState::eViewport)
-                          .Build(m_ModelPipelineLayout);
+    m_ModelPipelineBuild = m_PipelineFactory.Submit([this, &pipelineCache = m_Renderer.GetPipelineCache()]() {
+        const std::vector<ShaderBinary> shaders = LoadMeshShaders("MeshLOD/Res/Shaders/lod");
+
+        GraphicsPipelineBuilder pipelineBuilder(pipelineCache);
+
+        m_ModelPipeline = pipelineBuilder.BindShaderModules(shaders)
+                              .BindRenderPass(m_Renderer.GetVkRenderPass())
+                              .EnableDepthTest()
+                              .AddViewport(glm::uvec4(0, 0, m_Renderer.GetWidth(), m_Renderer.GetHeight()))
+                              .FrontFaceDirection(vk::FrontFace::eClockwise)
+                              .SetCullMode(vk::CullModeFlagBits::eBack)
+                              .AddDisabledBlendAttachment()
+                              .AddDescriptorLayout(m_MatrixDescSetLayout)
+                              .AddDescriptorLayout(m_Model->GetMeshSetLayout(0))
+                              .AddDescriptorLayout(m_InstancesDescSetLayout)
+                              .AddDescriptorLayout(m_LODDrawSetLayout)
+                              .AddPushConstantRange<FragmentPC>(vk::ShaderStageFlagBits::eFragment)
+                              .AddPushConstantRange<LodPC>(vk::ShaderStageFlagBits::eMeshEXT |
+                                                               vk::ShaderStageFlagBits::eTaskEXT,
+                                                           sizeof(FragmentPC))
+                              .SetPrimitiveAssembly(vk::PrimitiveTopology::eTriangleList)
+                              .AddDynamicState(vk::DynamicState::eScissor)
+                              .AddDynamicState(vk::DynamicState::eViewport)
+                              .Build(m_ModelPipelineLayout);
+    });
 }
 
 void LODApplication::InitializeAxisPipeline()
@@ -156,113 +172,352 @@ void LODApplication::InitializeAxisPipeline()
     m_AxisIndexBuffer = VkCore::Buffer(vk::BufferUsageFlagBits::eIndexBuffer);
     m_AxisIndexBuffer.InitializeOnGpu(&m_AxisIndexData, sizeof(uint32_t) * 6);
 
-    VkCore::VertexAttributeBuilder attributeBuilder{};
-
-    attributeBuilder.PushAttribute<float>(3);
-    attributeBuilder.SetBinding(0);
-
-    std::vector<VkCore::ShaderData> shaderData = VkCore::ShaderLoader::LoadClassicShaders("MeshLOD/Res/Shaders/axis");
-    VkCore::GraphicsPipelineBuilder pipelineBuilder(VkCore::DeviceManager::GetDevice());
-
-    m_AxisPipeline = pipelineBuilder.BindShaderModules(shaderData)
-                         .BindRenderPass(m_Renderer.m_RenderPass.GetVkRenderPass())
-                         .AddViewport(glm::uvec4(0, 0, m_Window->GetWidth(), m_Window->GetHeight()))
-                         .FrontFaceDirection(vk::FrontFace::eCounterClockwise)
-                         .SetCullMode(vk::CullModeFlagBits::eBack)
-                         .BindVertexAttributes(attributeBuilder)
-                         .AddDisabledBlendAttachment()
-                         .AddDescriptorLayout(m_MatrixDescSetLayout)
-                         .SetPrimitiveAssembly(vk::PrimitiveTopology::eLineList)
-                         .AddDynamicState(vk::DynamicState::eScissor)
-                         .AddDynamicState(vk::DynamicState::eViewport)
-                         .Build(m_AxisPipelineLayout);
+    m_AxisPipelineBuild = m_PipelineFactory.Submit([this, &pipelineCache = m_Renderer.GetPipelineCache()]() {
+        VertexLayout vertexLayout;
+
+        vertexLayout.PushAttribute<float>(3);
+        vertexLayout.SetBinding(0);
+
+        const std::vector<ShaderBinary> shaderData = LoadClassicShaders("MeshLOD/Res/Shaders/axis");
+        GraphicsPipelineBuilder pipelineBuilder(pipelineCache);
+
+        m_AxisPipeline = pipelineBuilder.BindShaderModules(shaderData)
+                             .BindRenderPass(m_Renderer.GetVkRenderPass())
+                             .AddViewport(glm::uvec4(0, 0, m_Renderer.GetWidth(), m_Renderer.GetHeight()))
+                             .FrontFaceDirection(vk::FrontFace::eCounterClockwise)
+                             .SetCullMode(vk::CullModeFlagBits::eBack)
+                             .BindVertexAttributes(vertexLayout)
+                             .AddDisabledBlendAttachment()
+                             .AddDescriptorLayout(m_MatrixDescSetLayout)
+                             .SetPrimitiveAssembly(vk::PrimitiveTopology::eLineList)
+                             .AddDynamicState(vk::DynamicState::eScissor)
+                             .AddDynamicState(vk::DynamicState::eViewport)
+                             .Build(m_AxisPipelineLayout);
+    });
 }
 
 void LODApplication::InitializeBoundsPipeline()
 {
+    // Built on the first use only, it's a debug view.
+    if (m_BoundsPipelineBuild.valid())
+    {
+        return;
+    }
 
     m_Sphere = SphereModel(Vec3f(0.f, 0.f, 0.f));
 
-    VkCore::VertexAttributeBuilder attributeBuilder;
+    m_BoundsPipelineBuild = m_PipelineFactory.Submit([this, &pipelineCache = m_Renderer.GetPipelineCache()]() {
+        VertexLayout vertexLayout;
+
+        vertexLayout.PushAttribute<float>(3).PushAttribute<float>(3).PushAttribute<float>(3);
+
+        GraphicsPipelineBuilder pipelineBuilder(pipelineCache);
+
+        const std::vector<ShaderBinary> shaderData = LoadClassicShaders("MeshLOD/Res/Shaders/bounds");
+
+        m_BoundsPipeline = pipelineBuilder.BindShaderModules(shaderData)
+                               .BindRenderPass(m_Renderer.GetVkRenderPass())
+                               .EnableDepthTest()
+                               .AddViewport(glm::uvec4(0, 0, m_Renderer.GetWidth(), m_Renderer.GetHeight()))
+                               .FrontFaceDirection(vk::FrontFace::eClockwise)
+                               .SetCullMode(vk::CullModeFlagBits::eNone)
+                               .BindVertexAttributes(vertexLayout)
+                               .AddDisabledBlendAttachment()
+                               .AddDescriptorLayout(m_MatrixDescSetLayout)
+                               .AddDescriptorLayout(m_Model->GetMeshSetLayout(0))
+                               .SetPrimitiveAssembly(vk::PrimitiveTopology::eLineList)
+                               .AddDynamicState(vk::DynamicState::eScissor)
+                               .AddDynamicState(vk::DynamicState::eViewport)
+                               .Build(m_BoundsPipelineLayout);
+    });
+}
 
-    attributeBuilder.PushAttribute<float>(3).PushAttribute<float>(3).PushAttribute<float>(3);
+void LODApplication::InitializeFrustumPipeline()
+{
+    std::tie(m_FrustumBuffer, m_FrustumIndexBuffer) = m_FrustumCamera.ConstructFrustumModel();
 
-    VkCore::GraphicsPipelineBuilder pipelineBuilder(VkCore::DeviceManager::GetDevice());
+    m_FrustumPipelineBuild = m_PipelineFactory.Submit([this, &pipelineCache = m_Renderer.GetPipelineCache()]() {
+        VertexLayout vertexLayout;
+
+        vertexLayout.PushAttribute<float>(3).PushAttribute<float>(3).PushAttribute<float>(3);
+        vertexLayout.SetBinding(0);
+
+        const std::vector<ShaderBinary> shaderData = LoadClassicShaders("MeshLOD/Res/Shaders/frustum");
+
+        GraphicsPipelineBuilder pipelineBuilder(pipelineCache);
+
+        m_FrustumPipeline = pipelineBuilder.BindShaderModules(shaderData)
+                                .BindRenderPass(m_Renderer.GetVkRenderPass())
+                                .AddViewport(glm::uvec4(0, 0, m_Renderer.GetWidth(), m_Renderer.GetHeight()))
+                                .FrontFaceDirection(vk::FrontFace::eCounterClockwise)
+                                .SetCullMode(vk::CullModeFlagBits::eNone)
+                                .BindVertexAttributes(vertexLayout)
+                                .AddDisabledBlendAttachment()
+                                .SetLineWidth(2.f)
+                                .AddDescriptorLayout(m_MatrixDescSetLayout)
+                                .SetPrimitiveAssembly(vk::PrimitiveTopology::eLineList)
+                                .AddDynamicState(vk::DynamicState::eScissor)
+                                .AddDynamicState(vk::DynamicState::eViewport)
+                                .Build(m_FrustumPipelineLayout);
+    });
+}
 
-    std::vector<VkCore::ShaderData> shaderData = VkCore::ShaderLoader::LoadClassicShaders("MeshLOD/Res/Shaders/bounds");
+glm::vec3 LODApplication::GetGridPosition(const uint32_t index) const
+{
+    const glm::vec3 span = glm::vec3(1.f);
 
-    m_BoundsPipeline = pipelineBuilder.BindShaderModules(shaderData)
-                           .BindRenderPass(m_Renderer.m_RenderPass.GetVkRenderPass())
-                           .EnableDepthTest()
-                           .AddViewport(glm::uvec4(0, 0, m_Window->GetWidth(), m_Window->GetHeight()))
-                           .FrontFaceDirection(vk::FrontFace::eClockwise)
-                           .SetCullMode(vk::CullModeFlagBits::eNone)
-                           .BindVertexAttributes(attributeBuilder)
-                           .AddDisabledBlendAttachment()
-                           .AddDescriptorLayout(m_MatrixDescSetLayout)
-                           .AddDescriptorLayout(m_Model->GetMeshSetLayout(0))
-                           .SetPrimitiveAssembly(vk::PrimitiveTopology::eLineList)
-                           .AddDynamicState(vk::DynamicState::eScissor)
-                           .AddDynamicState(vk::DynamicState::eViewport)
-                           .Build(m_BoundsPipelineLayout);
+    return {(index % m_InstanceSize.x) * span.x, 0.f, (index / m_InstanceSize.x) * span.y};
 }
 
-void LODApplication::InitializeFrustumPipeline()
+void LODApplication::AnimateInstances(const float time)
 {
-    std::tie(m_FrustumBuffer, m_FrustumIndexBuffer) = m_FrustumCamera.ConstructFrustumModel();
+    // Every instance whose index falls into the first N percent of a block of 100 bobs up and down. The moving
+    // instances form short runs spread over the whole buffer, like the objects moving in a real scene.
+    for (uint32_t index = 0; index < m_InstanceCountMax; index++)
+    {
+        if (index % 100 >= (uint32_t)m_AnimatedPercent)
+        {
+            continue;
+        }
+
+        const glm::vec3 position = GetGridPosition(index) + glm::vec3(0.f, 0.25f * sinf(time * 2.f + index * 0.1f), 0.f);
 
-    VkCore::VertexAttributeBuilder attributeBuilder{};
-
-    attributeBuilder.PushAttribute<float>(3).PushAttribute<float>(3).PushAttribute<float>(3);
-    attributeBuilder.SetBinding(0);
-
-    std::vector<VkCore::ShaderData> shaderData =
-        VkCore::ShaderLoader::LoadClassicShaders("MeshLOD/Res/Shaders/frustum");
-
-    VkCore::GraphicsPipelineBuilder pipelineBuilder(VkCore::DeviceManager::GetDevice());
-
-    m_FrustumPipeline = pipelineBuilder.BindShaderModules(shaderData)
-                            .BindRenderPass(m_Renderer.m_RenderPass.GetVkRenderPass())
-                            .AddViewport(glm::uvec4(0, 0, m_Window->GetWidth(), m_Window->GetHeight()))
-                            .FrontFaceDirection(vk::FrontFace::eCounterClockwise)
-                            .SetCullMode(vk::CullModeFlagBits::eNone)
-                            .BindVertexAttributes(attributeBuilder)
-                            .AddDisabledBlendAttachment()
-                            .SetLineWidth(2.f)
-                            .AddDescriptorLayout(m_MatrixDescSetLayout)
-                            .SetPrimitiveAssembly(vk::PrimitiveTopology::eLineList)
-                            .AddDynamicState(vk::DynamicState::eScissor)
-                            .AddDynamicState(vk::DynamicState::eViewport)
-                            .Build(m_FrustumPipelineLayout);
+        m_Instances.UpdateTransform(m_InstanceHandles[index], glm::translate(glm::identity<glm::mat4>(), position));
+    }
 }
 
 void LODApplication::InitializeInstancing()
 {
 
-    const glm::vec3 span = glm::vec3(1.f);
+    m_Instances.Initialize(m_InstanceCountMax, m_Renderer.GetFramesInFlight(), m_InstanceFormat,
+                           m_InstanceBounds,
+                           vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTaskShaderEXT |
+                               vk::PipelineStageFlagBits::eMeshShaderEXT);
 
-    std::vector<glm::mat4> instances;
-    instances.resize(m_InstanceCountMax);
+    m_InstanceHandles.resize(m_InstanceCountMax);
 
-    for (uint32_t y = 0; y < m_InstanceSize.y; y++)
+    for (uint32_t index = 0; index < m_InstanceCountMax; index++)
     {
-        for (uint32_t x = 0; x < m_InstanceSize.x; x++)
-        {
-            glm::vec3 instancePos = {x * span.x, 0.f, y * span.y};
+        m_InstanceHandles[index] = m_Instances.Add(glm::translate(glm::identity<glm::mat4>(), GetGridPosition(index)));
+    }
 
-            const uint32_t index = x + m_InstanceSize.y * y;
+    LOGF(Application, Info, "Instance buffer: %u instances, %.2f MB", m_InstanceCountMax,
+         m_Instances.GetInstanceBuffer().GetSize() / (1024.f * 1024.f))
 
-            instances[index] = (glm::translate(glm::identity<glm::mat4>(), instancePos));
-        }
-    }
+    lod_pc.packed_instances = m_InstanceFormat == EInstanceFormat::Packed;
+    lod_prepass_pc.packed_instances = m_InstanceFormat == EInstanceFormat::Packed;
+
+    const std::vector<uint32_t> lodStates(m_InstanceCountMax, LOD_STATE_NONE);
+
+    m_LODStateBuffer = VkCore::Buffer(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst);
+    m_LODStateBuffer.InitializeOnGpu(lodStates.data(), lodStates.size() * sizeof(uint32_t));
 
-    m_InstancesBuffer = VkCore::Buffer(vk::BufferUsageFlagBits::eStorageBuffer);
-    m_InstancesBuffer.InitializeOnGpu(instances.data(), instances.size() * sizeof(glm::mat4));
+    // A slot taken by another instance starts without a LOD, so no transition is counted for it.
+    m_Instances.AddSlotState(m_LODStateBuffer, LOD_STATE_NONE);
 
     m_DescriptorBuilder
-        .BindBuffer(0, m_InstancesBuffer, vk::DescriptorType::eStorageBuffer,
-                    vk::ShaderStageFlagBits::eMeshEXT | vk::ShaderStageFlagBits::eTaskEXT)
+        .BindBuffer(0, m_Instances.GetInstanceBuffer(), vk::DescriptorType::eStorageBuffer,
+                    vk::ShaderStageFlagBits::eMeshEXT | vk::ShaderStageFlagBits::eTaskEXT |
+                        vk::ShaderStageFlagBits::eCompute)
+        .BindBuffer(1, m_LODStateBuffer, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+        .BindBuffer(2, m_Instances.GetBoundsBuffer(), vk::DescriptorType::eStorageBuffer,
+                    vk::ShaderStageFlagBits::eCompute)
         .Build(m_InstancesDescSet, m_InstancesDescSetLayout);
+
+    m_DescriptorBuilder.Clear();
+
+    lod_pc.max_instance_count = m_InstanceCountMax;
+    lod_prepass_pc.max_instance_count = m_InstanceCountMax;
+
+    // The task workgroups of all the instances are flattened and split into commands within the dispatch limits.
+    // In the worst case every instance takes the workgroups of all the meshlets of the model.
+    const TaskDispatchLimits limits = QueryTaskDispatchLimits();
+    const uint64_t maxTaskCount = (uint64_t)m_InstanceCountMax * ((m_Model->GetMesh(0).GetMeshletCount() + 31) / 32);
+
+    m_TaskCmdCapacity = GetTaskCommandCount(maxTaskCount, limits);
+
+    lod_prepass_pc.max_task_groups = limits.maxGroupCountX;
+    lod_prepass_pc.max_task_cmds = m_TaskCmdCapacity;
+
+    for (uint32_t i = 0; i < m_Renderer.GetFramesInFlight(); i++)
+    {
+        // Draw count padded to 16 bytes, followed by the VkDrawMeshTasksIndirectCommandEXT commands.
+        m_TaskIndirectCmds.emplace_back(vk::BufferUsageFlagBits::eStorageBuffer |
+                                        vk::BufferUsageFlagBits::eIndirectBuffer |
+                                        vk::BufferUsageFlagBits::eTransferDst);
+        m_TaskIndirectCmds[i].InitializeOnGpu(16 + m_TaskCmdCapacity * sizeof(VkDrawMeshTasksIndirectCommandEXT));
+
+        // Instance counts and task workgroup offsets of the buckets, followed by the first workgroup of every
+        // command.
+        m_LODBucketBuffers.emplace_back(vk::BufferUsageFlagBits::eStorageBuffer |
+                                        vk::BufferUsageFlagBits::eTransferDst);
+        m_LODBucketBuffers[i].InitializeOnGpu((2 * Constants::MAX_LOD_LEVELS + 1 + m_TaskCmdCapacity) *
+                                              sizeof(uint32_t));
+
+        // Every LOD gets its own range of the size of the maximum instance count.
+        m_LODInstanceBuffers.emplace_back(vk::BufferUsageFlagBits::eStorageBuffer);
+        m_LODInstanceBuffers[i].InitializeOnGpu(Constants::MAX_LOD_LEVELS * m_InstanceCountMax * sizeof(uint32_t));
+
+        m_SortKeyBuffers.emplace_back(vk::BufferUsageFlagBits::eStorageBuffer);
+        m_SortKeyBuffers[i].InitializeOnGpu(Constants::MAX_LOD_LEVELS * m_InstanceCountMax * sizeof(uint32_t));
+
+        // Indexed by the instance, only the entries of the instances visible in the frame are written.
+        m_TransformCacheBuffers.emplace_back(vk::BufferUsageFlagBits::eStorageBuffer);
+        m_TransformCacheBuffers[i].InitializeOnGpu(m_InstanceCountMax * sizeof(CachedInstanceTransform));
+
+        // Indirect mesh tasks command of the impostors, followed by the impostor instance indices.
+        m_ImpostorInstanceBuffers.emplace_back(vk::BufferUsageFlagBits::eStorageBuffer |
+                                               vk::BufferUsageFlagBits::eIndirectBuffer |
+                                               vk::BufferUsageFlagBits::eTransferDst);
+        m_ImpostorInstanceBuffers[i].InitializeOnGpu(sizeof(ImpostorListHeader) + m_InstanceCountMax * sizeof(uint32_t));
+
+        m_LODStatsBuffers.emplace_back(vk::BufferUsageFlagBits::eStorageBuffer |
+                                       vk::BufferUsageFlagBits::eTransferSrc |
+                                       vk::BufferUsageFlagBits::eTransferDst);
+        m_LODStatsBuffers[i].InitializeOnGpu(sizeof(LODStats));
+
+        m_LODStatsReadbacks.emplace_back();
+        m_LODStatsReadbacks[i].Initialize(sizeof(LODStats), vk::BufferUsageFlagBits::eTransferDst);
+        m_HasFrameResults.emplace_back(false);
+
+        m_DurationQueries.emplace_back(std::make_unique<DurationQuery>());
+        m_UploadQueries.emplace_back(std::make_unique<DurationQuery>());
+        m_StatisticsQueries.emplace_back(std::make_unique<PipelineStatisticsQuery>(
+            vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations));
+
+        vk::DescriptorSet set;
+
+        m_DescriptorBuilder
+            .BindBuffer(0, m_TaskIndirectCmds[i], vk::DescriptorType::eStorageBuffer,
+                        vk::ShaderStageFlagBits::eCompute)
+            .BindBuffer(1, m_LODBucketBuffers[i], vk::DescriptorType::eStorageBuffer,
+                        vk::ShaderStageFlagBits::eCompute | vk::ShaderStageFlagBits::eTaskEXT)
+            .BindBuffer(2, m_LODInstanceBuffers[i], vk::DescriptorType::eStorageBuffer,
+                        vk::ShaderStageFlagBits::eCompute | vk::ShaderStageFlagBits::eTaskEXT)
+            .BindBuffer(3, m_ImpostorInstanceBuffers[i], vk::DescriptorType::eStorageBuffer,
+                        vk::ShaderStageFlagBits::eCompute)
+            .BindBuffer(4, m_LODStatsBuffers[i], vk::DescriptorType::eStorageBuffer,
+                        vk::ShaderStageFlagBits::eCompute)
+            .BindBuffer(5, m_SortKeyBuffers[i], vk::DescriptorType::eStorageBuffer,
+                        vk::ShaderStageFlagBits::eCompute)
+            .BindBuffer(6, m_TransformCacheBuffers[i], vk::DescriptorType::eStorageBuffer,
+                        vk::ShaderStageFlagBits::eCompute | vk::ShaderStageFlagBits::eMeshEXT)
+            .Build(set, m_LODDrawSetLayout);
+
+        m_LODDrawSets.emplace_back(set);
+
+        m_DescriptorBuilder.Clear();
+    }
+
+    // Every LOD bucket is a segment of its own, counted by the instance counts at the start of the bucket buffers.
+    m_DepthSort.Initialize(Constants::MAX_LOD_LEVELS, m_InstanceCountMax, m_Renderer.GetPipelineCache());
+
+    for (uint32_t i = 0; i < m_Renderer.GetFramesInFlight(); i++)
+    {
+        m_DepthSort.AddFrame(m_SortKeyBuffers[i], m_LODInstanceBuffers[i], m_LODBucketBuffers[i]);
+    }
+}
+
+void LODApplication::InitializeLODPrepass()
+{
+    // The LOD info is stored in the mesh descriptor set which is only visible to the mesh shading stages. The
+    // prepass therefore gets its own copy. The struct contains only 32-bit integers, so it has the same layout on
+    // the CPU and in std430.
+    const auto meshInfo = m_Model->GetMesh(0).GetMeshInfo();
+
+    m_LODInfoBuffer = VkCore::Buffer(vk::BufferUsageFlagBits::eStorageBuffer);
+    m_LODInfoBuffer.InitializeOnGpu(&meshInfo, sizeof(meshInfo));
+
+    m_DescriptorBuilder
+        .BindBuffer(0, m_LODInfoBuffer, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+        .Build(m_LODInfoSet, m_LODInfoSetLayout);
+
+    m_DescriptorBuilder.Clear();
+
+    // Each pass is built on its own worker.
+    m_LODPrepassPipelineBuild = m_PipelineFactory.Submit([this, &pipelineCache = m_Renderer.GetPipelineCache()]() {
+        const ShaderBinary computeShader = LoadShader("MeshLOD/Res/Shaders/lod_prepass.comp");
+
+        ComputePipelineBuilder pipelineBuilder(pipelineCache);
+
+        m_LODPrepassPipeline = pipelineBuilder.BindShaderModule(computeShader)
+                                   .AddPushConstantRange<LodPrepassPC>(vk::ShaderStageFlagBits::eCompute)
+                                   .AddDescriptorLayout(m_MatrixDescSetLayout)
+                                   .AddDescriptorLayout(m_LODInfoSetLayout)
+                                   .AddDescriptorLayout(m_InstancesDescSetLayout)
+                                   .AddDescriptorLayout(m_LODDrawSetLayout)
+                                   .Build(m_LODPrepassPipelineLayout);
+    });
+
+    m_LODFinalizePipelineBuild = m_PipelineFactory.Submit([this, &pipelineCache = m_Renderer.GetPipelineCache()]() {
+        const ShaderBinary computeShader = LoadShader("MeshLOD/Res/Shaders/lod_finalize.comp");
+
+        ComputePipelineBuilder pipelineBuilder(pipelineCache);
+
+        m_LODFinalizePipeline = pipelineBuilder.BindShaderModule(computeShader)
+                                    .AddPushConstantRange<LodPrepassPC>(vk::ShaderStageFlagBits::eCompute)
+                                    .AddDescriptorLayout(m_MatrixDescSetLayout)
+                                    .AddDescriptorLayout(m_LODInfoSetLayout)
+                                    .AddDescriptorLayout(m_InstancesDescSetLayout)
+                                    .AddDescriptorLayout(m_LODDrawSetLayout)
+                                    .Build(m_LODFinalizePipelineLayout);
+    });
+}
+
+void LODApplication::InitializeImpostors()
+{
+    // The meshlet buffers of the LOD model are only visible to the mesh shading stages, so the atlas is baked from
+    // the classic version of the same model.
+    ClassicLODModel* bakeModel = new ClassicLODModel("MeshLOD/Res/Artwork/OBJs/kitten_lod0.obj");
+
+    m_ImpostorAtlas.Bake({bakeModel}, m_Renderer.GetPipelineCache());
+
+    bakeModel->Destroy();
+    delete bakeModel;
+
+    vk::DescriptorImageInfo atlasInfo = m_ImpostorAtlas.GetAtlas().CreateDescriptorImageInfo(vk::ImageLayout::eGeneral);
+
+    for (uint32_t i = 0; i < m_Renderer.GetFramesInFlight(); i++)
+    {
+        vk::DescriptorSet set;
+
+        m_DescriptorBuilder
+            .BindImage(0, atlasInfo, vk::DescriptorType::eStorageImage, vk::ShaderStageFlagBits::eFragment)
+            .BindBuffer(1, m_ImpostorAtlas.GetBoundsBuffer(), vk::DescriptorType::eStorageBuffer,
+                        vk::ShaderStageFlagBits::eMeshEXT)
+            .BindBuffer(2, m_ImpostorInstanceBuffers[i], vk::DescriptorType::eStorageBuffer,
+                        vk::ShaderStageFlagBits::eMeshEXT)
+            .Build(set, m_ImpostorSetLayout);
+
+        m_ImpostorSets.emplace_back(set);
+
+        m_DescriptorBuilder.Clear();
+    }
+
+    m_ImpostorPipelineBuild = m_PipelineFactory.Submit([this, &pipelineCache = m_Renderer.GetPipelineCache()]() {
+        const std::vector<ShaderBinary> shaders = LoadMeshShaders("MeshLOD/Res/Shaders/impostor");
+
+        GraphicsPipelineBuilder pipelineBuilder(pipelineCache);
+
+        // The quads can face away from the camera, when the closest baked view doesn't match the camera direction
+        // exactly, therefore nothing is culled.
+        m_ImpostorPipeline = pipelineBuilder.BindShaderModules(shaders)
+                                 .BindRenderPass(m_Renderer.GetVkRenderPass())
+                                 .EnableDepthTest()
+                                 .AddViewport(glm::uvec4(0, 0, m_Renderer.GetWidth(), m_Renderer.GetHeight()))
+                                 .FrontFaceDirection(vk::FrontFace::eClockwise)
+                                 .SetCullMode(vk::CullModeFlagBits::eNone)
+                                 .AddDisabledBlendAttachment()
+                                 .AddDescriptorLayout(m_MatrixDescSetLayout)
+                                 .AddDescriptorLayout(m_ImpostorSetLayout)
+                                 .AddDescriptorLayout(m_InstancesDescSetLayout)
+                                 .AddPushConstantRange<FragmentPC>(vk::ShaderStageFlagBits::eFragment)
+                                 .AddPushConstantRange<LodPC>(vk::ShaderStageFlagBits::eMeshEXT, sizeof(FragmentPC))
+                                 .SetPrimitiveAssembly(vk::PrimitiveTopology::eTriangleList)
+                                 .AddDynamicState(vk::DynamicState::eScissor)
+                                 .AddDynamicState(vk::DynamicState::eViewport)
+                                 .Build(m_ImpostorPipelineLayout);
+    });
 }
 
 void LODApplication::DrawFrame()
@@ -277,7 +532,14 @@ void LODApplication::DrawFrame()
         return;
     }
 
-    const double time = glfwGetTime();
+    // The frame last recorded into this slot is finished by now, so its queries and statistics are read without
+    // stalling on the frames still in flight.
+    if (m_HasFrameResults[imageIndex])
+    {
+        ReadFrameResults(imageIndex);
+    }
+
+    const double time = m_Renderer.GetTime();
 
     m_CurrentCamera->Update();
 
@@ -305,36 +567,152 @@ void LODApplication::DrawFrame()
     m_Renderer.BeginCmdBuffer();
     vk::CommandBuffer commandBuffer = m_Renderer.GetCurrentCmdBuffer();
 
-    DurationQuery durationQuery;
+    DurationQuery& durationQuery = *m_DurationQueries[imageIndex];
+    DurationQuery& uploadQuery = *m_UploadQueries[imageIndex];
+    PipelineStatisticsQuery& statisticsQuery = *m_StatisticsQueries[imageIndex];
 
     durationQuery.Reset(commandBuffer);
+    uploadQuery.Reset(commandBuffer);
+    statisticsQuery.Reset(commandBuffer);
+
+    lod_prepass_pc.instance_count = std::min((uint32_t)m_InstanceCount, m_Instances.GetCount());
+    lod_prepass_pc.write_transform_cache = m_UseTransformCache;
+    lod_prepass_pc.model_mat = lod_pc.rotation_mat * lod_pc.scale_mat;
+    lod_pc.use_transform_cache = m_UseTransformCache;
+
+    {
+        // Move the animated instances and upload the changed ones
+        const auto cpuStart = std::chrono::high_resolution_clock::now();
+
+        if (m_AnimatedPercent > 0)
+        {
+            AnimateInstances((float)time);
+        }
+
+        uploadQuery.StartTimestamp(commandBuffer, vk::PipelineStageFlagBits::eTopOfPipe);
 
-    m_Renderer.BeginRenderPass({0.3f, 0.f, 0.2f, 1.f}, m_Window->GetWidth(), m_Window->GetHeight());
+        m_Instances.RecordUploads(commandBuffer, imageIndex);
 
-    vk::Rect2D scissor = vk::Rect2D({0, 0}, {m_Window->GetWidth(), m_Window->GetHeight()});
+        uploadQuery.EndTimestamp(commandBuffer, vk::PipelineStageFlagBits::eTransfer);
+
+        m_UploadCpuMs =
+            std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - cpuStart).count();
+    }
+
+    {
+        // Select the LOD of every instance and bucket the visible ones by it
+        commandBuffer.fillBuffer(m_TaskIndirectCmds[imageIndex].GetVkBuffer(), 0,
+                                 m_TaskIndirectCmds[imageIndex].GetSize(), 0);
+        commandBuffer.fillBuffer(m_LODBucketBuffers[imageIndex].GetVkBuffer(), 0,
+                                 m_LODBucketBuffers[imageIndex].GetSize(), 0);
+        commandBuffer.fillBuffer(m_ImpostorInstanceBuffers[imageIndex].GetVkBuffer(), 0, sizeof(ImpostorListHeader),
+                                 0);
+        commandBuffer.fillBuffer(m_LODStatsBuffers[imageIndex].GetVkBuffer(), 0,
+                                 m_LODStatsBuffers[imageIndex].GetSize(), 0);
+
+        vk::BufferMemoryBarrier clearBarriers[4] = {
+            m_TaskIndirectCmds[imageIndex].CreateBufferMemoryBarrier(vk::AccessFlagBits::eTransferWrite,
+                                                                     vk::AccessFlagBits::eShaderWrite),
+            m_LODBucketBuffers[imageIndex].CreateBufferMemoryBarrier(
+                vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite),
+            m_ImpostorInstanceBuffers[imageIndex].CreateBufferMemoryBarrier(
+                vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite),
+            m_LODStatsBuffers[imageIndex].CreateBufferMemoryBarrier(
+                vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite),
+        };
+
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader,
+                                      {}, {}, clearBarriers, {});
+
+        durationQuery.StartTimestamp(commandBuffer, vk::PipelineStageFlagBits::eComputeShader);
+
+        m_LODPrepassPipelineBuild.get();
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_LODPrepassPipeline);
+        commandBuffer.bindDescriptorSets(
+            vk::PipelineBindPoint::eCompute, m_LODPrepassPipelineLayout, 0,
+            {m_MatrixDescriptorSets[imageIndex], m_LODInfoSet, m_InstancesDescSet, m_LODDrawSets[imageIndex]}, {});
+
+        commandBuffer.pushConstants(m_LODPrepassPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0,
+                                    sizeof(LodPrepassPC), &lod_prepass_pc);
+
+        commandBuffer.dispatch(((uint32_t)m_InstanceCount / 32) + 1, 1, 1);
+
+        vk::MemoryBarrier memoryBarrier;
+        memoryBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+        memoryBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                      vk::PipelineStageFlagBits::eComputeShader, {}, memoryBarrier, {}, {});
+    }
+    if (m_SortByDepth)
+    {
+        // Order the instances of every LOD bucket front-to-back, so that the early depth test rejects more fragments
+        m_DepthSort.Record(commandBuffer, imageIndex);
+    }
+    {
+        // Flatten the LOD buckets into task workgroups and split them into the task commands
+        m_LODFinalizePipelineBuild.get();
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_LODFinalizePipeline);
+        commandBuffer.bindDescriptorSets(
+            vk::PipelineBindPoint::eCompute, m_LODFinalizePipelineLayout, 0,
+            {m_MatrixDescriptorSets[imageIndex], m_LODInfoSet, m_InstancesDescSet, m_LODDrawSets[imageIndex]}, {});
+
+        commandBuffer.pushConstants(m_LODFinalizePipelineLayout, vk::ShaderStageFlagBits::eCompute, 0,
+                                    sizeof(LodPrepassPC), &lod_prepass_pc);
+
+        commandBuffer.dispatch(1, 1, 1);
+
+        vk::MemoryBarrier memoryBarrier;
+        memoryBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+        memoryBarrier.dstAccessMask = vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead;
+
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                      vk::PipelineStageFlagBits::eDrawIndirect |
+                                          vk::PipelineStageFlagBits::eTaskShaderEXT |
+                                          vk::PipelineStageFlagBits::eMeshShaderEXT,
+                                      {}, memoryBarrier, {}, {});
+    }
+    {
+        // Copy the LOD statistics of this frame to the host, they are read once the frame is done
+        vk::BufferMemoryBarrier statsBarrier = m_LODStatsBuffers[imageIndex].CreateBufferMemoryBarrier(
+            vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eTransferRead);
+
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer,
+                                      {}, {}, statsBarrier, {});
+
+        commandBuffer.copyBuffer(m_LODStatsBuffers[imageIndex].GetVkBuffer(),
+                                 m_LODStatsReadbacks[imageIndex].GetVkBuffer(), vk::BufferCopy(0, 0, sizeof(LODStats)));
+
+        vk::MemoryBarrier hostBarrier;
+        hostBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+        hostBarrier.dstAccessMask = vk::AccessFlagBits::eHostRead;
+
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {},
+                                      hostBarrier, {}, {});
+    }
+
+    m_Renderer.BeginRenderPass({0.3f, 0.f, 0.2f, 1.f}, m_Renderer.GetWidth(), m_Renderer.GetHeight());
+
+    vk::Rect2D scissor = vk::Rect2D({0, 0}, {m_Renderer.GetWidth(), m_Renderer.GetHeight()});
     commandBuffer.setScissor(0, 1, &scissor);
 
-    vk::Viewport viewport = vk::Viewport(0, 0, m_Window->GetWidth(), m_Window->GetHeight(), 0, 1);
+    vk::Viewport viewport = vk::Viewport(0, 0, m_Renderer.GetWidth(), m_Renderer.GetHeight(), 0, 1);
     commandBuffer.setViewport(0, 1, &viewport);
 
     {
+        statisticsQuery.Begin(commandBuffer);
 
+        m_ModelPipelineBuild.get();
         commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_ModelPipeline);
         commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_ModelPipelineLayout, 0, 1,
                                          &m_MatrixDescriptorSets[imageIndex], 0, nullptr);
 
-        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_ModelPipelineLayout, 2, 1,
-                                         &m_InstancesDescSet, 0, nullptr);
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_ModelPipelineLayout, 2,
+                                         {m_InstancesDescSet, m_LODDrawSets[imageIndex]}, {});
 
         commandBuffer.pushConstants(m_ModelPipelineLayout, vk::ShaderStageFlagBits::eFragment, 0, sizeof(FragmentPC),
                                     &fragment_pc);
 
-        commandBuffer.pushConstants(m_ModelPipelineLayout,
-                                    vk::ShaderStageFlagBits::eMeshNV | vk::ShaderStageFlagBits ::eTaskEXT,
-                                    sizeof(FragmentPC), sizeof(LodPC), &lod_pc);
-
-        durationQuery.StartTimestamp(commandBuffer, vk::PipelineStageFlagBits::eTaskShaderEXT);
-
         for (uint32_t i = 0; i < m_Model->GetMeshCount(); i++)
         {
             LODMesh& mesh = m_Model->GetMesh(i);
@@ -344,21 +722,48 @@ void LODApplication::DrawFrame()
 
             lod_pc.meshlet_count = mesh.GetMeshInfo().lodMeshletCount[0];
 
+            commandBuffer.pushConstants(m_ModelPipelineLayout,
+                                        vk::ShaderStageFlagBits::eMeshNV | vk::ShaderStageFlagBits ::eTaskEXT,
+                                        sizeof(FragmentPC), sizeof(LodPC), &lod_pc);
+
             commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_ModelPipelineLayout, 1, 1, &set, 0,
                                              nullptr);
 
 #ifndef VK_MESH_EXT
             vkCmdDrawMeshTasksNv(&*commandBuffer, mesh.GetMeshletCount(), 0);
 #else
-            vkCmdDrawMeshTasksEXT(&*commandBuffer, (mesh.GetMeshInfo().lodMeshletCount[0] / 32) + 1, m_InstanceCount,
-                                  1);
+            const VkBuffer taskCmdsBuffer = m_TaskIndirectCmds[imageIndex].GetVkBuffer();
+
+            vkCmdDrawMeshTasksIndirectCountEXT(&*commandBuffer, taskCmdsBuffer, 16, taskCmdsBuffer, 0,
+                                               m_TaskCmdCapacity, sizeof(VkDrawMeshTasksIndirectCommandEXT));
 #endif
         }
 
+#ifdef VK_MESH_EXT
+        // Impostors of the instances beyond the impostor distance, the dispatch size is written by the finalize pass
+        m_ImpostorPipelineBuild.get();
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_ImpostorPipeline);
+        commandBuffer.bindDescriptorSets(
+            vk::PipelineBindPoint::eGraphics, m_ImpostorPipelineLayout, 0,
+            {m_MatrixDescriptorSets[imageIndex], m_ImpostorSets[imageIndex], m_InstancesDescSet}, {});
+
+        commandBuffer.pushConstants(m_ImpostorPipelineLayout, vk::ShaderStageFlagBits::eFragment, 0,
+                                    sizeof(FragmentPC), &fragment_pc);
+        commandBuffer.pushConstants(m_ImpostorPipelineLayout, vk::ShaderStageFlagBits::eMeshEXT, sizeof(FragmentPC),
+                                    sizeof(LodPC), &lod_pc);
+
+        vkCmdDrawMeshTasksIndirectEXT(&*commandBuffer, m_ImpostorInstanceBuffers[imageIndex].GetVkBuffer(), 0, 1,
+                                      sizeof(VkDrawMeshTasksIndirectCommandEXT));
+#endif
+
+        statisticsQuery.End(commandBuffer);
         durationQuery.EndTimestamp(commandBuffer, vk::PipelineStageFlagBits::eEarlyFragmentTests);
     }
 
     // {
+    //     InitializeBoundsPipeline();
+    //     m_BoundsPipelineBuild.get();
+    //
     //     commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_BoundsPipeline);
     //     commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_BoundsPipelineLayout, 0, 1,
     //                                      &m_MatrixDescriptorSets[imageIndex], 0, nullptr);
@@ -376,6 +781,7 @@ void LODApplication::DrawFrame()
     // }
 
     {
+        m_AxisPipelineBuild.get();
         commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_AxisPipeline);
         commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_AxisPipelineLayout, 0, 1,
                                          &m_MatrixDescriptorSets[imageIndex], 0, nullptr);
@@ -387,7 +793,7 @@ void LODApplication::DrawFrame()
     }
 
     {
-
+        m_FrustumPipelineBuild.get();
         commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_FrustumPipeline);
         commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_FrustumPipelineLayout, 0, 1,
                                          &m_MatrixDescriptorSets[imageIndex], 0, nullptr);
@@ -399,7 +805,7 @@ void LODApplication::DrawFrame()
     }
 
     {
-        m_Renderer.ImGuiNewFrame(m_Window->GetWidth(), m_Window->GetHeight());
+        m_Renderer.ImGuiNewFrame(m_Renderer.GetWidth(), m_Renderer.GetHeight());
 
         static bool open = true;
 
@@ -410,14 +816,66 @@ void LODApplication::DrawFrame()
 
         if (ImGui::Begin("Instancing", &open))
         {
-            ImGui::Text("Task/Mesh Shader execution in ms: %.4f", m_Duration / 1000000.f);
-            ImGui::Text("Avg. Task/Mesh Shader execution in ms: %.4f", m_AvgDuration / 1000000.f);
+            ImGui::Text("LOD Prepass + Task/Mesh Shader execution in ms: %.4f", m_Duration / 1000000.f);
+            ImGui::Text("Avg. LOD Prepass + Task/Mesh Shader execution in ms: %.4f", m_AvgDuration / 1000000.f);
+            ImGui::Text("Instance buffer (%s) in MB: %.2f",
+                        m_InstanceFormat == EInstanceFormat::Packed ? "packed" : "mat4",
+                        m_Instances.GetInstanceBuffer().GetSize() / (1024.f * 1024.f));
+
+            const InstanceUploadStats& uploadStats = m_Instances.GetUploadStats();
+
+            ImGui::Text("Animated instances in %%");
+            ImGui::SliderInt("##Animated instances", &m_AnimatedPercent, 0, 100, "%d", ImGuiSliderFlags_AlwaysClamp);
+            ImGui::Text("Uploaded %u instances in %u regions (%.1f KB)", uploadStats.dirtyInstances,
+                        uploadStats.copyRegions, uploadStats.uploadedBytes / 1024.f);
+            ImGui::Text("Instance update CPU ms: %.3f, GPU ms: %.4f", m_UploadCpuMs, m_UploadGpuMs);
             ImGui::Text("Instance Count");
             ImGui::SliderInt("##Instance Count", &m_InstanceCount, 0, (int)m_InstanceCountMax, "%d",
                              ImGuiSliderFlags_AlwaysClamp);
 
             ImGui::Text("LOD Exponent");
-            ImGui::SliderFloat("##LOD Exponent", &lod_pc.lod_pow, 0, 1.f, "%.3f", ImGuiSliderFlags_AlwaysClamp);
+            ImGui::SliderFloat("##LOD Exponent", &lod_prepass_pc.lod_pow, 0, 1.f, "%.3f",
+                               ImGuiSliderFlags_AlwaysClamp);
+
+            ImGui::Text("Auto LOD");
+            ImGui::SameLine();
+
+            if (ImGui::Checkbox("##Auto LOD", &m_AutoLOD))
+            {
+                m_LODGovernor.Reset();
+            }
+
+            if (m_AutoLOD)
+            {
+                ImGui::Text("Target GPU time in ms");
+                ImGui::SliderFloat("##Target GPU time", &m_LODGovernor.GetSettings().targetMs, 0.1f, 20.f, "%.2f",
+                                   ImGuiSliderFlags_AlwaysClamp);
+                ImGui::Text("Governor: %s (avg. %.3f ms)", m_LODGovernor.GetStateName(),
+                            m_LODGovernor.GetSmoothedMs());
+            }
+
+            ImGui::Text("Impostor distance (0 - disabled)");
+            ImGui::SliderFloat("##Impostor distance", &lod_prepass_pc.impostor_distance, 0, 300.f, "%.1f",
+                               ImGuiSliderFlags_AlwaysClamp);
+
+            ImGui::Text("LOD hysteresis");
+            ImGui::SliderFloat("##LOD hysteresis", &lod_prepass_pc.lod_hysteresis, 0, 1.f, "%.2f",
+                               ImGuiSliderFlags_AlwaysClamp);
+            ImGui::Text("Impostor hysteresis");
+            ImGui::SliderFloat("##Impostor hysteresis", &lod_prepass_pc.impostor_hysteresis, 0, 20.f, "%.1f",
+                               ImGuiSliderFlags_AlwaysClamp);
+            ImGui::Text("LOD transitions per frame: %u", m_LODTransitions);
+
+            ImGui::Text("Sort by depth");
+            ImGui::SameLine();
+            ImGui::Checkbox("##Sort by depth", &m_SortByDepth);
+            ImGui::Text("Fragment invocations: %llu", (unsigned long long)m_FragmentInvocations);
+            ImGui::Text("Unsorted: %llu, sorted: %llu", (unsigned long long)m_SortFragmentInvocations[0],
+                        (unsigned long long)m_SortFragmentInvocations[1]);
+
+            ImGui::Text("Transform cache");
+            ImGui::SameLine();
+            ImGui::Checkbox("##Transform cache", &m_UseTransformCache);
 
             ImGui::Text("Enable culling");
             ImGui::SameLine();
@@ -425,6 +883,7 @@ void LODApplication::DrawFrame()
             if (ImGui::Checkbox("##Enable culling", &m_EnableCulling))
             {
                 lod_pc.enable_culling = m_EnableCulling;
+                lod_prepass_pc.enable_culling = m_EnableCulling;
             };
 
             ImGui::Text("Posses Preview Camera");
@@ -486,7 +945,38 @@ void LODApplication::DrawFrame()
     }
 
     uint32_t endDrawResult = m_Renderer.EndDraw();
-    m_AccDuration += m_Duration = durationQuery.GetResults();
+
+    // The startup lasts until the first frame, which had to wait for its pipelines.
+    if (!m_IsStartupLogged)
+    {
+        m_Renderer.EndPipelineCreation();
+        m_IsStartupLogged = true;
+    }
+
+    m_HasFrameResults[imageIndex] = true;
+
+    if (endDrawResult == -1)
+    {
+        m_FramebufferResized = true;
+        RecreateSwapchain();
+        return;
+    }
+}
+
+void LODApplication::ReadFrameResults(const uint32_t frameIndex)
+{
+    m_AccDuration += m_Duration = m_DurationQueries[frameIndex]->GetResults();
+    m_UploadGpuMs = m_UploadQueries[frameIndex]->GetResults() / 1000000.f;
+
+    m_FragmentInvocations = m_StatisticsQueries[frameIndex]->GetResults()[0];
+    m_SortFragmentInvocations[m_SortByDepth ? 1 : 0] = m_FragmentInvocations;
+
+    m_LODTransitions = static_cast<const LODStats*>(m_LODStatsReadbacks[frameIndex].GetData())->transitionCount;
+
+    if (m_AutoLOD)
+    {
+        lod_prepass_pc.lod_pow = m_LODGovernor.Update(m_Duration, lod_prepass_pc.lod_pow);
+    }
 
     m_Counter++;
     m_Counter %= 180;
@@ -506,25 +996,18 @@ void LODApplication::DrawFrame()
         // }
         m_AccDuration = 0;
     }
-
-    if (endDrawResult == -1)
-    {
-        m_FramebufferResized = true;
-        RecreateSwapchain();
-        return;
-    }
 }
 
 void LODApplication::Loop()
 {
-    if (m_Window == nullptr)
+    if (m_Window == nullptr && !m_Renderer.IsHeadless())
     {
         throw std::runtime_error("Failed to run the App! The window is NULL!");
     }
 
-    while (!m_Window->ShouldClose())
+    while (!m_Renderer.ShouldClose())
     {
-        glfwPollEvents();
+        m_Renderer.PollEvents();
         DrawFrame();
     }
 }
@@ -534,7 +1017,10 @@ void LODApplication::Shutdown()
 
     VkCore::Device& device = VkCore::DeviceManager::GetDevice();
 
-    m_Renderer.m_Swapchain.Destroy();
+    device.WaitIdle();
+
+    // None of the pipelines may still be in the making when they are destroyed.
+    m_PipelineFactory.Destroy();
 
     device.DestroyPipeline(m_AxisPipeline);
     device.DestroyPipelineLayout(m_AxisPipelineLayout);
@@ -548,8 +1034,40 @@ void LODApplication::Shutdown()
     device.DestroyPipeline(m_FrustumPipeline);
     device.DestroyPipelineLayout(m_FrustumPipelineLayout);
 
+    device.DestroyPipeline(m_LODPrepassPipeline);
+    device.DestroyPipelineLayout(m_LODPrepassPipelineLayout);
+
+    device.DestroyPipeline(m_LODFinalizePipeline);
+    device.DestroyPipelineLayout(m_LODFinalizePipelineLayout);
+
+    device.DestroyPipeline(m_ImpostorPipeline);
+    device.DestroyPipelineLayout(m_ImpostorPipelineLayout);
+
+    m_ImpostorAtlas.Destroy();
+    m_DepthSort.Destroy();
+
     m_Model->Destroy();
 
+    m_Instances.Destroy();
+    m_LODStateBuffer.Destroy();
+    m_LODInfoBuffer.Destroy();
+
+    for (uint32_t i = 0; i < m_TaskIndirectCmds.size(); i++)
+    {
+        m_TaskIndirectCmds[i].Destroy();
+        m_LODBucketBuffers[i].Destroy();
+        m_LODInstanceBuffers[i].Destroy();
+        m_SortKeyBuffers[i].Destroy();
+        m_TransformCacheBuffers[i].Destroy();
+        m_ImpostorInstanceBuffers[i].Destroy();
+        m_LODStatsBuffers[i].Destroy();
+        m_LODStatsReadbacks[i].Destroy();
+    }
+
+    m_DurationQueries.clear();
+    m_UploadQueries.clear();
+    m_StatisticsQueries.clear();
+
     m_AxisBuffer.Destroy();
     m_AxisIndexBuffer.Destroy();
 
@@ -562,6 +1080,10 @@ void LODApplication::Shutdown()
     }
 
     device.DestroyDescriptorSetLayout(m_MatrixDescSetLayout);
+    device.DestroyDescriptorSetLayout(m_InstancesDescSetLayout);
+    device.DestroyDescriptorSetLayout(m_LODInfoSetLayout);
+    device.DestroyDescriptorSetLayout(m_LODDrawSetLayout);
+    device.DestroyDescriptorSetLayout(m_ImpostorSetLayout);
 
     m_DescriptorBuilder.Clear();
     m_DescriptorBuilder.Cleanup();
@@ -737,20 +1259,10 @@ bool LODApplication::OnKeyPressed(KeyPressedEvent& event)
 
 void LODApplication::RecreateSwapchain()
 {
+    // The pipelines are kept, the frames still in flight finish with the old swapchain.
+    m_Renderer.RecreateSwapchain();
 
-    VkCore::Device& device = VkCore::DeviceManager::GetDevice();
-
-    device.WaitIdle();
-    m_Window->WaitEvents();
-
-    m_Renderer.DestroySwapchain();
-    m_Renderer.DestroyFrameBuffers();
-
-    m_Window->RefreshResolution();
-    m_Renderer.CreateSwapchain(m_Window->GetWidth(), m_Window->GetHeight());
-    m_Renderer.CreateFramebuffers(m_Window->GetWidth(), m_Window->GetHeight());
-
-    m_Camera.RecreateProjection(m_Window->GetWidth(), m_Window->GetHeight());
+    m_Camera.RecreateProjection(m_Renderer.GetWidth(), m_Renderer.GetHeight());
 
     m_FramebufferResized = false;
 }
@@ -1,8 +1,19 @@
 #include <cstdint>
+#include <future>
+#include <memory>
 #include <vector>
 
 #include "../Model/PushConstants.h"
+#include "../../Common/Renderer/PipelineFactory.h"
 #include "../../Common/Renderer/VulkanRenderer.h"
+#include "../../Common/HostBuffer.h"
+#include "../../Common/Impostor/ImpostorAtlas.h"
+#include "../../Common/InstanceManager.h"
+#include "../../Common/InstanceTransform.h"
+#include "../../Common/LODGovernor.h"
+#include "../../Common/LODStats.h"
+#include "../../Common/Query.h"
+#include "../../Common/RadixSort.h"
 #include "Event/KeyEvent.h"
 #include "Event/MouseEvent.h"
 #include "Event/WindowEvent.h"
@@ -20,9 +31,11 @@ class LODApplication
   public:
     LODApplication() {};
 
-    void Run(const uint32_t winWidth, const uint32_t winHeight);
+    void Run(const LaunchOptions& options);
 
     void DrawFrame();
+    // Reads the results of the frame last recorded into the slot, once the slot is free again.
+    void ReadFrameResults(const uint32_t frameIndex);
     void Loop();
     void Shutdown();
 
@@ -31,9 +44,14 @@ class LODApplication
 	void InitializeBoundsPipeline();
 	void InitializeFrustumPipeline();
 	void InitializeInstancing();
+	void AnimateInstances(const float time);
+	void InitializeLODPrepass();
+	void InitializeImpostors();
 
     void RecreateSwapchain();
 
+	glm::vec3 GetGridPosition(const uint32_t index) const;
+
     void OnEvent(Event& event);
 
     bool OnMousePress(MouseButtonEvent& event);
@@ -61,6 +79,26 @@ class LODApplication
 	vk::Pipeline m_FrustumPipeline;
 	vk::PipelineLayout m_FrustumPipelineLayout;
 
+	vk::Pipeline m_LODPrepassPipeline;
+	vk::PipelineLayout m_LODPrepassPipelineLayout;
+
+	vk::Pipeline m_LODFinalizePipeline;
+	vk::PipelineLayout m_LODFinalizePipelineLayout;
+
+	vk::Pipeline m_ImpostorPipeline;
+	vk::PipelineLayout m_ImpostorPipelineLayout;
+
+    // Ready once the factory has built the pipelines above.
+    PipelineFactory m_PipelineFactory;
+    std::shared_future<void> m_AxisPipelineBuild;
+    std::shared_future<void> m_ModelPipelineBuild;
+    std::shared_future<void> m_BoundsPipelineBuild;
+    std::shared_future<void> m_FrustumPipelineBuild;
+    std::shared_future<void> m_LODPrepassPipelineBuild;
+    std::shared_future<void> m_LODFinalizePipelineBuild;
+    std::shared_future<void> m_ImpostorPipelineBuild;
+    bool m_IsStartupLogged = false;
+
     std::vector<VkCore::Buffer> m_MatBuffers;
     std::vector<vk::DescriptorSet> m_MatrixDescriptorSets;
     vk::DescriptorSetLayout m_MatrixDescSetLayout;
@@ -71,13 +109,60 @@ class LODApplication
 	VkCore::Buffer m_FrustumBuffer;
 	VkCore::Buffer m_FrustumIndexBuffer;
 
-	VkCore::Buffer m_InstancesBuffer;
+	// Compressed transforms halve the instance buffer, Mat4 keeps the full matrices.
+	EInstanceFormat m_InstanceFormat = EInstanceFormat::Packed;
+	InstanceManager m_Instances;
+	std::vector<InstanceHandle> m_InstanceHandles;
+	// Conservative bounding sphere (xyz - center, w - radius) of the model in instance space. Only used to reject
+	// whole instances, the task shader still culls the individual meshlets.
+	glm::vec4 m_InstanceBounds = glm::vec4(0.f, 0.f, 0.f, 1.f);
 	vk::DescriptorSet m_InstancesDescSet;
 	vk::DescriptorSetLayout m_InstancesDescSetLayout;
 
+	// LOD every instance was last drawn with, bound next to the instances. Kept across the frames for the hysteresis.
+	VkCore::Buffer m_LODStateBuffer;
+
+	// Copy of the LOD mesh info, readable by the LOD prepass.
+	VkCore::Buffer m_LODInfoBuffer;
+	vk::DescriptorSet m_LODInfoSet;
+	vk::DescriptorSetLayout m_LODInfoSetLayout;
+
+	// Per frame task dispatches, LOD buckets and bucketed instance indices written by the LOD prepass.
+	std::vector<VkCore::Buffer> m_TaskIndirectCmds;
+	// Most task commands the flattened task workgroups of a frame can be split into.
+	uint32_t m_TaskCmdCapacity = 0;
+	std::vector<VkCore::Buffer> m_LODBucketBuffers;
+	std::vector<VkCore::Buffer> m_LODInstanceBuffers;
+	// View depth of the bucketed instances. Sorting by it orders the instances of every LOD bucket front-to-back.
+	std::vector<VkCore::Buffer> m_SortKeyBuffers;
+	RadixSort m_DepthSort;
+	bool m_SortByDepth = true;
+	// Clip space and normal matrices of the visible instances, computed by the prepass for the mesh shader.
+	std::vector<VkCore::Buffer> m_TransformCacheBuffers;
+	bool m_UseTransformCache = true;
+	std::vector<vk::DescriptorSet> m_LODDrawSets;
+	vk::DescriptorSetLayout m_LODDrawSetLayout;
+
+	// Per frame LOD statistics of the prepass and their host visible copies.
+	std::vector<VkCore::Buffer> m_LODStatsBuffers;
+	std::vector<HostBuffer> m_LODStatsReadbacks;
+	std::vector<bool> m_HasFrameResults;
+
+	// Per frame queries, read once the timeline has passed the frame instead of right after its submission.
+	std::vector<std::unique_ptr<DurationQuery>> m_DurationQueries;
+	std::vector<std::unique_ptr<DurationQuery>> m_UploadQueries;
+	std::vector<std::unique_ptr<PipelineStatisticsQuery>> m_StatisticsQueries;
+
+	// Impostor LOD. The prepass appends the instances beyond the impostor distance to the per frame impostor lists.
+	ImpostorAtlas m_ImpostorAtlas;
+	std::vector<VkCore::Buffer> m_ImpostorInstanceBuffers;
+	std::vector<vk::DescriptorSet> m_ImpostorSets;
+	vk::DescriptorSetLayout m_ImpostorSetLayout;
+
     glm::vec2 angles = {0.f, 0.f};
 
     LodPC lod_pc;
+    LodPrepassPC lod_prepass_pc;
 
 	glm::uvec2 m_InstanceSize = glm::uvec3(200);
 	const uint32_t m_InstanceCountMax = m_InstanceSize.x * m_InstanceSize.y;
@@ -105,6 +190,21 @@ class LODApplication
 	int m_InstanceCount = 30000;
 	glm::vec3 m_Position;
 
+	// Tunes the LOD exponent from the measured GPU time when enabled.
+	LODGovernor m_LODGovernor;
+	bool m_AutoLOD = false;
+
+	uint32_t m_LODTransitions = 0;
+
+	// Fragment shader invocations of the last frame, and of the last frames drawn unsorted and sorted by depth.
+	uint64_t m_FragmentInvocations = 0;
+	uint64_t m_SortFragmentInvocations[2] = {};
+
+	// Instance update benchmark
+	int m_AnimatedPercent = 0;
+	float m_UploadCpuMs = 0.f;
+	float m_UploadGpuMs = 0.f;
+
 	uint64_t m_Duration = 0;
 	uint64_t m_AvgDuration = 0;
 	uint64_t m_AccDuration = 0;
@@ -115,6 +215,8 @@ class LODApplication
     PFN_vkCmdDrawMeshTasksNV vkCmdDrawMeshTasksNv;
 #else
     PFN_vkCmdDrawMeshTasksEXT vkCmdDrawMeshTasksEXT;
+    PFN_vkCmdDrawMeshTasksIndirectCountEXT vkCmdDrawMeshTasksIndirectCountEXT;
+    PFN_vkCmdDrawMeshTasksIndirectEXT vkCmdDrawMeshTasksIndirectEXT;
 #endif
 
 
@@ -10,5 +10,5 @@ int main(int argc, char* argv[])
 	VertexTriangleAdjacency adj = MeshUtils::BuildVertexTriangleAdjacency(indices, 10);
 
     LODApplication app = LODApplication();
-    app.Run(1280, 720);
+    app.Run(ParseLaunchOptions(argc, argv));
 }
@@ -19,6 +19,33 @@ struct LodPC {
     glm::mat4 rotation_mat = glm::identity<glm::mat4>();
     glm::mat4 scale_mat = glm::identity<glm::mat4>();
 	uint32_t meshlet_count = 0;
+	uint32_t max_instance_count = 0;
+	uint32_t enable_culling = true;
+	uint32_t packed_instances = false;
+	// Reads the transforms written by the prepass instead of computing them in the mesh shader.
+	uint32_t use_transform_cache = true;
+};
+
+// Push constant of the compute pass which selects the LOD of every instance and buckets the instances by it.
+struct LodPrepassPC {
+	uint32_t instance_count = 0;
+	uint32_t max_instance_count = 0;
 	float lod_pow = 0.7f;
 	uint32_t enable_culling = true;
+	// Distance from which the instances are drawn as impostors. Zero disables the impostor LOD.
+	float impostor_distance = 30.f;
+	// Margin in LOD levels by which the continuous LOD has to leave the range of the current LOD of an instance
+	// before the instance switches to another one.
+	float lod_hysteresis = 0.25f;
+	// Distance by which an impostor has to come closer than the impostor distance before it gets its mesh back.
+	float impostor_hysteresis = 2.f;
+	uint32_t packed_instances = false;
+	// Workgroups of a single task command and the number of the commands, used by the finalize pass to split the
+	// flattened task workgroups.
+	uint32_t max_task_groups = 0;
+	uint32_t max_task_cmds = 0;
+	// Writes the transforms of the visible instances for the mesh shader. Has to match LodPC::use_transform_cache.
+	uint32_t write_transform_cache = true;
+	// Rotation and scale of the LOD push constant, applied on top of every instance transform.
+	alignas(16) glm::mat4 model_mat = glm::identity<glm::mat4>();
 };
@@ -86,6 +86,9 @@ project("MeshLOD")
 	filter("options:with-vulkan")
 		defines{ "VK_MESH_EXT"}
 
+	filter("options:with-dedicated-queues")
+		defines{ "VK_DEDICATED_QUEUES"}
+
 	filter("options:sanitize")
 		buildoptions { "-fsanitize=address -lasan"}
 		linkoptions { "-fsanitize=address -lasan"}
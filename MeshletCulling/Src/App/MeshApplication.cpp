@@ -1,5 +1,6 @@
 #include "MeshApplication.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
 #include <cstdio>
@@ -8,20 +9,15 @@
 #include <stdexcept>
 #include <tuple>
 
+#include "../../Common/Renderer/PipelineBuilder.h"
 #include "GLFW/glfw3.h"
 #include "Log/Log.h"
 #include "Model/Camera.h"
 #include "Model/MatrixBuffer.h"
-#include "Model/Shaders/ShaderData.h"
-#include "Model/Shaders/ShaderLoader.h"
 #include "Vk/Buffers/Buffer.h"
 #include "Vk/Descriptors/DescriptorBuilder.h"
 #include "Vk/Devices/DeviceManager.h"
-#include "Vk/GraphicsPipeline/GraphicsPipelineBuilder.h"
-#include "Vk/Swapchain.h"
-#include "Vk/SwapchainRenderPass.h"
 #include "Vk/Utils.h"
-#include "Vk/Vertex/VertexAttributeBuilder.h"
 #include "glm/ext/matrix_transform.hpp"
 #include "glm/ext/vector_float3.hpp"
 #include "imgui.h"
@@ -32,14 +28,21 @@
 #include "vulkan/vulkan_structs.hpp"
 #include "glm/gtc/type_ptr.hpp"
 
-void MeshApplication::Run(const uint32_t winWidth, const uint32_t winHeight)
+// Id of the debug geometry among the static passes of the recorder.
+static constexpr uint32_t DEBUG_GEOMETRY_PASS = 0;
+
+void MeshApplication::Run(const LaunchOptions& options)
 {
     Logger::SetSeverityFilter(ESeverity::Verbose);
 
     std::cout << sizeof(Frustum) << std::endl;
 
-    m_Window = new VkCore::Window("Mesh Application", winWidth, winHeight);
-    m_Window->SetEventCallback(std::bind(&MeshApplication::OnEvent, this, std::placeholders::_1));
+    // The headless mode renders offscreen, without opening a window.
+    if (!options.headless)
+    {
+        m_Window = new VkCore::Window("Mesh Application", options.width, options.height);
+        m_Window->SetEventCallback(std::bind(&MeshApplication::OnEvent, this, std::placeholders::_1));
+    }
 
     m_Renderer = VulkanRenderer("Mesh Application", m_Window,
                                 {VK_KHR_SWAPCHAIN_EXTENSION_NAME, VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME,
@@ -50,8 +53,8 @@ void MeshApplication::Run(const uint32_t winWidth, const uint32_t winHeight)
                                  VK_EXT_MESH_SHADER_EXTENSION_NAME,
 #endif
                                  VK_KHR_SHADER_NON_SEMANTIC_INFO_EXTENSION_NAME},
-                                {});
-    m_Renderer.InitImGui(m_Window, winWidth, winHeight);
+                                {}, options);
+    m_Renderer.InitImGui(m_Window, m_Renderer.GetWidth(), m_Renderer.GetHeight());
 
 #ifndef VK_MESH_EXT
     vkCmdDrawMeshTasksNv =
@@ -61,8 +64,9 @@ void MeshApplication::Run(const uint32_t winWidth, const uint32_t winHeight)
         (PFN_vkCmdDrawMeshTasksEXT)vkGetDeviceProcAddr(*VkCore::DeviceManager::GetDevice(), "vkCmdDrawMeshTasksEXT");
 #endif
 
-    m_Camera = Camera({0.f, 0.f, -2.f}, {0.f, 0.f, 0.f}, (float)m_Window->GetWidth() / m_Window->GetHeight());
-    m_FrustumCamera = Camera({0.f, 0.f, -2.f}, {0.f, 0.f, 0.f}, (float)m_Window->GetWidth() / m_Window->GetHeight(), 45.f, 5.f);
+    m_Camera = Camera({0.f, 0.f, -2.f}, {0.f, 0.f, 0.f}, (float)m_Renderer.GetWidth() / m_Renderer.GetHeight());
+    m_FrustumCamera =
+        Camera({0.f, 0.f, -2.f}, {0.f, 0.f, 0.f}, (float)m_Renderer.GetWidth() / m_Renderer.GetHeight(), 45.f, 5.f);
 
     m_ZenithAngle = m_FrustumCamera.GetZenith();
     m_AzimuthAngle = m_FrustumCamera.GetAzimuth();
@@ -70,7 +74,7 @@ void MeshApplication::Run(const uint32_t winWidth, const uint32_t winHeight)
 
 
     // Create Uniform Buffers
-    for (int i = 0; i < m_Renderer.m_Swapchain.GetImageCount(); i++)
+    for (int i = 0; i < m_Renderer.GetFramesInFlight(); i++)
     {
         VkCore::Buffer matBuffer = VkCore::Buffer(vk::BufferUsageFlagBits::eUniformBuffer);
         matBuffer.InitializeOnCpu(sizeof(FrustumMatrixBuffer));
@@ -81,7 +85,7 @@ void MeshApplication::Run(const uint32_t winWidth, const uint32_t winHeight)
     // Camera Matrix Descriptor Sets
     VkCore::DescriptorBuilder descriptorBuilder(VkCore::DeviceManager::GetDevice());
 
-    for (uint32_t i = 0; i < m_Renderer.m_Swapchain.GetImageCount(); i++)
+    for (uint32_t i = 0; i < m_Renderer.GetFramesInFlight(); i++)
     {
         vk::DescriptorSet tempSet;
 
@@ -94,42 +98,52 @@ void MeshApplication::Run(const uint32_t winWidth, const uint32_t winHeight)
         m_MatrixDescriptorSets.emplace_back(tempSet);
     }
 
+    m_PipelineFactory.Initialize();
+    m_Recorder.Initialize(m_Renderer.GetFramesInFlight(),
+                          VkCore::DeviceManager::GetPhysicalDevice().GetQueueFamilyIndices().m_GraphicsFamily.value());
+
+    // The pipelines are built on the workers, the first frame waits for them. The bounds pipeline is only used by the
+    // disabled bounds pass, so it's left to InitializeBoundsPipeline to build it once the pass is needed.
+    m_Renderer.BeginPipelineCreation();
     InitializeModelPipeline();
     InitializeAxisPipeline();
-    InitializeBoundsPipeline();
     InitializeFrustumPipeline();
 
     Loop();
+
+    m_Renderer.WriteHeadlessCapture();
     Shutdown();
 }
 
 void MeshApplication::InitializeModelPipeline()
 {
 
-    const std::vector<VkCore::ShaderData> shaders =
-        VkCore::ShaderLoader::LoadMeshShaders("MeshletCulling/Res/Shaders/mesh_shading");
-
+    // The model uploads its buffers through the graphics queue, so it's loaded on the main thread.
     m_Model = new Model("MeshletCulling/Res/Artwork/OBJs/kitten.obj");
 
-    // Pipeline
-    VkCore::GraphicsPipelineBuilder pipelineBuilder(VkCore::DeviceManager::GetDevice(), true);
-
-    m_ModelPipeline = pipelineBuilder.BindShaderModules(shaders)
-                          .BindRenderPass(m_Renderer.m_RenderPass.GetVkRenderPass())
-                          .EnableDepthTest()
-                          .AddViewport(glm::uvec4(0, 0, m_Window->GetWidth(), m_Window->GetHeight()))
-                          .FrontFaceDirection(vk::FrontFace::eClockwise)
-                          .SetCullMode(vk::CullModeFlagBits::eBack)
-                          .AddDisabledBlendAttachment()
-                          .AddDescriptorLayout(m_MatrixDescSetLayout)
-                          .AddDescriptorLayout(m_Model->GetMeshes()[0].GetDescriptorSetLayout())
-                          .AddPushConstantRange<FragmentPC>(vk::ShaderStageFlagBits::eFragment)
-                          .AddPushConstantRange<MeshPC>(
-                              vk::ShaderStageFlagBits::eMeshEXT | vk::ShaderStageFlagBits::eTaskEXT, sizeof(FragmentPC))
-                          .SetPrimitiveAssembly(vk::PrimitiveTopology::eTriangleList)
-                          .AddDynamicState(vk::DynamicState::eScissor)
-                          .AddDynamicState(vk::DynamicState::eViewport)
-                          .Build(m_ModelPipelineLayout);
+    m_ModelPipelineBuild = m_PipelineFactory.Submit([this, &pipelineCache = m_Renderer.GetPipelineCache()]() {
+        const std::vector<ShaderBinary> shaders = LoadMeshShaders("MeshletCulling/Res/Shaders/mesh_shading");
+
+        GraphicsPipelineBuilder pipelineBuilder(pipelineCache);
+
+        m_ModelPipeline =
+            pipelineBuilder.BindShaderModules(shaders)
+                .BindRenderPass(m_Renderer.GetVkRenderPass())
+                .EnableDepthTest()
+                .AddViewport(glm::uvec4(0, 0, m_Renderer.GetWidth(), m_Renderer.GetHeight()))
+                .FrontFaceDirection(vk::FrontFace::eClockwise)
+                .SetCullMode(vk::CullModeFlagBits::eBack)
+                .AddDisabledBlendAttachment()
+                .AddDescriptorLayout(m_MatrixDescSetLayout)
+                .AddDescriptorLayout(m_Model->GetMeshes()[0].GetDescriptorSetLayout())
+                .AddPushConstantRange<FragmentPC>(vk::ShaderStageFlagBits::eFragment)
+                .AddPushConstantRange<MeshPC>(vk::ShaderStageFlagBits::eMeshEXT | vk::ShaderStageFlagBits::eTaskEXT,
+                                              sizeof(FragmentPC))
+                .SetPrimitiveAssembly(vk::PrimitiveTopology::eTriangleList)
+                .AddDynamicState(vk::DynamicState::eScissor)
+                .AddDynamicState(vk::DynamicState::eViewport)
+                .Build(m_ModelPipelineLayout);
+    });
 }
 
 void MeshApplication::InitializeAxisPipeline()
@@ -149,86 +163,95 @@ void MeshApplication::InitializeAxisPipeline()
     m_AxisIndexBuffer = VkCore::Buffer(vk::BufferUsageFlagBits::eIndexBuffer);
     m_AxisIndexBuffer.InitializeOnGpu(&m_AxisIndexData, sizeof(uint32_t) * 6);
 
-    VkCore::VertexAttributeBuilder attributeBuilder{};
-
-    attributeBuilder.PushAttribute<float>(3);
-    attributeBuilder.SetBinding(0);
-
-    std::vector<VkCore::ShaderData> shaderData =
-        VkCore::ShaderLoader::LoadClassicShaders("MeshletCulling/Res/Shaders/axis");
-    VkCore::GraphicsPipelineBuilder pipelineBuilder(VkCore::DeviceManager::GetDevice());
-
-    m_AxisPipeline = pipelineBuilder.BindShaderModules(shaderData)
-                         .BindRenderPass(m_Renderer.m_RenderPass.GetVkRenderPass())
-                         .AddViewport(glm::uvec4(0, 0, m_Window->GetWidth(), m_Window->GetHeight()))
-                         .FrontFaceDirection(vk::FrontFace::eCounterClockwise)
-                         .SetCullMode(vk::CullModeFlagBits::eBack)
-                         .BindVertexAttributes(attributeBuilder)
-                         .AddDisabledBlendAttachment()
-                         .AddDescriptorLayout(m_MatrixDescSetLayout)
-                         .SetPrimitiveAssembly(vk::PrimitiveTopology::eLineList)
-                         .AddDynamicState(vk::DynamicState::eScissor)
-                         .AddDynamicState(vk::DynamicState::eViewport)
-                         .Build(m_AxisPipelineLayout);
+    m_AxisPipelineBuild = m_PipelineFactory.Submit([this, &pipelineCache = m_Renderer.GetPipelineCache()]() {
+        VertexLayout vertexLayout;
+
+        vertexLayout.PushAttribute<float>(3);
+        vertexLayout.SetBinding(0);
+
+        const std::vector<ShaderBinary> shaderData = LoadClassicShaders("MeshletCulling/Res/Shaders/axis");
+        GraphicsPipelineBuilder pipelineBuilder(pipelineCache);
+
+        m_AxisPipeline = pipelineBuilder.BindShaderModules(shaderData)
+                             .BindRenderPass(m_Renderer.GetVkRenderPass())
+                             .AddViewport(glm::uvec4(0, 0, m_Renderer.GetWidth(), m_Renderer.GetHeight()))
+                             .FrontFaceDirection(vk::FrontFace::eCounterClockwise)
+                             .SetCullMode(vk::CullModeFlagBits::eBack)
+                             .BindVertexAttributes(vertexLayout)
+                             .AddDisabledBlendAttachment()
+                             .AddDescriptorLayout(m_MatrixDescSetLayout)
+                             .SetPrimitiveAssembly(vk::PrimitiveTopology::eLineList)
+                             .AddDynamicState(vk::DynamicState::eScissor)
+                             .AddDynamicState(vk::DynamicState::eViewport)
+                             .Build(m_AxisPipelineLayout);
+    });
 }
 
 void MeshApplication::InitializeFrustumPipeline()
 {
     std::tie(m_FrustumBuffer, m_FrustumIndexBuffer) = m_FrustumCamera.ConstructFrustumModel();
 
-    VkCore::VertexAttributeBuilder attributeBuilder{};
-
-    attributeBuilder.PushAttribute<float>(3).PushAttribute<float>(3).PushAttribute<float>(3);
-    attributeBuilder.SetBinding(0);
-
-    std::vector<VkCore::ShaderData> shaderData =
-        VkCore::ShaderLoader::LoadClassicShaders("MeshletCulling/Res/Shaders/frustum");
-
-    VkCore::GraphicsPipelineBuilder pipelineBuilder(VkCore::DeviceManager::GetDevice());
-
-    m_FrustumPipeline = pipelineBuilder.BindShaderModules(shaderData)
-                            .BindRenderPass(m_Renderer.m_RenderPass.GetVkRenderPass())
-                            .AddViewport(glm::uvec4(0, 0, m_Window->GetWidth(), m_Window->GetHeight()))
-                            .FrontFaceDirection(vk::FrontFace::eCounterClockwise)
-                            .SetCullMode(vk::CullModeFlagBits::eNone)
-                            .BindVertexAttributes(attributeBuilder)
-                            .AddDisabledBlendAttachment()
-                            .SetLineWidth(2.f)
-                            .AddDescriptorLayout(m_MatrixDescSetLayout)
-                            .SetPrimitiveAssembly(vk::PrimitiveTopology::eLineList)
-                            .AddDynamicState(vk::DynamicState::eScissor)
-                            .AddDynamicState(vk::DynamicState::eViewport)
-                            .Build(m_FrustumPipelineLayout);
+    m_FrustumPipelineBuild = m_PipelineFactory.Submit([this, &pipelineCache = m_Renderer.GetPipelineCache()]() {
+        VertexLayout vertexLayout;
+
+        vertexLayout.PushAttribute<float>(3).PushAttribute<float>(3).PushAttribute<float>(3);
+        vertexLayout.SetBinding(0);
+
+        const std::vector<ShaderBinary> shaderData = LoadClassicShaders("MeshletCulling/Res/Shaders/frustum");
+
+        GraphicsPipelineBuilder pipelineBuilder(pipelineCache);
+
+        m_FrustumPipeline = pipelineBuilder.BindShaderModules(shaderData)
+                                .BindRenderPass(m_Renderer.GetVkRenderPass())
+                                .AddViewport(glm::uvec4(0, 0, m_Renderer.GetWidth(), m_Renderer.GetHeight()))
+                                .FrontFaceDirection(vk::FrontFace::eCounterClockwise)
+                                .SetCullMode(vk::CullModeFlagBits::eNone)
+                                .BindVertexAttributes(vertexLayout)
+                                .AddDisabledBlendAttachment()
+                                .SetLineWidth(2.f)
+                                .AddDescriptorLayout(m_MatrixDescSetLayout)
+                                .SetPrimitiveAssembly(vk::PrimitiveTopology::eLineList)
+                                .AddDynamicState(vk::DynamicState::eScissor)
+                                .AddDynamicState(vk::DynamicState::eViewport)
+                                .Build(m_FrustumPipelineLayout);
+    });
 }
 
 void MeshApplication::InitializeBoundsPipeline()
 {
 
+    // Built on the first use only, it's a debug view.
+    if (m_BoundsPipelineBuild.valid())
+    {
+        return;
+    }
+
     m_Sphere = SphereModel(Vec3f(0.f, 0.f, 0.f));
 
-    VkCore::VertexAttributeBuilder attributeBuilder;
-
-    attributeBuilder.PushAttribute<float>(3).PushAttribute<float>(3).PushAttribute<float>(3);
-
-    VkCore::GraphicsPipelineBuilder pipelineBuilder(VkCore::DeviceManager::GetDevice());
-
-    std::vector<VkCore::ShaderData> shaderData =
-        VkCore::ShaderLoader::LoadClassicShaders("MeshletCulling/Res/Shaders/bounds");
-
-    m_BoundsPipeline = pipelineBuilder.BindShaderModules(shaderData)
-                           .BindRenderPass(m_Renderer.m_RenderPass.GetVkRenderPass())
-                           .EnableDepthTest()
-                           .AddViewport(glm::uvec4(0, 0, m_Window->GetWidth(), m_Window->GetHeight()))
-                           .FrontFaceDirection(vk::FrontFace::eClockwise)
-                           .SetCullMode(vk::CullModeFlagBits::eNone)
-                           .BindVertexAttributes(attributeBuilder)
-                           .AddDisabledBlendAttachment()
-                           .AddDescriptorLayout(m_MatrixDescSetLayout)
-                           .AddDescriptorLayout(m_Model->GetMeshes()[0].GetDescriptorSetLayout())
-                           .SetPrimitiveAssembly(vk::PrimitiveTopology::eLineList)
-                           .AddDynamicState(vk::DynamicState::eScissor)
-                           .AddDynamicState(vk::DynamicState::eViewport)
-                           .Build(m_BoundsPipelineLayout);
+    m_BoundsPipelineBuild = m_PipelineFactory.Submit([this, &pipelineCache = m_Renderer.GetPipelineCache()]() {
+        VertexLayout vertexLayout;
+
+        vertexLayout.PushAttribute<float>(3).PushAttribute<float>(3).PushAttribute<float>(3);
+
+        GraphicsPipelineBuilder pipelineBuilder(pipelineCache);
+
+        const std::vector<ShaderBinary> shaderData = LoadClassicShaders("MeshletCulling/Res/Shaders/bounds");
+
+        m_BoundsPipeline = pipelineBuilder.BindShaderModules(shaderData)
+                               .BindRenderPass(m_Renderer.GetVkRenderPass())
+                               .EnableDepthTest()
+                               .AddViewport(glm::uvec4(0, 0, m_Renderer.GetWidth(), m_Renderer.GetHeight()))
+                               .FrontFaceDirection(vk::FrontFace::eClockwise)
+                               .SetCullMode(vk::CullModeFlagBits::eNone)
+                               .BindVertexAttributes(vertexLayout)
+                               .AddDisabledBlendAttachment()
+                               .AddDescriptorLayout(m_MatrixDescSetLayout)
+                               .AddDescriptorLayout(m_Model->GetMeshes()[0].GetDescriptorSetLayout())
+                               .SetPrimitiveAssembly(vk::PrimitiveTopology::eLineList)
+                               .AddDynamicState(vk::DynamicState::eScissor)
+                               .AddDynamicState(vk::DynamicState::eViewport)
+                               .Build(m_BoundsPipelineLayout);
+    });
 }
 
 void MeshApplication::DrawFrame()
@@ -243,7 +266,7 @@ void MeshApplication::DrawFrame()
         return;
     }
 
-	const double time = glfwGetTime();
+	const double time = m_Renderer.GetTime();
 
     m_Camera.Update();
 
@@ -265,91 +288,43 @@ void MeshApplication::DrawFrame()
     fragment_pc.cam_pos = m_Camera.GetPosition();
     fragment_pc.cam_view_dir = m_Camera.GetViewDirection();
 
-    m_Renderer.BeginDraw({0.3f, 0.f, 0.2f, 1.f}, m_Window->GetWidth(), m_Window->GetHeight());
+    m_Renderer.BeginCmdBuffer();
+    m_Renderer.BeginRenderPass({0.3f, 0.f, 0.2f, 1.f}, m_Renderer.GetWidth(), m_Renderer.GetHeight(),
+                               vk::SubpassContents::eSecondaryCommandBuffers);
 
     m_MatBuffers[imageIndex].UpdateData(&ubo);
 
     vk::CommandBuffer commandBuffer = m_Renderer.GetCurrentCmdBuffer();
 
-    vk::Rect2D scissor = vk::Rect2D({0, 0}, {m_Window->GetWidth(), m_Window->GetHeight()});
-    commandBuffer.setScissor(0, 1, &scissor);
+    // The workers only bind the pipelines, waiting for their builds is left to the main thread.
+    m_ModelPipelineBuild.get();
+    m_FrustumPipelineBuild.get();
+    m_AxisPipelineBuild.get();
 
-    vk::Viewport viewport = vk::Viewport(0, 0, m_Window->GetWidth(), m_Window->GetHeight(), 0, 1);
-    commandBuffer.setViewport(0, 1, &viewport);
+    m_Recorder.Begin(imageIndex, m_Renderer.GetVkRenderPass(), m_Renderer.GetWidth(), m_Renderer.GetHeight());
 
     {
+        // The meshes are split evenly among the workers.
+        const uint32_t meshCount = m_Model->GetMeshes().size();
+        const uint32_t meshesPerJob = (meshCount + m_Recorder.GetThreadCount() - 1) / m_Recorder.GetThreadCount();
 
-        commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_ModelPipeline);
-        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_ModelPipelineLayout, 0, 1,
-                                         &m_MatrixDescriptorSets[imageIndex], 0, nullptr);
-
-        commandBuffer.pushConstants(m_ModelPipelineLayout, vk::ShaderStageFlagBits::eFragment, 0, sizeof(FragmentPC),
-                                    &fragment_pc);
-
-        commandBuffer.pushConstants(m_ModelPipelineLayout,
-                                    vk::ShaderStageFlagBits::eMeshNV | vk::ShaderStageFlagBits ::eTaskEXT,
-                                    sizeof(FragmentPC), sizeof(MeshPC), &mesh_pc);
-
-        for (const Mesh& mesh : m_Model->GetMeshes())
+        for (uint32_t firstMesh = 0; firstMesh < meshCount; firstMesh += meshesPerJob)
         {
-            const vk::DescriptorSetLayout layout = mesh.GetDescriptorSetLayout();
-            const vk::DescriptorSet set = mesh.GetDescriptorSet();
-
-            mesh_pc.meshlet_count = mesh.GetMeshletCount();
+            const uint32_t lastMesh = std::min(firstMesh + meshesPerJob, meshCount);
 
-            commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_ModelPipelineLayout, 1, 1, &set, 0,
-                                             nullptr);
-
-#ifndef VK_MESH_EXT
-            vkCmdDrawMeshTasksNv(&*commandBuffer, mesh.GetMeshletCount(), 0);
-#else
-            vkCmdDrawMeshTasksEXT(&*commandBuffer, (mesh.GetMeshletCount() / 32) + 1, 1, 1);
-#endif
+            m_Recorder.Record([this, imageIndex, firstMesh, lastMesh](const vk::CommandBuffer& cmdBuffer) {
+                RecordModel(cmdBuffer, imageIndex, firstMesh, lastMesh);
+            });
         }
     }
 
-    // {
-    //     commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_BoundsPipeline);
-    //     commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_BoundsPipelineLayout, 0, 1,
-    //                                      &m_MatrixDescriptorSets[imageIndex], 0, nullptr);
-    //
-    //     commandBuffer.bindVertexBuffers(0, m_Sphere.m_Vertexbuffer.GetVkBuffer(), {0});
-    //     commandBuffer.bindIndexBuffer(m_Sphere.m_IndexBuffer.GetVkBuffer(), 0, vk::IndexType::eUint32);
-    //
-    //     for (const Mesh& mesh : m_Model->GetMeshes())
-    //     {
-    //         const vk::DescriptorSet& set = mesh.GetDescriptorSet();
-    //         commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_BoundsPipelineLayout, 1, 1, &set, 0,
-    //                                          nullptr);
-    //         commandBuffer.drawIndexed(m_Sphere.indices.size(), mesh.GetMeshletCount(), 0, 0, 0);
-    //     }
-    // }
+    // The frustum moves through the uniform buffer only, so the debug geometry is recorded once per slot.
+    m_Recorder.RecordStatic(DEBUG_GEOMETRY_PASS, [this, imageIndex](const vk::CommandBuffer& cmdBuffer) {
+        RecordDebugGeometry(cmdBuffer, imageIndex);
+    });
 
     {
-
-        commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_FrustumPipeline);
-        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_FrustumPipelineLayout, 0, 1,
-                                         &m_MatrixDescriptorSets[imageIndex], 0, nullptr);
-
-        commandBuffer.bindVertexBuffers(0, m_FrustumBuffer.GetVkBuffer(), {0});
-
-        commandBuffer.bindIndexBuffer(m_FrustumIndexBuffer.GetVkBuffer(), 0, vk::IndexType::eUint32);
-        commandBuffer.drawIndexed(32, 1, 0, 0, 0);
-    }
-
-    {
-        commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_AxisPipeline);
-        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_AxisPipelineLayout, 0, 1,
-                                         &m_MatrixDescriptorSets[imageIndex], 0, nullptr);
-
-        commandBuffer.bindVertexBuffers(0, m_AxisBuffer.GetVkBuffer(), {0});
-
-        commandBuffer.bindIndexBuffer(m_AxisIndexBuffer.GetVkBuffer(), 0, vk::IndexType::eUint32);
-        commandBuffer.drawIndexed(6, 1, 0, 0, 0);
-    }
-
-    {
-        m_Renderer.ImGuiNewFrame(m_Window->GetWidth(), m_Window->GetHeight());
+        m_Renderer.ImGuiNewFrame(m_Renderer.GetWidth(), m_Renderer.GetHeight());
 
         static bool open = true;
 
@@ -389,11 +364,23 @@ void MeshApplication::DrawFrame()
             ImGui::End();
         }
 
-        m_Renderer.ImGuiRender(commandBuffer);
+        // The UI is built on the main thread, only its draw data is recorded on a worker.
+        m_Renderer.ImGuiEndFrame();
+        m_Recorder.Record([this](const vk::CommandBuffer& cmdBuffer) { m_Renderer.ImGuiRecord(cmdBuffer); });
     }
 
+    m_Recorder.Execute(commandBuffer);
+    m_Renderer.ImGuiRenderPlatformWindows();
+
     uint32_t endDrawResult = m_Renderer.EndDraw();
 
+    // The startup lasts until the first frame, which had to wait for its pipelines.
+    if (!m_IsStartupLogged)
+    {
+        m_Renderer.EndPipelineCreation();
+        m_IsStartupLogged = true;
+    }
+
     if (endDrawResult == -1)
     {
         m_FramebufferResized = true;
@@ -402,16 +389,92 @@ void MeshApplication::DrawFrame()
     }
 }
 
+void MeshApplication::RecordModel(const vk::CommandBuffer& cmdBuffer, const uint32_t frameIndex,
+                                  const uint32_t firstMesh, const uint32_t lastMesh) const
+{
+    cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_ModelPipeline);
+    cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_ModelPipelineLayout, 0, 1,
+                                 &m_MatrixDescriptorSets[frameIndex], 0, nullptr);
+
+    cmdBuffer.pushConstants(m_ModelPipelineLayout, vk::ShaderStageFlagBits::eFragment, 0, sizeof(FragmentPC),
+                            &fragment_pc);
+
+    // Every job pushes the meshlet counts of its own meshes.
+    MeshPC meshPC = mesh_pc;
+
+    for (uint32_t i = firstMesh; i < lastMesh; i++)
+    {
+        const Mesh& mesh = m_Model->GetMeshes()[i];
+        const vk::DescriptorSet set = mesh.GetDescriptorSet();
+
+        meshPC.meshlet_count = mesh.GetMeshletCount();
+
+        cmdBuffer.pushConstants(m_ModelPipelineLayout,
+                                vk::ShaderStageFlagBits::eMeshNV | vk::ShaderStageFlagBits ::eTaskEXT,
+                                sizeof(FragmentPC), sizeof(MeshPC), &meshPC);
+
+        cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_ModelPipelineLayout, 1, 1, &set, 0, nullptr);
+
+#ifndef VK_MESH_EXT
+        vkCmdDrawMeshTasksNv(&*cmdBuffer, mesh.GetMeshletCount(), 0);
+#else
+        vkCmdDrawMeshTasksEXT(&*cmdBuffer, (mesh.GetMeshletCount() / 32) + 1, 1, 1);
+#endif
+    }
+}
+
+void MeshApplication::RecordDebugGeometry(const vk::CommandBuffer& cmdBuffer, const uint32_t frameIndex) const
+{
+    // {
+    //     cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_BoundsPipeline);
+    //     cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_BoundsPipelineLayout, 0, 1,
+    //                                  &m_MatrixDescriptorSets[frameIndex], 0, nullptr);
+    //
+    //     cmdBuffer.bindVertexBuffers(0, m_Sphere.m_Vertexbuffer.GetVkBuffer(), {0});
+    //     cmdBuffer.bindIndexBuffer(m_Sphere.m_IndexBuffer.GetVkBuffer(), 0, vk::IndexType::eUint32);
+    //
+    //     for (const Mesh& mesh : m_Model->GetMeshes())
+    //     {
+    //         const vk::DescriptorSet& set = mesh.GetDescriptorSet();
+    //         cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_BoundsPipelineLayout, 1, 1, &set, 0,
+    //                                      nullptr);
+    //         cmdBuffer.drawIndexed(m_Sphere.indices.size(), mesh.GetMeshletCount(), 0, 0, 0);
+    //     }
+    // }
+
+    {
+        cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_FrustumPipeline);
+        cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_FrustumPipelineLayout, 0, 1,
+                                     &m_MatrixDescriptorSets[frameIndex], 0, nullptr);
+
+        cmdBuffer.bindVertexBuffers(0, m_FrustumBuffer.GetVkBuffer(), {0});
+
+        cmdBuffer.bindIndexBuffer(m_FrustumIndexBuffer.GetVkBuffer(), 0, vk::IndexType::eUint32);
+        cmdBuffer.drawIndexed(32, 1, 0, 0, 0);
+    }
+
+    {
+        cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_AxisPipeline);
+        cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_AxisPipelineLayout, 0, 1,
+                                     &m_MatrixDescriptorSets[frameIndex], 0, nullptr);
+
+        cmdBuffer.bindVertexBuffers(0, m_AxisBuffer.GetVkBuffer(), {0});
+
+        cmdBuffer.bindIndexBuffer(m_AxisIndexBuffer.GetVkBuffer(), 0, vk::IndexType::eUint32);
+        cmdBuffer.drawIndexed(6, 1, 0, 0, 0);
+    }
+}
+
 void MeshApplication::Loop()
 {
-    if (m_Window == nullptr)
+    if (m_Window == nullptr && !m_Renderer.IsHeadless())
     {
         throw std::runtime_error("Failed to run the App! The window is NULL!");
     }
 
-    while (!m_Window->ShouldClose())
+    while (!m_Renderer.ShouldClose())
     {
-        glfwPollEvents();
+        m_Renderer.PollEvents();
         DrawFrame();
     }
 }
@@ -421,7 +484,11 @@ void MeshApplication::Shutdown()
 
     VkCore::Device& device = VkCore::DeviceManager::GetDevice();
 
-    m_Renderer.m_Swapchain.Destroy();
+    device.WaitIdle();
+
+    // None of the pipelines may still be in the making when they are destroyed.
+    m_PipelineFactory.Destroy();
+    m_Recorder.Destroy();
 
     device.DestroyPipeline(m_AxisPipeline);
     device.DestroyPipelineLayout(m_AxisPipelineLayout);
@@ -610,20 +677,10 @@ bool MeshApplication::OnKeyPressed(KeyPressedEvent& event)
 
 void MeshApplication::RecreateSwapchain()
 {
+    // The pipelines are kept, the frames still in flight finish with the old swapchain.
+    m_Renderer.RecreateSwapchain();
 
-    VkCore::Device& device = VkCore::DeviceManager::GetDevice();
-
-    device.WaitIdle();
-    m_Window->WaitEvents();
-
-    m_Renderer.DestroySwapchain();
-    m_Renderer.DestroyFrameBuffers();
-
-    m_Window->RefreshResolution();
-    m_Renderer.CreateSwapchain(m_Window->GetWidth(), m_Window->GetHeight());
-    m_Renderer.CreateFramebuffers(m_Window->GetWidth(), m_Window->GetHeight());
-
-    m_Camera.RecreateProjection(m_Window->GetWidth(), m_Window->GetHeight());
+    m_Camera.RecreateProjection(m_Renderer.GetWidth(), m_Renderer.GetHeight());
 
     m_FramebufferResized = false;
 }
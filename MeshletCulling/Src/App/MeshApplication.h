@@ -1,4 +1,5 @@
 #include <cstdint>
+#include <future>
 #include <vector>
 
 #include "../Model/PushConstants.h"
@@ -6,6 +7,8 @@
 #include "Event/MouseEvent.h"
 #include "Event/WindowEvent.h"
 #include "Mesh/Model.h"
+#include "../../Common/Renderer/ParallelRecorder.h"
+#include "../../Common/Renderer/PipelineFactory.h"
 #include "../../Common/Renderer/VulkanRenderer.h"
 #include "Model/Camera.h"
 #include "Model/MouseState.h"
@@ -20,7 +23,7 @@ class MeshApplication
   public:
     MeshApplication() {};
 
-    void Run(const uint32_t winWidth, const uint32_t winHeight);
+    void Run(const LaunchOptions& options);
 
     void DrawFrame();
     void Loop();
@@ -33,6 +36,11 @@ class MeshApplication
 
     void RecreateSwapchain();
 
+    // Records the meshes in [firstMesh, lastMesh) into a secondary buffer of the recorder.
+    void RecordModel(const vk::CommandBuffer& cmdBuffer, const uint32_t frameIndex, const uint32_t firstMesh,
+                     const uint32_t lastMesh) const;
+    void RecordDebugGeometry(const vk::CommandBuffer& cmdBuffer, const uint32_t frameIndex) const;
+
     void OnEvent(Event& event);
 
     bool OnMousePress(MouseButtonEvent& event);
@@ -59,6 +67,16 @@ class MeshApplication
 	vk::Pipeline m_BoundsPipeline;
 	vk::PipelineLayout m_BoundsPipelineLayout;
 
+    // Ready once the factory has built the pipelines above.
+    PipelineFactory m_PipelineFactory;
+    std::shared_future<void> m_AxisPipelineBuild;
+    std::shared_future<void> m_ModelPipelineBuild;
+    std::shared_future<void> m_FrustumPipelineBuild;
+    std::shared_future<void> m_BoundsPipelineBuild;
+    bool m_IsStartupLogged = false;
+
+    ParallelRecorder m_Recorder;
+
     std::vector<VkCore::Buffer> m_MatBuffers;
 
     std::vector<vk::DescriptorSet> m_MatrixDescriptorSets;
@@ -4,5 +4,5 @@
 int main(int argc, char* argv[])
 {
     MeshApplication app = MeshApplication();
-    app.Run(1280, 720);
+    app.Run(ParseLaunchOptions(argc, argv));
 }
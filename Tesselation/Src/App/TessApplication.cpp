@@ -7,21 +7,15 @@
 #include <stddef.h>
 #include <stdexcept>
 
+#include "../../Common/Renderer/PipelineBuilder.h"
 #include "GLFW/glfw3.h"
 #include "Log/Log.h"
 #include "Model/Camera.h"
 #include "Model/MatrixBuffer.h"
-#include "Model/Shaders/ShaderData.h"
-#include "Model/Shaders/ShaderLoader.h"
-#include "../../Common/Query.h"
 #include "Vk/Buffers/Buffer.h"
 #include "Vk/Descriptors/DescriptorBuilder.h"
 #include "Vk/Devices/DeviceManager.h"
-#include "Vk/GraphicsPipeline/GraphicsPipelineBuilder.h"
-#include "Vk/Swapchain.h"
-#include "Vk/SwapchainRenderPass.h"
 #include "Vk/Utils.h"
-#include "Vk/Vertex/VertexAttributeBuilder.h"
 #include "backends/imgui_impl_glfw.h"
 #include "glm/ext/vector_float3.hpp"
 #include "imgui.h"
@@ -32,7 +26,7 @@
 #include "vulkan/vulkan_structs.hpp"
 #include "glm/gtc/type_ptr.hpp"
 
-void TessApplication::Run(const uint32_t winWidth, const uint32_t winHeight)
+void TessApplication::Run(const LaunchOptions& options)
 {
     VkCore::DeviceManager::AddDeviceExtension(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
 
@@ -40,8 +34,12 @@ void TessApplication::Run(const uint32_t winWidth, const uint32_t winHeight)
 
     std::cout << sizeof(Frustum) << std::endl;
 
-    m_Window = new VkCore::Window("Mesh Application", winWidth, winHeight);
-    m_Window->SetEventCallback(std::bind(&TessApplication::OnEvent, this, std::placeholders::_1));
+    // The headless mode renders offscreen, without opening a window.
+    if (!options.headless)
+    {
+        m_Window = new VkCore::Window("Mesh Application", options.width, options.height);
+        m_Window->SetEventCallback(std::bind(&TessApplication::OnEvent, this, std::placeholders::_1));
+    }
 
     m_Renderer = VulkanRenderer("Mesh Application", m_Window,
                                 {VK_KHR_SWAPCHAIN_EXTENSION_NAME, VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME,
@@ -52,8 +50,8 @@ void TessApplication::Run(const uint32_t winWidth, const uint32_t winHeight)
                                  VK_EXT_MESH_SHADER_EXTENSION_NAME,
 #endif
                                  VK_KHR_SHADER_NON_SEMANTIC_INFO_EXTENSION_NAME},
-                                {});
-    m_Renderer.InitImGui(m_Window, winWidth, winHeight);
+                                {}, options);
+    m_Renderer.InitImGui(m_Window, m_Renderer.GetWidth(), m_Renderer.GetHeight());
 
 #ifndef VK_MESH_EXT
     vkCmdDrawMeshTasksNv =
@@ -67,10 +65,10 @@ void TessApplication::Run(const uint32_t winWidth, const uint32_t winHeight)
         (PFN_vkCmdSetPolygonModeEXT)vkGetDeviceProcAddr(*VkCore::DeviceManager::GetDevice(), "vkCmdSetPolygonModeEXT");
 
     m_Camera =
-        Camera({0.f, 1.f, -1.f}, {0.f, 0.f, 0.f}, (float)m_Window->GetWidth() / m_Window->GetHeight(), 45.f, 50.f);
+        Camera({0.f, 1.f, -1.f}, {0.f, 0.f, 0.f}, (float)m_Renderer.GetWidth() / m_Renderer.GetHeight(), 45.f, 50.f);
 
     // Create Uniform Buffers
-    for (int i = 0; i < m_Renderer.m_Swapchain.GetImageCount(); i++)
+    for (int i = 0; i < m_Renderer.GetFramesInFlight(); i++)
     {
         VkCore::Buffer matBuffer = VkCore::Buffer(vk::BufferUsageFlagBits::eUniformBuffer);
         matBuffer.InitializeOnCpu(sizeof(FrustumMatrixBuffer));
@@ -81,7 +79,7 @@ void TessApplication::Run(const uint32_t winWidth, const uint32_t winHeight)
     // Camera Matrix Descriptor Sets
     m_DescriptorBuilder = VkCore::DescriptorBuilder(VkCore::DeviceManager::GetDevice());
 
-    for (uint32_t i = 0; i < m_Renderer.m_Swapchain.GetImageCount(); i++)
+    for (uint32_t i = 0; i < m_Renderer.GetFramesInFlight(); i++)
     {
         vk::DescriptorSet tempSet;
 
@@ -94,82 +92,106 @@ void TessApplication::Run(const uint32_t winWidth, const uint32_t winHeight)
         m_MatrixDescriptorSets.emplace_back(tempSet);
     }
 
+    m_PipelineFactory.Initialize();
+
+    // The pipelines are built on the workers, the first frame waits for them.
+    m_Renderer.BeginPipelineCreation();
     InitializeNoisePipeline();
     InitializeTessPipeline();
     InitializeAxisPipeline();
 
     Loop();
+
+    m_Renderer.WriteHeadlessCapture();
     Shutdown();
 }
 
 void TessApplication::InitializeTessPipeline()
 {
-
-    const std::vector<VkCore::ShaderData> shaders =
-        VkCore::ShaderLoader::LoadMeshShaders("Tesselation/Res/Shaders/tesselation", false);
-
-    VkCore::GraphicsPipelineBuilder pipelineBuilder(VkCore::DeviceManager::GetDevice(), true);
-
-    vk::PipelineColorBlendAttachmentState blendAttachment;
-
-    blendAttachment.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
-                                     vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
-    blendAttachment.blendEnable = true;
-    blendAttachment.srcColorBlendFactor = vk::BlendFactor::eSrcAlpha;
-    blendAttachment.dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
-    blendAttachment.colorBlendOp = vk::BlendOp::eAdd;
-    blendAttachment.srcAlphaBlendFactor = vk::BlendFactor::eOne;
-    blendAttachment.dstAlphaBlendFactor = vk::BlendFactor::eZero;
-    blendAttachment.alphaBlendOp = vk::BlendOp::eAdd;
-
-    m_WaterPipeline = pipelineBuilder.BindShaderModules(shaders)
-                          .BindRenderPass(m_Renderer.m_RenderPass.GetVkRenderPass())
-                          .EnableDepthTest()
-                          .AddViewport(glm::uvec4(0, 0, m_Window->GetWidth(), m_Window->GetHeight()))
-                          .FrontFaceDirection(vk::FrontFace::eClockwise)
-                          .SetCullMode(vk::CullModeFlagBits::eNone)
-                          .AddBlendAttachment(blendAttachment)
-                          .AddDescriptorLayout(m_MatrixDescSetLayout)
-                          .AddDescriptorLayout(m_MeshNoiseSetLayout)
-                          .AddPushConstantRange<FragmentPC>(vk::ShaderStageFlagBits::eFragment)
-                          .AddPushConstantRange<TessPC>(vk::ShaderStageFlagBits::eTaskEXT)
-                          .SetPrimitiveAssembly(vk::PrimitiveTopology::eTriangleList)
-                          .AddDynamicState(vk::DynamicState::eScissor)
-                          .AddDynamicState(vk::DynamicState::eViewport)
-                          .AddDynamicState(vk::DynamicState::ePolygonModeEXT)
-                          .Build(m_WaterPipelineLayout);
+    m_WaterPipelineBuild = m_PipelineFactory.Submit([this, &pipelineCache = m_Renderer.GetPipelineCache()]() {
+        const std::vector<ShaderBinary> shaders = LoadMeshShaders("Tesselation/Res/Shaders/tesselation");
+
+        GraphicsPipelineBuilder pipelineBuilder(pipelineCache);
+
+        vk::PipelineColorBlendAttachmentState blendAttachment;
+
+        blendAttachment.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+                                         vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+        blendAttachment.blendEnable = true;
+        blendAttachment.srcColorBlendFactor = vk::BlendFactor::eSrcAlpha;
+        blendAttachment.dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
+        blendAttachment.colorBlendOp = vk::BlendOp::eAdd;
+        blendAttachment.srcAlphaBlendFactor = vk::BlendFactor::eOne;
+        blendAttachment.dstAlphaBlendFactor = vk::BlendFactor::eZero;
+        blendAttachment.alphaBlendOp = vk::BlendOp::eAdd;
+
+        m_WaterPipeline = pipelineBuilder.BindShaderModules(shaders)
+                              .BindRenderPass(m_Renderer.GetVkRenderPass())
+                              .EnableDepthTest()
+                              .AddViewport(glm::uvec4(0, 0, m_Renderer.GetWidth(), m_Renderer.GetHeight()))
+                              .FrontFaceDirection(vk::FrontFace::eClockwise)
+                              .SetCullMode(vk::CullModeFlagBits::eNone)
+                              .AddBlendAttachment(blendAttachment)
+                              .AddDescriptorLayout(m_MatrixDescSetLayout)
+                              .AddDescriptorLayout(m_MeshNoiseSetLayout)
+                              .AddPushConstantRange<FragmentPC>(vk::ShaderStageFlagBits::eFragment)
+                              .AddPushConstantRange<TessPC>(vk::ShaderStageFlagBits::eTaskEXT)
+                              .SetPrimitiveAssembly(vk::PrimitiveTopology::eTriangleList)
+                              .AddDynamicState(vk::DynamicState::eScissor)
+                              .AddDynamicState(vk::DynamicState::eViewport)
+                              .AddDynamicState(vk::DynamicState::ePolygonModeEXT)
+                              .Build(m_WaterPipelineLayout);
+    });
 }
 
 void TessApplication::InitializeNoisePipeline()
 {
-    const VkCore::ShaderData shader =
-        VkCore::ShaderLoader::LoadComputeShader("Tesselation/Res/Shaders/noise/noise.comp", false);
-
-    VkCore::ComputePipelineBuilder pipelineBuilder{};
-
-    m_NoiseHeight.InitializeOnTheGpu(m_NoiseResolution, m_NoiseResolution, vk::Format::eR32Sfloat);
-    m_NoiseNormals.InitializeOnTheGpu(m_NoiseResolution, m_NoiseResolution, vk::Format::eR32G32B32A32Sfloat);
-
-    vk::DescriptorImageInfo descHeight = m_NoiseHeight.CreateDescriptorImageInfo(vk::ImageLayout::eGeneral);
-    vk::DescriptorImageInfo descNormals = m_NoiseNormals.CreateDescriptorImageInfo(vk::ImageLayout::eGeneral);
-
-    // Have to create 2 types of descriptor sets. One for the compute storage image and other for sampling (reading as a
-    // texture).
-    m_DescriptorBuilder.BindImage(0, descHeight, vk::DescriptorType::eStorageImage, vk::ShaderStageFlagBits::eCompute)
-        .BindImage(1, descNormals, vk::DescriptorType::eStorageImage, vk::ShaderStageFlagBits::eCompute)
-        .Build(m_ComputeNoiseSet, m_ComputeNoiseSetLayout);
-
-    m_DescriptorBuilder
-        .BindImage(0, descHeight, vk::DescriptorType::eCombinedImageSampler,
-                   vk::ShaderStageFlagBits::eMeshEXT | vk::ShaderStageFlagBits::eFragment)
-        .BindImage(1, descNormals, vk::DescriptorType::eCombinedImageSampler,
-                   vk::ShaderStageFlagBits::eMeshEXT | vk::ShaderStageFlagBits::eFragment)
-        .Build(m_MeshNoiseSet, m_MeshNoiseSetLayout);
-
-    m_ComputePipeline = pipelineBuilder.BindShaderModule(shader)
-                            .AddDescriptorLayout(m_ComputeNoiseSetLayout)
-                            .AddPushConstantRange<NoisePC>(vk::ShaderStageFlagBits::eCompute)
-                            .Build(m_ComputePipelineLayout);
+    // Every frame in flight has its own noise, so the noise of the next frame can be generated while the current one
+    // still samples its own.
+    m_NoiseHeights.resize(m_Renderer.GetFramesInFlight());
+    m_NoiseNormals.resize(m_Renderer.GetFramesInFlight());
+
+    for (uint32_t i = 0; i < m_Renderer.GetFramesInFlight(); i++)
+    {
+        m_NoiseHeights[i].Initialize(m_NoiseResolution, m_NoiseResolution, vk::Format::eR32Sfloat);
+        m_NoiseNormals[i].Initialize(m_NoiseResolution, m_NoiseResolution, vk::Format::eR32G32B32A32Sfloat);
+
+        vk::DescriptorImageInfo descHeight = m_NoiseHeights[i].CreateDescriptorImageInfo(vk::ImageLayout::eGeneral);
+        vk::DescriptorImageInfo descNormals = m_NoiseNormals[i].CreateDescriptorImageInfo(vk::ImageLayout::eGeneral);
+
+        vk::DescriptorSet computeSet, meshSet;
+
+        // Have to create 2 types of descriptor sets. One for the compute storage image and other for sampling
+        // (reading as a texture).
+        m_DescriptorBuilder
+            .BindImage(0, descHeight, vk::DescriptorType::eStorageImage, vk::ShaderStageFlagBits::eCompute)
+            .BindImage(1, descNormals, vk::DescriptorType::eStorageImage, vk::ShaderStageFlagBits::eCompute)
+            .Build(computeSet, m_ComputeNoiseSetLayout);
+
+        m_DescriptorBuilder
+            .BindImage(0, descHeight, vk::DescriptorType::eCombinedImageSampler,
+                       vk::ShaderStageFlagBits::eMeshEXT | vk::ShaderStageFlagBits::eFragment)
+            .BindImage(1, descNormals, vk::DescriptorType::eCombinedImageSampler,
+                       vk::ShaderStageFlagBits::eMeshEXT | vk::ShaderStageFlagBits::eFragment)
+            .Build(meshSet, m_MeshNoiseSetLayout);
+
+        m_ComputeNoiseSets.emplace_back(computeSet);
+        m_MeshNoiseSets.emplace_back(meshSet);
+
+        m_DurationQueries.emplace_back(std::make_unique<DurationQuery>());
+        m_HasFrameResults.emplace_back(false);
+    }
+
+    m_ComputePipelineBuild = m_PipelineFactory.Submit([this, &pipelineCache = m_Renderer.GetPipelineCache()]() {
+        const ShaderBinary shader = LoadShader("Tesselation/Res/Shaders/noise/noise.comp");
+
+        ComputePipelineBuilder pipelineBuilder(pipelineCache);
+
+        m_ComputePipeline = pipelineBuilder.BindShaderModule(shader)
+                                .AddDescriptorLayout(m_ComputeNoiseSetLayout)
+                                .AddPushConstantRange<NoisePC>(vk::ShaderStageFlagBits::eCompute)
+                                .Build(m_ComputePipelineLayout);
+    });
 }
 
 void TessApplication::InitializeAxisPipeline()
@@ -189,27 +211,28 @@ void TessApplication::InitializeAxisPipeline()
     m_AxisIndexBuffer = VkCore::Buffer(vk::BufferUsageFlagBits::eIndexBuffer);
     m_AxisIndexBuffer.InitializeOnGpu(&m_AxisIndexData, sizeof(uint32_t) * 6);
 
-    VkCore::VertexAttributeBuilder attributeBuilder{};
-
-    attributeBuilder.PushAttribute<float>(3);
-    attributeBuilder.SetBinding(0);
-
-    std::vector<VkCore::ShaderData> shaderData =
-        VkCore::ShaderLoader::LoadClassicShaders("Tesselation/Res/Shaders/axis");
-    VkCore::GraphicsPipelineBuilder pipelineBuilder(VkCore::DeviceManager::GetDevice());
-
-    m_AxisPipeline = pipelineBuilder.BindShaderModules(shaderData)
-                         .BindRenderPass(m_Renderer.m_RenderPass.GetVkRenderPass())
-                         .AddViewport(glm::uvec4(0, 0, m_Window->GetWidth(), m_Window->GetHeight()))
-                         .FrontFaceDirection(vk::FrontFace::eCounterClockwise)
-                         .SetCullMode(vk::CullModeFlagBits::eBack)
-                         .BindVertexAttributes(attributeBuilder)
-                         .AddDisabledBlendAttachment()
-                         .AddDescriptorLayout(m_MatrixDescSetLayout)
-                         .SetPrimitiveAssembly(vk::PrimitiveTopology::eLineList)
-                         .AddDynamicState(vk::DynamicState::eScissor)
-                         .AddDynamicState(vk::DynamicState::eViewport)
-                         .Build(m_AxisPipelineLayout);
+    m_AxisPipelineBuild = m_PipelineFactory.Submit([this, &pipelineCache = m_Renderer.GetPipelineCache()]() {
+        VertexLayout vertexLayout;
+
+        vertexLayout.PushAttribute<float>(3);
+        vertexLayout.SetBinding(0);
+
+        const std::vector<ShaderBinary> shaderData = LoadClassicShaders("Tesselation/Res/Shaders/axis");
+        GraphicsPipelineBuilder pipelineBuilder(pipelineCache);
+
+        m_AxisPipeline = pipelineBuilder.BindShaderModules(shaderData)
+                             .BindRenderPass(m_Renderer.GetVkRenderPass())
+                             .AddViewport(glm::uvec4(0, 0, m_Renderer.GetWidth(), m_Renderer.GetHeight()))
+                             .FrontFaceDirection(vk::FrontFace::eCounterClockwise)
+                             .SetCullMode(vk::CullModeFlagBits::eBack)
+                             .BindVertexAttributes(vertexLayout)
+                             .AddDisabledBlendAttachment()
+                             .AddDescriptorLayout(m_MatrixDescSetLayout)
+                             .SetPrimitiveAssembly(vk::PrimitiveTopology::eLineList)
+                             .AddDynamicState(vk::DynamicState::eScissor)
+                             .AddDynamicState(vk::DynamicState::eViewport)
+                             .Build(m_AxisPipelineLayout);
+    });
 }
 
 void TessApplication::DrawFrame()
@@ -224,7 +247,14 @@ void TessApplication::DrawFrame()
         return;
     }
 
-    noise_pc.time = glfwGetTime();
+    // The frame last recorded into this slot is finished by now, so its duration is read without stalling on the
+    // frames still in flight.
+    if (m_HasFrameResults[imageIndex])
+    {
+        m_Duration = m_DurationQueries[imageIndex]->GetResults();
+    }
+
+    noise_pc.time = m_Renderer.GetTime();
 
     m_Camera.Update();
 
@@ -239,44 +269,80 @@ void TessApplication::DrawFrame()
 
     m_MatBuffers[imageIndex].UpdateData(&ubo);
 
+    AsyncCompute& asyncCompute = m_Renderer.GetAsyncCompute();
+
+    StorageImage* const noiseImages[] = {&m_NoiseHeights[imageIndex], &m_NoiseNormals[imageIndex]};
+
+    // The noise handed over to the sampling, in the general layout on both queues.
+    std::vector<vk::ImageMemoryBarrier> noiseBarriers;
+
+    for (const StorageImage* image : noiseImages)
+    {
+        noiseBarriers.emplace_back(image->CreateImageMemoryBarrier(
+            vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead, vk::ImageLayout::eGeneral,
+            vk::ImageLayout::eGeneral));
+    }
+
+    {
+        // The noise is submitted ahead of the frame, so it's generated alongside the rasterization of the previous one.
+        const vk::CommandBuffer computeCmdBuffer = asyncCompute.Begin();
+
+        // The noise is generated anew, so the images are taken over from the sampling of their last frame without
+        // keeping the contents. The compute waits for that frame at all the stages, so the barrier is chained to it.
+        std::vector<vk::ImageMemoryBarrier> discardBarriers;
+
+        for (const StorageImage* image : noiseImages)
+        {
+            discardBarriers.emplace_back(image->CreateImageMemoryBarrier(
+                {}, vk::AccessFlagBits::eShaderWrite, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral));
+        }
+
+        computeCmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                         vk::PipelineStageFlagBits::eComputeShader, {}, {}, {}, discardBarriers);
+
+        m_ComputePipelineBuild.get();
+        computeCmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_ComputePipeline);
+        computeCmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_ComputePipelineLayout, 0, 1,
+                                            &m_ComputeNoiseSets[imageIndex], 0, nullptr);
+        computeCmdBuffer.pushConstants(m_ComputePipelineLayout, vk::ShaderStageFlagBits::eCompute, 0,
+                                       sizeof(NoisePC), &noise_pc);
+
+        computeCmdBuffer.dispatch(m_NoiseResolution / 8, m_NoiseResolution / 8, 1);
+
+        asyncCompute.ReleaseImages(computeCmdBuffer, noiseBarriers);
+        asyncCompute.Submit(vk::PipelineStageFlagBits::eTaskShaderEXT);
+    }
+
     m_Renderer.BeginCmdBuffer();
 
-    DurationQuery durationQuery;
+    DurationQuery& durationQuery = *m_DurationQueries[imageIndex];
 
     vk::CommandBuffer commandBuffer = m_Renderer.GetCurrentCmdBuffer();
     durationQuery.Reset(commandBuffer);
 
-    {
-        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_ComputePipeline);
-        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_ComputePipelineLayout, 0, 1,
-                                         &m_ComputeNoiseSet, 0, nullptr);
-        commandBuffer.pushConstants(m_ComputePipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(NoisePC),
-                                    &noise_pc);
-
-        commandBuffer.dispatch(m_NoiseResolution / 8, m_NoiseResolution / 8, 1);
-
-        m_NoiseNormals.TransitionToShaderRead(commandBuffer, vk::PipelineStageFlagBits::eComputeShader,
-                                              vk::PipelineStageFlagBits::eTaskShaderEXT);
-        m_NoiseHeight.TransitionToShaderRead(commandBuffer, vk::PipelineStageFlagBits::eComputeShader,
-                                             vk::PipelineStageFlagBits::eTaskShaderEXT);
-    }
+    // The frame waits for the noise at the task stage, which makes the writes visible to the sampling as well. The
+    // sampled descriptors are in the general layout like the storage ones, so the images are only acquired from a
+    // compute queue of another family.
+    asyncCompute.AcquireImages(commandBuffer, noiseBarriers,
+                               vk::PipelineStageFlagBits::eTaskShaderEXT | vk::PipelineStageFlagBits::eMeshShaderEXT |
+                                   vk::PipelineStageFlagBits::eFragmentShader);
 
-    vk::Rect2D scissor = vk::Rect2D({0, 0}, {m_Window->GetWidth(), m_Window->GetHeight()});
+    vk::Rect2D scissor = vk::Rect2D({0, 0}, {m_Renderer.GetWidth(), m_Renderer.GetHeight()});
     commandBuffer.setScissor(0, 1, &scissor);
 
-    vk::Viewport viewport = vk::Viewport(0, 0, m_Window->GetWidth(), m_Window->GetHeight(), 0, 1);
+    vk::Viewport viewport = vk::Viewport(0, 0, m_Renderer.GetWidth(), m_Renderer.GetHeight(), 0, 1);
     commandBuffer.setViewport(0, 1, &viewport);
 
-    m_Renderer.BeginRenderPass({0.3f, 0.f, 0.2f, 1.f}, m_Window->GetWidth(), m_Window->GetHeight());
+    m_Renderer.BeginRenderPass({0.3f, 0.f, 0.2f, 1.f}, m_Renderer.GetWidth(), m_Renderer.GetHeight());
 
     {
-
+        m_WaterPipelineBuild.get();
         commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_WaterPipeline);
         commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_WaterPipelineLayout, 0, 1,
                                          &m_MatrixDescriptorSets[imageIndex], 0, nullptr);
 
-        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_WaterPipelineLayout, 1, 1, &m_MeshNoiseSet,
-                                         0, nullptr);
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_WaterPipelineLayout, 1, 1,
+                                         &m_MeshNoiseSets[imageIndex], 0, nullptr);
 
         commandBuffer.pushConstants(m_WaterPipelineLayout, vk::ShaderStageFlagBits::eFragment, 0, sizeof(FragmentPC),
                                     &fragment_pc);
@@ -298,7 +364,7 @@ void TessApplication::DrawFrame()
     }
 
     {
-        m_Renderer.ImGuiNewFrame(m_Window->GetWidth(), m_Window->GetHeight());
+        m_Renderer.ImGuiNewFrame(m_Renderer.GetWidth(), m_Renderer.GetHeight());
 
         static bool open = true;
 
@@ -311,6 +377,8 @@ void TessApplication::DrawFrame()
         {
 
             ImGui::Text("Task/Mesh Shader execution in ms: %.4f", m_Duration / 1000000.f);
+            ImGui::Text("Noise compute %.3f ms, graphics %.3f ms, overlapped %.3f ms", asyncCompute.GetComputeMs(),
+                        asyncCompute.GetGraphicsMs(), asyncCompute.GetOverlapMs());
             ImGui::Text("Patch Count");
             ImGui::DragInt2("##Patch Count", glm::value_ptr(m_PatchCounts), 1.f, 1, 100, "%d",
                             ImGuiSliderFlags_AlwaysClamp);
@@ -348,14 +416,16 @@ void TessApplication::DrawFrame()
 
     m_Renderer.EndRenderPass();
 
-    m_NoiseNormals.TransitionToGeneral(commandBuffer, vk::PipelineStageFlagBits::eFragmentShader,
-                                       vk::PipelineStageFlagBits::eFragmentShader);
-    m_NoiseHeight.TransitionToGeneral(commandBuffer, vk::PipelineStageFlagBits::eFragmentShader,
-                                      vk::PipelineStageFlagBits::eFragmentShader);
-
     int endDrawResult = m_Renderer.EndCmdBuffer();
 
-    m_Duration = durationQuery.GetResults();
+    // The startup lasts until the first frame, which had to wait for its pipelines.
+    if (!m_IsStartupLogged)
+    {
+        m_Renderer.EndPipelineCreation();
+        m_IsStartupLogged = true;
+    }
+
+    m_HasFrameResults[imageIndex] = true;
 
     if (endDrawResult == -1)
     {
@@ -367,14 +437,14 @@ void TessApplication::DrawFrame()
 
 void TessApplication::Loop()
 {
-    if (m_Window == nullptr)
+    if (m_Window == nullptr && !m_Renderer.IsHeadless())
     {
         throw std::runtime_error("Failed to run the App! The window is NULL!");
     }
 
-    while (!m_Window->ShouldClose())
+    while (!m_Renderer.ShouldClose())
     {
-        glfwPollEvents();
+        m_Renderer.PollEvents();
         DrawFrame();
     }
 }
@@ -384,7 +454,10 @@ void TessApplication::Shutdown()
 
     VkCore::Device& device = VkCore::DeviceManager::GetDevice();
 
-    m_Renderer.m_Swapchain.Destroy();
+    device.WaitIdle();
+
+    // None of the pipelines may still be in the making when they are destroyed.
+    m_PipelineFactory.Destroy();
 
     device.DestroyPipeline(m_AxisPipeline);
     device.DestroyPipelineLayout(m_AxisPipelineLayout);
@@ -392,8 +465,17 @@ void TessApplication::Shutdown()
     device.DestroyPipeline(m_WaterPipeline);
     device.DestroyPipelineLayout(m_WaterPipelineLayout);
 
-    m_NoiseHeight.Destroy();
-    m_NoiseNormals.Destroy();
+    for (StorageImage& image : m_NoiseHeights)
+    {
+        image.Destroy();
+    }
+
+    for (StorageImage& image : m_NoiseNormals)
+    {
+        image.Destroy();
+    }
+
+    m_DurationQueries.clear();
 
     m_AxisBuffer.Destroy();
     m_AxisIndexBuffer.Destroy();
@@ -571,20 +653,10 @@ bool TessApplication::OnKeyPressed(KeyPressedEvent& event)
 
 void TessApplication::RecreateSwapchain()
 {
+    // The pipelines are kept, the frames still in flight finish with the old swapchain.
+    m_Renderer.RecreateSwapchain();
 
-    VkCore::Device& device = VkCore::DeviceManager::GetDevice();
-
-    device.WaitIdle();
-    m_Window->WaitEvents();
-
-    m_Renderer.DestroySwapchain();
-    m_Renderer.DestroyFrameBuffers();
-
-    m_Window->RefreshResolution();
-    m_Renderer.CreateSwapchain(m_Window->GetWidth(), m_Window->GetHeight());
-    m_Renderer.CreateFramebuffers(m_Window->GetWidth(), m_Window->GetHeight());
-
-    m_Camera.RecreateProjection(m_Window->GetWidth(), m_Window->GetHeight());
+    m_Camera.RecreateProjection(m_Renderer.GetWidth(), m_Renderer.GetHeight());
 
     m_FramebufferResized = false;
 }
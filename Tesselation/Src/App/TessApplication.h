@@ -1,7 +1,12 @@
 #include <cstdint>
+#include <future>
+#include <memory>
 #include <vector>
 
 #include "../Model/PushConstants.h"
+#include "../../Common/Query.h"
+#include "../../Common/StorageImage.h"
+#include "../../Common/Renderer/PipelineFactory.h"
 #include "../../Common/Renderer/VulkanRenderer.h"
 #include "Event/KeyEvent.h"
 #include "Event/MouseEvent.h"
@@ -12,14 +17,13 @@
 #include "vulkan/vulkan_core.h"
 #include "vulkan/vulkan_enums.hpp"
 #include "vulkan/vulkan_handles.hpp"
-#include "Vk/Texture/Image2D.h"
 
 class TessApplication
 {
   public:
     TessApplication() {};
 
-    void Run(const uint32_t winWidth, const uint32_t winHeight);
+    void Run(const LaunchOptions& options);
 
     void DrawFrame();
     void Loop();
@@ -55,6 +59,13 @@ class TessApplication
     vk::Pipeline m_ComputePipeline;
     vk::PipelineLayout m_ComputePipelineLayout;
 
+    // Ready once the factory has built the pipelines above. The axis pipeline isn't bound by any pass.
+    PipelineFactory m_PipelineFactory;
+    std::shared_future<void> m_AxisPipelineBuild;
+    std::shared_future<void> m_WaterPipelineBuild;
+    std::shared_future<void> m_ComputePipelineBuild;
+    bool m_IsStartupLogged = false;
+
     std::vector<VkCore::Buffer> m_MatBuffers;
     std::vector<vk::DescriptorSet> m_MatrixDescriptorSets;
     vk::DescriptorSetLayout m_MatrixDescSetLayout;
@@ -62,15 +73,20 @@ class TessApplication
     VkCore::Buffer m_AxisBuffer;
     VkCore::Buffer m_AxisIndexBuffer;
 
-    VkCore::Image2D m_NoiseHeight;
-    VkCore::Image2D m_NoiseNormals;
+    // One noise per frame in flight, handed over from the compute queue to the graphics one every frame.
+    std::vector<StorageImage> m_NoiseHeights;
+    std::vector<StorageImage> m_NoiseNormals;
 
-    vk::DescriptorSet m_ComputeNoiseSet;
+    std::vector<vk::DescriptorSet> m_ComputeNoiseSets;
     vk::DescriptorSetLayout m_ComputeNoiseSetLayout;
 
-    vk::DescriptorSet m_MeshNoiseSet;
+    std::vector<vk::DescriptorSet> m_MeshNoiseSets;
     vk::DescriptorSetLayout m_MeshNoiseSetLayout;
 
+    // Per frame GPU time of the task and mesh shaders, read once the slot comes around again.
+    std::vector<std::unique_ptr<DurationQuery>> m_DurationQueries;
+    std::vector<bool> m_HasFrameResults;
+
     // ImGui Params
     glm::ivec2 m_PatchCounts = {5, 5};
     VkPolygonMode m_PolygonMode = VK_POLYGON_MODE_FILL;
@@ -9,6 +9,11 @@ workspace("MeshAndTaskShaders")
 		description = "Compile project with Vulkan specific mesh shader extensions and shaders, leaving null compiles with Nvidia's features"
 	}
 
+	newoption {
+		trigger = "with-dedicated-queues",
+		description = "Submit the async compute and the uploads to the dedicated queue families, needs a VulkanCore creating the device with their queues"
+	}
+
 	newoption {
 		trigger = "sanitize",
 		description = "Compile the project with address sanitizing code for memory debugging purposes"
@@ -26,3 +31,5 @@ workspace("MeshAndTaskShaders")
     include("Tesselation")
     include("VulkanCore")
 
+	include("CompileShaders.lua")
+